@@ -2,6 +2,12 @@
 #include "AnimationController.h"
 #include "AnimationLayer.h"
 #include "AnimationKeyframe.h"
+#include "CapturedFrames.h"
+#include "FrameExporter.h"
+#include "ImageDownsampler.h"
+#include "MultiResolutionWriter.h"
+#include "PngEncoder.h"
+#include "SpriteSheetExporter.h"
 #include "../MainWindow.h"
 #include "../Timeline.h"
 #include "../Canvas.h"
@@ -22,6 +28,19 @@
 #include <QDir>
 #include <QProcess>
 #include <QStandardPaths>
+#include <QSysInfo>
+#include <QDebug>
+#include <QElapsedTimer>
+
+namespace {
+// Raw frames queued on ffmpeg's stdin before rendering waits for the encoder
+// (about eight 1080p frames)
+const qint64 kMaxQueuedEncoderBytes = 64LL * 1024 * 1024;
+const int kEncoderPollMs = 50;
+
+// Frames spread over the animation that a global GIF palette is built from
+const int kGifPaletteSamples = 4;
+}
 
 AnimationController::AnimationController(MainWindow* parent)
     : QObject(parent)
@@ -32,6 +51,9 @@ AnimationController::AnimationController(MainWindow* parent)
     , m_frameRate(24)
     , m_isPlaying(false)
     , m_currentLayer(0)
+    , m_exporter(nullptr)
+    , m_gifDither(GifEncoder::Dither::None)
+    , m_gifGlobalPalette(false)
 {
     // Setup playback timer
     m_playbackTimer = new QTimer(this);
@@ -41,8 +63,8 @@ AnimationController::AnimationController(MainWindow* parent)
     // Set initial timer interval based on frame rate
     setFrameRate(m_frameRate);
 
-    // Find timeline component
-    m_timeline = m_mainWindow->findChild<Timeline*>();
+    // Find timeline component; export jobs run without a main window
+    m_timeline = m_mainWindow ? m_mainWindow->findChild<Timeline*>() : nullptr;
 
     // Connect timeline signals if available
     if (m_timeline) {
@@ -331,76 +353,103 @@ void AnimationController::moveKeyframe(int fromFrame, int toFrame)
 
 bool AnimationController::exportAnimation(const QString& filename, const QString& format, int quality, bool loop)
 {
+    m_exportError.clear();
     if (filename.isEmpty()) {
         return false;
     }
 
-    // Get canvas for rendering
-    Canvas* canvas = m_mainWindow->findChild<Canvas*>();
-    if (!canvas || !canvas->scene()) {
-        QMessageBox::warning(m_mainWindow, "Export Error", "Cannot access canvas for export.");
+    const QString type = format.toLower();
+    if (type != "gif" && type != "png" && type != "sprites" && type != "mp4") {
+        m_exportError = "Unsupported export format: " + format;
         return false;
     }
 
-    QGraphicsScene* scene = canvas->scene();
-    // Use the canvas's defined rectangle to ensure export size matches the
-    // intended canvas dimensions (default 1920x1080) rather than expanding to
-    // include items that extend beyond the canvas area.
-    QRectF sceneRect = canvas->getCanvasRect();
+    // Export jobs hand in frames the GUI thread captures for them; otherwise
+    // capture them from the canvas here, as they are rendered. Sprite frames
+    // are trimmed, so they leave out the background.
+    CapturedFrames frames = m_capturedFrames;
+    if (frames.isEmpty()) {
+        Canvas* canvas = m_mainWindow ? m_mainWindow->findChild<Canvas*>() : nullptr;
+        if (!canvas || !canvas->scene()) {
+            m_exportError = "Cannot access canvas for export.";
+            return false;
+        }
+        frames = CapturedFrames::capture(canvas, 1, m_totalFrames, type != "sprites");
+    }
+
+    if (type == "gif") {
+        const bool exported = exportGif(frames, filename, loop);
+        emit exportProgress(m_totalFrames, m_totalFrames);
+        return exported;
+    }
+    if (type == "png") {
+        const bool exported = exportPngSequence(frames, filename);
+        emit exportProgress(m_totalFrames, m_totalFrames);
+        return exported;
+    }
+    if (type == "sprites") {
+        const bool exported = exportSpriteSheet(frames, filename);
+        emit exportProgress(m_totalFrames, m_totalFrames);
+        return exported;
+    }
+
+    // MP4 frames stream straight into ffmpeg; a PNG sequence on disk is only
+    // the fallback when the encoder cannot be started
+    bool encoderStarted = false;
+    const bool streamed = streamToMp4(frames, filename, quality, encoderStarted);
+    if (encoderStarted) {
+        emit exportProgress(m_totalFrames, m_totalFrames);
+        return streamed;
+    }
+    qDebug() << "Could not start" << ffmpegProgram() << "for streaming, exporting PNG frames instead";
 
     // Create temporary directory for frames
     QString tempDir = QStandardPaths::writableLocation(QStandardPaths::TempLocation) + "/framedirector_export";
     QDir().mkpath(tempDir);
 
-    QStringList frameFiles;
-
-    emit exportProgress(0, m_totalFrames);
-
-    // Store original frame so it can be restored after export
-    int originalFrame = m_currentFrame;
-
-    // Render each frame
-    for (int frame = 1; frame <= m_totalFrames; ++frame) {
-        emit exportProgress(frame, m_totalFrames);
-
-        // Set animation to this frame
-        setCurrentFrame(frame);
-
-        // Allow UI to update after changing frame
-        QApplication::processEvents();
+    auto frameFileName = [tempDir](int frame) {
+        return QString("%1/frame_%2.png").arg(tempDir).arg(frame, 4, 10, QChar('0'));
+    };
+
+    // Frames are rendered from snapshots in parallel, so the live scene
+    // stays on the frame being edited. They are only read back by ffmpeg,
+    // so they are compressed as fast as possible.
+    PngEncoder::Options pngOptions;
+    PngEncoder::optionsFromName("fast", pngOptions);
+    FrameExporter exporter;
+    frames.attach(exporter);
+    exporter.setEncoder([frameFileName, pngOptions](int frame, const QImage& image) {
+        return PngEncoder::write(image, frameFileName(frame), pngOptions);
+    });
+    connect(&exporter, &FrameExporter::progress, this, &AnimationController::exportProgress);
 
-        // Render frame
-        QImage frameImage(sceneRect.size().toSize(), QImage::Format_ARGB32);
-        frameImage.fill(Qt::transparent);
-
-        QPainter painter(&frameImage);
-        painter.setRenderHint(QPainter::Antialiasing, true);
-        painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
-
-        scene->render(&painter, frameImage.rect(), sceneRect);
-        painter.end();
-
-        // Save frame
-        QString frameFile = QString("%1/frame_%2.png").arg(tempDir).arg(frame, 4, 10, QChar('0'));
-        frameImage.save(frameFile, "PNG");
-        frameFiles.append(frameFile);
+    QStringList frameFiles;
+    m_exporter = &exporter;
+    const bool rendered = exporter.run(1, m_totalFrames,
+        [&frameFiles, frameFileName](int frame, const QImage&, int sourceFrame) {
+            // Held frames reuse the file written for the frame they repeat
+            if (sourceFrame != frame &&
+                !FrameExporter::linkFrameFile(frameFileName(sourceFrame), frameFileName(frame))) {
+                return false;
+            }
+            frameFiles.append(frameFileName(frame));
+            return true;
+        });
+    m_exporter = nullptr;
+
+    if (!rendered) {
+        // Workers may have written frames past the last one delivered
+        for (int frame = 1; frame <= m_totalFrames; ++frame) {
+            QFile::remove(frameFileName(frame));
+        }
+        QDir().rmdir(tempDir);
+        if (!exporter.wasCancelled()) {
+            m_exportError = "Failed to render the animation frames.";
+        }
+        return false;
     }
 
-    // Restore original frame once after rendering all frames
-    setCurrentFrame(originalFrame);
-
-    bool success = false;
-
-    // Convert frames to final format
-    if (format.toLower() == "gif") {
-        success = exportToGif(frameFiles, filename, loop);
-    }
-    else if (format.toLower() == "mp4") {
-        success = exportToMp4(frameFiles, filename, quality);
-    }
-    else {
-        QMessageBox::warning(m_mainWindow, "Export Error", "Unsupported export format: " + format);
-    }
+    const bool success = exportToMp4(frameFiles, filename, quality);
 
     emit exportProgress(m_totalFrames, m_totalFrames);
 
@@ -411,12 +460,50 @@ bool AnimationController::exportAnimation(const QString& filename, const QString
         }
         QDir().rmdir(tempDir);
     } else {
-        QMessageBox::warning(m_mainWindow, "Export Error", "Export failed. Frames have been left in:\n" + tempDir);
+        m_exportError += "\nFrames have been left in:\n" + tempDir;
     }
 
     return success;
 }
 
+void AnimationController::cancelExport()
+{
+    if (m_exporter) {
+        m_exporter->cancel();
+    }
+}
+
+void AnimationController::setCapturedFrames(const CapturedFrames& frames)
+{
+    m_capturedFrames = frames;
+}
+
+void AnimationController::setAudioFile(const QString& audioFile)
+{
+    m_audioFile = audioFile;
+}
+
+QString AnimationController::exportErrorString() const
+{
+    return m_exportError;
+}
+
+void AnimationController::setPngOptions(const PngEncoder::Options& options)
+{
+    m_pngOptions = options;
+}
+
+void AnimationController::setGifOptions(const QString& dither, bool globalPalette)
+{
+    m_gifDither = GifEncoder::ditherFromName(dither);
+    m_gifGlobalPalette = globalPalette;
+}
+
+void AnimationController::setExportSizes(const QVector<QSize>& sizes)
+{
+    m_exportSizes = sizes;
+}
+
 void AnimationController::exportFrame(int frame, const QString& filename)
 {
     if (filename.isEmpty() || frame < 1 || frame > m_totalFrames) {
@@ -457,7 +544,7 @@ void AnimationController::exportFrame(int frame, const QString& filename)
     }
     else {
         // Export as raster image
-        QImage image(sceneRect.size().toSize() * 2, QImage::Format_ARGB32); // 2x for better quality
+        QImage image(sceneRect.size().toSize() * 2, QImage::Format_ARGB32_Premultiplied); // 2x for better quality
         image.fill(Qt::transparent);
 
         QPainter painter(&image);
@@ -467,8 +554,8 @@ void AnimationController::exportFrame(int frame, const QString& filename)
         scene->render(&painter, image.rect(), sceneRect);
         painter.end();
 
-        // Scale down for final image
-        QImage finalImage = image.scaled(sceneRect.size().toSize(), Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        // Scale down for final image; a 2x2 box average is exact for this
+        QImage finalImage = ImageDownsampler::scaled(image, sceneRect.size().toSize(), ImageDownsampler::Filter::Box);
 
         if (!finalImage.save(filename, format.toLatin1().data())) {
             QMessageBox::warning(m_mainWindow, "Export Error", "Failed to save frame image.");
@@ -498,91 +585,253 @@ void AnimationController::updateLayerAtFrame(AnimationLayer* layer, int frame)
     }
 }
 
-bool AnimationController::exportToGif(const QStringList& frameFiles, const QString& filename, bool loop)
+bool AnimationController::exportToMp4(const QStringList& frameFiles, const QString& filename, int quality)
 {
-    // This requires an external tool like ImageMagick
-    QString convertCommand = "convert";
-#ifdef Q_OS_WIN
-    convertCommand = "magick";
-#endif
-
-    QString usageCommand;
-#ifdef Q_OS_WIN
-    usageCommand = "magick convert";
-#else
-    usageCommand = "convert";
-#endif
-
-    QString infoText = QStringLiteral("GIF export requires ImageMagick to be installed.\n\n"
-        "Individual frames have been saved. You can use ImageMagick with:\n")
-        + usageCommand + " -delay " + QString::number(100 / m_frameRate)
-        + " frame_*.png " + filename;
+    const QString audioFile = m_mainWindow ? m_mainWindow->getAudioFile() : m_audioFile;
 
-    QMessageBox::information(m_mainWindow, "GIF Export", infoText);
+    // Shown with the error, for encoding the saved frames by hand
+    QString ffmpegCmd = "ffmpeg -framerate " + QString::number(m_frameRate) +
+        " -i frame_%04d.png";
+    if (!audioFile.isEmpty())
+        ffmpegCmd += " -i \"" + audioFile + "\" -c:a aac -shortest";
+    ffmpegCmd += " -vf pad=ceil(iw/2)*2:ceil(ih/2)*2 -c:v libx264 -pix_fmt yuv420p " + filename;
 
     QProcess process;
     QStringList arguments;
-#ifdef Q_OS_WIN
-    arguments << "convert";
-#endif
-    arguments << "-delay" << QString::number(100 / m_frameRate);
-    arguments << "-loop" << (loop ? "0" : "1");
-    arguments << frameFiles;
+    arguments << "-framerate" << QString::number(m_frameRate);
+    QString pattern = frameFiles.first();
+    pattern.replace(QRegularExpression("frame_\\d{4}\\.png"), "frame_%04d.png");
+    arguments << "-i" << pattern;
+    arguments << mp4EncodingArguments(audioFile, quality);
+    arguments << "-y"; // Overwrite output file
     arguments << filename;
     process.setWorkingDirectory(QFileInfo(frameFiles.first()).absolutePath());
 
-    process.start(convertCommand, arguments);
+    process.start(ffmpegProgram(), arguments);
     if (!process.waitForStarted(3000)) {
-#ifdef Q_OS_WIN
-        QStringList fallbackArguments = arguments;
-        if (!fallbackArguments.isEmpty())
-            fallbackArguments.removeFirst();
-        process.start(QStringLiteral("convert"), fallbackArguments);
-        if (!process.waitForStarted(3000)) {
-            QMessageBox::warning(m_mainWindow, "Export Error",
-                "ImageMagick (convert/magick) not found.");
-            return false;
-        }
-#else
-        QMessageBox::warning(m_mainWindow, "Export Error",
-            "ImageMagick (convert/magick) not found.");
+        m_exportError = "MP4 export requires FFmpeg to be installed. You can encode the frames with:\n" + ffmpegCmd;
         return false;
-#endif
     }
+
+    // Wait until encoding finishes
     process.waitForFinished(-1);
     if (process.exitCode() == 0) {
-        QMessageBox::information(m_mainWindow, "Export Complete",
-            "GIF animation exported successfully to:\n" + filename);
         return true;
     }
-    QMessageBox::warning(m_mainWindow, "Export Error",
-        "ImageMagick conversion failed:\n" + process.readAllStandardError());
+    m_exportError = "FFmpeg encoding failed:\n" + QString::fromLocal8Bit(process.readAllStandardError());
     return false;
 }
 
-bool AnimationController::exportToMp4(const QStringList& frameFiles, const QString& filename, int quality)
+// Writes the GIF in-process. Quantization runs on the render workers right
+// after each frame is rendered; the encoder then crops every frame to what
+// changed and LZW-compresses it in frame order.
+bool AnimationController::exportGif(const CapturedFrames& frames, const QString& filename, bool loop)
 {
-    QString audioFile;
-    if (m_mainWindow)
-        audioFile = m_mainWindow->getAudioFile();
+    const QSize size = frames.canvasSize();
+    if (size.isEmpty() || m_totalFrames < 1) {
+        return false;
+    }
 
-    // This requires FFmpeg
-    QString ffmpegCmd = "ffmpeg -framerate " + QString::number(m_frameRate) +
-        " -i frame_%04d.png";
-    if (!audioFile.isEmpty())
-        ffmpegCmd += " -i \"" + audioFile + "\" -c:a aac -shortest";
-    ffmpegCmd += " -vf pad=ceil(iw/2)*2:ceil(ih/2)*2 -c:v libx264 -pix_fmt yuv420p " + filename;
-    QMessageBox::information(m_mainWindow, "MP4 Export",
-        "MP4 export requires FFmpeg to be installed.\n\n"
-        "Individual frames have been saved. You can use FFmpeg with:\n" +
-        ffmpegCmd);
+    GifEncoder::Options options;
+    options.paletteMode = m_gifGlobalPalette ? GifEncoder::PaletteMode::Global : GifEncoder::PaletteMode::PerFrame;
+    options.dither = m_gifDither;
+    options.loop = loop;
+    options.frameRate = m_frameRate;
+
+    // An empty palette makes every frame build its own
+    QVector<QRgb> palette;
+    if (m_gifGlobalPalette) {
+        QVector<QImage> samples;
+        const int count = qMin(kGifPaletteSamples, m_totalFrames);
+        for (int i = 0; i < count; ++i) {
+            const int frame = count > 1 ? 1 + (m_totalFrames - 1) * i / (count - 1) : 1;
+            samples.append(frames.snapshot(frame).render());
+        }
+        palette = GifEncoder::buildPalette(samples);
+    }
+
+    GifEncoder gif;
+    if (!gif.open(filename, size, options, palette)) {
+        m_exportError = "Cannot write GIF file:\n" + gif.errorString();
+        return false;
+    }
+
+    FrameExporter exporter;
+    frames.attach(exporter);
+    exporter.setOutputFormat(QImage::Format_ARGB32);
+    const GifEncoder::Dither dither = m_gifDither;
+    exporter.setProcessor([palette, dither](int frame, const QImage& image) {
+        Q_UNUSED(frame);
+        return GifEncoder::quantize(image, palette, dither);
+    });
+    connect(&exporter, &FrameExporter::progress, this, &AnimationController::exportProgress);
+
+    // Held frames lengthen the delay of the frame they repeat
+    m_exporter = &exporter;
+    const bool rendered = exporter.run(1, m_totalFrames,
+        [&gif](int frame, const QImage& indexed, int sourceFrame) {
+            return sourceFrame != frame ? gif.extendLastFrame() : gif.addFrame(indexed);
+        });
+    m_exporter = nullptr;
+
+    const bool closed = gif.close();
+    if (!rendered || !closed) {
+        QFile::remove(filename);
+        if (!exporter.wasCancelled()) {
+            m_exportError = "GIF export failed:\n" + gif.errorString();
+        }
+        return false;
+    }
+
+    qDebug() << "GIF export:" << m_totalFrames << "frames," << QFileInfo(filename).size() << "bytes";
+    return true;
+}
+
+// Writes a PNG sequence into directory at every size from setExportSizes()
+// (the canvas size by default), rendering each frame once
+bool AnimationController::exportPngSequence(const CapturedFrames& frames, const QString& directory)
+{
+    const QVector<QSize> sizes = m_exportSizes.isEmpty() ? QVector<QSize>{ frames.canvasSize() } : m_exportSizes;
+
+    FrameExporter exporter;
+    frames.attach(exporter);
+    connect(&exporter, &FrameExporter::progress, this, &AnimationController::exportProgress);
+
+    MultiResolutionWriter writer(sizes, directory);
+    writer.setPngOptions(m_pngOptions);
+    QString error;
+    if (!writer.attach(exporter, &error)) {
+        m_exportError = error;
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    m_exporter = &exporter;
+    const bool rendered = exporter.run(1, m_totalFrames,
+        [&writer](int frame, const QImage&, int sourceFrame) {
+            return sourceFrame == frame || writer.linkHeld(frame, sourceFrame);
+        });
+    m_exporter = nullptr;
+
+    if (!rendered) {
+        writer.removeFrames(1, m_totalFrames);
+        if (!exporter.wasCancelled()) {
+            m_exportError = "Failed to write the PNG sequence.";
+        }
+        return false;
+    }
+
+    qDebug() << "PNG sequence export:" << writer.statistics(m_totalFrames, timer.nsecsElapsed() / 1e9);
+    return true;
+}
+
+// The frames should be captured without the canvas background so they can
+// be trimmed to what is drawn
+bool AnimationController::exportSpriteSheet(const CapturedFrames& frames, const QString& jsonFile)
+{
+    FrameExporter exporter;
+    frames.attach(exporter);
+    connect(&exporter, &FrameExporter::progress, this, &AnimationController::exportProgress);
+
+    SpriteSheetExporter::Options options;
+    options.frameRate = m_frameRate;
+
+    SpriteSheetExporter sheet;
+    m_exporter = &exporter;
+    const bool exported = sheet.exportSheet(exporter, 1, m_totalFrames, frames.canvasSize(), jsonFile, options);
+    m_exporter = nullptr;
+
+    if (!exported) {
+        if (!exporter.wasCancelled()) {
+            m_exportError = "Sprite sheet export failed:\n" + sheet.errorString();
+        }
+        return false;
+    }
+    return true;
+}
+
+// Feeds rendered frames to ffmpeg's stdin as raw video while later frames are
+// still rendering, so nothing is compressed to or read back from disk. When
+// ffmpeg cannot be launched encoderStarted stays false and nothing was written.
+bool AnimationController::streamToMp4(const CapturedFrames& frames, const QString& filename, int quality,
+                                      bool& encoderStarted)
+{
+    encoderStarted = false;
+
+    const QSize size = frames.canvasSize();
+    if (size.isEmpty()) {
+        return false;
+    }
+
+    const QString audioFile = m_mainWindow ? m_mainWindow->getAudioFile() : m_audioFile;
+
+    // QImage::Format_ARGB32 is stored as B, G, R, A bytes on little-endian hosts
+    const QString pixelFormat = QSysInfo::ByteOrder == QSysInfo::LittleEndian ? "bgra" : "argb";
 
-    QProcess process;
     QStringList arguments;
+    arguments << "-y";
+    arguments << "-loglevel" << "error"; // Keep stderr small; it is only read at the end
+    arguments << "-f" << "rawvideo";
+    arguments << "-pix_fmt" << pixelFormat;
+    arguments << "-s" << QString("%1x%2").arg(size.width()).arg(size.height());
     arguments << "-framerate" << QString::number(m_frameRate);
-    QString pattern = frameFiles.first();
-    pattern.replace(QRegularExpression("frame_\\d{4}\\.png"), "frame_%04d.png");
-    arguments << "-i" << pattern;
+    arguments << "-i" << "-";
+    arguments << mp4EncodingArguments(audioFile, quality);
+    arguments << filename;
+
+    QProcess encoder;
+    encoder.start(ffmpegProgram(), arguments);
+    if (!encoder.waitForStarted(3000)) {
+        return false;
+    }
+    encoderStarted = true;
+
+    FrameExporter exporter;
+    frames.attach(exporter);
+    exporter.setOutputFormat(QImage::Format_ARGB32);
+    connect(&exporter, &FrameExporter::progress, this, &AnimationController::exportProgress);
+
+    // Held frames are not rendered again; their pixels are simply written
+    // to ffmpeg once more
+    m_exporter = &exporter;
+    const bool rendered = exporter.run(1, m_totalFrames,
+        [&encoder, &exporter](int frame, const QImage& image, int sourceFrame) {
+            Q_UNUSED(frame);
+            Q_UNUSED(sourceFrame);
+            // Keeps this thread's events, and a cancel request, flowing
+            return writeToEncoder(encoder, image, [&exporter]() {
+                QCoreApplication::processEvents();
+                return !exporter.wasCancelled();
+            });
+        });
+    m_exporter = nullptr;
+
+    encoder.closeWriteChannel();
+
+    if (!rendered) {
+        const QString errors = QString::fromLocal8Bit(encoder.readAllStandardError());
+        encoder.kill();
+        encoder.waitForFinished(3000);
+        QFile::remove(filename);
+        if (!exporter.wasCancelled()) {
+            m_exportError = "FFmpeg encoding failed:\n" + errors;
+        }
+        return false;
+    }
+
+    encoder.waitForFinished(-1);
+    if (encoder.exitStatus() == QProcess::NormalExit && encoder.exitCode() == 0) {
+        return true;
+    }
+    m_exportError = "FFmpeg encoding failed:\n" + QString::fromLocal8Bit(encoder.readAllStandardError());
+    return false;
+}
+
+// Output options shared by the streamed and the PNG sequence paths
+QStringList AnimationController::mp4EncodingArguments(const QString& audioFile, int quality)
+{
+    QStringList arguments;
     if (!audioFile.isEmpty())
         arguments << "-i" << audioFile;
     arguments << "-vf" << "pad=ceil(iw/2)*2:ceil(ih/2)*2";
@@ -592,24 +841,31 @@ bool AnimationController::exportToMp4(const QStringList& frameFiles, const QStri
     arguments << "-pix_fmt" << "yuv420p";
     if (!audioFile.isEmpty())
         arguments << "-c:a" << "aac" << "-shortest";
-    arguments << "-y"; // Overwrite output file
-    arguments << filename;
-    process.setWorkingDirectory(QFileInfo(frameFiles.first()).absolutePath());
+    return arguments;
+}
 
-    process.start("ffmpeg", arguments);
-    if (!process.waitForStarted(3000)) {
-        QMessageBox::warning(m_mainWindow, "Export Error", "FFmpeg not found.");
+bool AnimationController::writeToEncoder(QProcess& encoder, const QImage& image,
+                                         const std::function<bool()>& keepWaiting)
+{
+    const qint64 bytes = image.sizeInBytes();
+    if (encoder.write(reinterpret_cast<const char*>(image.constBits()), bytes) != bytes) {
         return false;
     }
 
-    // Wait until encoding finishes
-    process.waitForFinished(-1);
-    if (process.exitCode() == 0) {
-        QMessageBox::information(m_mainWindow, "Export Complete",
-            "MP4 video exported successfully to:\n" + filename);
-        return true;
+    // Hold further frames until ffmpeg has taken most of the queued ones
+    while (encoder.bytesToWrite() > kMaxQueuedEncoderBytes) {
+        if (encoder.state() != QProcess::Running || (keepWaiting && !keepWaiting())) {
+            return false;
+        }
+        encoder.waitForBytesWritten(kEncoderPollMs);
     }
-    QMessageBox::warning(m_mainWindow, "Export Error",
-        "FFmpeg encoding failed:\n" + process.readAllStandardError());
-    return false;
+    return encoder.state() == QProcess::Running;
+}
+
+// FRAMEDIRECTOR_FFMPEG points exports at another ffmpeg build, or at a stub
+// encoder when testing the export pipeline
+QString AnimationController::ffmpegProgram()
+{
+    const QString program = qEnvironmentVariable("FRAMEDIRECTOR_FFMPEG");
+    return program.isEmpty() ? QStringLiteral("ffmpeg") : program;
 }
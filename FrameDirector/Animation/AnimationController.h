@@ -5,12 +5,22 @@
 #include <QTimer>
 #include <QPropertyAnimation>
 #include <QEasingCurve>
+#include <QSize>
+#include <QVector>
+#include "CapturedFrames.h"
+#include "GifEncoder.h"
+#include "PngEncoder.h"
+#include <functional>
 #include <vector>
 #include <memory>
 
+class QProcess;
+
 class MainWindow;
 class AnimationLayer;
 class Timeline;
+class FrameExporter;
+class Canvas;
 
 class AnimationController : public QObject
 {
@@ -53,9 +63,37 @@ public:
     void copyKeyframe(int fromLayer, int fromFrame, int toLayer, int toFrame);
     void moveKeyframe(int fromFrame, int toFrame);
 
-    // Export
+    // Export. Does not show any UI, so it can run in a background job; on
+    // failure exportErrorString() says why (empty when cancelled).
     bool exportAnimation(const QString& filename, const QString& format, int quality = 80, bool loop = true);
+    QString exportErrorString() const;
+    // Frames for exportAnimation to render instead of capturing them from
+    // the canvas; required when exporting off the GUI thread
+    void setCapturedFrames(const CapturedFrames& frames);
+    // Soundtrack muxed into MP4 exports by a controller without a main window
+    void setAudioFile(const QString& audioFile);
     void exportFrame(int frame, const QString& filename);
+    // Dithering ("none", "ordered" or "diffusion") and palette for GIF export
+    void setGifOptions(const QString& dither, bool globalPalette);
+    // Sizes a PNG sequence is written at, all from one render per frame;
+    // empty for the canvas size
+    void setExportSizes(const QVector<QSize>& sizes);
+    // Compression for PNG sequences
+    void setPngOptions(const PngEncoder::Options& options);
+
+    // ffmpeg output options for H.264 MP4, shared with batch rendering
+    static QStringList mp4EncodingArguments(const QString& audioFile, int quality);
+    static QString ffmpegProgram();
+    // Writes one raw frame to ffmpeg's stdin. Back-pressure: while too much
+    // is queued, waits for ffmpeg, calling keepWaiting between waits; false
+    // from it (a cancel) or ffmpeg exiting gives up. Shared with batch
+    // rendering.
+    static bool writeToEncoder(QProcess& encoder, const QImage& image,
+                               const std::function<bool()>& keepWaiting = std::function<bool()>());
+
+public slots:
+    // Stops a running exportAnimation after the frames being rendered
+    void cancelExport();
 
 signals:
     void frameChanged(int frame);
@@ -75,8 +113,11 @@ private slots:
 private:
     void updateAllLayers();
     void updateLayerAtFrame(AnimationLayer* layer, int frame);
-    bool exportToGif(const QStringList& frameFiles, const QString& filename, bool loop);
+    bool exportGif(const CapturedFrames& frames, const QString& filename, bool loop);
+    bool exportPngSequence(const CapturedFrames& frames, const QString& directory);
+    bool exportSpriteSheet(const CapturedFrames& frames, const QString& jsonFile);
     bool exportToMp4(const QStringList& frameFiles, const QString& filename, int quality);
+    bool streamToMp4(const CapturedFrames& frames, const QString& filename, int quality, bool& encoderStarted);
     MainWindow* m_mainWindow;
     Timeline* m_timeline;
 
@@ -86,6 +127,14 @@ private:
     int m_frameRate;
     bool m_isPlaying;
     int m_currentLayer;
+    FrameExporter* m_exporter;  // Set while exportAnimation renders frames
+    GifEncoder::Dither m_gifDither;
+    bool m_gifGlobalPalette;
+    QVector<QSize> m_exportSizes;
+    PngEncoder::Options m_pngOptions;
+    CapturedFrames m_capturedFrames;
+    QString m_audioFile;
+    QString m_exportError;
 
     std::vector<std::unique_ptr<AnimationLayer>> m_layers;
 };
@@ -0,0 +1,1143 @@
+// Animation/BatchRenderer.cpp
+#include "BatchRenderer.h"
+#include "AnimationController.h"
+#include "FrameExporter.h"
+#include "GifEncoder.h"
+#include "MultiResolutionWriter.h"
+#include "PngEncoder.h"
+#include "SpriteSheetExporter.h"
+#include "../Canvas.h"
+#include "../Common/ProcessMemory.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QGraphicsScene>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <cstring>
+#include <vector>
+#ifdef Q_OS_WIN
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+namespace {
+const char* const kRenderOption = "--render";
+// Set by --check-mp4-stream for the encoder it points FRAMEDIRECTOR_FFMPEG at
+const char* const kStubEncoderVariable = "FRAMEDIRECTOR_STUB_ENCODER";
+
+QTextStream& out()
+{
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+QTextStream& err()
+{
+    static QTextStream stream(stderr);
+    return stream;
+}
+
+// Saved the way MainWindow saves a binary project
+bool writeBinaryProject(const CanvasSnapshot& snapshot, const QString& fileName)
+{
+    QVector<ProjectFrameChunk> frames;
+    QHash<QString, EncodedChunk> assets;
+    QJsonObject layout;
+    layout["canvas"] = snapshot.toProject(frames, assets);
+    ProjectContainer binary;
+    binary.setLayout(layout);
+    binary.setFrames(frames);
+    binary.setAssets(assets);
+    return binary.write(fileName);
+}
+}
+
+bool BatchRenderer::isBatchCommandLine(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], kRenderOption) == 0) {
+            return true;
+        }
+    }
+    return !qEnvironmentVariableIsEmpty(kStubEncoderVariable);
+}
+
+int BatchRenderer::exec(const QStringList& arguments)
+{
+    // The renders --check-mp4-stream starts see the variable too; only the
+    // encoder they start has no --render
+    const QString stubMode = qEnvironmentVariable(kStubEncoderVariable);
+    if (!stubMode.isEmpty() && !arguments.contains(kRenderOption)) {
+        return runStubEncoder(stubMode, arguments.mid(1));
+    }
+
+    Options options;
+    QString error;
+    if (!parseArguments(arguments, options, error)) {
+        err() << "FrameDirector: " << error << Qt::endl;
+        err() << "Usage: FrameDirector --render project.fdr [--frames 1-500] --out dir"
+                 " [--format png|mp4|gif|sprites] [--jobs N] [--fps 24] [--quality 80]"
+                 " [--dither none|ordered|diffusion] [--sizes 3840x2160,1920x1080,320]"
+                 " [--png-compression fast|default|max|0-9] [--png-filter adaptive|none|sub|up|average|paeth]" << Qt::endl;
+        err() << "       FrameDirector --render project.fdr --compare-formats" << Qt::endl;
+        err() << "       FrameDirector --render project.fdr [--frames 1-1000] [--fps 24]"
+                 " [--dither none|ordered|diffusion] --compare-gif" << Qt::endl;
+        err() << "       FrameDirector --render project.fdr [--frames 1-3000] --bench-frame-store" << Qt::endl;
+        err() << "       FrameDirector --render project.fdr [--frames 1-3000] --bench-frame-switch" << Qt::endl;
+        err() << "       FrameDirector --render project.fdr [--frames 1-100] --check-mp4-stream" << Qt::endl;
+        return UsageError;
+    }
+
+    BatchRenderer renderer(options);
+    return renderer.run();
+}
+
+bool BatchRenderer::parseArguments(const QStringList& arguments, Options& options, QString& error)
+{
+    QCommandLineParser parser;
+    const QCommandLineOption render("render", "Project to render.", "project");
+    const QCommandLineOption frames("frames", "Frame range, e.g. 1-500.", "range");
+    const QCommandLineOption output("out", "Output directory or file.", "path");
+    const QCommandLineOption format("format", "png, mp4, gif or sprites.", "format", "png");
+    const QCommandLineOption jobs("jobs", "Worker processes.", "count", "1");
+    const QCommandLineOption fps("fps", "Frame rate.", "fps", "24");
+    const QCommandLineOption quality("quality", "MP4 quality, 1-100.", "percent", "80");
+    const QCommandLineOption dither("dither", "GIF dithering.", "mode", "none");
+    const QCommandLineOption sizes("sizes", "PNG output sizes, rendered in one pass.", "list");
+    const QCommandLineOption pngCompression("png-compression", "PNG compression: fast, default, max or 0-9.", "level", "default");
+    const QCommandLineOption pngFilter("png-filter", "PNG row filter.", "filter");
+    const QCommandLineOption compareFormats("compare-formats", "Compare loading the project saved as JSON and as binary.");
+    const QCommandLineOption compareGif("compare-gif", "Compare GIF export with the built-in encoder and with ImageMagick.");
+    const QCommandLineOption benchFrameStore("bench-frame-store", "Time frame queries and a save and load of the frames.");
+    const QCommandLineOption benchFrameSwitch("bench-frame-switch", "Time switching the canvas from frame to frame.");
+    const QCommandLineOption checkMp4Stream("check-mp4-stream", "Check MP4 streaming export against a stub encoder.");
+    QCommandLineOption segment("segment");
+    segment.setFlags(QCommandLineOption::HiddenFromHelp);
+    QCommandLineOption loadOnly("load-only");
+    loadOnly.setFlags(QCommandLineOption::HiddenFromHelp);
+    parser.addOptions({ render, frames, output, format, jobs, fps, quality, dither, sizes,
+                        pngCompression, pngFilter, compareFormats, compareGif, benchFrameStore,
+                        benchFrameSwitch, checkMp4Stream, segment, loadOnly });
+
+    if (!parser.parse(arguments)) {
+        error = parser.errorText();
+        return false;
+    }
+
+    options.projectFile = parser.value(render);
+    options.output = parser.value(output);
+    options.format = parser.value(format).toLower();
+    options.dither = parser.value(dither).toLower();
+    options.sizes = parser.value(sizes);
+    options.pngCompression = parser.value(pngCompression).toLower();
+    options.pngFilter = parser.value(pngFilter).toLower();
+    options.segment = parser.isSet(segment);
+    options.compareFormats = parser.isSet(compareFormats);
+    options.loadOnly = parser.isSet(loadOnly);
+    options.compareGif = parser.isSet(compareGif);
+    options.benchFrameStore = parser.isSet(benchFrameStore);
+    options.benchFrameSwitch = parser.isSet(benchFrameSwitch);
+    options.checkMp4Stream = parser.isSet(checkMp4Stream);
+    if (options.projectFile.isEmpty() ||
+        (options.output.isEmpty() && !options.compareFormats && !options.loadOnly && !options.compareGif &&
+         !options.benchFrameStore && !options.benchFrameSwitch && !options.checkMp4Stream)) {
+        error = "--render and --out are required";
+        return false;
+    }
+    if (options.format != "png" && options.format != "mp4" && options.format != "gif" &&
+        options.format != "sprites") {
+        error = "Unsupported format: " + options.format;
+        return false;
+    }
+    if (!options.sizes.isEmpty() && options.format != "png") {
+        error = "--sizes is only supported with --format png";
+        return false;
+    }
+    if ((parser.isSet(pngCompression) || parser.isSet(pngFilter)) && options.format != "png") {
+        error = "--png-compression and --png-filter are only supported with --format png";
+        return false;
+    }
+    PngEncoder::Options png;
+    if (!PngEncoder::optionsFromName(options.pngCompression, png)) {
+        error = "Unsupported PNG compression: " + options.pngCompression;
+        return false;
+    }
+    if (!options.pngFilter.isEmpty() && !PngEncoder::filterFromName(options.pngFilter, png.filter)) {
+        error = "Unsupported PNG filter: " + options.pngFilter;
+        return false;
+    }
+    if (options.dither != "none" && options.dither != "ordered" && options.dither != "diffusion") {
+        error = "Unsupported dithering: " + options.dither;
+        return false;
+    }
+
+    bool ok = true;
+    auto number = [&parser, &ok](const QCommandLineOption& option, int minimum) {
+        bool valid = false;
+        const int value = parser.value(option).toInt(&valid);
+        ok = ok && valid && value >= minimum;
+        return value;
+    };
+    options.jobs = number(jobs, 1);
+    options.frameRate = number(fps, 1);
+    options.quality = qBound(1, number(quality, 1), 100);
+    if (!ok) {
+        error = "--jobs, --fps and --quality take positive numbers";
+        return false;
+    }
+
+    if (parser.isSet(frames)) {
+        const QStringList range = parser.value(frames).split('-');
+        bool firstOk = false;
+        bool lastOk = range.size() == 1;
+        options.firstFrame = range.value(0).toInt(&firstOk);
+        options.lastFrame = range.size() == 2 ? range[1].toInt(&lastOk) : options.firstFrame;
+        if (range.size() > 2 || !firstOk || !lastOk || options.firstFrame < 1 ||
+            options.lastFrame < options.firstFrame) {
+            error = "Invalid frame range: " + parser.value(frames);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+BatchRenderer::BatchRenderer(const Options& options)
+    : m_options(options)
+    , m_reportedPercent(-1)
+{
+}
+
+BatchRenderer::~BatchRenderer() = default;
+
+int BatchRenderer::run()
+{
+    if (m_options.compareFormats) {
+        return compareFormats();
+    }
+    if (!loadProject()) {
+        return ProjectError;
+    }
+    if (m_options.loadOnly) {
+        return Success;
+    }
+
+    if (m_options.lastFrame <= 0) {
+        m_options.lastFrame = qMax(m_options.firstFrame, m_canvas->getLastContentFrame());
+    }
+    const int frameCount = m_options.lastFrame - m_options.firstFrame + 1;
+    if (m_options.benchFrameStore) {
+        return benchFrameStore();
+    }
+    if (m_options.benchFrameSwitch) {
+        return benchFrameSwitch();
+    }
+    if (m_options.checkMp4Stream) {
+        return checkMp4Stream();
+    }
+
+    QString error;
+    m_sizes = MultiResolutionWriter::parseSizes(m_options.sizes, m_canvas->getCanvasSize(), &error);
+    if (m_sizes.isEmpty()) {
+        err() << "FrameDirector: " << error << Qt::endl;
+        return UsageError;
+    }
+    if (m_options.compareGif) {
+        return compareGif();
+    }
+
+    const QString target = m_options.format == "png" ? m_options.output : outputFile();
+    const QString targetDir = m_options.format == "png" ? target : QFileInfo(target).absolutePath();
+    if (!QDir().mkpath(targetDir)) {
+        err() << "FrameDirector: cannot create " << targetDir << Qt::endl;
+        return RenderError;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Atlases are packed from every frame at once, so sprite sheets render
+    // in one process
+    const int jobs = m_options.format == "sprites" ? 1 : qMin(m_options.jobs, frameCount);
+    const bool rendered = jobs > 1 ? renderWithWorkers(target, jobs)
+                                   : renderRange(target, m_options.firstFrame, m_options.lastFrame);
+    if (!rendered) {
+        return RenderError;
+    }
+
+    if (!m_options.segment) {
+        const double seconds = qMax(timer.elapsed(), qint64(1)) / 1000.0;
+        out() << "Rendered " << frameCount << " frames to " << target << " in "
+              << QString::number(seconds, 'f', 1) << " s ("
+              << QString::number(frameCount / seconds, 'f', 1) << " fps)" << Qt::endl;
+    }
+    return Success;
+}
+
+bool BatchRenderer::loadProject()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    ProjectContainer project;
+    if (!project.read(m_options.projectFile)) {
+        err() << "FrameDirector: cannot open " << m_options.projectFile << ": " << project.errorString() << Qt::endl;
+        return false;
+    }
+
+    // Same layout MainWindow::loadFile reads
+    m_canvas = std::make_unique<Canvas>();
+    if (!m_canvas->fromProject(project) || m_canvas->getCanvasSize().isEmpty()) {
+        err() << "FrameDirector: " << m_options.projectFile << " has no canvas" << Qt::endl;
+        return false;
+    }
+
+    // A fresh process per render makes this the place to compare formats
+    if (!m_options.segment) {
+        out() << "Loaded " << (project.isJson() ? "JSON" : "binary") << " project in " << timer.elapsed()
+              << " ms (peak RSS " << peakResidentBytes() / (1024 * 1024) << " MB)" << Qt::endl;
+    }
+
+    m_audioFile = project.layout().value("audioFile").toString();
+    return true;
+}
+
+// Writes the canvas to a JSON and a binary project, the way each format is
+// saved, then loads each in a fresh process of its own so that its peak RSS
+// covers that load alone
+int BatchRenderer::compareFormats()
+{
+    ProjectContainer project;
+    if (!project.read(m_options.projectFile)) {
+        err() << "FrameDirector: cannot open " << m_options.projectFile << ": " << project.errorString() << Qt::endl;
+        return ProjectError;
+    }
+    Canvas canvas;
+    if (!canvas.fromProject(project)) {
+        err() << "FrameDirector: " << m_options.projectFile << " has no canvas" << Qt::endl;
+        return ProjectError;
+    }
+
+    QTemporaryDir directory;
+    if (!directory.isValid()) {
+        err() << "FrameDirector: cannot create a temporary directory" << Qt::endl;
+        return RenderError;
+    }
+    const QString baseName = QFileInfo(m_options.projectFile).completeBaseName();
+    const QString jsonFile = directory.filePath(baseName + "_json.fdr");
+    const QString binaryFile = directory.filePath(baseName + "_binary.fdr");
+
+    const CanvasSnapshot snapshot = canvas.captureSnapshot();
+    QJsonObject root;
+    root["canvas"] = snapshot.toJson();
+    QSaveFile json(jsonFile);
+    bool written = json.open(QIODevice::WriteOnly) && json.write(QJsonDocument(root).toJson()) >= 0 && json.commit();
+    written = written && writeBinaryProject(snapshot, binaryFile);
+    if (!written) {
+        err() << "FrameDirector: cannot write the comparison projects to " << directory.path() << Qt::endl;
+        return RenderError;
+    }
+
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    if (!environment.contains("QT_QPA_PLATFORM")) {
+        environment.insert("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    // loadProject()'s report, from the child
+    static const QRegularExpression loaded("in (\\d+) ms \\(peak RSS (\\d+) MB\\)");
+    out() << "Format   File size     Load time    Peak RSS" << Qt::endl;
+    const QStringList labels = { "JSON", "binary" };
+    const QStringList files = { jsonFile, binaryFile };
+    for (int i = 0; i < files.size(); ++i) {
+        QProcess loader;
+        loader.setProcessEnvironment(environment);
+        loader.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        loader.start(QCoreApplication::applicationFilePath(), { kRenderOption, files[i], "--load-only" });
+        const bool finished = loader.waitForFinished(-1) && loader.exitStatus() == QProcess::NormalExit &&
+                              loader.exitCode() == Success;
+        const QRegularExpressionMatch match = loaded.match(QString::fromLocal8Bit(loader.readAllStandardOutput()));
+        if (!finished || !match.hasMatch()) {
+            err() << "FrameDirector: loading the " << labels[i] << " copy failed" << Qt::endl;
+            return ProjectError;
+        }
+        out() << QString("%1 %2 MB %3 ms %4 MB")
+                     .arg(labels[i], -6)
+                     .arg(QFileInfo(files[i]).size() / (1024.0 * 1024.0), 9, 'f', 1)
+                     .arg(match.captured(1), 9)
+                     .arg(match.captured(2), 8)
+              << Qt::endl;
+    }
+    return Success;
+}
+
+// Both exports run in this process, one after the other, over the same
+// frames; the ImageMagick time includes rendering the PNG sequence it reads
+int BatchRenderer::compareGif()
+{
+    QTemporaryDir directory;
+    const QString framesDir = directory.filePath("frames");
+    if (!directory.isValid() || !QDir().mkpath(framesDir)) {
+        err() << "FrameDirector: cannot create a temporary directory" << Qt::endl;
+        return RenderError;
+    }
+    const QString encoderFile = directory.filePath("encoder.gif");
+    const QString convertFile = directory.filePath("imagemagick.gif");
+    const int frameCount = m_options.lastFrame - m_options.firstFrame + 1;
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!renderGif(encoderFile, m_options.firstFrame, m_options.lastFrame)) {
+        return RenderError;
+    }
+    const qint64 encoderMs = timer.elapsed();
+
+    // As AnimationController::exportToGif ran it
+    m_reportedPercent = -1;
+    timer.restart();
+    if (!renderPng(framesDir, m_options.firstFrame, m_options.lastFrame)) {
+        return RenderError;
+    }
+    QStringList arguments;
+#ifdef Q_OS_WIN
+    const QString program = "magick";
+    arguments << "convert";
+#else
+    const QString program = "convert";
+#endif
+    arguments << "-delay" << QString::number(100 / m_options.frameRate);
+    arguments << "-loop" << "0";
+    arguments << QDir(framesDir).entryList({ "*.png" }, QDir::Files, QDir::Name);
+    arguments << convertFile;
+    QProcess convert;
+    convert.setWorkingDirectory(framesDir);
+    convert.setProcessChannelMode(QProcess::ForwardedChannels);
+    convert.start(program, arguments);
+    const bool converted = convert.waitForStarted() && convert.waitForFinished(-1) &&
+                           convert.exitStatus() == QProcess::NormalExit && convert.exitCode() == 0;
+    const qint64 convertMs = timer.elapsed();
+
+    auto report = [frameCount](const QString& label, qint64 ms, const QString& file) {
+        const double seconds = qMax(ms, qint64(1)) / 1000.0;
+        out() << QString("%1 %2 s %3 fps %4 MB")
+                     .arg(label, -12)
+                     .arg(seconds, 8, 'f', 1)
+                     .arg(frameCount / seconds, 7, 'f', 1)
+                     .arg(QFileInfo(file).size() / (1024.0 * 1024.0), 8, 'f', 2)
+              << Qt::endl;
+    };
+    out() << "GIF export of " << frameCount << " frames" << Qt::endl;
+    report("GifEncoder", encoderMs, encoderFile);
+    if (!converted) {
+        err() << "FrameDirector: ImageMagick (" << program << ") did not run; only GifEncoder was measured" << Qt::endl;
+        return RenderError;
+    }
+    report("ImageMagick", convertMs, convertFile);
+    return Success;
+}
+
+// Times the exposure-sheet lookups timeline navigation and tweening make, on
+// every layer and frame of the range, then saves the canvas as a binary
+// project, loads it into a fresh canvas and checks every frame came back with
+// the same keyframe, hold and tween. Lookups that only need timing never
+// decode a span, so a freshly loaded project times the index alone.
+int BatchRenderer::benchFrameStore()
+{
+    Canvas& canvas = *m_canvas;
+    const int layerCount = canvas.getLayerCount();
+    const int firstFrame = m_options.firstFrame;
+    const int lastFrame = m_options.lastFrame;
+    const qint64 lookups = qint64(layerCount) * (lastFrame - firstFrame + 1);
+
+    int keyframes = 0;
+    for (int layer = 0; layer < layerCount; ++layer) {
+        for (int frame = firstFrame; frame <= lastFrame; ++frame) {
+            keyframes += canvas.getFrameType(frame, layer) == FrameType::Keyframe ? 1 : 0;
+        }
+    }
+    out() << "Frame store: " << layerCount << " layers, " << keyframes << " keyframes in frames "
+          << firstFrame << "-" << lastFrame << Qt::endl;
+
+    // Enough passes that each query is timed over a few million lookups
+    const int passes = int(qBound<qint64>(1, 4000000 / qMax<qint64>(lookups, 1), 10000));
+    qint64 checksum = 0;    // Keeps the lookups from being optimized away
+    auto time = [&](const QString& name, auto query) {
+        QElapsedTimer timer;
+        timer.start();
+        for (int pass = 0; pass < passes; ++pass) {
+            for (int layer = 0; layer < layerCount; ++layer) {
+                for (int frame = firstFrame; frame <= lastFrame; ++frame) {
+                    checksum += query(frame, layer);
+                }
+            }
+        }
+        const double nanoseconds = double(timer.nsecsElapsed()) / double(qMax<qint64>(lookups * passes, 1));
+        out() << QString("%1 %2 ns").arg(name, -22).arg(nanoseconds, 8, 'f', 1) << Qt::endl;
+    };
+    time("getFrameType", [&canvas](int frame, int layer) { return int(canvas.getFrameType(frame, layer)); });
+    time("getSourceKeyframe", [&canvas](int frame, int layer) { return canvas.getSourceKeyframe(frame, layer); });
+    time("isFrameTweened", [&canvas](int frame, int layer) { return int(canvas.isFrameTweened(frame, layer)); });
+    time("getLastKeyframeBefore", [&canvas](int frame, int layer) { return canvas.getLastKeyframeBefore(frame, layer); });
+    time("getNextKeyframeAfter", [&canvas](int frame, int layer) { return canvas.getNextKeyframeAfter(frame, layer); });
+    if (checksum == 0) {
+        out() << "(no content in the range)" << Qt::endl;
+    }
+
+    QTemporaryDir directory;
+    if (!directory.isValid()) {
+        err() << "FrameDirector: cannot create a temporary directory" << Qt::endl;
+        return RenderError;
+    }
+    const QString roundTripFile = directory.filePath("frame_store.fdr");
+
+    QElapsedTimer timer;
+    timer.start();
+    const CanvasSnapshot snapshot = canvas.captureSnapshot();
+    const qint64 captureMs = timer.restart();
+    if (!writeBinaryProject(snapshot, roundTripFile)) {
+        err() << "FrameDirector: cannot write " << roundTripFile << Qt::endl;
+        return RenderError;
+    }
+    const qint64 saveMs = timer.restart();
+    ProjectContainer project;
+    Canvas reloaded;
+    if (!project.read(roundTripFile) || !reloaded.fromProject(project)) {
+        err() << "FrameDirector: cannot load " << roundTripFile << " back" << Qt::endl;
+        return RenderError;
+    }
+    const qint64 loadMs = timer.elapsed();
+    out() << "Round trip: capture " << captureMs << " ms, save " << saveMs << " ms, load " << loadMs
+          << " ms, " << QString::number(QFileInfo(roundTripFile).size() / (1024.0 * 1024.0), 'f', 1)
+          << " MB" << Qt::endl;
+
+    if (reloaded.getLayerCount() != layerCount) {
+        err() << "FrameDirector: " << reloaded.getLayerCount() << " layers came back instead of "
+              << layerCount << Qt::endl;
+        return RenderError;
+    }
+    const int checkedLast = qMax(lastFrame, qMax(canvas.getLastContentFrame(), reloaded.getLastContentFrame()));
+    for (int layer = 0; layer < layerCount; ++layer) {
+        for (int frame = 1; frame <= checkedLast; ++frame) {
+            if (reloaded.getFrameType(frame, layer) != canvas.getFrameType(frame, layer) ||
+                reloaded.getSourceKeyframe(frame, layer) != canvas.getSourceKeyframe(frame, layer) ||
+                reloaded.isFrameTweened(frame, layer) != canvas.isFrameTweened(frame, layer)) {
+                err() << "FrameDirector: frame " << frame << " of layer " << layer
+                      << " differs after the round trip" << Qt::endl;
+                return RenderError;
+            }
+        }
+    }
+    out() << "Round trip kept every frame" << Qt::endl;
+    return Success;
+}
+
+// Steps the canvas through the range one frame at a time, as playback and
+// the timeline do, timing each Canvas::setCurrentFrame. Switches are grouped
+// by the number of items on stage afterwards; frames where every layer holds
+// the previous frame's content are reported apart, since only the layers'
+// properties are refreshed for them.
+int BatchRenderer::benchFrameSwitch()
+{
+    Canvas& canvas = *m_canvas;
+    const int layerCount = canvas.getLayerCount();
+    auto holdsPrevious = [&canvas, layerCount](int frame) {
+        for (int layer = 0; layer < layerCount; ++layer) {
+            if (canvas.isFrameTweened(frame, layer) ||
+                canvas.getSourceKeyframe(frame, layer) != canvas.getSourceKeyframe(frame - 1, layer)) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    struct Latency {
+        int switches = 0;
+        qint64 totalNs = 0;
+        qint64 maxNs = 0;
+        void add(qint64 ns) { ++switches; totalNs += ns; maxNs = qMax(maxNs, ns); }
+    };
+    QMap<int, Latency> byItems;     // Keyed by the power of ten below the item count
+    Latency held;
+
+    canvas.setCurrentFrame(m_options.firstFrame);
+    QElapsedTimer timer;
+    for (int frame = m_options.firstFrame + 1; frame <= m_options.lastFrame; ++frame) {
+        const bool hold = holdsPrevious(frame);
+        timer.start();
+        canvas.setCurrentFrame(frame);
+        const qint64 ns = timer.nsecsElapsed();
+
+        int bucket = 0;
+        for (int items = int(canvas.scene()->items().size()); items >= 10; items /= 10) {
+            bucket = bucket == 0 ? 10 : bucket * 10;
+        }
+        byItems[bucket].add(ns);
+        if (hold) {
+            held.add(ns);
+        }
+    }
+
+    auto report = [](const QString& label, const Latency& latency) {
+        out() << QString("%1 %2 %3 ms %4 ms")
+                     .arg(label, -14)
+                     .arg(latency.switches, 8)
+                     .arg(latency.totalNs / 1e6 / qMax(latency.switches, 1), 9, 'f', 3)
+                     .arg(latency.maxNs / 1e6, 9, 'f', 3)
+              << Qt::endl;
+    };
+    out() << "Items on stage Switches   Average          Max" << Qt::endl;
+    for (auto it = byItems.constBegin(); it != byItems.constEnd(); ++it) {
+        report(it.key() == 0 ? QString("0-9") : QString("%1-%2").arg(it.key()).arg(it.key() * 10 - 1), it.value());
+    }
+    if (held.switches > 0) {
+        report("held frames", held);
+    }
+    return Success;
+}
+
+// Each mode renders the range in a process of its own, the way a user's
+// "--render --format mp4" runs, with FRAMEDIRECTOR_FFMPEG pointing back at
+// this executable as the stub encoder:
+//
+//   count       reads everything; every frame must arrive, whole
+//   slow        reads at FRAMEDIRECTOR_STUB_RATE MB/s (default 100), so the
+//               encoder queue fills and back-pressure holds the exporter
+//   exit-early  fails after FRAMEDIRECTOR_STUB_EXIT_BYTES (default 16 MB),
+//               so the export gives up the way a cancel does
+//
+// Back-pressure only starts once more than 64 MB are queued, so the range
+// should be well above that, e.g. 100 frames at 1920x1080.
+int BatchRenderer::checkMp4Stream()
+{
+    const int frameCount = m_options.lastFrame - m_options.firstFrame + 1;
+    const qint64 exitBytes = qEnvironmentVariableIsEmpty("FRAMEDIRECTOR_STUB_EXIT_BYTES")
+        ? qint64(16) * 1024 * 1024 : qgetenv("FRAMEDIRECTOR_STUB_EXIT_BYTES").toLongLong();
+
+    QTemporaryDir directory;
+    if (!directory.isValid()) {
+        err() << "FrameDirector: cannot create a temporary directory" << Qt::endl;
+        return RenderError;
+    }
+    const QString output = directory.filePath("stream.mp4");
+
+    auto render = [this, &output](const QString& mode, qint64& ms) {
+        QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+        environment.insert("FRAMEDIRECTOR_FFMPEG", QCoreApplication::applicationFilePath());
+        environment.insert(kStubEncoderVariable, mode);
+        if (!environment.contains("QT_QPA_PLATFORM")) {
+            environment.insert("QT_QPA_PLATFORM", "offscreen");
+        }
+        QFile::remove(output);
+
+        QElapsedTimer timer;
+        timer.start();
+        QProcess renderer;
+        renderer.setProcessEnvironment(environment);
+        renderer.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        renderer.setStandardOutputFile(QProcess::nullDevice());
+        renderer.start(QCoreApplication::applicationFilePath(),
+            { kRenderOption, m_options.projectFile,
+              "--frames", QString("%1-%2").arg(m_options.firstFrame).arg(m_options.lastFrame),
+              "--format", "mp4", "--jobs", "1", "--out", output });
+        const bool finished = renderer.waitForFinished(-1) && renderer.exitStatus() == QProcess::NormalExit;
+        ms = timer.elapsed();
+        return finished ? renderer.exitCode() : -1;
+    };
+
+    QStringList failures;
+    qint64 counted = -1;
+    for (const QString mode : { QString("count"), QString("slow") }) {
+        qint64 ms = 0;
+        const int code = render(mode, ms);
+        QFile report(output);
+        if (code != Success || !report.open(QIODevice::ReadOnly)) {
+            failures << QString("%1: exit code %2").arg(mode).arg(code);
+            continue;
+        }
+        const QJsonObject stats = QJsonDocument::fromJson(report.readAll()).object();
+        const qint64 received = qint64(stats.value("bytes").toDouble());
+        const qint64 frameBytes = qMax(qint64(stats.value("frameBytes").toDouble()), qint64(1));
+        out() << QString("%1 %2 frames, %3 MB in %4 s")
+                     .arg(mode, -10)
+                     .arg(received / frameBytes)
+                     .arg(received / (1024.0 * 1024.0), 0, 'f', 1)
+                     .arg(ms / 1000.0, 0, 'f', 1)
+              << Qt::endl;
+        if (received != frameCount * frameBytes) {
+            failures << QString("%1: received %2 bytes, expected %3 frames of %4")
+                            .arg(mode).arg(received).arg(frameCount).arg(frameBytes);
+        }
+        if (mode == "count") {
+            counted = received;
+            if (received <= qint64(4) * 64 * 1024 * 1024) {
+                out() << "note: too little data to exercise back-pressure; render more frames" << Qt::endl;
+            }
+        }
+    }
+
+    qint64 ms = 0;
+    const int code = render("exit-early", ms);
+    out() << QString("%1 exit code %2 in %3 s").arg("exit-early", -10).arg(code).arg(ms / 1000.0, 0, 'f', 1)
+          << Qt::endl;
+    if (counted >= 0 && counted <= exitBytes) {
+        out() << "note: the range fits before the stub exits; render more frames" << Qt::endl;
+    }
+    else if (code != RenderError) {
+        failures << QString("exit-early: exit code %1, expected %2").arg(code).arg(int(RenderError));
+    }
+    if (QFileInfo::exists(output)) {
+        failures << "exit-early: the partial output was left behind";
+    }
+
+    for (const QString& failure : failures) {
+        out() << "FAILED " << failure << Qt::endl;
+    }
+    if (!failures.isEmpty()) {
+        return RenderError;
+    }
+    out() << "OK" << Qt::endl;
+    return Success;
+}
+
+int BatchRenderer::runStubEncoder(const QString& mode, const QStringList& arguments)
+{
+    const QStringList size = arguments.value(arguments.indexOf("-s") + 1).split('x');
+    const qint64 frameBytes = qint64(size.value(0).toInt()) * size.value(1).toInt() * 4;
+    const QString output = arguments.value(arguments.size() - 1);
+    const double rate = (qEnvironmentVariableIsEmpty("FRAMEDIRECTOR_STUB_RATE")
+        ? 100.0 : qgetenv("FRAMEDIRECTOR_STUB_RATE").toDouble()) * 1024 * 1024;
+    const qint64 exitBytes = qEnvironmentVariableIsEmpty("FRAMEDIRECTOR_STUB_EXIT_BYTES")
+        ? qint64(16) * 1024 * 1024 : qgetenv("FRAMEDIRECTOR_STUB_EXIT_BYTES").toLongLong();
+
+#ifdef Q_OS_WIN
+    // Raw frames, not text
+    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+    QFile input;
+    if (frameBytes <= 0 || output.isEmpty() || !input.open(stdin, QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        err() << "stub encoder: unexpected arguments " << arguments.join(' ') << Qt::endl;
+        return UsageError;
+    }
+
+    qint64 received = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (;;) {
+        const QByteArray block = input.read(256 * 1024);
+        if (block.isEmpty()) {
+            break;
+        }
+        received += block.size();
+        if (mode == "exit-early" && received >= exitBytes) {
+            err() << "stub encoder: stopping after " << received << " bytes" << Qt::endl;
+            return RenderError;
+        }
+        if (mode == "slow") {
+            const qint64 behindMs = qint64(received * 1000.0 / rate) - timer.elapsed();
+            if (behindMs > 0) {
+                QThread::msleep(static_cast<unsigned long>(behindMs));
+            }
+        }
+    }
+
+    QJsonObject stats;
+    stats["bytes"] = double(received);
+    stats["frameBytes"] = double(frameBytes);
+    QSaveFile report(output);
+    if (!report.open(QIODevice::WriteOnly) || report.write(QJsonDocument(stats).toJson()) < 0 || !report.commit()) {
+        err() << "stub encoder: cannot write " << output << Qt::endl;
+        return RenderError;
+    }
+    return Success;
+}
+
+// For mp4, gif and sprite sheets (the JSON file), --out names the file or
+// the directory it goes in
+QString BatchRenderer::outputFile() const
+{
+    const QString extension = m_options.format == "sprites" ? QString("json") : m_options.format;
+    if (m_options.output.endsWith('.' + extension, Qt::CaseInsensitive)) {
+        return m_options.output;
+    }
+    const QString name = QFileInfo(m_options.projectFile).completeBaseName() + '.' + extension;
+    return QDir(m_options.output).filePath(name);
+}
+
+bool BatchRenderer::renderRange(const QString& target, int firstFrame, int lastFrame)
+{
+    if (m_options.format == "gif") {
+        return renderGif(target, firstFrame, lastFrame);
+    }
+    if (m_options.format == "mp4") {
+        return renderMp4(target, firstFrame, lastFrame);
+    }
+    if (m_options.format == "sprites") {
+        return renderSprites(target, firstFrame, lastFrame);
+    }
+    return renderPng(target, firstFrame, lastFrame);
+}
+
+bool BatchRenderer::renderPng(const QString& directory, int firstFrame, int lastFrame)
+{
+    Canvas* canvas = m_canvas.get();
+    FrameExporter exporter;
+    exporter.setSnapshotProvider([canvas](int frame) {
+        return canvas->captureFrameSnapshot(frame);
+    });
+    exporter.setHoldDetector([canvas](int frame) {
+        return canvas->isHoldFrame(frame);
+    });
+    QObject::connect(&exporter, &FrameExporter::progress, [this](int done, int total) {
+        reportProgress(done, total);
+    });
+
+    // Every size comes out of the one render of each frame; the options
+    // were validated with the arguments
+    PngEncoder::Options png;
+    PngEncoder::optionsFromName(m_options.pngCompression, png);
+    if (!m_options.pngFilter.isEmpty()) {
+        PngEncoder::filterFromName(m_options.pngFilter, png.filter);
+    }
+    MultiResolutionWriter writer(m_sizes, directory);
+    writer.setPngOptions(png);
+    QString error;
+    if (!writer.attach(exporter, &error)) {
+        err() << "FrameDirector: " << error << Qt::endl;
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const bool rendered = exporter.run(firstFrame, lastFrame,
+        [&writer](int frame, const QImage&, int sourceFrame) {
+            return sourceFrame == frame || writer.linkHeld(frame, sourceFrame);
+        });
+    if (!rendered) {
+        err() << "FrameDirector: rendering frames " << firstFrame << "-" << lastFrame << " failed" << Qt::endl;
+    }
+    else if (!m_options.segment) {
+        out() << "PNG: " << writer.statistics(lastFrame - firstFrame + 1, timer.nsecsElapsed() / 1e9) << Qt::endl;
+    }
+    return rendered;
+}
+
+bool BatchRenderer::renderGif(const QString& filename, int firstFrame, int lastFrame)
+{
+    GifEncoder::Options options;
+    options.dither = GifEncoder::ditherFromName(m_options.dither);
+    options.frameRate = m_options.frameRate;
+
+    GifEncoder gif;
+    if (!gif.open(filename, m_canvas->getCanvasSize(), options)) {
+        err() << "FrameDirector: cannot write " << filename << ": " << gif.errorString() << Qt::endl;
+        return false;
+    }
+
+    Canvas* canvas = m_canvas.get();
+    FrameExporter exporter;
+    exporter.setSnapshotProvider([canvas](int frame) {
+        return canvas->captureFrameSnapshot(frame);
+    });
+    exporter.setHoldDetector([canvas](int frame) {
+        return canvas->isHoldFrame(frame);
+    });
+    exporter.setOutputFormat(QImage::Format_ARGB32);
+    const GifEncoder::Dither dither = options.dither;
+    exporter.setProcessor([dither](int frame, const QImage& image) {
+        Q_UNUSED(frame);
+        return GifEncoder::quantize(image, QVector<QRgb>(), dither);
+    });
+    QObject::connect(&exporter, &FrameExporter::progress, [this](int done, int total) {
+        reportProgress(done, total);
+    });
+
+    const bool rendered = exporter.run(firstFrame, lastFrame,
+        [&gif](int frame, const QImage& indexed, int sourceFrame) {
+            return sourceFrame != frame ? gif.extendLastFrame() : gif.addFrame(indexed);
+        });
+    const bool closed = gif.close();
+    if (!rendered || !closed) {
+        err() << "FrameDirector: GIF export failed: " << gif.errorString() << Qt::endl;
+        QFile::remove(filename);
+        return false;
+    }
+    return true;
+}
+
+bool BatchRenderer::renderSprites(const QString& jsonFile, int firstFrame, int lastFrame)
+{
+    Canvas* canvas = m_canvas.get();
+    FrameExporter exporter;
+    exporter.setSnapshotProvider([canvas](int frame) {
+        return canvas->captureFrameSnapshot(frame, QVector<int>(), false);
+    });
+    exporter.setHoldDetector([canvas](int frame) {
+        return canvas->isHoldFrame(frame);
+    });
+    QObject::connect(&exporter, &FrameExporter::progress, [this](int done, int total) {
+        reportProgress(done, total);
+    });
+
+    SpriteSheetExporter::Options options;
+    options.frameRate = m_options.frameRate;
+
+    SpriteSheetExporter sheet;
+    if (!sheet.exportSheet(exporter, firstFrame, lastFrame, canvas->getCanvasSize(), jsonFile, options)) {
+        err() << "FrameDirector: sprite sheet export failed: " << sheet.errorString() << Qt::endl;
+        return false;
+    }
+    return true;
+}
+
+bool BatchRenderer::renderMp4(const QString& filename, int firstFrame, int lastFrame)
+{
+    const QSize size = m_canvas->getCanvasSize();
+    const QString pixelFormat = QSysInfo::ByteOrder == QSysInfo::LittleEndian ? "bgra" : "argb";
+    const QStringList audio = m_options.segment ? QStringList() : audioInputArguments();
+
+    QStringList arguments;
+    arguments << "-y" << "-loglevel" << "error";
+    arguments << "-f" << "rawvideo" << "-pix_fmt" << pixelFormat;
+    arguments << "-s" << QString("%1x%2").arg(size.width()).arg(size.height());
+    arguments << "-framerate" << QString::number(m_options.frameRate);
+    arguments << "-i" << "-";
+    arguments << audio;
+    arguments << AnimationController::mp4EncodingArguments(QString(), m_options.quality);
+    if (!audio.isEmpty()) {
+        arguments << "-c:a" << "aac" << "-shortest";
+    }
+    arguments << filename;
+
+    QProcess encoder;
+    encoder.start(AnimationController::ffmpegProgram(), arguments);
+    if (!encoder.waitForStarted(3000)) {
+        err() << "FrameDirector: cannot start " << AnimationController::ffmpegProgram() << Qt::endl;
+        return false;
+    }
+
+    Canvas* canvas = m_canvas.get();
+    FrameExporter exporter;
+    exporter.setSnapshotProvider([canvas](int frame) {
+        return canvas->captureFrameSnapshot(frame);
+    });
+    exporter.setHoldDetector([canvas](int frame) {
+        return canvas->isHoldFrame(frame);
+    });
+    exporter.setOutputFormat(QImage::Format_ARGB32);
+    QObject::connect(&exporter, &FrameExporter::progress, [this](int done, int total) {
+        reportProgress(done, total);
+    });
+
+    const bool rendered = exporter.run(firstFrame, lastFrame,
+        [&encoder](int frame, const QImage& image, int sourceFrame) {
+            Q_UNUSED(frame);
+            Q_UNUSED(sourceFrame);
+            // Nothing to keep responsive here, so simply wait for ffmpeg
+            return AnimationController::writeToEncoder(encoder, image);
+        });
+
+    encoder.closeWriteChannel();
+    if (!rendered) {
+        encoder.kill();
+        encoder.waitForFinished(3000);
+    }
+    else {
+        encoder.waitForFinished(-1);
+    }
+
+    if (!rendered || encoder.exitStatus() != QProcess::NormalExit || encoder.exitCode() != 0) {
+        err() << "FrameDirector: MP4 encoding failed: "
+              << QString::fromLocal8Bit(encoder.readAllStandardError()) << Qt::endl;
+        QFile::remove(filename);
+        return false;
+    }
+    return true;
+}
+
+// Splits the range into one contiguous part per worker. PNG workers write
+// into the output directory directly; MP4 and GIF parts are joined after all
+// workers succeeded.
+bool BatchRenderer::renderWithWorkers(const QString& target, int jobs)
+{
+    const bool png = m_options.format == "png";
+    const QString workDir = png ? QString()
+        : QDir(QFileInfo(target).absolutePath()).filePath(
+              QString(".framedirector_parts_%1").arg(QCoreApplication::applicationPid()));
+    if (!png && !QDir().mkpath(workDir)) {
+        err() << "FrameDirector: cannot create " << workDir << Qt::endl;
+        return false;
+    }
+
+    // Share the cores between the workers' render pools
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    if (!environment.contains("FRAMEDIRECTOR_EXPORT_THREADS")) {
+        environment.insert("FRAMEDIRECTOR_EXPORT_THREADS", QString::number(qMax(1, QThread::idealThreadCount() / jobs)));
+    }
+    if (!environment.contains("QT_QPA_PLATFORM")) {
+        environment.insert("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    const int frameCount = m_options.lastFrame - m_options.firstFrame + 1;
+    std::vector<std::unique_ptr<QProcess>> workers;
+    QStringList parts;
+    bool ok = true;
+
+    for (int job = 0; job < jobs && ok; ++job) {
+        const int first = m_options.firstFrame + frameCount * job / jobs;
+        const int last = m_options.firstFrame + frameCount * (job + 1) / jobs - 1;
+        const QString part = png ? target
+            : QDir(workDir).filePath(QString("part_%1.%2").arg(job, 3, 10, QChar('0')).arg(m_options.format));
+        parts.append(part);
+
+        QStringList arguments;
+        arguments << kRenderOption << m_options.projectFile;
+        arguments << "--frames" << QString("%1-%2").arg(first).arg(last);
+        arguments << "--out" << part;
+        arguments << "--format" << m_options.format;
+        arguments << "--fps" << QString::number(m_options.frameRate);
+        arguments << "--quality" << QString::number(m_options.quality);
+        arguments << "--dither" << m_options.dither;
+        if (!m_options.sizes.isEmpty()) {
+            arguments << "--sizes" << m_options.sizes;
+        }
+        if (png) {
+            arguments << "--png-compression" << m_options.pngCompression;
+            if (!m_options.pngFilter.isEmpty()) {
+                arguments << "--png-filter" << m_options.pngFilter;
+            }
+        }
+        arguments << "--segment";
+
+        auto worker = std::make_unique<QProcess>();
+        worker->setProcessEnvironment(environment);
+        worker->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        worker->start(QCoreApplication::applicationFilePath(), arguments);
+        if (!worker->waitForStarted()) {
+            err() << "FrameDirector: cannot start worker " << job << Qt::endl;
+            ok = false;
+        }
+        workers.push_back(std::move(worker));
+    }
+
+    if (!m_options.segment) {
+        out() << "Rendering frames " << m_options.firstFrame << "-" << m_options.lastFrame
+              << " in " << jobs << " processes" << Qt::endl;
+    }
+
+    for (int job = 0; job < static_cast<int>(workers.size()); ++job) {
+        QProcess* worker = workers[job].get();
+        if (!ok) {
+            worker->kill();
+        }
+        worker->waitForFinished(-1);
+        if (worker->exitStatus() != QProcess::NormalExit || worker->exitCode() != Success) {
+            if (ok) {
+                err() << "FrameDirector: worker " << job << " failed with exit code " << worker->exitCode() << Qt::endl;
+            }
+            ok = false;
+        }
+        else if (!m_options.segment) {
+            out() << "Worker " << job + 1 << "/" << jobs << " finished" << Qt::endl;
+        }
+    }
+
+    if (ok && m_options.format == "gif") {
+        QString error;
+        ok = GifEncoder::concatenate(parts, target, &error);
+        if (!ok) {
+            err() << "FrameDirector: joining GIF parts failed: " << error << Qt::endl;
+        }
+    }
+    else if (ok && m_options.format == "mp4") {
+        ok = concatenateMp4(parts, target, workDir);
+    }
+
+    if (!png) {
+        QDir(workDir).removeRecursively();
+    }
+    return ok;
+}
+
+// Parts share their encoding settings, so ffmpeg's concat demuxer joins them
+// without re-encoding; the soundtrack is added here rather than per part
+bool BatchRenderer::concatenateMp4(const QStringList& parts, const QString& filename, const QString& workDir)
+{
+    const QString listFile = QDir(workDir).filePath("parts.txt");
+    QFile list(listFile);
+    if (!list.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        err() << "FrameDirector: cannot write " << listFile << Qt::endl;
+        return false;
+    }
+    QTextStream stream(&list);
+    for (const QString& part : parts) {
+        QString path = QFileInfo(part).absoluteFilePath();
+        path.replace("'", "'\\''");
+        stream << "file '" << path << "'\n";
+    }
+    stream.flush();
+    list.close();
+
+    const QStringList audio = audioInputArguments();
+    QStringList arguments;
+    arguments << "-y" << "-loglevel" << "error";
+    arguments << "-f" << "concat" << "-safe" << "0" << "-i" << listFile;
+    arguments << audio;
+    arguments << "-map" << "0:v" << "-c:v" << "copy";
+    if (!audio.isEmpty()) {
+        arguments << "-map" << "1:a" << "-c:a" << "aac" << "-shortest";
+    }
+    arguments << filename;
+
+    QProcess process;
+    process.start(AnimationController::ffmpegProgram(), arguments);
+    if (!process.waitForStarted(3000)) {
+        err() << "FrameDirector: cannot start " << AnimationController::ffmpegProgram() << Qt::endl;
+        return false;
+    }
+    process.waitForFinished(-1);
+    if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+        err() << "FrameDirector: joining MP4 parts failed: "
+              << QString::fromLocal8Bit(process.readAllStandardError()) << Qt::endl;
+        QFile::remove(filename);
+        return false;
+    }
+    return true;
+}
+
+// The soundtrack starts at frame 1, so a later range skips into it
+QStringList BatchRenderer::audioInputArguments() const
+{
+    if (m_audioFile.isEmpty() || !QFileInfo::exists(m_audioFile)) {
+        return QStringList();
+    }
+    QStringList arguments;
+    if (m_options.firstFrame > 1) {
+        const double offset = (m_options.firstFrame - 1) / static_cast<double>(m_options.frameRate);
+        arguments << "-ss" << QString::number(offset, 'f', 3);
+    }
+    arguments << "-i" << m_audioFile;
+    return arguments;
+}
+
+void BatchRenderer::reportProgress(int done, int total)
+{
+    if (m_options.segment || total <= 0) {
+        return;
+    }
+    const int percent = done * 100 / total;
+    if (percent / 10 != m_reportedPercent / 10) {
+        m_reportedPercent = percent;
+        out() << "Rendered " << done << "/" << total << " frames (" << percent << "%)" << Qt::endl;
+    }
+}
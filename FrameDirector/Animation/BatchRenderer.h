@@ -0,0 +1,116 @@
+#ifndef BATCHRENDERER_H
+#define BATCHRENDERER_H
+
+#include <QString>
+#include <QSize>
+#include <QStringList>
+#include <QVector>
+#include <memory>
+
+class Canvas;
+
+// Headless export for scripts and render farms:
+//
+//   FrameDirector --render project.fdr [--frames 1-500] --out dir
+//                 [--format png|mp4|gif|sprites] [--jobs N] [--fps 24] [--quality 80]
+//                 [--dither none|ordered|diffusion] [--sizes 3840x2160,1920x1080,320]
+//                 [--png-compression fast|default|max|0-9] [--png-filter adaptive|none|sub|up|average|paeth]
+//   FrameDirector --render project.fdr --compare-formats
+//   FrameDirector --render project.fdr [--frames 1-1000] [--fps 24] [--dither ...] --compare-gif
+//   FrameDirector --render project.fdr [--frames 1-3000] --bench-frame-store
+//   FrameDirector --render project.fdr [--frames 1-3000] --bench-frame-switch
+//   FrameDirector --render project.fdr [--frames 1-100] --check-mp4-stream
+//
+// Runs without MainWindow, dialogs or message boxes, normally on the
+// offscreen platform plugin, and reports through stdout, stderr and the exit
+// code. Frames are captured from the scene on one GUI thread per process, so
+// --jobs splits the range across worker processes of this executable and the
+// parent stitches their output together. --compare-formats saves the
+// project as JSON and as binary and reports how long each takes to load and
+// at what peak memory, each loaded by a process of its own. --compare-gif
+// renders the range with GifEncoder and as the PNG sequence plus ImageMagick
+// that GIF export used before it, and reports the time and size of both.
+// --bench-frame-store times the exposure-sheet queries over every layer and
+// frame of the range, and round-trips the canvas through a binary project.
+// --bench-frame-switch steps the canvas through the range and reports the
+// frame-switch latency by the number of items on stage. --check-mp4-stream
+// renders the range as MP4 three times, with this executable standing in
+// for ffmpeg (see runStubEncoder), and checks that every frame arrives, that
+// back-pressure holds a slow encoder and that an encoder failing mid-stream
+// ends the render with RenderError and no partial file.
+class BatchRenderer
+{
+public:
+    enum ExitCode {
+        Success = 0,
+        UsageError = 1,
+        ProjectError = 2,
+        RenderError = 3
+    };
+
+    struct Options {
+        QString projectFile;
+        int firstFrame = 1;
+        int lastFrame = 0;      // 0: the last frame with content
+        QString output;         // Directory, or the .mp4/.gif/.json file to write
+        QString format = "png";
+        int jobs = 1;
+        int frameRate = 24;
+        int quality = 80;
+        QString dither = "none";
+        QString sizes;          // PNG only; see MultiResolutionWriter::parseSizes
+        QString pngCompression = "default"; // PNG only; see PngEncoder::optionsFromName
+        QString pngFilter;      // PNG only; empty for the compression's own filter
+        bool segment = false;   // Worker part: no audio, no progress output
+        bool compareFormats = false;
+        bool compareGif = false;
+        bool benchFrameStore = false;
+        bool benchFrameSwitch = false;
+        bool checkMp4Stream = false;
+        bool loadOnly = false;  // Comparison part: load, report and exit
+    };
+
+    // Whether main() should run a batch render instead of the editor. Also
+    // true for the stub encoder --check-mp4-stream starts.
+    static bool isBatchCommandLine(int argc, char** argv);
+
+    // Parses the arguments and renders; returns the process exit code.
+    // Needs a QApplication on the calling thread.
+    static int exec(const QStringList& arguments);
+
+    explicit BatchRenderer(const Options& options);
+    ~BatchRenderer();
+
+    int run();
+
+private:
+    static bool parseArguments(const QStringList& arguments, Options& options, QString& error);
+
+    bool loadProject();
+    int compareFormats();
+    int compareGif();
+    int benchFrameStore();
+    int benchFrameSwitch();
+    int checkMp4Stream();
+    // Takes ffmpeg's place for --check-mp4-stream: reads the raw frames from
+    // stdin and writes how many bytes arrived to the output file
+    static int runStubEncoder(const QString& mode, const QStringList& arguments);
+    QString outputFile() const;
+    bool renderRange(const QString& target, int firstFrame, int lastFrame);
+    bool renderPng(const QString& directory, int firstFrame, int lastFrame);
+    bool renderGif(const QString& filename, int firstFrame, int lastFrame);
+    bool renderMp4(const QString& filename, int firstFrame, int lastFrame);
+    bool renderSprites(const QString& jsonFile, int firstFrame, int lastFrame);
+    bool renderWithWorkers(const QString& target, int jobs);
+    bool concatenateMp4(const QStringList& parts, const QString& filename, const QString& workDir);
+    QStringList audioInputArguments() const;
+    void reportProgress(int done, int total);
+
+    Options m_options;
+    std::unique_ptr<Canvas> m_canvas;
+    QString m_audioFile;
+    QVector<QSize> m_sizes;
+    int m_reportedPercent;
+};
+
+#endif // BATCHRENDERER_H
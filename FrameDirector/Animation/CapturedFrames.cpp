@@ -0,0 +1,184 @@
+// Animation/CapturedFrames.cpp
+#include "CapturedFrames.h"
+#include "FrameExporter.h"
+#include "../Canvas.h"
+#include <QCoreApplication>
+#include <QMap>
+#include <QMutex>
+#include <QPointer>
+#include <QThread>
+#include <QWaitCondition>
+
+namespace {
+// How often a job waiting for a capture checks for cancellation
+const int kCancelPollMs = 50;
+}
+
+struct CapturedFrames::Frame {
+    bool captured = false;
+    bool hold = false;
+    FrameSnapshot snapshot;
+};
+
+struct CapturedFrames::State {
+    QPointer<Canvas> canvas;    // GUI thread only
+    int firstFrame = 1;
+    int lastFrame = 0;
+    bool includeBackground = true;
+    QSize canvasSize;
+
+    QMutex mutex;
+    QWaitCondition captured;
+    QMap<int, Frame> frames;    // Captured or queued frames not yet passed
+    int lookAhead = 1;
+    int nextInOrder = 0;        // The frame asked for next when reading in order
+    std::function<bool()> cancelled;
+
+    // GUI thread only: the last frame captured, for holds to share
+    int lastCapturedFrame = -1;
+    FrameSnapshot lastSnapshot;
+};
+
+CapturedFrames CapturedFrames::capture(Canvas* canvas, int firstFrame, int lastFrame, bool includeBackground)
+{
+    CapturedFrames frames;
+    if (!canvas || lastFrame < firstFrame) {
+        return frames;
+    }
+
+    frames.m_state = std::make_shared<State>();
+    frames.m_state->canvas = canvas;
+    frames.m_state->firstFrame = firstFrame;
+    frames.m_state->lastFrame = lastFrame;
+    frames.m_state->includeBackground = includeBackground;
+    frames.m_state->canvasSize = canvas->getCanvasSize();
+    frames.m_state->nextInOrder = firstFrame;
+    return frames;
+}
+
+bool CapturedFrames::isEmpty() const
+{
+    return !m_state;
+}
+
+int CapturedFrames::firstFrame() const
+{
+    return m_state ? m_state->firstFrame : 1;
+}
+
+int CapturedFrames::lastFrame() const
+{
+    return m_state ? m_state->lastFrame : 0;
+}
+
+QSize CapturedFrames::canvasSize() const
+{
+    return m_state ? m_state->canvasSize : QSize();
+}
+
+FrameSnapshot CapturedFrames::snapshot(int frame) const
+{
+    return fetch(frame).snapshot;
+}
+
+bool CapturedFrames::isHold(int frame) const
+{
+    return fetch(frame).hold;
+}
+
+void CapturedFrames::setLookAhead(int frames) const
+{
+    if (m_state) {
+        QMutexLocker locker(&m_state->mutex);
+        m_state->lookAhead = qMax(1, frames);
+    }
+}
+
+void CapturedFrames::setCancelCheck(std::function<bool()> cancelled) const
+{
+    if (m_state) {
+        QMutexLocker locker(&m_state->mutex);
+        m_state->cancelled = std::move(cancelled);
+    }
+}
+
+CapturedFrames::Frame CapturedFrames::fetch(int frame) const
+{
+    if (!m_state || frame < m_state->firstFrame || frame > m_state->lastFrame) {
+        return Frame();
+    }
+    const std::shared_ptr<State> state = m_state;
+
+    QMutexLocker locker(&state->mutex);
+
+    // Earlier frames are done with; reading in order also queues the frames
+    // the exporter will ask for next
+    state->frames.erase(state->frames.begin(), state->frames.lowerBound(frame));
+    const int ahead = frame == state->nextInOrder ? qMin(state->lastFrame, frame + state->lookAhead - 1) : frame;
+    state->nextInOrder = frame + 1;
+    QVector<int> missing;
+    for (int f = frame; f <= ahead; ++f) {
+        if (!state->frames.contains(f)) {
+            state->frames.insert(f, Frame());
+            missing.append(f);
+        }
+    }
+
+    if (!missing.isEmpty()) {
+        if (QThread::currentThread() == qApp->thread()) {
+            locker.unlock();
+            captureFrames(state, missing);
+            locker.relock();
+        }
+        else {
+            QMetaObject::invokeMethod(qApp, [state, missing]() {
+                captureFrames(state, missing);
+            }, Qt::QueuedConnection);
+        }
+    }
+
+    while (!state->frames.value(frame).captured) {
+        if (state->cancelled && state->cancelled()) {
+            return Frame();
+        }
+        state->captured.wait(&state->mutex, kCancelPollMs);
+    }
+    return state->frames.value(frame);
+}
+
+// GUI thread
+void CapturedFrames::captureFrames(const std::shared_ptr<State>& state, const QVector<int>& frames)
+{
+    Canvas* canvas = state->canvas.data();
+    for (int frame : frames) {
+        Frame captured;
+        captured.captured = true;
+        if (canvas) {
+            captured.hold = frame > state->firstFrame && canvas->isHoldFrame(frame);
+            captured.snapshot = captured.hold && state->lastCapturedFrame == frame - 1
+                ? state->lastSnapshot
+                : canvas->captureFrameSnapshot(frame, QVector<int>(), state->includeBackground);
+        }
+        state->lastCapturedFrame = frame;
+        state->lastSnapshot = captured.snapshot;
+
+        QMutexLocker locker(&state->mutex);
+        auto it = state->frames.find(frame);
+        if (it != state->frames.end()) {
+            it.value() = captured;
+        }
+        state->captured.wakeAll();
+    }
+}
+
+void CapturedFrames::attach(FrameExporter& exporter) const
+{
+    const CapturedFrames frames = *this;
+    frames.setLookAhead(exporter.lookAhead());
+    exporter.setSnapshotProvider([frames](int frame) {
+        return frames.snapshot(frame);
+    });
+    exporter.setHoldDetector([frames](int frame) {
+        return frames.isHold(frame);
+    });
+}
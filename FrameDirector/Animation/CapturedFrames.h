@@ -0,0 +1,58 @@
+#ifndef CAPTUREDFRAMES_H
+#define CAPTUREDFRAMES_H
+
+#include "FrameSnapshot.h"
+#include <QSize>
+#include <functional>
+#include <memory>
+
+class Canvas;
+class FrameExporter;
+
+// Snapshots of a frame range for an export job rendering on another thread
+// while editing goes on. Frames are captured on the GUI thread on demand:
+// a request for a frame queues the capture of it and of the frames just
+// after it, as many as the exporter renders ahead, and the job waits only
+// for that frame. Snapshots are dropped once a later frame is asked for, so
+// the export holds a window of frames rather than the whole range; frames
+// captured after an edit show it. Held frames share the snapshot of the
+// frame they repeat (snapshots are implicitly shared).
+class CapturedFrames
+{
+public:
+    CapturedFrames() = default;
+
+    // GUI thread only. Captures nothing yet.
+    static CapturedFrames capture(Canvas* canvas, int firstFrame, int lastFrame, bool includeBackground = true);
+
+    bool isEmpty() const;
+    int firstFrame() const;
+    int lastFrame() const;
+    QSize canvasSize() const;
+
+    // Thread-safe; invalid outside the range, once the canvas is gone, or
+    // when the cancel check fires while waiting for the GUI thread
+    FrameSnapshot snapshot(int frame) const;
+    bool isHold(int frame) const;
+
+    // Frames captured past the one asked for, while frames are asked for
+    // in order; attach() sets it to the exporter's window
+    void setLookAhead(int frames) const;
+    // Polled while waiting for a capture, so a job being cancelled while the
+    // GUI thread waits for it does not deadlock
+    void setCancelCheck(std::function<bool()> cancelled) const;
+
+    // Makes the exporter render from these snapshots and skip the holds
+    void attach(FrameExporter& exporter) const;
+
+private:
+    struct State;
+    struct Frame;
+
+    Frame fetch(int frame) const;
+    static void captureFrames(const std::shared_ptr<State>& state, const QVector<int>& frames);
+
+    std::shared_ptr<State> m_state;
+};
+
+#endif // CAPTUREDFRAMES_H
@@ -0,0 +1,342 @@
+// Animation/FrameExporter.cpp
+#include "FrameExporter.h"
+#include <QEventLoop>
+#include <QElapsedTimer>
+#include <QDir>
+#include <QFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QLoggingCategory>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+// Frames captured ahead of delivery per worker; bounds the memory held by
+// snapshots and by rendered frames waiting for an earlier one
+const int kFramesPerThread = 2;
+}
+
+// Off by default; QT_LOGGING_RULES="framedirector.export.debug=true" reports
+// each export's timing and why one stopped
+Q_LOGGING_CATEGORY(lcFrameExporter, "framedirector.export", QtInfoMsg)
+
+FrameExporter::FrameExporter(QObject* parent)
+    : QObject(parent)
+    , m_pool(new QThreadPool(this))
+    , m_loop(nullptr)
+    , m_outputFormat(QImage::Format_ARGB32_Premultiplied)
+    , m_generation(0)
+    , m_firstFrame(1)
+    , m_lastFrame(0)
+    , m_nextToRender(1)
+    , m_nextToDeliver(1)
+    , m_inFlight(0)
+    , m_lastUniqueFrame(1)
+    , m_lastUniqueHash(0)
+    , m_renderedFrames(0)
+    , m_cancelled(false)
+    , m_delivering(false)
+    , m_success(false)
+    , m_framesPerSecond(0.0)
+{
+    int threads = QThread::idealThreadCount();
+    bool ok = false;
+    const int requested = qEnvironmentVariableIntValue("FRAMEDIRECTOR_EXPORT_THREADS", &ok);
+    if (ok && requested > 0) {
+        threads = requested;
+    }
+    setThreadCount(threads);
+}
+
+FrameExporter::~FrameExporter()
+{
+    // Workers call the encoder and post back to this object
+    m_pool->clear();
+    m_pool->waitForDone();
+}
+
+void FrameExporter::setSnapshotProvider(SnapshotProvider provider)
+{
+    m_provider = std::move(provider);
+}
+
+void FrameExporter::setProcessor(FrameProcessor processor)
+{
+    m_processor = std::move(processor);
+}
+
+void FrameExporter::setEncoder(FrameEncoder encoder)
+{
+    m_encoder = std::move(encoder);
+}
+
+void FrameExporter::setHoldDetector(HoldDetector detector)
+{
+    m_holdDetector = std::move(detector);
+}
+
+void FrameExporter::setOutputFormat(QImage::Format format)
+{
+    m_outputFormat = format;
+}
+
+void FrameExporter::setRenderSize(const QSize& size)
+{
+    m_renderSize = size;
+}
+
+void FrameExporter::setThreadCount(int threads)
+{
+    m_pool->setMaxThreadCount(qMax(1, threads));
+}
+
+int FrameExporter::threadCount() const
+{
+    return m_pool->maxThreadCount();
+}
+
+int FrameExporter::lookAhead() const
+{
+    return threadCount() * kFramesPerThread;
+}
+
+bool FrameExporter::run(int firstFrame, int lastFrame, FrameSink sink)
+{
+    if (!m_provider || lastFrame < firstFrame || m_loop) {
+        return false;
+    }
+
+    ++m_generation;
+    m_sink = std::move(sink);
+    m_ready.clear();
+    m_holds.clear();
+    m_lastDelivered = QImage();
+    m_firstFrame = firstFrame;
+    m_lastFrame = lastFrame;
+    m_nextToRender = firstFrame;
+    m_nextToDeliver = firstFrame;
+    m_inFlight = 0;
+    m_lastUniqueFrame = firstFrame;
+    m_lastUniqueHash = 0;
+    m_lastUniqueSnapshot = FrameSnapshot();
+    m_renderedFrames = 0;
+    m_cancelled = false;
+    m_delivering = false;
+    m_success = false;
+    m_framesPerSecond = 0.0;
+
+    const int total = lastFrame - firstFrame + 1;
+    emit progress(0, total);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QEventLoop loop;
+    m_loop = &loop;
+    deliverFrames();
+    if (m_loop) {
+        loop.exec();
+    }
+    m_loop = nullptr;
+
+    // A failed or cancelled run may still have frames on the workers
+    m_pool->clear();
+    m_pool->waitForDone();
+    ++m_generation;
+    m_ready.clear();
+    m_holds.clear();
+    m_lastDelivered = QImage();
+    m_sink = FrameSink();
+
+    if (m_success) {
+        const qint64 elapsed = qMax<qint64>(1, timer.elapsed());
+        m_framesPerSecond = total * 1000.0 / elapsed;
+        qCDebug(lcFrameExporter) << "exported" << total << "frames (" << m_renderedFrames << "rendered ) in"
+            << elapsed << "ms (" << m_framesPerSecond << "fps ) on" << threadCount() << "threads";
+    }
+    else if (m_cancelled) {
+        qCDebug(lcFrameExporter) << "cancelled after" << (m_nextToDeliver - firstFrame) << "of" << total << "frames";
+    }
+
+    return m_success;
+}
+
+void FrameExporter::cancel()
+{
+    if (!m_loop || m_cancelled) {
+        return;
+    }
+    m_cancelled = true;
+    finish(false);
+}
+
+void FrameExporter::scheduleFrames()
+{
+    const int window = lookAhead();
+
+    // Held frames cost nothing to queue, so only rendered ones fill the window
+    while (m_loop && m_nextToRender <= m_lastFrame && m_inFlight < window) {
+        const int frame = m_nextToRender;
+        const bool canHold = m_holdDetector && frame > m_firstFrame;
+
+        if (canHold && m_holdDetector(frame)) {
+            m_holds.insert(frame, m_lastUniqueFrame);
+            ++m_nextToRender;
+            continue;
+        }
+
+        const FrameSnapshot snapshot = m_provider(frame);
+        if (!snapshot.isValid()) {
+            qCDebug(lcFrameExporter) << "no snapshot for frame" << frame;
+            finish(false);
+            return;
+        }
+        ++m_nextToRender;
+
+        // Redrawn or copied keyframes that end up identical. The hash only
+        // picks candidates; a collision must not repeat the wrong frame.
+        if (m_holdDetector) {
+            const quint64 hash = snapshot.contentHash();
+            if (canHold && hash == m_lastUniqueHash && snapshot == m_lastUniqueSnapshot) {
+                m_holds.insert(frame, m_lastUniqueFrame);
+                continue;
+            }
+            m_lastUniqueHash = hash;
+            m_lastUniqueSnapshot = snapshot;
+        }
+
+        m_lastUniqueFrame = frame;
+        ++m_inFlight;
+        ++m_renderedFrames;
+        const int generation = m_generation;
+        const FrameProcessor processor = m_processor;
+        const FrameEncoder encoder = m_encoder;
+        const QImage::Format format = m_outputFormat;
+        const QSize renderSize = m_renderSize.isEmpty() ? snapshot.canvasSize() : m_renderSize;
+        m_pool->start([this, snapshot, frame, generation, processor, encoder, format, renderSize]() {
+            QImage image = snapshot.render(renderSize);
+            if (!image.isNull() && image.format() != format) {
+                image.convertTo(format);
+            }
+            if (!image.isNull() && processor) {
+                image = processor(frame, image);
+            }
+            const bool encoded = !image.isNull() && (!encoder || encoder(frame, image));
+            QMetaObject::invokeMethod(this, [this, frame, generation, image, encoded]() {
+                frameRendered(frame, generation, image, encoded);
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void FrameExporter::frameRendered(int frame, int generation, const QImage& image, bool encoded)
+{
+    if (generation != m_generation || !m_loop) {
+        return;
+    }
+
+    if (!encoded) {
+        qCDebug(lcFrameExporter) << "rendering or encoding frame" << frame << "failed";
+        finish(false);
+        return;
+    }
+
+    m_ready.insert(frame, image);
+    deliverFrames();
+}
+
+// Hands over every frame that is next in order, topping up the workers
+// whenever the next frame is still missing
+void FrameExporter::deliverFrames()
+{
+    if (m_delivering) {
+        return; // A sink spinning the event loop; the running delivery picks it up
+    }
+
+    m_delivering = true;
+    while (m_loop && m_nextToDeliver <= m_lastFrame) {
+        if (deliverNext()) {
+            continue;
+        }
+        // Newly scheduled frames may hold the one just delivered
+        scheduleFrames();
+        if (!m_holds.contains(m_nextToDeliver)) {
+            break;
+        }
+    }
+    m_delivering = false;
+
+    if (m_loop && m_nextToDeliver > m_lastFrame) {
+        finish(true);
+    }
+}
+
+// False when the next frame is not ready yet. A rejected frame ends the run,
+// which the caller sees through m_loop.
+bool FrameExporter::deliverNext()
+{
+    const int frame = m_nextToDeliver;
+    int sourceFrame = frame;
+    QImage image;
+
+    auto hold = m_holds.find(frame);
+    if (hold != m_holds.end()) {
+        sourceFrame = hold.value();
+        image = m_lastDelivered;
+        m_holds.erase(hold);
+    }
+    else {
+        auto ready = m_ready.find(frame);
+        if (ready == m_ready.end()) {
+            return false;
+        }
+        image = ready.value();
+        m_ready.erase(ready);
+        m_lastDelivered = image;
+        --m_inFlight;
+    }
+
+    if (m_sink && !m_sink(frame, image, sourceFrame)) {
+        if (m_loop) {
+            qCDebug(lcFrameExporter) << "sink rejected frame" << frame;
+        }
+        finish(false);
+        return true;
+    }
+
+    ++m_nextToDeliver;
+    emit progress(m_nextToDeliver - m_firstFrame, m_lastFrame - m_firstFrame + 1);
+    return true;
+}
+
+void FrameExporter::finish(bool success)
+{
+    if (!m_loop) {
+        return;
+    }
+    m_success = success && !m_cancelled;
+    m_loop->quit();
+    m_loop = nullptr;
+}
+
+bool FrameExporter::linkFrameFile(const QString& source, const QString& target)
+{
+    QFile::remove(target);
+#ifdef Q_OS_WIN
+    const QString nativeSource = QDir::toNativeSeparators(source);
+    const QString nativeTarget = QDir::toNativeSeparators(target);
+    if (CreateHardLinkW(reinterpret_cast<LPCWSTR>(nativeTarget.utf16()),
+                        reinterpret_cast<LPCWSTR>(nativeSource.utf16()), nullptr)) {
+        return true;
+    }
+#else
+    if (::link(QFile::encodeName(source).constData(), QFile::encodeName(target).constData()) == 0) {
+        return true;
+    }
+#endif
+    return QFile::copy(source, target);
+}
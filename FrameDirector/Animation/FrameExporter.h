@@ -0,0 +1,123 @@
+#ifndef FRAMEEXPORTER_H
+#define FRAMEEXPORTER_H
+
+#include "FrameSnapshot.h"
+#include <QObject>
+#include <QMap>
+#include <QImage>
+#include <functional>
+
+class QEventLoop;
+class QThreadPool;
+
+// Renders a range of frames for export on a worker pool. Frames are captured
+// as snapshots on the calling thread a few at a time just ahead of the
+// workers, so the live scene is never moved to another frame, and are handed
+// back in frame order. run() keeps the calling thread's event loop spinning,
+// so the UI stays responsive and cancel() can stop the export between
+// frames. run() may be called from a background job as long as the snapshot
+// provider does not touch the scene (see CapturedFrames).
+class FrameExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Called on the thread running run()
+    using SnapshotProvider = std::function<FrameSnapshot(int frame)>;
+    // Called on a worker thread to transform the rendered frame, e.g. to
+    // quantize it; the sink receives the result. Must be thread-safe; a null
+    // image fails the export.
+    using FrameProcessor = std::function<QImage(int frame, const QImage& image)>;
+    // Called on a worker thread right after the frame is rendered, e.g. to
+    // encode it. Must be thread-safe; returning false fails the export.
+    using FrameEncoder = std::function<bool(int frame, const QImage& image)>;
+    // Called on the thread running run() in frame order; returning false fails the
+    // export. sourceFrame is the frame whose render the image is: the frame
+    // itself, or the earlier frame it holds when hold detection is on.
+    using FrameSink = std::function<bool(int frame, const QImage& image, int sourceFrame)>;
+    // Called on the thread running run(); true when the frame shows exactly what the
+    // frame before it shows
+    using HoldDetector = std::function<bool(int frame)>;
+
+    explicit FrameExporter(QObject* parent = nullptr);
+    ~FrameExporter();
+
+    void setSnapshotProvider(SnapshotProvider provider);
+    void setProcessor(FrameProcessor processor);
+    void setEncoder(FrameEncoder encoder);
+
+    // Turns on hold deduplication. Frames the detector accepts, and frames
+    // whose snapshot hashes like the last rendered one, are not rendered,
+    // processed or encoded; the sink gets the held frame's image instead.
+    void setHoldDetector(HoldDetector detector);
+
+    // Pixel format frames are converted to on the workers before the
+    // processor, encoder and sink see them; defaults to the renderer's premultiplied ARGB32
+    void setOutputFormat(QImage::Format format);
+
+    // Size frames are rendered at; defaults to the snapshot's canvas size
+    void setRenderSize(const QSize& size);
+
+    // Worker threads; defaults to one per core, or FRAMEDIRECTOR_EXPORT_THREADS
+    void setThreadCount(int threads);
+    int threadCount() const;
+    // Rendered frames captured ahead of the one being delivered, at most
+    int lookAhead() const;
+
+    // Renders [firstFrame, lastFrame] and returns once every frame reached
+    // the sink, or false after a failure or cancel()
+    bool run(int firstFrame, int lastFrame, FrameSink sink = FrameSink());
+
+    bool wasCancelled() const { return m_cancelled; }
+
+    // Frames per second of the last completed run
+    double framesPerSecond() const { return m_framesPerSecond; }
+    // Frames actually rendered in the last run, holds excluded
+    int renderedFrameCount() const { return m_renderedFrames; }
+
+    // Makes target the same file as source: a hard link where the file
+    // system allows it, a copy otherwise. For image sequences with holds.
+    static bool linkFrameFile(const QString& source, const QString& target);
+
+public slots:
+    void cancel();
+
+signals:
+    void progress(int done, int total);
+
+private:
+    void scheduleFrames();
+    void frameRendered(int frame, int generation, const QImage& image, bool encoded);
+    void deliverFrames();
+    bool deliverNext();
+    void finish(bool success);
+
+    SnapshotProvider m_provider;
+    FrameProcessor m_processor;
+    FrameEncoder m_encoder;
+    FrameSink m_sink;
+    HoldDetector m_holdDetector;
+    QThreadPool* m_pool;
+    QEventLoop* m_loop;
+    QMap<int, QImage> m_ready;  // Rendered frames waiting for earlier ones
+    QMap<int, int> m_holds;     // Scheduled held frame -> frame it repeats
+    QImage m_lastDelivered;     // Image of the last rendered frame delivered
+    QImage::Format m_outputFormat;
+    QSize m_renderSize;
+    int m_generation;           // Bumped per run so late results are ignored
+    int m_firstFrame;
+    int m_lastFrame;
+    int m_nextToRender;
+    int m_nextToDeliver;
+    int m_inFlight;             // Rendered frames scheduled but not delivered
+    int m_lastUniqueFrame;
+    quint64 m_lastUniqueHash;
+    FrameSnapshot m_lastUniqueSnapshot; // Confirms a hash match before holding
+    int m_renderedFrames;
+    bool m_cancelled;
+    bool m_delivering;          // A sink spinning the event loop must not re-enter
+    bool m_success;
+    double m_framesPerSecond;
+};
+
+#endif // FRAMEEXPORTER_H
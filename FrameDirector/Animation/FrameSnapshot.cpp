@@ -0,0 +1,425 @@
+// Animation/FrameSnapshot.cpp
+#include "FrameSnapshot.h"
+#include <QGraphicsItem>
+#include <QGraphicsEffect>
+#include <QGraphicsTextItem>
+#include <QTextDocument>
+#include <QPainter>
+#include <QFont>
+#include <QtMath>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// One horizontal and one vertical box pass over premultiplied ARGB32
+void boxBlur(QImage& image, int radius)
+{
+    const int width = image.width();
+    const int height = image.height();
+    if (radius < 1 || width == 0 || height == 0) {
+        return;
+    }
+
+    QVector<QRgb> line(qMax(width, height));
+    const int window = radius * 2 + 1;
+
+    auto blurLine = [&](QRgb* pixels, int count, int stride) {
+        for (int i = 0; i < count; ++i) {
+            line[i] = pixels[i * stride];
+        }
+        int a = 0, r = 0, g = 0, b = 0;
+        for (int i = -radius; i <= radius; ++i) {
+            QRgb p = line[qBound(0, i, count - 1)];
+            a += qAlpha(p); r += qRed(p); g += qGreen(p); b += qBlue(p);
+        }
+        for (int i = 0; i < count; ++i) {
+            pixels[i * stride] = qRgba(r / window, g / window, b / window, a / window);
+            QRgb out = line[qBound(0, i - radius, count - 1)];
+            QRgb in = line[qBound(0, i + radius + 1, count - 1)];
+            a += qAlpha(in) - qAlpha(out);
+            r += qRed(in) - qRed(out);
+            g += qGreen(in) - qGreen(out);
+            b += qBlue(in) - qBlue(out);
+        }
+    };
+
+    QRgb* bits = reinterpret_cast<QRgb*>(image.bits());
+    const int stride = image.bytesPerLine() / 4;
+    for (int y = 0; y < height; ++y) {
+        blurLine(bits + y * stride, width, 1);
+    }
+    for (int x = 0; x < width; ++x) {
+        blurLine(bits + x, height, stride);
+    }
+}
+
+// Three box passes approximate the gaussian QGraphicsBlurEffect applies
+void blurImage(QImage& image, qreal radius)
+{
+    const int boxRadius = qMax(1, qRound(radius / 3.0));
+    for (int pass = 0; pass < 3; ++pass) {
+        boxBlur(image, boxRadius);
+    }
+}
+
+// Order-sensitive 64-bit hash over everything that affects a rendered frame
+class ContentHasher
+{
+public:
+    quint64 result() const { return m_hash; }
+
+    void add(quint64 value) {
+        m_hash ^= value + 0x9e3779b97f4a7c15ULL + (m_hash << 6) + (m_hash >> 2);
+    }
+    void add(int value) { add(static_cast<quint64>(static_cast<qint64>(value))); }
+    void add(double value) {
+        quint64 bits = 0;
+        value = value == 0.0 ? 0.0 : value; // -0.0 renders like 0.0
+        std::memcpy(&bits, &value, sizeof(bits));
+        add(bits);
+    }
+    void add(const QPointF& point) { add(point.x()); add(point.y()); }
+    void add(const QRectF& rect) { add(rect.topLeft()); add(rect.bottomRight()); }
+    void add(const QString& text) { add(static_cast<quint64>(qHash(text))); }
+    void add(const QColor& color) { add(static_cast<quint64>(color.rgba64())); }
+
+    void add(const QTransform& transform) {
+        const double values[] = { transform.m11(), transform.m12(), transform.m13(),
+                                  transform.m21(), transform.m22(), transform.m23(),
+                                  transform.m31(), transform.m32(), transform.m33() };
+        for (double value : values) {
+            add(value);
+        }
+    }
+
+    void add(const QImage& image) {
+        add(image.width());
+        add(image.height());
+        add(static_cast<int>(image.format()));
+        // Row by row: padding at the end of a scanline is not initialized
+        const qsizetype rowBytes = (qsizetype(image.width()) * image.depth() + 7) / 8;
+        for (int y = 0; y < image.height(); ++y) {
+            add(static_cast<quint64>(qHashBits(image.constScanLine(y), rowBytes)));
+        }
+    }
+
+    void add(const QBrush& brush) {
+        add(static_cast<int>(brush.style()));
+        add(brush.color());
+        add(brush.transform());
+        if (const QGradient* gradient = brush.gradient()) {
+            add(static_cast<int>(gradient->type()));
+            add(static_cast<int>(gradient->spread()));
+            for (const QGradientStop& stop : gradient->stops()) {
+                add(stop.first);
+                add(stop.second);
+            }
+            if (gradient->type() == QGradient::LinearGradient) {
+                const QLinearGradient* linear = static_cast<const QLinearGradient*>(gradient);
+                add(linear->start());
+                add(linear->finalStop());
+            }
+            else if (gradient->type() == QGradient::RadialGradient) {
+                const QRadialGradient* radial = static_cast<const QRadialGradient*>(gradient);
+                add(radial->center());
+                add(radial->focalPoint());
+                add(radial->radius());
+            }
+        }
+        else if (brush.style() == Qt::TexturePattern) {
+            add(brush.textureImage());
+        }
+    }
+
+    void add(const QPen& pen) {
+        add(static_cast<int>(pen.style()));
+        add(pen.widthF());
+        add(static_cast<int>(pen.capStyle()));
+        add(static_cast<int>(pen.joinStyle()));
+        add(pen.miterLimit());
+        add(pen.dashOffset());
+        for (qreal dash : pen.dashPattern()) {
+            add(dash);
+        }
+        add(pen.brush());
+    }
+
+    void add(const QPainterPath& path) {
+        add(static_cast<int>(path.fillRule()));
+        add(path.elementCount());
+        for (int i = 0; i < path.elementCount(); ++i) {
+            const QPainterPath::Element element = path.elementAt(i);
+            add(static_cast<int>(element.type));
+            add(element.x);
+            add(element.y);
+        }
+    }
+
+private:
+    quint64 m_hash = 0xcbf29ce484222325ULL;
+};
+
+void paintPrimitive(QPainter* painter, const FrameSnapshot::Primitive& primitive)
+{
+    using Kind = FrameSnapshot::Primitive::Kind;
+
+    switch (primitive.kind) {
+    case Kind::Rect:
+        painter->setPen(primitive.pen);
+        painter->setBrush(primitive.brush);
+        painter->drawRect(primitive.rect);
+        break;
+    case Kind::Ellipse:
+        painter->setPen(primitive.pen);
+        painter->setBrush(primitive.brush);
+        painter->drawEllipse(primitive.rect);
+        break;
+    case Kind::Line:
+        painter->setPen(primitive.pen);
+        painter->drawLine(primitive.line);
+        break;
+    case Kind::Path: {
+        // QPainterPath lazily caches its bounds and vector form inside the
+        // shared data, so each render paints from a private copy
+        QPainterPath path;
+        path.addPath(primitive.path);
+        painter->setPen(primitive.pen);
+        painter->setBrush(primitive.brush);
+        painter->drawPath(path);
+        break;
+    }
+    case Kind::Image:
+        painter->setRenderHint(QPainter::SmoothPixmapTransform, primitive.smoothTransform);
+        painter->drawImage(primitive.offset, primitive.image);
+        break;
+    case Kind::Text: {
+        // QFont is not thread-safe either; rebuild it from its description
+        QFont font;
+        font.fromString(primitive.font);
+        painter->setFont(font);
+        painter->setPen(primitive.pen);
+        painter->drawText(primitive.rect, primitive.textFlags, primitive.text);
+        break;
+    }
+    }
+}
+
+} // namespace
+
+FrameSnapshot::FrameSnapshot(const QSize& canvasSize)
+    : m_canvasSize(canvasSize)
+{
+}
+
+void FrameSnapshot::addItem(const QGraphicsItem* item, const QTransform& sceneTransform,
+                            qreal opacity, qreal blurRadius)
+{
+    if (!item) {
+        return;
+    }
+
+    if (auto group = qgraphicsitem_cast<const QGraphicsItemGroup*>(item)) {
+        // Children paint in stacking order, placed relative to the group
+        QList<QGraphicsItem*> children = group->childItems();
+        std::stable_sort(children.begin(), children.end(),
+            [](const QGraphicsItem* a, const QGraphicsItem* b) { return a->zValue() < b->zValue(); });
+
+        for (const QGraphicsItem* child : children) {
+            if (!child->isVisible()) {
+                continue;
+            }
+
+            qreal childOpacity = child->opacity();
+            if (!(child->flags() & QGraphicsItem::ItemIgnoresParentOpacity)) {
+                childOpacity *= opacity;
+            }
+
+            qreal childBlur = blurRadius;
+            if (auto blur = dynamic_cast<QGraphicsBlurEffect*>(child->graphicsEffect())) {
+                childBlur = qMax(childBlur, blur->blurRadius());
+            }
+
+            addItem(child, child->itemTransform(item) * sceneTransform, childOpacity, childBlur);
+        }
+        return;
+    }
+
+    addPrimitive(item, sceneTransform, opacity, blurRadius);
+}
+
+void FrameSnapshot::addPrimitive(const QGraphicsItem* item, const QTransform& sceneTransform,
+                                 qreal opacity, qreal blurRadius)
+{
+    Primitive primitive;
+
+    if (auto rectItem = qgraphicsitem_cast<const QGraphicsRectItem*>(item)) {
+        primitive.kind = Primitive::Kind::Rect;
+        primitive.rect = rectItem->rect();
+        primitive.pen = rectItem->pen();
+        primitive.brush = rectItem->brush();
+    }
+    else if (auto ellipseItem = qgraphicsitem_cast<const QGraphicsEllipseItem*>(item)) {
+        primitive.kind = Primitive::Kind::Ellipse;
+        primitive.rect = ellipseItem->rect();
+        primitive.pen = ellipseItem->pen();
+        primitive.brush = ellipseItem->brush();
+    }
+    else if (auto lineItem = qgraphicsitem_cast<const QGraphicsLineItem*>(item)) {
+        primitive.kind = Primitive::Kind::Line;
+        primitive.line = lineItem->line();
+        primitive.pen = lineItem->pen();
+    }
+    else if (auto pathItem = qgraphicsitem_cast<const QGraphicsPathItem*>(item)) {
+        primitive.kind = Primitive::Kind::Path;
+        primitive.path = pathItem->path();
+        primitive.pen = pathItem->pen();
+        primitive.brush = pathItem->brush();
+    }
+    else if (auto pixmapItem = qgraphicsitem_cast<const QGraphicsPixmapItem*>(item)) {
+        // QPixmap may only be used on the GUI thread
+        primitive.kind = Primitive::Kind::Image;
+        primitive.image = pixmapItem->pixmap().toImage();
+        primitive.offset = pixmapItem->offset();
+        primitive.smoothTransform = pixmapItem->transformationMode() == Qt::SmoothTransformation;
+    }
+    else if (auto textItem = qgraphicsitem_cast<const QGraphicsTextItem*>(item)) {
+        const qreal margin = textItem->document() ? textItem->document()->documentMargin() : 0.0;
+        primitive.kind = Primitive::Kind::Text;
+        primitive.rect = textItem->boundingRect().adjusted(margin, margin, -margin, -margin);
+        primitive.text = textItem->toPlainText();
+        primitive.font = textItem->font().toString();
+        primitive.pen = QPen(textItem->defaultTextColor());
+        primitive.textFlags = Qt::AlignLeft | Qt::AlignTop;
+        if (textItem->textWidth() > 0) {
+            primitive.textFlags |= Qt::TextWordWrap;
+        }
+    }
+    else {
+        return;
+    }
+
+    primitive.transform = sceneTransform;
+    primitive.opacity = opacity;
+    primitive.blurRadius = blurRadius;
+    primitive.bounds = item->boundingRect();
+    m_primitives.append(primitive);
+}
+
+bool FrameSnapshot::Primitive::operator==(const Primitive& other) const
+{
+    return kind == other.kind && transform == other.transform && opacity == other.opacity &&
+        blurRadius == other.blurRadius && bounds == other.bounds && pen == other.pen &&
+        brush == other.brush && rect == other.rect && line == other.line && path == other.path &&
+        offset == other.offset && smoothTransform == other.smoothTransform && text == other.text &&
+        font == other.font && textFlags == other.textFlags && image == other.image;
+}
+
+bool FrameSnapshot::operator==(const FrameSnapshot& other) const
+{
+    return m_canvasSize == other.m_canvasSize && m_primitives == other.m_primitives;
+}
+
+quint64 FrameSnapshot::contentHash() const
+{
+    ContentHasher hasher;
+    hasher.add(m_canvasSize.width());
+    hasher.add(m_canvasSize.height());
+    for (const Primitive& primitive : m_primitives) {
+        hasher.add(static_cast<int>(primitive.kind));
+        hasher.add(primitive.transform);
+        hasher.add(primitive.opacity);
+        hasher.add(primitive.blurRadius);
+        hasher.add(primitive.bounds);
+        hasher.add(primitive.pen);
+        hasher.add(primitive.brush);
+        hasher.add(primitive.rect);
+        hasher.add(primitive.line.p1());
+        hasher.add(primitive.line.p2());
+        hasher.add(primitive.path);
+        hasher.add(primitive.image);
+        hasher.add(primitive.offset);
+        hasher.add(primitive.smoothTransform ? 1 : 0);
+        hasher.add(primitive.text);
+        hasher.add(primitive.font);
+        hasher.add(primitive.textFlags);
+    }
+    return hasher.result();
+}
+
+QImage FrameSnapshot::render() const
+{
+    return render(m_canvasSize);
+}
+
+QImage FrameSnapshot::render(const QSize& size) const
+{
+    if (!isValid() || size.isEmpty()) {
+        return QImage();
+    }
+
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    if (size != m_canvasSize) {
+        painter.scale(qreal(size.width()) / m_canvasSize.width(), qreal(size.height()) / m_canvasSize.height());
+    }
+    render(&painter);
+    painter.end();
+
+    return image;
+}
+
+void FrameSnapshot::render(QPainter* painter) const
+{
+    if (!painter) {
+        return;
+    }
+
+    const QRect canvasRect(QPoint(0, 0), m_canvasSize);
+    const QTransform base = painter->transform();
+
+    for (const Primitive& primitive : m_primitives) {
+        if (primitive.opacity <= 0.0) {
+            continue;
+        }
+
+        painter->save();
+        painter->setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform, true);
+        painter->setOpacity(primitive.opacity);
+
+        if (primitive.blurRadius <= 0.0) {
+            painter->setTransform(primitive.transform * base);
+            paintPrimitive(painter, primitive);
+            painter->restore();
+            continue;
+        }
+
+        // Blurred shapes are painted into a padded buffer, blurred, then
+        // composited like QGraphicsBlurEffect does for live items
+        const int padding = qCeil(primitive.blurRadius);
+        QRect area = primitive.transform.mapRect(primitive.bounds).toAlignedRect()
+                         .adjusted(-padding, -padding, padding, padding)
+                         .intersected(canvasRect.adjusted(-padding, -padding, padding, padding));
+        if (area.isEmpty()) {
+            painter->restore();
+            continue;
+        }
+
+        QImage buffer(area.size(), QImage::Format_ARGB32_Premultiplied);
+        buffer.fill(Qt::transparent);
+        {
+            QPainter bufferPainter(&buffer);
+            bufferPainter.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform, true);
+            bufferPainter.setTransform(primitive.transform
+                                       * QTransform::fromTranslate(-area.x(), -area.y()));
+            paintPrimitive(&bufferPainter, primitive);
+        }
+        blurImage(buffer, primitive.blurRadius);
+
+        painter->setTransform(base);
+        painter->drawImage(area.topLeft(), buffer);
+        painter->restore();
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef FRAMESNAPSHOT_H
+#define FRAMESNAPSHOT_H
+
+#include <QBrush>
+#include <QImage>
+#include <QLineF>
+#include <QPainterPath>
+#include <QPen>
+#include <QRectF>
+#include <QSize>
+#include <QString>
+#include <QTransform>
+#include <QVector>
+
+class QGraphicsItem;
+class QPainter;
+
+// Immutable, self-contained description of one flattened frame. A snapshot
+// is captured from the live items on the GUI thread and holds only value
+// types (geometry, pen, brush, scene transform, opacity), so rendering it
+// never touches a QGraphicsItem or QGraphicsScene. Any number of threads may
+// render the same snapshot concurrently.
+class FrameSnapshot
+{
+public:
+    // One drawable shape in scene paint order
+    struct Primitive {
+        enum class Kind { Rect, Ellipse, Line, Path, Image, Text };
+
+        Kind kind = Kind::Path;
+        QTransform transform;   // Item coordinates -> canvas coordinates
+        qreal opacity = 1.0;
+        qreal blurRadius = 0.0;
+        QRectF bounds;          // Item bounding rect, used to size blur buffers
+
+        QPen pen;
+        QBrush brush;
+        QRectF rect;            // Rect, Ellipse, Text layout box
+        QLineF line;
+        QPainterPath path;
+        QImage image;           // Pixmaps are converted on capture
+        QPointF offset;
+        bool smoothTransform = false;
+        QString text;
+        QString font;           // QFont::toString(), rebuilt per render
+        int textFlags = 0;
+
+        bool operator==(const Primitive& other) const;
+        bool operator!=(const Primitive& other) const { return !(*this == other); }
+    };
+
+    FrameSnapshot() = default;
+    explicit FrameSnapshot(const QSize& canvasSize);
+
+    QSize canvasSize() const { return m_canvasSize; }
+    bool isValid() const { return m_canvasSize.isValid() && !m_canvasSize.isEmpty(); }
+    int primitiveCount() const { return m_primitives.size(); }
+
+    // GUI thread only. Records the item (and, for groups, its visible
+    // children) placed with the given scene transform, opacity and blur.
+    // Item types the snapshot cannot describe are skipped.
+    void addItem(const QGraphicsItem* item, const QTransform& sceneTransform,
+                 qreal opacity, qreal blurRadius);
+
+    // Equal for snapshots that render identical frames; used to spot held
+    // frames whose keyframes were redrawn or copied rather than extended
+    quint64 contentHash() const;
+    // Field by field, images by their pixels; confirms a contentHash() match
+    bool operator==(const FrameSnapshot& other) const;
+    bool operator!=(const FrameSnapshot& other) const { return !(*this == other); }
+
+    // Thread-safe
+    QImage render() const;
+    // Canvas stretched to size, for exports above or below canvas resolution
+    QImage render(const QSize& size) const;
+    void render(QPainter* painter) const;
+
+private:
+    void addPrimitive(const QGraphicsItem* item, const QTransform& sceneTransform,
+                      qreal opacity, qreal blurRadius);
+
+    QSize m_canvasSize;
+    QVector<Primitive> m_primitives;
+};
+
+#endif // FRAMESNAPSHOT_H
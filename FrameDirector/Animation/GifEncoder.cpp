@@ -0,0 +1,762 @@
+// Animation/GifEncoder.cpp
+#include "GifEncoder.h"
+#include <QRect>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace {
+
+// Histogram bins: 5 bits per channel
+const int kHistogramBits = 5;
+const int kHistogramSize = 1 << (kHistogramBits * 3);
+
+// Nearest-colour cache: 6 bits per channel
+const int kMapBits = 6;
+const int kMapSize = 1 << (kMapBits * 3);
+
+// Pixels below this alpha are written as the transparent entry
+const int kAlphaThreshold = 128;
+
+// LZW dictionary hash (as in compress/gifencod)
+const int kHashSize = 5003;
+const int kHashShift = 4;
+const int kMaxLzwCode = 4095;
+
+// Ordered dithering spread, in colour levels
+const int kOrderedSpread = 24;
+
+const int kBayer8[8][8] = {
+    {  0, 32,  8, 40,  2, 34, 10, 42 },
+    { 48, 16, 56, 24, 50, 18, 58, 26 },
+    { 12, 44,  4, 36, 14, 46,  6, 38 },
+    { 60, 28, 52, 20, 62, 30, 54, 22 },
+    {  3, 35, 11, 43,  1, 33,  9, 41 },
+    { 51, 19, 59, 27, 49, 17, 57, 25 },
+    { 15, 47,  7, 39, 13, 45,  5, 37 },
+    { 63, 31, 55, 23, 61, 29, 53, 21 }
+};
+
+struct Histogram {
+    std::vector<quint32> count = std::vector<quint32>(kHistogramSize, 0);
+    std::vector<quint64> red = std::vector<quint64>(kHistogramSize, 0);
+    std::vector<quint64> green = std::vector<quint64>(kHistogramSize, 0);
+    std::vector<quint64> blue = std::vector<quint64>(kHistogramSize, 0);
+
+    static int binOf(int r, int g, int b) {
+        const int shift = 8 - kHistogramBits;
+        return ((r >> shift) << (kHistogramBits * 2)) | ((g >> shift) << kHistogramBits) | (b >> shift);
+    }
+
+    void add(const QImage& image) {
+        for (int y = 0; y < image.height(); ++y) {
+            const QRgb* line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+            for (int x = 0; x < image.width(); ++x) {
+                const QRgb pixel = line[x];
+                if (qAlpha(pixel) < kAlphaThreshold) {
+                    continue;
+                }
+                const int bin = binOf(qRed(pixel), qGreen(pixel), qBlue(pixel));
+                ++count[bin];
+                red[bin] += qRed(pixel);
+                green[bin] += qGreen(pixel);
+                blue[bin] += qBlue(pixel);
+            }
+        }
+    }
+};
+
+int binComponent(int bin, int axis)
+{
+    const int mask = (1 << kHistogramBits) - 1;
+    return (bin >> (kHistogramBits * (2 - axis))) & mask;
+}
+
+// Median cut over the occupied bins. Each box is a range of the bins vector;
+// the box with the most pixels times its longest side is split at the
+// pixel median along that side until maxColors boxes exist.
+QVector<QRgb> medianCut(const Histogram& histogram, int maxColors)
+{
+    std::vector<int> bins;
+    for (int bin = 0; bin < kHistogramSize; ++bin) {
+        if (histogram.count[bin] > 0) {
+            bins.push_back(bin);
+        }
+    }
+
+    struct Box {
+        int begin;
+        int end;
+        quint64 pixels;
+        int longestAxis;
+        int longestExtent;
+    };
+
+    auto measure = [&](int begin, int end) {
+        Box box{ begin, end, 0, 0, 0 };
+        int low[3] = { 255, 255, 255 };
+        int high[3] = { 0, 0, 0 };
+        for (int i = begin; i < end; ++i) {
+            box.pixels += histogram.count[bins[i]];
+            for (int axis = 0; axis < 3; ++axis) {
+                const int value = binComponent(bins[i], axis);
+                low[axis] = std::min(low[axis], value);
+                high[axis] = std::max(high[axis], value);
+            }
+        }
+        for (int axis = 0; axis < 3; ++axis) {
+            if (high[axis] - low[axis] > box.longestExtent) {
+                box.longestExtent = high[axis] - low[axis];
+                box.longestAxis = axis;
+            }
+        }
+        return box;
+    };
+
+    std::vector<Box> boxes;
+    if (!bins.empty()) {
+        boxes.push_back(measure(0, static_cast<int>(bins.size())));
+    }
+
+    while (static_cast<int>(boxes.size()) < maxColors) {
+        int chosen = -1;
+        quint64 bestScore = 0;
+        for (int i = 0; i < static_cast<int>(boxes.size()); ++i) {
+            const Box& box = boxes[i];
+            const quint64 score = box.pixels * static_cast<quint64>(box.longestExtent);
+            if (box.end - box.begin > 1 && box.longestExtent > 0 && score > bestScore) {
+                bestScore = score;
+                chosen = i;
+            }
+        }
+        if (chosen < 0) {
+            break; // Every box is a single colour
+        }
+
+        const Box box = boxes[chosen];
+        const int axis = box.longestAxis;
+        std::sort(bins.begin() + box.begin, bins.begin() + box.end, [axis](int a, int b) {
+            return binComponent(a, axis) < binComponent(b, axis);
+        });
+
+        // First bin past half the pixels, keeping both halves non-empty
+        quint64 seen = 0;
+        int split = box.begin + 1;
+        for (int i = box.begin; i < box.end - 1; ++i) {
+            seen += histogram.count[bins[i]];
+            split = i + 1;
+            if (seen * 2 >= box.pixels) {
+                break;
+            }
+        }
+
+        boxes[chosen] = measure(box.begin, split);
+        boxes.push_back(measure(split, box.end));
+    }
+
+    QVector<QRgb> palette;
+    palette.reserve(static_cast<int>(boxes.size()));
+    for (const Box& box : boxes) {
+        quint64 red = 0, green = 0, blue = 0;
+        for (int i = box.begin; i < box.end; ++i) {
+            red += histogram.red[bins[i]];
+            green += histogram.green[bins[i]];
+            blue += histogram.blue[bins[i]];
+        }
+        const quint64 pixels = std::max<quint64>(1, box.pixels);
+        palette.append(qRgb(int((red + pixels / 2) / pixels), int((green + pixels / 2) / pixels),
+                            int((blue + pixels / 2) / pixels)));
+    }
+    return palette;
+}
+
+// Nearest palette entry per colour, filled in as colours are met
+class PaletteMapper
+{
+public:
+    explicit PaletteMapper(const QVector<QRgb>& palette)
+        : m_palette(palette)
+        , m_cache(m_palette.isEmpty() ? 0 : kMapSize, -1)
+    {
+    }
+
+    int map(int r, int g, int b) {
+        const int shift = 8 - kMapBits;
+        const int key = ((r >> shift) << (kMapBits * 2)) | ((g >> shift) << kMapBits) | (b >> shift);
+        short& cached = m_cache[key];
+        if (cached < 0) {
+            // Match against the cell centre so the cache is order independent
+            const int half = 1 << (shift - 1);
+            cached = static_cast<short>(nearest(((r >> shift) << shift) + half,
+                                                ((g >> shift) << shift) + half,
+                                                ((b >> shift) << shift) + half));
+        }
+        return cached;
+    }
+
+    QRgb color(int index) const { return m_palette[index]; }
+
+private:
+    int nearest(int r, int g, int b) const {
+        int best = 0;
+        int bestDistance = std::numeric_limits<int>::max();
+        for (int i = 0; i < m_palette.size(); ++i) {
+            const int dr = qRed(m_palette[i]) - r;
+            const int dg = qGreen(m_palette[i]) - g;
+            const int db = qBlue(m_palette[i]) - b;
+            const int distance = dr * dr + dg * dg + db * db;
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    const QVector<QRgb>& m_palette;
+    std::vector<short> m_cache;
+};
+
+// Variable-width LSB-first code packer writing 255-byte GIF sub-blocks
+class CodeWriter
+{
+public:
+    explicit CodeWriter(QByteArray& out) : m_out(out) {}
+
+    void write(int code, int bits) {
+        m_buffer |= static_cast<quint32>(code) << m_bitCount;
+        m_bitCount += bits;
+        while (m_bitCount >= 8) {
+            pushByte(static_cast<char>(m_buffer & 0xff));
+            m_buffer >>= 8;
+            m_bitCount -= 8;
+        }
+    }
+
+    void flush() {
+        if (m_bitCount > 0) {
+            pushByte(static_cast<char>(m_buffer & 0xff));
+            m_buffer = 0;
+            m_bitCount = 0;
+        }
+        if (!m_block.isEmpty()) {
+            m_out.append(static_cast<char>(m_block.size()));
+            m_out.append(m_block);
+            m_block.clear();
+        }
+        m_out.append('\0'); // Block terminator
+    }
+
+private:
+    void pushByte(char byte) {
+        m_block.append(byte);
+        if (m_block.size() == 255) {
+            m_out.append(static_cast<char>(255));
+            m_out.append(m_block);
+            m_block.clear();
+        }
+    }
+
+    QByteArray& m_out;
+    QByteArray m_block;
+    quint32 m_buffer = 0;
+    int m_bitCount = 0;
+};
+
+} // namespace
+
+GifEncoder::~GifEncoder()
+{
+    if (m_file.isOpen()) {
+        close();
+    }
+}
+
+QVector<QRgb> GifEncoder::buildPalette(const QVector<QImage>& samples, int maxColors)
+{
+    Histogram histogram;
+    for (const QImage& sample : samples) {
+        if (sample.isNull()) {
+            continue;
+        }
+        histogram.add(sample.format() == QImage::Format_ARGB32
+                          ? sample : sample.convertToFormat(QImage::Format_ARGB32));
+    }
+    return medianCut(histogram, qBound(1, maxColors, kMaxColors));
+}
+
+QImage GifEncoder::quantize(const QImage& image, const QVector<QRgb>& palette, Dither dither)
+{
+    if (image.isNull()) {
+        return QImage();
+    }
+
+    const QImage source = image.format() == QImage::Format_ARGB32
+                              ? image : image.convertToFormat(QImage::Format_ARGB32);
+    const QVector<QRgb> colors = palette.isEmpty() ? buildPalette({ source }) : palette;
+    const int transparentIndex = colors.size();
+
+    QImage indexed(source.size(), QImage::Format_Indexed8);
+    QVector<QRgb> table = colors;
+    table.append(qRgba(0, 0, 0, 0));
+    indexed.setColorTable(table);
+
+    PaletteMapper mapper(colors);
+    const int width = source.width();
+
+    // Floyd-Steinberg error rows, three channels per pixel plus a margin
+    std::vector<int> errors;
+    std::vector<int> nextErrors;
+    if (dither == Dither::Diffusion) {
+        errors.assign((width + 2) * 3, 0);
+        nextErrors.assign((width + 2) * 3, 0);
+    }
+
+    for (int y = 0; y < source.height(); ++y) {
+        const QRgb* in = reinterpret_cast<const QRgb*>(source.constScanLine(y));
+        uchar* out = indexed.scanLine(y);
+
+        for (int x = 0; x < width; ++x) {
+            const QRgb pixel = in[x];
+            if (qAlpha(pixel) < kAlphaThreshold || colors.isEmpty()) {
+                out[x] = static_cast<uchar>(transparentIndex);
+                continue;
+            }
+
+            int r = qRed(pixel);
+            int g = qGreen(pixel);
+            int b = qBlue(pixel);
+
+            if (dither == Dither::Ordered) {
+                const int offset = (kBayer8[y & 7][x & 7] - 32) * kOrderedSpread / 64;
+                r = qBound(0, r + offset, 255);
+                g = qBound(0, g + offset, 255);
+                b = qBound(0, b + offset, 255);
+            }
+            else if (dither == Dither::Diffusion) {
+                const int* error = &errors[(x + 1) * 3];
+                r = qBound(0, r + error[0] / 16, 255);
+                g = qBound(0, g + error[1] / 16, 255);
+                b = qBound(0, b + error[2] / 16, 255);
+            }
+
+            const int index = mapper.map(r, g, b);
+            out[x] = static_cast<uchar>(index);
+
+            if (dither == Dither::Diffusion) {
+                const QRgb chosen = mapper.color(index);
+                const int diff[3] = { r - qRed(chosen), g - qGreen(chosen), b - qBlue(chosen) };
+                for (int c = 0; c < 3; ++c) {
+                    errors[(x + 2) * 3 + c] += diff[c] * 7;
+                    nextErrors[x * 3 + c] += diff[c] * 3;
+                    nextErrors[(x + 1) * 3 + c] += diff[c] * 5;
+                    nextErrors[(x + 2) * 3 + c] += diff[c];
+                }
+            }
+        }
+
+        if (dither == Dither::Diffusion) {
+            errors.swap(nextErrors);
+            std::fill(nextErrors.begin(), nextErrors.end(), 0);
+        }
+    }
+
+    return indexed;
+}
+
+bool GifEncoder::open(const QString& filename, const QSize& size, const Options& options,
+                      const QVector<QRgb>& globalPalette)
+{
+    if (m_file.isOpen() || size.isEmpty() || size.width() > 0xffff || size.height() > 0xffff) {
+        m_error = "Invalid GIF size";
+        return false;
+    }
+
+    m_file.setFileName(filename);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+
+    m_options = options;
+    m_options.frameRate = qMax(1, options.frameRate);
+    m_size = size;
+    m_globalPalette = options.paletteMode == PaletteMode::Global ? globalPalette : QVector<QRgb>();
+    m_displayed.fill(qRgba(0, 0, 0, 0), size.width() * size.height());
+    m_frameCount = 0;
+    m_elapsedFrames = 0;
+    m_lastFrameStart = 0;
+    m_pending = QImage();
+    m_pendingFrames = 0;
+    m_sawTransparency = false;
+    m_error.clear();
+
+    m_file.write("GIF89a", 6);
+    writeShort(size.width());
+    writeShort(size.height());
+
+    if (options.paletteMode == PaletteMode::Global) {
+        QVector<QRgb> table = m_globalPalette;
+        table.append(qRgba(0, 0, 0, 0));
+        const int bits = tableBits(table.size());
+        const char packed = static_cast<char>(0x80 | ((bits - 1) << 4) | (bits - 1));
+        m_file.putChar(packed);
+        m_file.putChar(0); // Background colour index
+        m_file.putChar(0); // Pixel aspect ratio
+        writeColorTable(table, bits);
+    }
+    else {
+        m_file.putChar(0);
+        m_file.putChar(0);
+        m_file.putChar(0);
+    }
+
+    if (options.loop) {
+        // NETSCAPE2.0 application extension, loop forever
+        static const char loopExtension[] = {
+            '\x21', '\xff', '\x0b', 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0',
+            '\x03', '\x01', '\x00', '\x00', '\x00'
+        };
+        m_file.write(loopExtension, sizeof(loopExtension));
+    }
+
+    return m_file.error() == QFileDevice::NoError;
+}
+
+bool GifEncoder::addFrame(const QImage& indexed, int durationFrames)
+{
+    if (!m_file.isOpen()) {
+        m_error = "GIF file is not open";
+        return false;
+    }
+    if (indexed.format() != QImage::Format_Indexed8 || indexed.size() != m_size ||
+        indexed.colorTable().isEmpty()) {
+        m_error = "Frame is not a quantized image of the animation's size";
+        return false;
+    }
+
+    const bool written = m_pending.isNull() || writeFrame(&indexed);
+    m_pending = indexed;
+    m_pendingFrames = qMax(1, durationFrames);
+    return written;
+}
+
+// Writes the pending frame. What a viewer shows after each frame is that
+// frame exactly: it either turns no pixel transparent that the previous one
+// showed, or the previous one was cleared. When the next frame would turn
+// pixels transparent, this one is written over the whole image with
+// disposal 2, so the viewer clears it before drawing the next. The last
+// frame is followed by the first on looping, or by another part after
+// concatenate(), so it is cleared whenever the animation has transparency.
+bool GifEncoder::writeFrame(const QImage* next)
+{
+    const QImage& indexed = m_pending;
+    const QVector<QRgb> table = indexed.colorTable();
+    const int transparentIndex = table.size() - 1;
+    const int width = m_size.width();
+    const int height = m_size.height();
+
+    bool uncovers = false;
+    const int nextTransparent = next ? next->colorTable().size() - 1 : -1;
+    for (int y = 0; y < height && !(uncovers && m_sawTransparency); ++y) {
+        const uchar* line = indexed.constScanLine(y);
+        const uchar* nextLine = next ? next->constScanLine(y) : nullptr;
+        for (int x = 0; x < width; ++x) {
+            if (line[x] == transparentIndex) {
+                m_sawTransparency = true;
+            }
+            else if (nextLine && nextLine[x] == nextTransparent) {
+                uncovers = true;
+            }
+        }
+    }
+    const bool clear = next ? uncovers : m_sawTransparency;
+    const bool delta = m_frameCount > 0 && m_options.cropToChanges;
+
+    auto colorAt = [&](const uchar* line, int x) {
+        const int index = line[x];
+        return index == transparentIndex ? qRgba(0, 0, 0, 0) : (table[index] | 0xff000000);
+    };
+
+    // Rectangle covering every pixel that changed since the last frame; a
+    // frame that is cleared afterwards covers the whole image
+    QRect changed(0, 0, width, height);
+    if (delta && !clear) {
+        int left = width, right = -1, top = height, bottom = -1;
+        for (int y = 0; y < height; ++y) {
+            const uchar* line = indexed.constScanLine(y);
+            const QRgb* shown = m_displayed.constData() + y * width;
+            for (int x = 0; x < width; ++x) {
+                if (line[x] != transparentIndex && colorAt(line, x) != shown[x]) {
+                    left = std::min(left, x);
+                    right = std::max(right, x);
+                    top = std::min(top, y);
+                    bottom = std::max(bottom, y);
+                }
+            }
+        }
+        changed = right < 0 ? QRect(0, 0, 1, 1) : QRect(QPoint(left, top), QPoint(right, bottom));
+    }
+
+    QVector<uchar> indices;
+    indices.reserve(changed.width() * changed.height());
+    for (int y = changed.top(); y <= changed.bottom(); ++y) {
+        const uchar* line = indexed.constScanLine(y);
+        QRgb* shown = m_displayed.data() + y * width;
+        for (int x = changed.left(); x <= changed.right(); ++x) {
+            const QRgb color = colorAt(line, x);
+            if (line[x] == transparentIndex || (delta && color == shown[x])) {
+                indices.append(static_cast<uchar>(transparentIndex));
+            }
+            else {
+                indices.append(line[x]);
+                shown[x] = color;
+            }
+        }
+    }
+
+    m_lastFrameStart = m_elapsedFrames;
+    m_elapsedFrames += m_pendingFrames;
+    if (clear) {
+        m_displayed.fill(qRgba(0, 0, 0, 0));
+    }
+
+    // Graphic control extension
+    const int disposal = clear ? 2 : 1;
+    m_file.putChar('\x21');
+    m_file.putChar('\xf9');
+    m_file.putChar('\x04');
+    m_file.putChar(static_cast<char>((disposal << 2) | 0x01));
+    writeShort(lastFrameDelay());
+    m_file.putChar(static_cast<char>(transparentIndex));
+    m_file.putChar(0);
+
+    // Image descriptor, with a local colour table unless the global one applies
+    const bool localTable = m_options.paletteMode != PaletteMode::Global;
+    const int bits = tableBits(localTable ? table.size() : m_globalPalette.size() + 1);
+    m_file.putChar('\x2c');
+    writeShort(changed.left());
+    writeShort(changed.top());
+    writeShort(changed.width());
+    writeShort(changed.height());
+    m_file.putChar(localTable ? static_cast<char>(0x80 | (bits - 1)) : 0);
+    if (localTable) {
+        writeColorTable(table, bits);
+    }
+
+    writeImageData(indices, std::max(2, bits));
+    ++m_frameCount;
+
+    if (m_file.error() != QFileDevice::NoError) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool GifEncoder::extendLastFrame(int frames)
+{
+    if (!m_file.isOpen() || m_pending.isNull()) {
+        m_error = "No frame to extend";
+        return false;
+    }
+    m_pendingFrames += qMax(1, frames);
+    return true;
+}
+
+bool GifEncoder::close()
+{
+    if (!m_file.isOpen()) {
+        return false;
+    }
+    if (!m_pending.isNull()) {
+        writeFrame(nullptr);
+        m_pending = QImage();
+    }
+    m_file.putChar('\x3b');
+    const bool ok = m_file.error() == QFileDevice::NoError && m_frameCount > 0;
+    if (!ok && m_error.isEmpty()) {
+        m_error = m_frameCount > 0 ? m_file.errorString() : QString("No frames were written");
+    }
+    m_file.close();
+    m_displayed.clear();
+    return ok;
+}
+
+GifEncoder::Dither GifEncoder::ditherFromName(const QString& name)
+{
+    if (name == "ordered")
+        return Dither::Ordered;
+    if (name == "diffusion")
+        return Dither::Diffusion;
+    return Dither::None;
+}
+
+bool GifEncoder::concatenate(const QStringList& parts, const QString& filename, QString* error)
+{
+    auto fail = [error](const QString& message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    QFile out(filename);
+    if (parts.isEmpty() || !out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return fail(parts.isEmpty() ? QString("No GIF parts") : out.errorString());
+    }
+
+    QByteArray firstGlobalTable;
+    for (int i = 0; i < parts.size(); ++i) {
+        QFile part(parts[i]);
+        if (!part.open(QIODevice::ReadOnly)) {
+            return fail(parts[i] + ": " + part.errorString());
+        }
+        const QByteArray data = part.readAll();
+        const int size = data.size();
+        if (size < 14 || !data.startsWith("GIF89a") || data.at(size - 1) != '\x3b') {
+            return fail(parts[i] + ": not a complete GIF");
+        }
+
+        // Header: signature, screen descriptor and optional global table
+        const uchar packed = static_cast<uchar>(data.at(10));
+        const int globalTableBytes = (packed & 0x80) ? 3 * (1 << ((packed & 0x07) + 1)) : 0;
+        int pos = 13 + globalTableBytes;
+        const QByteArray globalTable = data.mid(13, globalTableBytes);
+        if (i == 0) {
+            firstGlobalTable = globalTable;
+        }
+        else if (globalTable != firstGlobalTable) {
+            return fail(parts[i] + ": global palette differs from the first part");
+        }
+
+        // Application extensions (looping) belong to the header too
+        while (pos + 1 < size && static_cast<uchar>(data.at(pos)) == 0x21 &&
+               static_cast<uchar>(data.at(pos + 1)) == 0xff) {
+            pos += 2;
+            while (pos < size && data.at(pos) != 0) {
+                pos += static_cast<uchar>(data.at(pos)) + 1;
+            }
+            ++pos;
+        }
+        if (pos >= size) {
+            return fail(parts[i] + ": truncated GIF");
+        }
+
+        if (i == 0) {
+            out.write(data.constData(), pos);
+        }
+        out.write(data.constData() + pos, size - 1 - pos);
+    }
+
+    out.putChar('\x3b');
+    if (out.error() != QFileDevice::NoError) {
+        return fail(out.errorString());
+    }
+    out.close();
+    return true;
+}
+
+void GifEncoder::writeColorTable(const QVector<QRgb>& colors, int tableBits)
+{
+    QByteArray bytes(3 * (1 << tableBits), '\0');
+    for (int i = 0; i < colors.size() && i < (1 << tableBits); ++i) {
+        bytes[i * 3] = static_cast<char>(qRed(colors[i]));
+        bytes[i * 3 + 1] = static_cast<char>(qGreen(colors[i]));
+        bytes[i * 3 + 2] = static_cast<char>(qBlue(colors[i]));
+    }
+    m_file.write(bytes);
+}
+
+// Variable-length-code LZW as the GIF format specifies it
+void GifEncoder::writeImageData(const QVector<uchar>& indices, int minCodeSize)
+{
+    QByteArray out;
+    out.reserve(indices.size() / 2 + 16);
+    out.append(static_cast<char>(minCodeSize));
+
+    const int clearCode = 1 << minCodeSize;
+    const int endCode = clearCode + 1;
+
+    std::vector<int> hashKeys(kHashSize, -1);
+    std::vector<int> hashCodes(kHashSize, 0);
+
+    CodeWriter writer(out);
+    int codeSize = minCodeSize + 1;
+    int nextCode = endCode + 1;
+    writer.write(clearCode, codeSize);
+
+    if (!indices.isEmpty()) {
+        int prefix = indices[0];
+        for (int i = 1; i < indices.size(); ++i) {
+            const int pixel = indices[i];
+            const int key = (pixel << 12) | prefix;
+
+            int slot = ((pixel << kHashShift) ^ prefix) % kHashSize;
+            const int step = slot == 0 ? 1 : kHashSize - slot;
+            bool found = false;
+            while (hashKeys[slot] >= 0) {
+                if (hashKeys[slot] == key) {
+                    found = true;
+                    break;
+                }
+                slot -= step;
+                if (slot < 0) {
+                    slot += kHashSize;
+                }
+            }
+            if (found) {
+                prefix = hashCodes[slot];
+                continue;
+            }
+
+            writer.write(prefix, codeSize);
+            prefix = pixel;
+
+            if (nextCode <= kMaxLzwCode) {
+                hashKeys[slot] = key;
+                hashCodes[slot] = nextCode;
+                if (nextCode >= (1 << codeSize)) {
+                    ++codeSize;
+                }
+                ++nextCode;
+            }
+            if (nextCode > kMaxLzwCode) {
+                // Dictionary full: start over
+                writer.write(clearCode, codeSize);
+                std::fill(hashKeys.begin(), hashKeys.end(), -1);
+                codeSize = minCodeSize + 1;
+                nextCode = endCode + 1;
+            }
+        }
+        writer.write(prefix, codeSize);
+    }
+
+    writer.write(endCode, codeSize);
+    writer.flush();
+    m_file.write(out);
+}
+
+// Delay in hundredths of a second, rounded on the running total
+int GifEncoder::lastFrameDelay() const
+{
+    const int fps = m_options.frameRate;
+    const qint64 start = (m_lastFrameStart * 100 + fps / 2) / fps;
+    const qint64 end = (m_elapsedFrames * 100 + fps / 2) / fps;
+    return static_cast<int>(qBound<qint64>(0, end - start, 0xffff));
+}
+
+void GifEncoder::writeShort(int value)
+{
+    m_file.putChar(static_cast<char>(value & 0xff));
+    m_file.putChar(static_cast<char>((value >> 8) & 0xff));
+}
+
+int GifEncoder::tableBits(int colorCount)
+{
+    int bits = 1;
+    while ((1 << bits) < colorCount && bits < 8) {
+        ++bits;
+    }
+    return bits;
+}
@@ -0,0 +1,99 @@
+#ifndef GIFENCODER_H
+#define GIFENCODER_H
+
+#include <QFile>
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// In-process animated GIF writer. Quantizing a frame is the expensive part
+// and is a static, thread-safe call, so exporters run it on their render
+// workers; addFrame() then only crops, LZW-compresses and writes, in order.
+//
+// Quantized frames are Format_Indexed8 images whose colour table ends with
+// one fully transparent entry. After the first frame only the rectangle that
+// changed is written, and pixels inside it that still show the right colour
+// become transparent so the previous frame shows through and LZW finds
+// longer runs. Layering cannot turn a pixel transparent again, so a frame
+// is held back until the next one arrives: when that one is transparent
+// where this one is not, this one is written whole and cleared afterwards.
+class GifEncoder
+{
+public:
+    enum class Dither { None, Ordered, Diffusion };
+    enum class PaletteMode { PerFrame, Global };
+
+    struct Options {
+        PaletteMode paletteMode = PaletteMode::PerFrame;
+        Dither dither = Dither::None;
+        bool loop = true;
+        int frameRate = 24;
+        bool cropToChanges = true;
+    };
+
+    // Opaque colours available to a frame; the last index is transparent
+    static const int kMaxColors = 255;
+
+    GifEncoder() = default;
+    GifEncoder(const GifEncoder&) = delete;
+    GifEncoder& operator=(const GifEncoder&) = delete;
+    ~GifEncoder();
+
+    // Thread-safe. Median-cut palette covering the opaque pixels of the
+    // samples, at most kMaxColors entries.
+    static QVector<QRgb> buildPalette(const QVector<QImage>& samples, int maxColors = kMaxColors);
+
+    // Thread-safe. Maps the image onto the palette, or onto one built from
+    // the image itself when the palette is empty. Pixels with alpha below
+    // half become the transparent entry.
+    static QImage quantize(const QImage& image, const QVector<QRgb>& palette, Dither dither);
+
+    // A global palette is written once in the header; frames quantized with
+    // it carry no colour table of their own
+    bool open(const QString& filename, const QSize& size, const Options& options,
+              const QVector<QRgb>& globalPalette = QVector<QRgb>());
+
+    // Appends a frame from quantize() shown for the given number of frames.
+    // It is written by the next addFrame() or close().
+    bool addFrame(const QImage& indexed, int durationFrames = 1);
+    // Shows the last frame for more frames, for held frames that are known
+    // only after the frame was added
+    bool extendLastFrame(int frames = 1);
+
+    bool close();
+    bool isOpen() const { return m_file.isOpen(); }
+    QString errorString() const { return m_error; }
+
+    // "none", "ordered" or "diffusion"; anything else is None
+    static Dither ditherFromName(const QString& name);
+
+    // Joins GIFs written with the same options into one, keeping the first
+    // file's header. Each part starts with a full frame, so the frames play
+    // on unchanged; parts with global palettes must share the palette.
+    static bool concatenate(const QStringList& parts, const QString& filename, QString* error = nullptr);
+
+private:
+    bool writeFrame(const QImage* next);
+    void writeColorTable(const QVector<QRgb>& colors, int tableBits);
+    void writeImageData(const QVector<uchar>& indices, int minCodeSize);
+    void writeShort(int value);
+    int lastFrameDelay() const;
+    static int tableBits(int colorCount);
+
+    QFile m_file;
+    QString m_error;
+    Options m_options;
+    QSize m_size;
+    QVector<QRgb> m_globalPalette;
+    QVector<QRgb> m_displayed;  // What a viewer shows after the last frame
+    int m_frameCount = 0;
+    qint64 m_elapsedFrames = 0; // For delays without rounding drift
+    qint64 m_lastFrameStart = 0; // m_elapsedFrames when the last frame began
+    QImage m_pending;           // Added, not yet written
+    int m_pendingFrames = 0;    // Its duration so far
+    bool m_sawTransparency = false;
+};
+
+#endif // GIFENCODER_H
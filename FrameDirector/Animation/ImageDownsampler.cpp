@@ -0,0 +1,285 @@
+// Animation/ImageDownsampler.cpp
+#include "ImageDownsampler.h"
+#include <QtMath>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRAMEDIRECTOR_DOWNSAMPLE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Weights are fixed point with this many fraction bits; 255 * 2^14 times the
+// summed weights of a Lanczos kernel stays well inside 32 bits
+const int kWeightBits = 14;
+const int kWeightOne = 1 << kWeightBits;
+const int kRounding = 1 << (kWeightBits - 1);
+
+const double kLanczosLobes = 3.0;
+
+double sinc(double x)
+{
+    if (x == 0.0) {
+        return 1.0;
+    }
+    x *= M_PI;
+    return std::sin(x) / x;
+}
+
+double filterWeight(ImageDownsampler::Filter filter, double x)
+{
+    if (filter == ImageDownsampler::Filter::Box) {
+        return x >= -0.5 && x < 0.5 ? 1.0 : 0.0;
+    }
+    return std::abs(x) < kLanczosLobes ? sinc(x) * sinc(x / kLanczosLobes) : 0.0;
+}
+
+// Scalar path: clamps the channels, then the colours to alpha so the result
+// stays valid premultiplied ARGB
+inline quint32 packPixel(const int sums[4])
+{
+    const int alpha = qBound(0, (sums[3] + kRounding) >> kWeightBits, 255);
+    quint32 pixel = quint32(alpha) << 24;
+    for (int channel = 0; channel < 3; ++channel) {
+        pixel |= quint32(qBound(0, (sums[channel] + kRounding) >> kWeightBits, alpha)) << (8 * channel);
+    }
+    return pixel;
+}
+
+inline void accumulate(int sums[4], quint32 pixel, int weight)
+{
+    for (int channel = 0; channel < 4; ++channel) {
+        sums[channel] += int((pixel >> (8 * channel)) & 0xff) * weight;
+    }
+}
+
+#ifdef FRAMEDIRECTOR_DOWNSAMPLE_SSE2
+
+// Two 16-bit weights in every 32-bit lane, for _mm_madd_epi16 on channel
+// pairs interleaved as (first, second)
+inline __m128i weightPair(qint16 first, qint16 second)
+{
+    return _mm_set1_epi32(int(quint32(quint16(first)) | (quint32(quint16(second)) << 16)));
+}
+
+// Rounds the channel sums of two pixels and clamps their colours to alpha;
+// the result is eight 16-bit lanes for _mm_packus_epi16, which clamps to 0-255
+inline __m128i finishPixels(__m128i first, __m128i second)
+{
+    const __m128i rounding = _mm_set1_epi32(kRounding);
+    first = _mm_srai_epi32(_mm_add_epi32(first, rounding), kWeightBits);
+    second = _mm_srai_epi32(_mm_add_epi32(second, rounding), kWeightBits);
+    const __m128i packed = _mm_packs_epi32(first, second);
+    const __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(packed, _MM_SHUFFLE(3, 3, 3, 3)),
+                                              _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm_min_epi16(packed, alpha);
+}
+
+// Channel sums of one output pixel from taps neighbouring source pixels
+inline __m128i horizontalSums(const quint32* source, const qint16* weights, int taps)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sums = zero;
+    int tap = 0;
+    for (; tap + 1 < taps; tap += 2) {
+        // b0 g0 r0 a0 b1 g1 r1 a1 -> b0 b1 g0 g1 r0 r1 a0 a1
+        const __m128i pixels = _mm_unpacklo_epi8(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(source + tap)), zero);
+        const __m128i pairs = _mm_unpacklo_epi16(pixels, _mm_srli_si128(pixels, 8));
+        sums = _mm_add_epi32(sums, _mm_madd_epi16(pairs, weightPair(weights[tap], weights[tap + 1])));
+    }
+    if (tap < taps) {
+        const __m128i pixel = _mm_unpacklo_epi8(_mm_cvtsi32_si128(int(source[tap])), zero);
+        sums = _mm_add_epi32(sums, _mm_madd_epi16(_mm_unpacklo_epi16(pixel, zero), weightPair(weights[tap], 0)));
+    }
+    return sums;
+}
+
+#endif
+
+} // namespace
+
+ImageDownsampler::ImageDownsampler(const QSize& sourceSize, const QSize& targetSize, Filter filter)
+    : m_sourceSize(sourceSize)
+    , m_targetSize(targetSize)
+{
+    if (!sourceSize.isEmpty() && !targetSize.isEmpty()) {
+        m_horizontal = buildAxis(sourceSize.width(), targetSize.width(), filter);
+        m_vertical = buildAxis(sourceSize.height(), targetSize.height(), filter);
+    }
+}
+
+// The kernel is stretched by the reduction factor so every source pixel
+// contributes; outputs near the edges renormalize over the pixels they have.
+// Each output gets the same number of taps, the span shifted inward at the
+// edges and padded with zero weights, so the inner loops never branch.
+ImageDownsampler::Axis ImageDownsampler::buildAxis(int sourceSize, int targetSize, Filter filter)
+{
+    const double scale = double(sourceSize) / targetSize;
+    const double filterScale = qMax(1.0, scale);
+    const double support = (filter == Filter::Box ? 0.5 : kLanczosLobes) * filterScale;
+
+    std::vector<int> starts(targetSize);
+    std::vector<int> ends(targetSize);
+    int taps = 1;
+    for (int i = 0; i < targetSize; ++i) {
+        const double center = (i + 0.5) * scale;
+        starts[i] = qMax(0, int(center - support + 0.5));
+        ends[i] = qMin(sourceSize, int(center + support + 0.5));
+        ends[i] = qMax(ends[i], qMin(starts[i] + 1, sourceSize));
+        starts[i] = qMin(starts[i], ends[i] - 1);
+        taps = qMax(taps, ends[i] - starts[i]);
+    }
+
+    Axis axis;
+    axis.taps = taps;
+    axis.first.resize(targetSize);
+    axis.weights.fill(0, targetSize * taps);
+
+    std::vector<double> values(taps);
+    for (int i = 0; i < targetSize; ++i) {
+        const double center = (i + 0.5) * scale;
+        const int first = qMin(starts[i], sourceSize - taps);
+        const int offset = starts[i] - first;
+        const int count = ends[i] - starts[i];
+
+        double total = 0.0;
+        for (int tap = 0; tap < count; ++tap) {
+            values[tap] = filterWeight(filter, (starts[i] + tap + 0.5 - center) / filterScale);
+            total += values[tap];
+        }
+        if (total == 0.0) {
+            values[0] = total = 1.0;
+            std::fill(values.begin() + 1, values.begin() + count, 0.0);
+        }
+
+        // Round, then put the rounding error on the largest weight so every
+        // output sums to exactly one
+        qint16* weights = axis.weights.data() + i * taps + offset;
+        int sum = 0;
+        int largest = 0;
+        for (int tap = 0; tap < count; ++tap) {
+            weights[tap] = qint16(qRound(values[tap] / total * kWeightOne));
+            sum += weights[tap];
+            if (weights[tap] > weights[largest]) {
+                largest = tap;
+            }
+        }
+        weights[largest] = qint16(weights[largest] + kWeightOne - sum);
+        axis.first[i] = first;
+    }
+    return axis;
+}
+
+QImage ImageDownsampler::apply(const QImage& image) const
+{
+    if (image.size() != m_sourceSize || m_targetSize.isEmpty()) {
+        return QImage();
+    }
+
+    // RGB32 shares the layout with an opaque alpha
+    QImage source = image;
+    if (source.format() != QImage::Format_ARGB32_Premultiplied && source.format() != QImage::Format_RGB32) {
+        source.convertTo(QImage::Format_ARGB32_Premultiplied);
+    }
+
+    const int sourceHeight = m_sourceSize.height();
+    const int targetWidth = m_targetSize.width();
+    const int targetHeight = m_targetSize.height();
+
+    // Horizontal pass into a targetWidth x sourceHeight intermediate
+    QImage horizontal;
+    if (targetWidth == m_sourceSize.width()) {
+        horizontal = source;
+    }
+    else {
+        horizontal = QImage(targetWidth, sourceHeight, QImage::Format_ARGB32_Premultiplied);
+        const int taps = m_horizontal.taps;
+        for (int y = 0; y < sourceHeight; ++y) {
+            const quint32* in = reinterpret_cast<const quint32*>(source.constScanLine(y));
+            quint32* out = reinterpret_cast<quint32*>(horizontal.scanLine(y));
+            int x = 0;
+#ifdef FRAMEDIRECTOR_DOWNSAMPLE_SSE2
+            for (; x + 1 < targetWidth; x += 2) {
+                const __m128i first = horizontalSums(in + m_horizontal.first[x],
+                                                     m_horizontal.weights.constData() + x * taps, taps);
+                const __m128i second = horizontalSums(in + m_horizontal.first[x + 1],
+                                                      m_horizontal.weights.constData() + (x + 1) * taps, taps);
+                const __m128i pixels = finishPixels(first, second);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(pixels, pixels));
+            }
+#endif
+            for (; x < targetWidth; ++x) {
+                const quint32* pixels = in + m_horizontal.first[x];
+                const qint16* weights = m_horizontal.weights.constData() + x * taps;
+                int sums[4] = { 0, 0, 0, 0 };
+                for (int tap = 0; tap < taps; ++tap) {
+                    accumulate(sums, pixels[tap], weights[tap]);
+                }
+                out[x] = packPixel(sums);
+            }
+        }
+    }
+
+    if (targetHeight == sourceHeight) {
+        return horizontal.format() == QImage::Format_ARGB32_Premultiplied
+            ? horizontal : horizontal.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+
+    // Vertical pass, a run of output pixels at a time down the same taps
+    QImage result(targetWidth, targetHeight, QImage::Format_ARGB32_Premultiplied);
+    const int taps = m_vertical.taps;
+    const uchar* base = horizontal.constBits();
+    const qsizetype stride = horizontal.bytesPerLine();
+    for (int y = 0; y < targetHeight; ++y) {
+        const uchar* rows = base + m_vertical.first[y] * stride;
+        const qint16* weights = m_vertical.weights.constData() + y * taps;
+        quint32* out = reinterpret_cast<quint32*>(result.scanLine(y));
+        int x = 0;
+#ifdef FRAMEDIRECTOR_DOWNSAMPLE_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 3 < targetWidth; x += 4) {
+            __m128i sums0 = zero;
+            __m128i sums1 = zero;
+            __m128i sums2 = zero;
+            __m128i sums3 = zero;
+            for (int tap = 0; tap < taps; tap += 2) {
+                // Two rows at once: their channels interleaved as (upper, lower)
+                const __m128i upper = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows + tap * stride));
+                const __m128i lower = tap + 1 < taps
+                    ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows + (tap + 1) * stride))
+                    : zero;
+                const __m128i weight = weightPair(weights[tap], tap + 1 < taps ? weights[tap + 1] : 0);
+                const __m128i upperLow = _mm_unpacklo_epi8(upper, zero);
+                const __m128i upperHigh = _mm_unpackhi_epi8(upper, zero);
+                const __m128i lowerLow = _mm_unpacklo_epi8(lower, zero);
+                const __m128i lowerHigh = _mm_unpackhi_epi8(lower, zero);
+                sums0 = _mm_add_epi32(sums0, _mm_madd_epi16(_mm_unpacklo_epi16(upperLow, lowerLow), weight));
+                sums1 = _mm_add_epi32(sums1, _mm_madd_epi16(_mm_unpackhi_epi16(upperLow, lowerLow), weight));
+                sums2 = _mm_add_epi32(sums2, _mm_madd_epi16(_mm_unpacklo_epi16(upperHigh, lowerHigh), weight));
+                sums3 = _mm_add_epi32(sums3, _mm_madd_epi16(_mm_unpackhi_epi16(upperHigh, lowerHigh), weight));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x),
+                             _mm_packus_epi16(finishPixels(sums0, sums1), finishPixels(sums2, sums3)));
+            rows += 4 * sizeof(quint32);
+        }
+#endif
+        for (; x < targetWidth; ++x) {
+            int sums[4] = { 0, 0, 0, 0 };
+            for (int tap = 0; tap < taps; ++tap) {
+                accumulate(sums, reinterpret_cast<const quint32*>(rows + tap * stride)[0], weights[tap]);
+            }
+            out[x] = packPixel(sums);
+            rows += sizeof(quint32);
+        }
+    }
+    return result;
+}
+
+QImage ImageDownsampler::scaled(const QImage& image, const QSize& size, Filter filter)
+{
+    return ImageDownsampler(image.size(), size, filter).apply(image);
+}
@@ -0,0 +1,75 @@
+#ifndef MULTIRESOLUTIONWRITER_H
+#define MULTIRESOLUTIONWRITER_H
+
+#include "ImageDownsampler.h"
+#include "PngEncoder.h"
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+#include <vector>
+
+class FrameExporter;
+
+// Writes a PNG sequence at several resolutions in one pass, e.g. a 4K
+// master, a 1080p delivery and 320px previews. Each frame is rendered once
+// at the largest size; every smaller size is downsampled from that render on
+// the same export worker, so extra sizes cost a resample and a save rather
+// than a render. Each size goes to its own directory as frame_0001.png, ...
+// PNG encoding also runs on the workers, with the compression chosen by
+// setPngOptions().
+class MultiResolutionWriter
+{
+public:
+    // Parses a comma-separated list such as "3840x2160, 1920x1080, 320":
+    // WxH is exact, a bare width keeps the canvas aspect ratio and "50%"
+    // scales the canvas. Empty text is the canvas size.
+    static QVector<QSize> parseSizes(const QString& text, const QSize& canvasSize, QString* error = nullptr);
+
+    // A single size writes into directory itself; several each get a
+    // subdirectory named after the size, e.g. directory/1920x1080
+    MultiResolutionWriter(const QVector<QSize>& sizes, const QString& directory);
+
+    QSize renderSize() const { return m_renderSize; }
+    QStringList directories() const;
+
+    // Compression for every size; set before attach()
+    void setPngOptions(const PngEncoder::Options& options) { m_pngOptions = options; }
+    PngEncoder::Options pngOptions() const { return m_pngOptions; }
+
+    // Creates the directories, then sets the exporter's render size and an
+    // encoder that writes every size
+    bool attach(FrameExporter& exporter, QString* error = nullptr) const;
+
+    // Thread-safe; image is the frame rendered at renderSize()
+    bool write(int frame, const QImage& image) const;
+    // Makes a held frame's files the ones written for sourceFrame
+    bool linkHeld(int frame, int sourceFrame) const;
+    void removeFrames(int firstFrame, int lastFrame) const;
+
+    static QString frameFileName(const QString& directory, int frame);
+
+    // Totals over every write() so far
+    qint64 bytesWritten() const { return m_bytesWritten; }
+    int imagesWritten() const { return m_imagesWritten; }
+    // One line for the log: frames/s and MB/s written over the given wall
+    // time, with the mean encode time per image
+    QString statistics(int frames, double seconds) const;
+
+private:
+    struct Output {
+        QSize size;
+        QString directory;
+        ImageDownsampler downsampler;  // Unused for the render size itself
+    };
+
+    std::vector<Output> m_outputs;
+    QSize m_renderSize;
+    PngEncoder::Options m_pngOptions;
+    mutable std::atomic<qint64> m_bytesWritten{ 0 };
+    mutable std::atomic<qint64> m_encodeNanoseconds{ 0 };
+    mutable std::atomic<int> m_imagesWritten{ 0 };
+};
+
+#endif // MULTIRESOLUTIONWRITER_H
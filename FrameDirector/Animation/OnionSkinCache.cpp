@@ -0,0 +1,81 @@
+// Animation/OnionSkinCache.cpp
+#include "OnionSkinCache.h"
+#include <QPainter>
+
+namespace {
+// Share of the tint mixed into the drawing, keeping its shapes readable
+const qreal kTintStrength = 0.5;
+}
+
+void OnionSkinCache::setSnapshotProvider(SnapshotProvider provider)
+{
+    m_provider = std::move(provider);
+    clear();
+}
+
+QImage OnionSkinCache::image(int layerIndex, int frame, Side side, quint64 revision)
+{
+    Entry& entry = m_entries[key(layerIndex, frame, side)];
+    entry.used = true;
+
+    if (entry.valid && entry.revision == revision) {
+        return entry.image;
+    }
+
+    entry.revision = revision;
+    entry.image = QImage();
+    entry.valid = true;
+    if (!m_provider) {
+        return QImage();
+    }
+
+    const FrameSnapshot snapshot = m_provider(layerIndex, frame);
+    if (snapshot.primitiveCount() == 0) {
+        return QImage();
+    }
+
+    QImage image = snapshot.render();
+    if (image.isNull()) {
+        return QImage();
+    }
+
+    // Colour only where the drawing is, keeping its alpha
+    QPainter painter(&image);
+    painter.setCompositionMode(QPainter::CompositionMode_SourceAtop);
+    painter.setOpacity(kTintStrength);
+    painter.fillRect(image.rect(), tint(side));
+    painter.end();
+
+    entry.image = image;
+    return entry.image;
+}
+
+void OnionSkinCache::pruneUnused()
+{
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (!it->used) {
+            it = m_entries.erase(it);
+        }
+        else {
+            it->used = false;
+            ++it;
+        }
+    }
+}
+
+void OnionSkinCache::clear()
+{
+    m_entries.clear();
+}
+
+QColor OnionSkinCache::tint(Side side)
+{
+    return side == Side::Before ? QColor(230, 60, 60) : QColor(60, 170, 80);
+}
+
+quint64 OnionSkinCache::key(int layerIndex, int frame, Side side)
+{
+    return (static_cast<quint64>(static_cast<quint32>(layerIndex)) << 33) |
+           (static_cast<quint64>(static_cast<quint32>(frame)) << 1) |
+           (side == Side::After ? 1u : 0u);
+}
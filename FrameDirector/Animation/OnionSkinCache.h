@@ -0,0 +1,51 @@
+#ifndef ONIONSKINCACHE_H
+#define ONIONSKINCACHE_H
+
+#include "FrameSnapshot.h"
+#include <QColor>
+#include <QHash>
+#include <QImage>
+#include <functional>
+
+// Tinted, pre-rendered onion skin images for the vector canvas. Each entry is
+// one layer's content at one frame on one side of the playhead, tagged with
+// the layer revision it was rendered from. Stepping and editing reuse the
+// images until the layer's content actually changes, so the scene never has
+// to hold the neighbouring frames' items.
+class OnionSkinCache
+{
+public:
+    enum class Side { Before, After };
+
+    // Captures one layer's content at a frame, at full opacity
+    using SnapshotProvider = std::function<FrameSnapshot(int layerIndex, int frame)>;
+
+    void setSnapshotProvider(SnapshotProvider provider);
+
+    // Tinted image of the layer at frame, rendered on a miss or when the
+    // cached one was built from an older revision. Null for empty content.
+    QImage image(int layerIndex, int frame, Side side, quint64 revision);
+
+    // Drops every entry not requested since the previous prune, so memory
+    // follows the onion range currently shown
+    void pruneUnused();
+    void clear();
+    int size() const { return m_entries.size(); }
+
+    static QColor tint(Side side);
+
+private:
+    struct Entry {
+        quint64 revision = 0;
+        QImage image;           // Null when the layer had nothing to show
+        bool valid = false;
+        bool used = false;
+    };
+
+    static quint64 key(int layerIndex, int frame, Side side);
+
+    SnapshotProvider m_provider;
+    QHash<quint64, Entry> m_entries;
+};
+
+#endif // ONIONSKINCACHE_H
@@ -0,0 +1,394 @@
+// Animation/PlaybackCache.cpp
+#include "PlaybackCache.h"
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QThread>
+#include <QThreadPool>
+
+namespace {
+// Enough for ~60 full HD frames
+const qint64 kDefaultMemoryBudget = 512LL * 1024 * 1024;
+
+// Auto quality: frames measured at a resolution before it may step down,
+// and the weight of each new measurement in the running average
+const int kAutoQualitySamples = 4;
+const qreal kRenderTimeSmoothing = 0.25;
+const int kMaxDivisor = 4;
+}
+
+PlaybackCache::PlaybackCache(QObject* parent)
+    : QObject(parent)
+    , m_prefetchTimer(new QTimer(this))
+    , m_renderPool(new QThreadPool(this))
+    , m_generation(0)
+    , m_frameBytes(0)
+    , m_memoryBudget(kDefaultMemoryBudget)
+    , m_memoryUsage(0)
+    , m_firstFrame(1)
+    , m_lastFrame(1)
+    , m_playhead(1)
+    , m_quality(Quality::Full)
+    , m_divisor(1)
+    , m_canvasWidth(0)
+    , m_frameBudget(1000.0 / 24)
+    , m_averageRenderMs(0.0)
+    , m_renderSamples(0)
+    , m_hits(0)
+    , m_misses(0)
+    , m_active(false)
+{
+    // Leave a core for the GUI thread, which captures snapshots and plays
+    m_renderPool->setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+
+    m_prefetchTimer->setSingleShot(true);
+    m_prefetchTimer->setInterval(0);
+    connect(m_prefetchTimer, &QTimer::timeout, this, &PlaybackCache::prefetchNext);
+}
+
+PlaybackCache::~PlaybackCache()
+{
+    stop();
+    // Workers post their results back to this object; let them finish first
+    m_renderPool->waitForDone();
+}
+
+void PlaybackCache::setSnapshotProvider(SnapshotProvider provider)
+{
+    m_provider = std::move(provider);
+    invalidate();
+}
+
+void PlaybackCache::setMemoryBudget(qint64 bytes)
+{
+    m_memoryBudget = qMax<qint64>(0, bytes);
+    while (m_memoryUsage > m_memoryBudget && !m_frames.isEmpty()) {
+        remove(farthestCachedFrame());
+    }
+}
+
+qint64 PlaybackCache::memoryBudget() const
+{
+    return m_memoryBudget;
+}
+
+qint64 PlaybackCache::memoryUsage() const
+{
+    return m_memoryUsage;
+}
+
+void PlaybackCache::start(int frame, int firstFrame, int lastFrame)
+{
+    m_firstFrame = qMax(1, firstFrame);
+    m_lastFrame = qMax(m_firstFrame, lastFrame);
+    m_playhead = qBound(m_firstFrame, frame, m_lastFrame);
+    m_active = true;
+    schedulePrefetch();
+}
+
+void PlaybackCache::stop()
+{
+    m_active = false;
+    m_prefetchTimer->stop();
+    m_renderPool->clear();
+    m_pending.clear();
+    m_stalePending.clear();
+    ++m_generation;
+
+    if (m_quality == Quality::Auto) {
+        setResolutionDivisor(1);
+    }
+}
+
+bool PlaybackCache::isActive() const
+{
+    return m_active;
+}
+
+void PlaybackCache::setQuality(Quality quality)
+{
+    m_quality = quality;
+    switch (quality) {
+    case Quality::Half: setResolutionDivisor(2); break;
+    case Quality::Quarter: setResolutionDivisor(4); break;
+    default: setResolutionDivisor(1); break;
+    }
+}
+
+PlaybackCache::Quality PlaybackCache::quality() const
+{
+    return m_quality;
+}
+
+void PlaybackCache::setFrameBudget(qreal milliseconds)
+{
+    m_frameBudget = qMax<qreal>(1.0, milliseconds);
+}
+
+int PlaybackCache::resolutionDivisor() const
+{
+    return m_divisor;
+}
+
+void PlaybackCache::invalidate()
+{
+    m_renderPool->clear();
+    m_pending.clear();
+    m_stalePending.clear();
+    ++m_generation;
+    m_frames.clear();
+    m_memoryUsage = 0;
+    schedulePrefetch();
+}
+
+void PlaybackCache::invalidateFrames(int firstFrame, int lastFrame)
+{
+    for (int frame : m_pending) {
+        if (frame >= firstFrame && frame <= lastFrame) {
+            m_stalePending.insert(frame);
+        }
+    }
+
+    if (lastFrame - firstFrame + 1 < m_frames.size()) {
+        for (int frame = firstFrame; frame <= lastFrame; ++frame) {
+            remove(frame);
+        }
+    }
+    else {
+        for (auto it = m_frames.begin(); it != m_frames.end();) {
+            if (it.key() >= firstFrame && it.key() <= lastFrame) {
+                m_memoryUsage -= it.value().sizeInBytes();
+                it = m_frames.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+    schedulePrefetch();
+}
+
+void PlaybackCache::setPlayhead(int frame)
+{
+    m_playhead = qBound(m_firstFrame, frame, m_lastFrame);
+    schedulePrefetch();
+}
+
+QImage PlaybackCache::frame(int frame)
+{
+    auto it = m_frames.constFind(frame);
+    if (it == m_frames.constEnd()) {
+        ++m_misses;
+        return QImage();
+    }
+
+    ++m_hits;
+    return it.value();
+}
+
+bool PlaybackCache::contains(int frame) const
+{
+    return m_frames.contains(frame);
+}
+
+int PlaybackCache::cachedFrameCount() const
+{
+    return m_frames.size();
+}
+
+int PlaybackCache::hits() const
+{
+    return m_hits;
+}
+
+int PlaybackCache::misses() const
+{
+    return m_misses;
+}
+
+void PlaybackCache::resetStatistics()
+{
+    m_hits = 0;
+    m_misses = 0;
+}
+
+void PlaybackCache::prefetchNext()
+{
+    if (!m_active || !m_provider) {
+        return;
+    }
+
+    const int length = m_lastFrame - m_firstFrame + 1;
+
+    while (m_pending.size() < m_renderPool->maxThreadCount()) {
+        // Next frame the playhead will reach that isn't cached or rendering
+        int target = -1;
+        for (int step = 1; step <= length; ++step) {
+            int candidate = m_firstFrame + (m_playhead - m_firstFrame + step) % length;
+            if (!m_frames.contains(candidate) && !m_pending.contains(candidate)) {
+                target = candidate;
+                break;
+            }
+        }
+
+        if (target == -1) {
+            return; // The whole loop range is cached or on its way
+        }
+
+        // Make room for the target and every frame in flight by dropping
+        // frames needed later than the target. If nothing cached is further
+        // away, wait for the playhead to move on.
+        const qint64 needed = (m_pending.size() + 1) * m_frameBytes;
+        while (m_memoryUsage + needed > m_memoryBudget) {
+            if (m_frames.isEmpty()) {
+                return;
+            }
+            int farthest = farthestCachedFrame();
+            if (distanceFromPlayhead(farthest) <= distanceFromPlayhead(target)) {
+                return;
+            }
+            remove(farthest);
+        }
+
+        const FrameSnapshot snapshot = m_provider(target);
+        if (!snapshot.isValid()) {
+            return;
+        }
+
+        m_pending.insert(target);
+        m_canvasWidth = snapshot.canvasSize().width();
+        const int generation = m_generation;
+        const int divisor = m_divisor;
+        const QSize size(qMax(1, snapshot.canvasSize().width() / divisor),
+                         qMax(1, snapshot.canvasSize().height() / divisor));
+        m_renderPool->start([this, snapshot, target, generation, divisor, size]() {
+            QElapsedTimer timer;
+            timer.start();
+            const QImage image = snapshot.render(size);
+            const qint64 elapsed = timer.nsecsElapsed();
+            QMetaObject::invokeMethod(this, [this, target, generation, image, divisor, elapsed]() {
+                frameRendered(target, generation, image, divisor, elapsed);
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void PlaybackCache::frameRendered(int frame, int generation, const QImage& image, int divisor,
+                                  qint64 renderNanoseconds)
+{
+    if (generation != m_generation) {
+        return; // Rendered from a snapshot that has since been invalidated
+    }
+
+    m_pending.remove(frame);
+    if (m_stalePending.remove(frame) || divisor > m_divisor) {
+        schedulePrefetch(); // Outdated content or resolution; render it again
+        return;
+    }
+    if (image.isNull()) {
+        return;
+    }
+
+    if (divisor == m_divisor) {
+        updateAutoQuality(renderNanoseconds);
+    }
+
+    m_frameBytes = image.sizeInBytes();
+    insert(frame, image);
+
+    // The first batch is scheduled before any frame size is known
+    while (m_memoryUsage > m_memoryBudget && !m_frames.isEmpty()) {
+        remove(farthestCachedFrame());
+    }
+
+    schedulePrefetch();
+}
+
+// Workers render in parallel, so a frame is late only when the render time
+// spread over the pool exceeds the frame budget
+void PlaybackCache::updateAutoQuality(qint64 renderNanoseconds)
+{
+    if (m_quality != Quality::Auto || !m_active) {
+        return;
+    }
+
+    const qreal milliseconds = renderNanoseconds / 1e6;
+    m_averageRenderMs = m_renderSamples == 0 ? milliseconds
+        : m_averageRenderMs + (milliseconds - m_averageRenderMs) * kRenderTimeSmoothing;
+    ++m_renderSamples;
+
+    const qreal frameTime = m_averageRenderMs / m_renderPool->maxThreadCount();
+    if (m_renderSamples >= kAutoQualitySamples && frameTime > m_frameBudget && m_divisor < kMaxDivisor) {
+        setResolutionDivisor(m_divisor * 2);
+    }
+}
+
+// Frames already cached at a higher resolution stay; going finer drops the
+// coarser proxies so they are rendered again
+void PlaybackCache::setResolutionDivisor(int divisor)
+{
+    m_averageRenderMs = 0.0;
+    m_renderSamples = 0;
+    if (divisor == m_divisor) {
+        return;
+    }
+
+    if (divisor < m_divisor && m_canvasWidth > 0) {
+        const int width = qMax(1, m_canvasWidth / divisor);
+        for (auto it = m_frames.begin(); it != m_frames.end();) {
+            if (it.value().width() < width) {
+                m_memoryUsage -= it.value().sizeInBytes();
+                it = m_frames.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+    m_divisor = divisor;
+    emit resolutionChanged(divisor);
+    schedulePrefetch();
+}
+
+int PlaybackCache::distanceFromPlayhead(int frame) const
+{
+    const int length = m_lastFrame - m_firstFrame + 1;
+    return ((frame - m_playhead) % length + length) % length;
+}
+
+int PlaybackCache::farthestCachedFrame() const
+{
+    int farthest = -1;
+    int farthestDistance = -1;
+    for (auto it = m_frames.constBegin(); it != m_frames.constEnd(); ++it) {
+        int distance = distanceFromPlayhead(it.key());
+        if (distance > farthestDistance) {
+            farthestDistance = distance;
+            farthest = it.key();
+        }
+    }
+    return farthest;
+}
+
+void PlaybackCache::insert(int frame, const QImage& image)
+{
+    remove(frame);
+    m_frames.insert(frame, image);
+    m_memoryUsage += image.sizeInBytes();
+}
+
+void PlaybackCache::remove(int frame)
+{
+    auto it = m_frames.find(frame);
+    if (it != m_frames.end()) {
+        m_memoryUsage -= it.value().sizeInBytes();
+        m_frames.erase(it);
+    }
+}
+
+void PlaybackCache::schedulePrefetch()
+{
+    if (m_active && !m_prefetchTimer->isActive()) {
+        m_prefetchTimer->start();
+    }
+}
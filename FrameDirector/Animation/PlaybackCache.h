@@ -0,0 +1,120 @@
+#ifndef PLAYBACKCACHE_H
+#define PLAYBACKCACHE_H
+
+#include "FrameSnapshot.h"
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QImage>
+#include <functional>
+
+class QTimer;
+class QThreadPool;
+
+// Bounded cache of pre-rendered frames used during playback. While playing,
+// frames ahead of the playhead are captured as snapshots on the GUI thread
+// and rendered on worker threads, so the canvas can show each one as a
+// single image blit instead of rebuilding the live scene. Frames are kept in
+// playback order around the playhead: when the memory budget is reached, the
+// frame furthest away in playback order (the one just shown) makes room for
+// the next one, so the cache behaves as a ring buffer over the loop range.
+//
+// Frames can be rendered at a fraction of the canvas resolution (proxies)
+// and are upscaled when shown, so large canvases still play in time.
+class PlaybackCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Called on the GUI thread; the snapshot is rendered on a worker
+    using SnapshotProvider = std::function<FrameSnapshot(int frame)>;
+
+    // Auto starts at full resolution and halves it, down to a quarter,
+    // while the workers render frames slower than the frame budget; stop()
+    // returns it to full resolution
+    enum class Quality { Full, Half, Quarter, Auto };
+
+    explicit PlaybackCache(QObject* parent = nullptr);
+    ~PlaybackCache();
+
+    void setSnapshotProvider(SnapshotProvider provider);
+
+    // Memory budget in bytes for all cached images
+    void setMemoryBudget(qint64 bytes);
+    qint64 memoryBudget() const;
+    qint64 memoryUsage() const;
+
+    // Starts pre-rendering ahead of frame within [firstFrame, lastFrame]
+    void start(int frame, int firstFrame, int lastFrame);
+    void stop();
+    bool isActive() const;
+
+    void setQuality(Quality quality);
+    Quality quality() const;
+    // Time per frame at the playback frame rate, for Auto
+    void setFrameBudget(qreal milliseconds);
+    // Canvas size divisor frames are currently rendered at: 1, 2 or 4
+    int resolutionDivisor() const;
+
+    // Drops every cached frame, e.g. after the document changed. Frames
+    // still being rendered from older snapshots are discarded on arrival.
+    void invalidate();
+
+    // Drops just the frames in [firstFrame, lastFrame]; renders of them
+    // already in flight are discarded on arrival and scheduled again
+    void invalidateFrames(int firstFrame, int lastFrame);
+
+    // Moves the playhead; prefetching continues from here
+    void setPlayhead(int frame);
+
+    // Returns the cached image for frame, or a null image on a miss
+    QImage frame(int frame);
+    bool contains(int frame) const;
+    int cachedFrameCount() const;
+
+    // Lookup statistics since the last reset
+    int hits() const;
+    int misses() const;
+    void resetStatistics();
+
+signals:
+    void resolutionChanged(int divisor);
+
+private slots:
+    void prefetchNext();
+
+private:
+    int distanceFromPlayhead(int frame) const;
+    int farthestCachedFrame() const;
+    void frameRendered(int frame, int generation, const QImage& image, int divisor, qint64 renderNanoseconds);
+    void setResolutionDivisor(int divisor);
+    void updateAutoQuality(qint64 renderNanoseconds);
+    void insert(int frame, const QImage& image);
+    void remove(int frame);
+    void schedulePrefetch();
+
+    SnapshotProvider m_provider;
+    QTimer* m_prefetchTimer;
+    QThreadPool* m_renderPool;
+    QHash<int, QImage> m_frames;
+    QSet<int> m_pending;       // Frames being rendered on workers
+    QSet<int> m_stalePending;  // Pending frames invalidated since they were captured
+    int m_generation;          // Bumped whenever pending renders go stale
+    qint64 m_frameBytes;       // Size of the last rendered frame
+    qint64 m_memoryBudget;
+    qint64 m_memoryUsage;
+    int m_firstFrame;
+    int m_lastFrame;
+    int m_playhead;
+    Quality m_quality;
+    int m_divisor;
+    int m_canvasWidth;         // From the last snapshot, to tell proxies apart
+    qreal m_frameBudget;       // Milliseconds
+    qreal m_averageRenderMs;   // Per frame at the current divisor
+    int m_renderSamples;
+    int m_hits;
+    int m_misses;
+    bool m_active;
+};
+
+#endif // PLAYBACKCACHE_H
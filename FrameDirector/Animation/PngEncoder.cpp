@@ -0,0 +1,280 @@
+// Animation/PngEncoder.cpp
+#include "PngEncoder.h"
+#include <QFile>
+#include <QtEndian>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const char kSignature[] = "\x89PNG\r\n\x1a\n";
+
+// PNG filter type bytes, in the order of PngEncoder::Filter
+const int kFilterTypes = 5;
+
+inline int paeth(int left, int up, int upLeft)
+{
+    const int estimate = left + up - upLeft;
+    const int toLeft = std::abs(estimate - left);
+    const int toUp = std::abs(estimate - up);
+    const int toUpLeft = std::abs(estimate - upLeft);
+    if (toLeft <= toUp && toLeft <= toUpLeft) {
+        return left;
+    }
+    return toUp <= toUpLeft ? up : upLeft;
+}
+
+// libpng's heuristic: the row whose bytes, read as signed, sum to the least
+// magnitude usually compresses best
+int rowCost(const uchar* row, int rowBytes)
+{
+    int cost = 0;
+    for (int i = 0; i < rowBytes; ++i) {
+        cost += std::abs(int(static_cast<signed char>(row[i])));
+    }
+    return cost;
+}
+
+QByteArray bigEndian(quint32 value)
+{
+    QByteArray bytes(4, Qt::Uninitialized);
+    qToBigEndian(value, bytes.data());
+    return bytes;
+}
+
+}
+
+bool PngEncoder::optionsFromName(const QString& name, Options& options)
+{
+    const QString key = name.trimmed().toLower();
+    if (key == "fast") {
+        options.compressionLevel = 1;
+        options.filter = Filter::Sub;
+        return true;
+    }
+    if (key == "default") {
+        options.compressionLevel = 6;
+        options.filter = Filter::Adaptive;
+        return true;
+    }
+    if (key == "max") {
+        options.compressionLevel = 9;
+        options.filter = Filter::Adaptive;
+        return true;
+    }
+
+    bool ok = false;
+    const int level = key.toInt(&ok);
+    if (!ok || level < 0 || level > 9) {
+        return false;
+    }
+    options.compressionLevel = level;
+    options.filter = Filter::Adaptive;
+    return true;
+}
+
+bool PngEncoder::filterFromName(const QString& name, Filter& filter)
+{
+    for (Filter candidate : { Filter::None, Filter::Sub, Filter::Up, Filter::Average, Filter::Paeth, Filter::Adaptive }) {
+        if (filterName(candidate) == name.trimmed().toLower()) {
+            filter = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+QString PngEncoder::filterName(Filter filter)
+{
+    switch (filter) {
+    case Filter::None:
+        return "none";
+    case Filter::Sub:
+        return "sub";
+    case Filter::Up:
+        return "up";
+    case Filter::Average:
+        return "average";
+    case Filter::Paeth:
+        return "paeth";
+    case Filter::Adaptive:
+        break;
+    }
+    return "adaptive";
+}
+
+QByteArray PngEncoder::encode(const QImage& image, const Options& options)
+{
+    if (image.isNull()) {
+        return QByteArray();
+    }
+
+    // Opaque frames lose the alpha byte, a quarter of the data to compress
+    const bool opaque = isOpaque(image);
+    const QImage pixels = image.convertToFormat(opaque ? QImage::Format_RGB888 : QImage::Format_RGBA8888);
+    const int bytesPerPixel = opaque ? 3 : 4;
+    const int width = pixels.width();
+    const int height = pixels.height();
+    const int rowBytes = width * bytesPerPixel;
+
+    // Each filtered row is its filter type byte followed by the row
+    QByteArray filtered(qsizetype(rowBytes + 1) * height, Qt::Uninitialized);
+    const std::vector<uchar> zeroRow(rowBytes, 0);
+    std::vector<uchar> candidates(options.filter == Filter::Adaptive ? size_t(rowBytes) * kFilterTypes : 0);
+
+    for (int y = 0; y < height; ++y) {
+        const uchar* row = pixels.constScanLine(y);
+        const uchar* previous = y > 0 ? pixels.constScanLine(y - 1) : zeroRow.data();
+        uchar* out = reinterpret_cast<uchar*>(filtered.data()) + qsizetype(rowBytes + 1) * y;
+
+        if (options.filter != Filter::Adaptive) {
+            out[0] = uchar(options.filter);
+            filterRow(options.filter, row, previous, out + 1, rowBytes, bytesPerPixel);
+            continue;
+        }
+
+        int bestType = 0;
+        int bestCost = INT_MAX;
+        for (int type = 0; type < kFilterTypes; ++type) {
+            uchar* candidate = candidates.data() + size_t(rowBytes) * type;
+            filterRow(Filter(type), row, previous, candidate, rowBytes, bytesPerPixel);
+            const int cost = rowCost(candidate, rowBytes);
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestType = type;
+            }
+        }
+        out[0] = uchar(bestType);
+        std::memcpy(out + 1, candidates.data() + size_t(rowBytes) * bestType, rowBytes);
+    }
+
+    // qCompress produces a zlib stream behind a 4-byte length, and a zlib
+    // stream is exactly what IDAT holds
+    const QByteArray compressed = qCompress(filtered, qBound(0, options.compressionLevel, 9));
+    if (compressed.size() <= 4) {
+        return QByteArray();
+    }
+
+    QByteArray header;
+    header.append(bigEndian(quint32(width)));
+    header.append(bigEndian(quint32(height)));
+    header.append(char(8));                     // Bit depth
+    header.append(char(opaque ? 2 : 6));        // Truecolour, with alpha unless opaque
+    header.append(char(0));                     // Deflate
+    header.append(char(0));                     // Adaptive filtering
+    header.append(char(0));                     // Not interlaced
+
+    QByteArray png;
+    png.reserve(compressed.size() + 64);
+    png.append(kSignature, 8);
+    appendChunk(png, "IHDR", header);
+    appendChunk(png, "IDAT", compressed.mid(4));
+    appendChunk(png, "IEND", QByteArray());
+    return png;
+}
+
+bool PngEncoder::write(const QImage& image, const QString& fileName, const Options& options, qint64* bytesWritten)
+{
+    const QByteArray png = encode(image, options);
+    if (png.isEmpty()) {
+        return false;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(png) != png.size()) {
+        return false;
+    }
+    if (bytesWritten) {
+        *bytesWritten = png.size();
+    }
+    return true;
+}
+
+bool PngEncoder::isOpaque(const QImage& image)
+{
+    if (!image.hasAlphaChannel()) {
+        return true;
+    }
+    if (image.format() != QImage::Format_ARGB32 && image.format() != QImage::Format_ARGB32_Premultiplied) {
+        return false;
+    }
+
+    for (int y = 0; y < image.height(); ++y) {
+        const QRgb* line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            if (qAlpha(line[x]) != 255) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void PngEncoder::filterRow(Filter filter, const uchar* row, const uchar* previous, uchar* out,
+                           int rowBytes, int bytesPerPixel)
+{
+    switch (filter) {
+    case Filter::Sub:
+        std::memcpy(out, row, bytesPerPixel);
+        for (int i = bytesPerPixel; i < rowBytes; ++i) {
+            out[i] = uchar(row[i] - row[i - bytesPerPixel]);
+        }
+        break;
+    case Filter::Up:
+        for (int i = 0; i < rowBytes; ++i) {
+            out[i] = uchar(row[i] - previous[i]);
+        }
+        break;
+    case Filter::Average:
+        for (int i = 0; i < bytesPerPixel; ++i) {
+            out[i] = uchar(row[i] - (previous[i] >> 1));
+        }
+        for (int i = bytesPerPixel; i < rowBytes; ++i) {
+            out[i] = uchar(row[i] - ((row[i - bytesPerPixel] + previous[i]) >> 1));
+        }
+        break;
+    case Filter::Paeth:
+        for (int i = 0; i < bytesPerPixel; ++i) {
+            out[i] = uchar(row[i] - previous[i]);
+        }
+        for (int i = bytesPerPixel; i < rowBytes; ++i) {
+            out[i] = uchar(row[i] - paeth(row[i - bytesPerPixel], previous[i], previous[i - bytesPerPixel]));
+        }
+        break;
+    case Filter::None:
+    case Filter::Adaptive:
+        std::memcpy(out, row, rowBytes);
+        break;
+    }
+}
+
+void PngEncoder::appendChunk(QByteArray& png, const char* type, const QByteArray& data)
+{
+    png.append(bigEndian(quint32(data.size())));
+    const int start = png.size();
+    png.append(type, 4);
+    png.append(data);
+    png.append(bigEndian(crc32(png.constData() + start, png.size() - start) ^ 0xFFFFFFFFu));
+}
+
+quint32 PngEncoder::crc32(const char* data, int length, quint32 crc)
+{
+    static const std::vector<quint32> table = [] {
+        std::vector<quint32> entries(256);
+        for (quint32 n = 0; n < 256; ++n) {
+            quint32 c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[n] = c;
+        }
+        return entries;
+    }();
+
+    for (int i = 0; i < length; ++i) {
+        crc = table[(crc ^ uchar(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
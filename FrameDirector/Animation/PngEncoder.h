@@ -0,0 +1,46 @@
+#ifndef PNGENCODER_H
+#define PNGENCODER_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QString>
+
+// PNG writer for image-sequence export. QImage::save always compresses at
+// libpng's default settings; this exposes the two knobs that trade file size
+// for encoding time: the zlib level and the per-row filter. Dailies want
+// level 1 with a fixed filter, archives level 9 with adaptive filtering.
+// Opaque frames are written as 8-bit RGB, others as 8-bit straight RGBA.
+//
+// Every call is thread-safe, so exporters encode on their render workers.
+class PngEncoder
+{
+public:
+    enum class Filter { None, Sub, Up, Average, Paeth, Adaptive };
+
+    struct Options {
+        int compressionLevel = 6;   // zlib level, 0 (stored) to 9
+        Filter filter = Filter::Adaptive;
+    };
+
+    // "fast" (level 1, Sub), "default" (level 6, adaptive), "max" (level 9,
+    // adaptive) or a level 0-9 with adaptive filtering. False for anything else.
+    static bool optionsFromName(const QString& name, Options& options);
+    // "none", "sub", "up", "average", "paeth" or "adaptive"
+    static bool filterFromName(const QString& name, Filter& filter);
+    static QString filterName(Filter filter);
+
+    // Empty for a null image
+    static QByteArray encode(const QImage& image, const Options& options);
+    // bytesWritten receives the file size on success
+    static bool write(const QImage& image, const QString& fileName, const Options& options,
+                      qint64* bytesWritten = nullptr);
+
+private:
+    static bool isOpaque(const QImage& image);
+    static void filterRow(Filter filter, const uchar* row, const uchar* previous, uchar* out,
+                          int rowBytes, int bytesPerPixel);
+    static void appendChunk(QByteArray& png, const char* type, const QByteArray& data);
+    static quint32 crc32(const char* data, int length, quint32 crc = 0xFFFFFFFFu);
+};
+
+#endif // PNGENCODER_H
@@ -0,0 +1,485 @@
+// Animation/SpriteSheetExporter.cpp
+#include "SpriteSheetExporter.h"
+#include "FrameExporter.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPainter>
+#include <QThreadPool>
+#include <QDebug>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+namespace {
+
+// Processed frames with no visible pixel are 1x1 and carry this offset
+const QPoint kEmptyFrameOffset(-1, -1);
+
+struct PackRect {
+    int x = 0;
+    int y = 0;
+    int w = 0;
+    int h = 0;
+
+    int right() const { return x + w; }
+    int bottom() const { return y + h; }
+    bool contains(const PackRect& other) const {
+        return other.x >= x && other.y >= y && other.right() <= right() && other.bottom() <= bottom();
+    }
+    bool intersects(const PackRect& other) const {
+        return other.x < right() && other.right() > x && other.y < bottom() && other.bottom() > y;
+    }
+};
+
+// MaxRects bin packer with the best short side fit heuristic (Jylanki,
+// "A Thousand Ways to Pack the Bin")
+class MaxRectsPacker
+{
+public:
+    MaxRectsPacker(int width, int height) { m_free.append({ 0, 0, width, height }); }
+
+    bool insert(int width, int height, QPoint& position) {
+        int best = -1;
+        int bestShort = std::numeric_limits<int>::max();
+        int bestLong = std::numeric_limits<int>::max();
+        for (int i = 0; i < m_free.size(); ++i) {
+            const PackRect& free = m_free[i];
+            if (free.w < width || free.h < height) {
+                continue;
+            }
+            const int leftoverX = free.w - width;
+            const int leftoverY = free.h - height;
+            const int shortSide = std::min(leftoverX, leftoverY);
+            const int longSide = std::max(leftoverX, leftoverY);
+            if (shortSide < bestShort || (shortSide == bestShort && longSide < bestLong)) {
+                best = i;
+                bestShort = shortSide;
+                bestLong = longSide;
+            }
+        }
+        if (best < 0) {
+            return false;
+        }
+
+        const PackRect used{ m_free[best].x, m_free[best].y, width, height };
+        position = QPoint(used.x, used.y);
+        split(used);
+        prune();
+        return true;
+    }
+
+private:
+    // Replaces every free rectangle the used one overlaps by its leftovers
+    void split(const PackRect& used) {
+        QVector<PackRect> result;
+        result.reserve(m_free.size() + 4);
+        for (const PackRect& free : m_free) {
+            if (!free.intersects(used)) {
+                result.append(free);
+                continue;
+            }
+            if (used.x > free.x) {
+                result.append({ free.x, free.y, used.x - free.x, free.h });
+            }
+            if (used.right() < free.right()) {
+                result.append({ used.right(), free.y, free.right() - used.right(), free.h });
+            }
+            if (used.y > free.y) {
+                result.append({ free.x, free.y, free.w, used.y - free.y });
+            }
+            if (used.bottom() < free.bottom()) {
+                result.append({ free.x, used.bottom(), free.w, free.bottom() - used.bottom() });
+            }
+        }
+        m_free.swap(result);
+    }
+
+    // Drops free rectangles lying inside another one
+    void prune() {
+        for (int i = 0; i < m_free.size(); ++i) {
+            for (int j = i + 1; j < m_free.size(); ++j) {
+                if (m_free[j].contains(m_free[i])) {
+                    m_free.removeAt(i);
+                    --i;
+                    break;
+                }
+                if (m_free[i].contains(m_free[j])) {
+                    m_free.removeAt(j);
+                    --j;
+                }
+            }
+        }
+    }
+
+    QVector<PackRect> m_free;
+};
+
+int nextPowerOfTwo(int value)
+{
+    int result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+quint64 imageHash(const QImage& image)
+{
+    quint64 hash = (quint64(image.width()) << 32) ^ quint64(image.height());
+    const qsizetype rowBytes = qsizetype(image.width()) * 4;
+    for (int y = 0; y < image.height(); ++y) {
+        hash = hash * 1099511628211ULL ^ qHashBits(image.constScanLine(y), rowBytes);
+    }
+    return hash;
+}
+
+} // namespace
+
+QRect SpriteSheetExporter::alphaBounds(const QImage& image)
+{
+    if (image.isNull() || !image.hasAlphaChannel()) {
+        return image.rect();
+    }
+
+    const QImage argb = image.format() == QImage::Format_ARGB32_Premultiplied ||
+                        image.format() == QImage::Format_ARGB32
+                            ? image : image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    const int width = argb.width();
+    const int height = argb.height();
+
+    auto rowHasAlpha = [&](int y, int from, int to) {
+        const QRgb* line = reinterpret_cast<const QRgb*>(argb.constScanLine(y));
+        for (int x = from; x < to; ++x) {
+            if (qAlpha(line[x]) != 0) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    int top = 0;
+    while (top < height && !rowHasAlpha(top, 0, width)) {
+        ++top;
+    }
+    if (top == height) {
+        return QRect();
+    }
+    int bottom = height - 1;
+    while (bottom > top && !rowHasAlpha(bottom, 0, width)) {
+        --bottom;
+    }
+
+    // Only rows between top and bottom can widen the box
+    int left = width;
+    int right = -1;
+    for (int y = top; y <= bottom; ++y) {
+        const QRgb* line = reinterpret_cast<const QRgb*>(argb.constScanLine(y));
+        for (int x = 0; x < left; ++x) {
+            if (qAlpha(line[x]) != 0) {
+                left = x;
+                break;
+            }
+        }
+        for (int x = width - 1; x > right; --x) {
+            if (qAlpha(line[x]) != 0) {
+                right = x;
+                break;
+            }
+        }
+    }
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+bool SpriteSheetExporter::exportSheet(FrameExporter& exporter, int firstFrame, int lastFrame,
+                                      const QSize& frameSize, const QString& jsonFile, const Options& options)
+{
+    m_sprites.clear();
+    m_runs.clear();
+    m_error.clear();
+
+    if (options.maxAtlasSize < 1 || nextPowerOfTwo(options.maxAtlasSize) != options.maxAtlasSize) {
+        m_error = "The maximum atlas size must be a power of two";
+        return false;
+    }
+
+    // Trimming runs on the workers; the offset travels with the image
+    exporter.setOutputFormat(QImage::Format_ARGB32_Premultiplied);
+    exporter.setProcessor([](int frame, const QImage& image) {
+        Q_UNUSED(frame);
+        const QRect bounds = alphaBounds(image);
+        if (bounds.isEmpty()) {
+            QImage empty(1, 1, QImage::Format_ARGB32_Premultiplied);
+            empty.fill(Qt::transparent);
+            empty.setOffset(kEmptyFrameOffset);
+            return empty;
+        }
+        QImage trimmed = image.copy(bounds);
+        trimmed.setOffset(bounds.topLeft());
+        return trimmed;
+    });
+
+    // Identical sprites are shared wherever they appear in the range
+    QMultiHash<quint64, int> spritesByHash;
+    const bool rendered = exporter.run(firstFrame, lastFrame,
+        [this, &spritesByHash](int frame, const QImage& image, int sourceFrame) {
+            if (sourceFrame != frame && !m_runs.isEmpty()) {
+                ++m_runs.last().frames;
+                return true;
+            }
+
+            FrameRun run;
+            run.frame = frame;
+            run.frames = 1;
+            if (image.offset() != kEmptyFrameOffset) {
+                run.offset = image.offset();
+                const quint64 hash = imageHash(image);
+                for (auto it = spritesByHash.constFind(hash); it != spritesByHash.constEnd() && it.key() == hash; ++it) {
+                    if (m_sprites[it.value()].image == image) {
+                        run.sprite = it.value();
+                        break;
+                    }
+                }
+                if (run.sprite < 0) {
+                    run.sprite = m_sprites.size();
+                    m_sprites.append({ image, -1, QPoint() });
+                    spritesByHash.insert(hash, run.sprite);
+                }
+            }
+
+            if (!m_runs.isEmpty() && m_runs.last().sprite == run.sprite && m_runs.last().offset == run.offset) {
+                ++m_runs.last().frames;
+            }
+            else {
+                m_runs.append(run);
+            }
+            return true;
+        });
+
+    if (!rendered) {
+        m_error = exporter.wasCancelled() ? QString("Export cancelled") : QString("Rendering the frames failed");
+        return false;
+    }
+
+    QVector<QSize> atlasSizes;
+    if (!pack(options, atlasSizes)) {
+        return false;
+    }
+
+    qDebug() << "SpriteSheetExporter:" << (lastFrame - firstFrame + 1) << "frames," << m_sprites.size()
+        << "sprites in" << atlasSizes.size() << "atlases";
+    return writeOutput(jsonFile, options, atlasSizes, frameSize);
+}
+
+// Fills atlases one at a time. Each takes the smallest power-of-two size
+// that holds every sprite left, or the maximum size and as many sprites as
+// fit. Padding is added to the right and bottom of each sprite, so the bins
+// are that much larger than the atlases.
+bool SpriteSheetExporter::pack(const Options& options, QVector<QSize>& atlasSizes)
+{
+    const int padding = qMax(0, options.padding);
+    const int maxSize = options.maxAtlasSize;
+
+    QVector<int> remaining;
+    for (int i = 0; i < m_sprites.size(); ++i) {
+        const QSize size = m_sprites[i].image.size();
+        if (size.width() > maxSize || size.height() > maxSize) {
+            m_error = QString("A sprite of %1x%2 does not fit a %3x%3 atlas")
+                .arg(size.width()).arg(size.height()).arg(maxSize);
+            return false;
+        }
+        remaining.append(i);
+    }
+
+    // Largest first packs tightest
+    std::sort(remaining.begin(), remaining.end(), [this](int a, int b) {
+        const QSize sa = m_sprites[a].image.size();
+        const QSize sb = m_sprites[b].image.size();
+        const int longA = qMax(sa.width(), sa.height());
+        const int longB = qMax(sb.width(), sb.height());
+        return longA != longB ? longA > longB : sa.width() * sa.height() > sb.width() * sb.height();
+    });
+
+    auto tryPack = [&](const QVector<int>& sprites, const QSize& atlas, QVector<QPoint>& positions,
+                       QVector<int>& leftover) {
+        MaxRectsPacker packer(atlas.width() + padding, atlas.height() + padding);
+        positions.clear();
+        leftover.clear();
+        for (int sprite : sprites) {
+            const QSize size = m_sprites[sprite].image.size();
+            QPoint position;
+            if (packer.insert(size.width() + padding, size.height() + padding, position)) {
+                positions.append(position);
+            }
+            else {
+                positions.append(QPoint(-1, -1));
+                leftover.append(sprite);
+            }
+        }
+    };
+
+    while (!remaining.isEmpty()) {
+        qint64 area = 0;
+        int widest = 1;
+        int tallest = 1;
+        for (int sprite : remaining) {
+            const QSize size = m_sprites[sprite].image.size();
+            area += qint64(size.width()) * size.height();
+            widest = qMax(widest, size.width());
+            tallest = qMax(tallest, size.height());
+        }
+
+        // Candidate sizes by area, squarer first
+        QVector<QSize> candidates;
+        for (int w = nextPowerOfTwo(widest); w <= maxSize; w <<= 1) {
+            for (int h = nextPowerOfTwo(tallest); h <= maxSize; h <<= 1) {
+                if (qint64(w) * h >= area) {
+                    candidates.append(QSize(w, h));
+                }
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const QSize& a, const QSize& b) {
+            const qint64 areaA = qint64(a.width()) * a.height();
+            const qint64 areaB = qint64(b.width()) * b.height();
+            if (areaA != areaB) return areaA < areaB;
+            return qAbs(a.width() - a.height()) < qAbs(b.width() - b.height());
+        });
+
+        QSize atlas(maxSize, maxSize);
+        QVector<QPoint> positions;
+        QVector<int> leftover;
+        bool packedAll = false;
+        for (const QSize& candidate : candidates) {
+            tryPack(remaining, candidate, positions, leftover);
+            if (leftover.isEmpty()) {
+                atlas = candidate;
+                packedAll = true;
+                break;
+            }
+        }
+        if (!packedAll) {
+            tryPack(remaining, atlas, positions, leftover);
+            if (leftover.size() == remaining.size()) {
+                m_error = "Sprites do not fit the maximum atlas size";
+                return false;
+            }
+        }
+
+        const int atlasIndex = atlasSizes.size();
+        for (int i = 0; i < remaining.size(); ++i) {
+            if (positions[i].x() >= 0) {
+                m_sprites[remaining[i]].atlas = atlasIndex;
+                m_sprites[remaining[i]].position = positions[i];
+            }
+        }
+        atlasSizes.append(atlas);
+        remaining = leftover;
+    }
+    return true;
+}
+
+bool SpriteSheetExporter::writeOutput(const QString& jsonFile, const Options& options,
+                                      const QVector<QSize>& atlasSizes, const QSize& sourceSize)
+{
+    const QFileInfo info(jsonFile);
+    const QDir directory = info.absoluteDir();
+    auto atlasName = [&info](int atlas) {
+        return QString("%1_%2.png").arg(info.completeBaseName()).arg(atlas);
+    };
+
+    // Compose and compress the atlases in parallel
+    QThreadPool pool;
+    std::atomic<bool> saved(true);
+    for (int atlas = 0; atlas < atlasSizes.size(); ++atlas) {
+        QVector<Sprite> sprites;
+        for (const Sprite& sprite : m_sprites) {
+            if (sprite.atlas == atlas) {
+                sprites.append(sprite);
+            }
+        }
+        const QString fileName = directory.filePath(atlasName(atlas));
+        const QSize size = atlasSizes[atlas];
+        pool.start([sprites, fileName, size, &saved]() {
+            QImage image(size, QImage::Format_ARGB32_Premultiplied);
+            image.fill(Qt::transparent);
+            QPainter painter(&image);
+            painter.setCompositionMode(QPainter::CompositionMode_Source);
+            for (const Sprite& sprite : sprites) {
+                painter.drawImage(sprite.position, sprite.image);
+            }
+            painter.end();
+            if (!image.save(fileName, "PNG")) {
+                saved = false;
+            }
+        });
+    }
+    pool.waitForDone();
+    if (!saved) {
+        m_error = "Cannot write the atlas images to " + directory.absolutePath();
+        return false;
+    }
+
+    QJsonObject meta;
+    meta["app"] = "FrameDirector";
+    meta["frameRate"] = options.frameRate;
+    meta["sourceW"] = sourceSize.width();
+    meta["sourceH"] = sourceSize.height();
+    meta["padding"] = options.padding;
+
+    QJsonArray atlases;
+    for (int atlas = 0; atlas < atlasSizes.size(); ++atlas) {
+        QJsonObject entry;
+        entry["image"] = atlasName(atlas);
+        entry["w"] = atlasSizes[atlas].width();
+        entry["h"] = atlasSizes[atlas].height();
+        atlases.append(entry);
+    }
+
+    QJsonArray sprites;
+    for (const Sprite& sprite : m_sprites) {
+        QJsonObject entry;
+        entry["atlas"] = sprite.atlas;
+        entry["x"] = sprite.position.x();
+        entry["y"] = sprite.position.y();
+        entry["w"] = sprite.image.width();
+        entry["h"] = sprite.image.height();
+        sprites.append(entry);
+    }
+
+    // Durations in milliseconds, rounded on the running total
+    QJsonArray frames;
+    const int fps = qMax(1, options.frameRate);
+    qint64 elapsed = 0;
+    for (const FrameRun& run : m_runs) {
+        const qint64 start = (elapsed * 1000 + fps / 2) / fps;
+        elapsed += run.frames;
+        const qint64 end = (elapsed * 1000 + fps / 2) / fps;
+
+        QJsonObject entry;
+        entry["frame"] = run.frame;
+        entry["sprite"] = run.sprite;
+        entry["offsetX"] = run.offset.x();
+        entry["offsetY"] = run.offset.y();
+        entry["frames"] = run.frames;
+        entry["duration"] = static_cast<int>(end - start);
+        frames.append(entry);
+    }
+
+    QJsonObject root;
+    root["meta"] = meta;
+    root["atlases"] = atlases;
+    root["sprites"] = sprites;
+    root["frames"] = frames;
+
+    QFile file(jsonFile);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+        file.write(QJsonDocument(root).toJson(QJsonDocument::Indented)) < 0) {
+        m_error = "Cannot write " + jsonFile;
+        return false;
+    }
+    return true;
+}
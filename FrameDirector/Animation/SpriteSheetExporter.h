@@ -0,0 +1,70 @@
+#ifndef SPRITESHEETEXPORTER_H
+#define SPRITESHEETEXPORTER_H
+
+#include <QImage>
+#include <QPoint>
+#include <QRect>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+class FrameExporter;
+
+// Packs a frame range into texture atlases for game engines. Frames are
+// rendered and trimmed to their alpha bounds on the exporter's workers;
+// identical frames, held or not, share one sprite. Sprites are packed with
+// MaxRects (best short side fit) into the smallest power-of-two atlases that
+// hold them, and a JSON sidecar lists every frame with its sprite, trim
+// offset and duration:
+//
+//   { "meta":    { "frameRate", "sourceW", "sourceH", "padding" },
+//     "atlases": [ { "image", "w", "h" } ],
+//     "sprites": [ { "atlas", "x", "y", "w", "h" } ],
+//     "frames":  [ { "frame", "sprite", "offsetX", "offsetY", "frames", "duration" } ] }
+//
+// A frame entry covers a run of identical frames; duration is in
+// milliseconds. Fully transparent frames have sprite -1.
+class SpriteSheetExporter
+{
+public:
+    struct Options {
+        int maxAtlasSize = 4096;  // Power of two
+        int padding = 2;          // Transparent pixels between sprites
+        int frameRate = 24;
+    };
+
+    // Renders [firstFrame, lastFrame] of frameSize with the exporter, which
+    // must already have its snapshot provider. Atlases are written next to
+    // jsonFile as <name>_0.png, <name>_1.png and so on.
+    bool exportSheet(FrameExporter& exporter, int firstFrame, int lastFrame, const QSize& frameSize,
+                     const QString& jsonFile, const Options& options);
+
+    QString errorString() const { return m_error; }
+
+    // Bounding rectangle of the pixels with any alpha; empty when none
+    static QRect alphaBounds(const QImage& image);
+
+private:
+    struct Sprite {
+        QImage image;      // Trimmed
+        int atlas = -1;
+        QPoint position;   // Position in the atlas
+    };
+
+    struct FrameRun {
+        int frame = 0;
+        int sprite = -1;
+        QPoint offset;     // Position of the trimmed sprite in the frame
+        int frames = 0;
+    };
+
+    bool pack(const Options& options, QVector<QSize>& atlasSizes);
+    bool writeOutput(const QString& jsonFile, const Options& options, const QVector<QSize>& atlasSizes,
+                     const QSize& sourceSize);
+
+    QVector<Sprite> m_sprites;
+    QVector<FrameRun> m_runs;
+    QString m_error;
+};
+
+#endif // SPRITESHEETEXPORTER_H
@@ -33,9 +33,16 @@
 #include <QRadialGradient>
 #include <QConicalGradient>
 #include <QDateTime>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <QPaintEvent>
 #include <algorithm>
 #include <limits>
 
+// Off by default; QT_LOGGING_RULES="framedirector.canvas.repaint.debug=true"
+// turns on the repaint timing
+Q_LOGGING_CATEGORY(lcCanvasRepaint, "framedirector.canvas.repaint", QtInfoMsg)
+
 // ROBUST: Enhanced layer data structure with better state management
 struct LayerData {
     QString name;
@@ -44,129 +51,77 @@ struct LayerData {
     bool locked;
     double opacity;
     QPainter::CompositionMode blendMode;
-    QList<QGraphicsItem*> items;
-    QHash<int, QList<QGraphicsItem*>> frameItems; // Per-frame item tracking
-    QSet<QGraphicsItem*> allTimeItems; // All items ever added to this layer
+    FrameSpanIndex spans; // Exposure sheet - the only per-frame store for this layer
+    quint64 propertyRevision = 0; // Bumped on name, lock, visibility and opacity changes
 
-    LayerData(const QString& layerName)
+    // Items several spans share, by SharedItemIdRole: their saved form,
+    // until a span that lists them is decoded, and the item built from it
+    QHash<QString, QJsonObject> sharedItemJson;
+    QHash<QString, QGraphicsItem*> sharedItems;
+
+    LayerData(const QString& layerName, ItemRegistry* registry)
         : name(layerName), visible(true), locked(false), opacity(1.0),
         blendMode(QPainter::CompositionMode_SourceOver) {
         // Generate unique ID to prevent layer confusion
         uuid = QString("layer_%1_%2").arg(layerName).arg(QDateTime::currentMSecsSinceEpoch());
-    }
-
-    void syncCaches() {
-        QSet<QGraphicsItem*> uniqueItems;
-        QList<QGraphicsItem*> orderedItems;
-
-        QList<int> frameKeys = frameItems.keys();
-        std::sort(frameKeys.begin(), frameKeys.end());
-
-        for (int key : frameKeys) {
-            const QList<QGraphicsItem*>& perFrame = frameItems[key];
-            for (QGraphicsItem* frameItem : perFrame) {
-                if (frameItem && !uniqueItems.contains(frameItem)) {
-                    uniqueItems.insert(frameItem);
-                    orderedItems.append(frameItem);
-                }
-            }
-        }
-
-        allTimeItems = uniqueItems;
-        items = orderedItems;
+        spans.attachRegistry(registry, this);
     }
 
     void addItem(QGraphicsItem* item, int frame) {
         if (!item) return;
 
-        QList<QGraphicsItem*>& perFrame = frameItems[frame];
-        if (!perFrame.contains(item)) {
-            perFrame.append(item);
-        }
-
-        if (!allTimeItems.contains(item)) {
-            allTimeItems.insert(item);
+        FrameSpan* span = spans.spanAt(frame);
+        if (!span) {
+            span = &spans.insertKeyframe(frame);
         }
-
-        if (!items.contains(item)) {
-            items.append(item);
+        else if (span->keyframe != frame) {
+            // Adding to a held frame starts a keyframe there that still
+            // references the held content
+            const QList<QGraphicsItem*> heldItems = span->items;
+            const QMap<QGraphicsItem*, QVariant> heldStates = span->itemStates;
+            span = &spans.insertKeyframe(frame);
+            spans.setItems(*span, heldItems, heldStates);
         }
+        spans.appendItem(*span, item);
     }
 
     void removeItem(QGraphicsItem* item) {
         if (!item) return;
 
-        items.removeAll(item);
-        allTimeItems.remove(item);
-
         // Remove from all frames
-        for (auto& frameList : frameItems) {
-            frameList.removeAll(item);
-        }
+        spans.removeItem(item);
     }
 
+    // Items referenced by any frame of this layer - O(1)
     bool containsItem(QGraphicsItem* item) const {
-        return allTimeItems.contains(item);
-    }
-
-    void setFrameItems(int frame, const QList<QGraphicsItem*>& itemList) {
-        frameItems[frame] = itemList;
-        syncCaches();
-    }
-    void clearFrame(int frame) {
-        frameItems.remove(frame);
-        syncCaches();
+        return spans.references(item);
     }
 
     QList<QGraphicsItem*> getFrameItems(int frame) const {
-        auto it = frameItems.find(frame);
-        if (it != frameItems.end()) {
-            return it.value();
-        }
-        return QList<QGraphicsItem*>();
+        const FrameSpan* span = spans.spanAt(frame);
+        return span ? span->items : QList<QGraphicsItem*>();
     }
 
     void debugPrint() const {
         qDebug() << "Layer" << name << "UUID:" << uuid
-            << "Items:" << items.size()
-            << "Frames:" << frameItems.keys()
-            << "AllTime:" << allTimeItems.size();
+            << "Keyframes:" << spans.keyframes()
+            << "Items:" << spans.referencedItems().size();
     }
     void removeItemFromAllFrames(QGraphicsItem* item) {
         if (!item) return;
 
-        // Remove from all frame-specific data
-        for (auto& frameEntry : frameItems) {
-            frameEntry.removeAll(item);
-        }
-
-        // Remove from cached collections
-        items.removeAll(item);
-        allTimeItems.remove(item);
+        spans.removeItem(item);
 
         qDebug() << "Removed item from all frames in layer" << uuid;
     }
 
+    // Held frames share their keyframe's content, so this detaches the item
+    // from the whole span covering the frame.
     void removeItemFromFrame(int frame, QGraphicsItem* item) {
         if (!item) return;
 
-        auto it = frameItems.find(frame);
-        if (it != frameItems.end()) {
-            it.value().removeAll(item);
-        }
-
-        // If the item is no longer referenced by any frame, drop it from caches
-        bool stillUsed = false;
-        for (auto frameIt = frameItems.begin(); frameIt != frameItems.end(); ++frameIt) {
-            if (frameIt.value().contains(item)) {
-                stillUsed = true;
-                break;
-            }
-        }
-
-        if (!stillUsed) {
-            items.removeAll(item);
-            allTimeItems.remove(item);
+        if (FrameSpan* span = spans.spanAt(frame)) {
+            spans.removeItemFromSpan(*span, item);
         }
     }
 };
@@ -198,14 +153,32 @@ Canvas::Canvas(MainWindow* parent)
     , m_onionSkinBefore(1)
     , m_onionSkinAfter(1)
 {
+    // Mutations during one event-loop turn are reported as one change set
+    m_changeSetTimer = new QTimer(this);
+    m_changeSetTimer->setSingleShot(true);
+    m_changeSetTimer->setInterval(0);
+    connect(m_changeSetTimer, &QTimer::timeout, this, &Canvas::emitChangeSet);
+
     setupScene();
+    m_onionSkinCache.setSnapshotProvider([this](int layerIndex, int frame) {
+        FrameSnapshot snapshot(m_canvasSize);
+        if (layerIndex >= 0 && layerIndex < m_layers.size()) {
+            appendLayerToSnapshot(snapshot, frame, layerIndex, 1.0, false);
+        }
+        return snapshot;
+    });
     setupDefaultLayers();
 
     setRenderHint(QPainter::Antialiasing, true);
     setRenderHint(QPainter::SmoothPixmapTransform, true);
     setDragMode(QGraphicsView::NoDrag);
     setInteractive(true);
-    setViewportUpdateMode(QGraphicsView::FullViewportUpdate);
+    // Repaint only the regions items report as dirty. The static backdrop
+    // (view background, canvas bounds, grid) is rendered once into a cache
+    // that the view reuses until it scrolls, zooms or the backdrop changes.
+    setViewportUpdateMode(QGraphicsView::SmartViewportUpdate);
+    setCacheMode(QGraphicsView::CacheBackground);
+    m_profileRepaints = lcCanvasRepaint().isDebugEnabled();
     setMouseTracking(true);
     setBackgroundBrush(QBrush(QColor(48, 48, 48)));
 
@@ -218,7 +191,6 @@ Canvas::Canvas(MainWindow* parent)
     m_rubberBand->hide();
 
     qDebug() << "Canvas created with robust layer system, size:" << m_canvasSize;
-    m_interpolatedItems.clear();
 }
 
 Canvas::~Canvas()
@@ -233,13 +205,9 @@ Canvas::~Canvas()
     }
 
     // CRITICAL: Clean up all layer-specific interpolated items
-    cleanupInterpolatedItems();  // This cleans up all layers
+    releaseTweenProxies();  // This cleans up all layers
 
     // Clear all data structures
-    m_frameItems.clear();
-    m_layerKeyframes.clear();
-    m_layerFrameData.clear();
-    m_layerInterpolatedItems.clear();
     m_layerShowingInterpolated.clear();
 
     // Clean up rubber band and layers...
@@ -251,9 +219,7 @@ Canvas::~Canvas()
     for (void* layerPtr : m_layers) {
         if (layerPtr) {
             LayerData* layer = static_cast<LayerData*>(layerPtr);
-            layer->items.clear();
-            layer->frameItems.clear();
-            layer->allTimeItems.clear();
+            layer->spans.clear();
             delete layer;
         }
     }
@@ -305,12 +271,19 @@ void Canvas::setupDefaultLayers()
     m_layers.clear();
 
     // Create background layer with unique identification
-    LayerData* backgroundLayer = new LayerData("Background");
+    LayerData* backgroundLayer = new LayerData("Background", &m_itemRegistry);
     m_layers.push_back(backgroundLayer);
+    trackLayerChanges(backgroundLayer);
 
     // Create drawing layer
-    LayerData* drawingLayer = new LayerData("Layer 1");
+    LayerData* drawingLayer = new LayerData("Layer 1", &m_itemRegistry);
     m_layers.push_back(drawingLayer);
+    trackLayerChanges(drawingLayer);
+    markStructureChanged();
+
+    // Initialize frame 1 for both layers
+    backgroundLayer->spans.insertKeyframe(1);
+    drawingLayer->spans.insertKeyframe(1);
 
     // REMOVED: Don't create another background rectangle here
     // The background rectangle is already created in setupScene()
@@ -319,20 +292,6 @@ void Canvas::setupDefaultLayers()
         backgroundLayer->addItem(m_backgroundRect, 1);
     }
 
-    // Initialize frame 1 for both layers
-    FrameData bgFrame;
-    bgFrame.type = FrameType::Keyframe;
-    if (m_backgroundRect) {
-        bgFrame.items.append(m_backgroundRect);
-    }
-    m_layerFrameData[0][1] = bgFrame;
-    m_layerKeyframes[0].insert(1);
-
-    FrameData drawFrame;
-    drawFrame.type = FrameType::Keyframe;
-    m_layerFrameData[1][1] = drawFrame;
-    m_layerKeyframes[1].insert(1);
-
     // Set Layer 1 as current (not background)
     setCurrentLayer(1);
 
@@ -352,25 +311,21 @@ int Canvas::addLayer(const QString& name, bool visible, double opacity,
     }
 
     // Create new layer
-    LayerData* newLayer = new LayerData(layerName);
+    LayerData* newLayer = new LayerData(layerName, &m_itemRegistry);
     newLayer->visible = visible;
     newLayer->opacity = qBound(0.0, opacity, 1.0);
     newLayer->blendMode = blendMode;
     m_layers.push_back(newLayer);
+    trackLayerChanges(newLayer);
+    markStructureChanged();
 
     int newIndex = m_layers.size() - 1;
 
     // Initialize layer-specific data structures (empty)
-    m_layerFrameData[newIndex] = QHash<int, FrameData>();
-    m_layerInterpolatedItems[newIndex] = QList<QGraphicsItem*>();
     m_layerShowingInterpolated[newIndex] = false;
-    m_layerKeyframes[newIndex] = QSet<int>();
 
     // Every layer starts with an empty keyframe at frame 1
-    FrameData frame1;
-    frame1.type = FrameType::Keyframe;
-    m_layerFrameData[newIndex][1] = frame1;
-    m_layerKeyframes[newIndex].insert(1);
+    newLayer->spans.insertKeyframe(1);
 
     qDebug() << "Added layer:" << layerName << "Index:" << newIndex << "UUID:" << newLayer->uuid;
 
@@ -393,15 +348,17 @@ void Canvas::removeLayer(int layerIndex)
 
         qDebug() << "Removing layer" << layerIndex << "UUID:" << layer->uuid;
 
+        releaseTweenProxies(layerIndex);
+
         // ROBUST: Remove all items in this layer from scene AND all frame tracking
-        const QList<QGraphicsItem*> itemsToRemove = layer->allTimeItems.values();
+        const QList<QGraphicsItem*> itemsToRemove = layer->spans.referencedItems();
+        layer->spans.clear();
         for (QGraphicsItem* item : itemsToRemove) {
             if (item && item != m_backgroundRect) {
                 // Remove from scene
-                if (m_scene->items().contains(item)) {
+                if (item->scene() == m_scene) {
                     m_scene->removeItem(item);
                 }
-                removeItemFromAllFrames(item);
                 delete item;
             }
         }
@@ -410,25 +367,17 @@ void Canvas::removeLayer(int layerIndex)
         delete layer;
         m_layers.erase(m_layers.begin() + layerIndex);
 
-        m_layerFrameData.remove(layerIndex);
-        m_layerInterpolatedItems.remove(layerIndex);
         m_layerShowingInterpolated.remove(layerIndex);
-        m_layerKeyframes.remove(layerIndex);
+        m_onionSkinCache.clear();
+        m_onionSkinOverlayKey.clear();
 
         // Reindex remaining layer-specific data
-        QHash<int, QHash<int, FrameData>> newFrameData;
-        for (auto it = m_layerFrameData.begin(); it != m_layerFrameData.end(); ++it) {
-            int idx = it.key();
-            newFrameData[idx > layerIndex ? idx - 1 : idx] = it.value();
-        }
-        m_layerFrameData = newFrameData;
-
-        QHash<int, QList<QGraphicsItem*>> newInterpolated;
-        for (auto it = m_layerInterpolatedItems.begin(); it != m_layerInterpolatedItems.end(); ++it) {
+        QHash<int, TweenProxyPool> newPools;
+        for (auto it = m_tweenProxyPools.begin(); it != m_tweenProxyPools.end(); ++it) {
             int idx = it.key();
-            newInterpolated[idx > layerIndex ? idx - 1 : idx] = it.value();
+            newPools[idx > layerIndex ? idx - 1 : idx] = it.value();
         }
-        m_layerInterpolatedItems = newInterpolated;
+        m_tweenProxyPools = newPools;
 
         QHash<int, bool> newShowing;
         for (auto it = m_layerShowingInterpolated.begin(); it != m_layerShowingInterpolated.end(); ++it) {
@@ -437,13 +386,6 @@ void Canvas::removeLayer(int layerIndex)
         }
         m_layerShowingInterpolated = newShowing;
 
-        QHash<int, QSet<int>> newKeys;
-        for (auto it = m_layerKeyframes.begin(); it != m_layerKeyframes.end(); ++it) {
-            int idx = it.key();
-            newKeys[idx > layerIndex ? idx - 1 : idx] = it.value();
-        }
-        m_layerKeyframes = newKeys;
-
         // ROBUST: Adjust current layer carefully
         if (m_currentLayerIndex >= m_layers.size()) {
             m_currentLayerIndex = m_layers.size() - 1;
@@ -454,8 +396,13 @@ void Canvas::removeLayer(int layerIndex)
 
         // ROBUST: Recalculate Z-values for all remaining layers
         updateAllLayerZValues();
+        markStructureChanged();
 
         storeCurrentFrameState();
+        if (m_staticLayerCaching) {
+            // The current layer may have changed, and with it what is live
+            loadFrameState(m_currentFrame);
+        }
         emit layerChanged(m_currentLayerIndex);
         emit layerRemoved(layerIndex);
 
@@ -496,14 +443,17 @@ void Canvas::setLayerVisible(int layerIndex, bool visible)
 {
     if (layerIndex >= 0 && layerIndex < m_layers.size()) {
         LayerData* layer = static_cast<LayerData*>(m_layers[layerIndex]);
-        layer->visible = visible;
-
-        // ROBUST: Update visibility of items in current frame only
-        QList<QGraphicsItem*> currentFrameItems = layer->getFrameItems(m_currentFrame);
-        for (QGraphicsItem* item : currentFrameItems) {
-            if (item && m_scene->items().contains(item)) {
-                item->setVisible(visible);
+        if (layer->visible != visible) {
+            // Capture pending edits while the layer is still on stage
+            if (!visible && layerIndex == m_currentLayerIndex) {
+                storeCurrentFrameState();
             }
+            layer->visible = visible;
+            markLayerPropertiesChanged(layerIndex, true);
+
+            // Hidden layers are kept out of the scene, so the frame reload
+            // adds or drops just this layer's items
+            loadFrameState(m_currentFrame);
         }
 
         qDebug() << "Layer" << layerIndex << "UUID:" << layer->uuid << "visibility set to:" << visible;
@@ -515,12 +465,15 @@ void Canvas::setLayerLocked(int layerIndex, bool locked)
 {
     if (layerIndex >= 0 && layerIndex < m_layers.size()) {
         LayerData* layer = static_cast<LayerData*>(m_layers[layerIndex]);
-        layer->locked = locked;
+        if (layer->locked != locked) {
+            layer->locked = locked;
+            markLayerPropertiesChanged(layerIndex, false);
+        }
 
         // ROBUST: Update lock state of items in current frame only
         QList<QGraphicsItem*> currentFrameItems = layer->getFrameItems(m_currentFrame);
         for (QGraphicsItem* item : currentFrameItems) {
-            if (item && m_scene->items().contains(item)) {
+            if (item && item->scene() == m_scene) {
                 item->setFlag(QGraphicsItem::ItemIsSelectable, !locked);
                 item->setFlag(QGraphicsItem::ItemIsMovable, !locked);
             }
@@ -536,6 +489,11 @@ void Canvas::moveLayer(int fromIndex, int toIndex)
         toIndex < 0 || toIndex >= m_layers.size() || fromIndex == toIndex)
         return;
 
+    // Proxies and onion images are keyed by layer index
+    releaseTweenProxies();
+    m_onionSkinCache.clear();
+    m_onionSkinOverlayKey.clear();
+
     void* layerPtr = m_layers[fromIndex];
     m_layers.erase(m_layers.begin() + fromIndex);
     m_layers.insert(m_layers.begin() + toIndex, layerPtr);
@@ -548,6 +506,8 @@ void Canvas::moveLayer(int fromIndex, int toIndex)
         m_currentLayerIndex++;
 
     updateAllLayerZValues();
+    markStructureChanged();
+    loadFrameState(m_currentFrame);
     emit layerChanged(m_currentLayerIndex);
 }
 
@@ -556,12 +516,16 @@ void Canvas::setLayerOpacity(int layerIndex, double opacity)
 {
     if (layerIndex >= 0 && layerIndex < m_layers.size()) {
         LayerData* layer = static_cast<LayerData*>(m_layers[layerIndex]);
-        layer->opacity = qBound(0.0, opacity, 1.0);
+        const double newOpacity = qBound(0.0, opacity, 1.0);
+        if (layer->opacity != newOpacity) {
+            layer->opacity = newOpacity;
+            markLayerPropertiesChanged(layerIndex, true);
+        }
 
         // ROBUST: Update opacity of items in current frame only, preserve individual opacity
         QList<QGraphicsItem*> currentFrameItems = layer->getFrameItems(m_currentFrame);
         for (QGraphicsItem* item : currentFrameItems) {
-            if (item && m_scene->items().contains(item)) {
+            if (item && item->scene() == m_scene) {
                 // Get individual item opacity and combine with layer opacity
                 double individualOpacity = item->data(0).toDouble(); // Store individual opacity in data(0)
                 if (individualOpacity == 0.0) individualOpacity = 1.0; // Default if not set
@@ -571,6 +535,7 @@ void Canvas::setLayerOpacity(int layerIndex, double opacity)
         }
 
         storeCurrentFrameState();
+        updateLayerComposites(m_currentFrame);
         qDebug() << "Layer" << layerIndex << "UUID:" << layer->uuid << "opacity set to:" << layer->opacity;
         emit layerOpacityChanged(layerIndex, layer->opacity);
     }
@@ -600,6 +565,7 @@ void Canvas::setLayerName(int index, const QString& name)
     }
 
     layer->name = trimmedName;
+    markLayerPropertiesChanged(index, false);
 
     qDebug() << "Layer" << index << "UUID:" << layer->uuid << "renamed to" << trimmedName;
     emit layerNameChanged(index, trimmedName);
@@ -620,14 +586,10 @@ void Canvas::addItemToCurrentLayer(QGraphicsItem* item)
     LayerData* currentLayer = static_cast<LayerData*>(m_layers[m_currentLayerIndex]);
 
     // ROBUST: Check if item is already in another layer and remove it
-    for (int i = 0; i < m_layers.size(); ++i) {
-        if (i != m_currentLayerIndex) {
-            LayerData* otherLayer = static_cast<LayerData*>(m_layers[i]);
-            if (otherLayer->containsItem(item)) {
-                qDebug() << "Warning: Moving item from layer" << i << "to layer" << m_currentLayerIndex;
-                otherLayer->removeItem(item);
-            }
-        }
+    const int ownerIndex = getItemLayerIndex(item);
+    if (ownerIndex != -1 && ownerIndex != m_currentLayerIndex) {
+        qDebug() << "Warning: Moving item from layer" << ownerIndex << "to layer" << m_currentLayerIndex;
+        static_cast<LayerData*>(m_layers[ownerIndex])->removeItem(item);
     }
 
     const bool placeBehindStroke = item->data(GraphicsItemRoles::BucketFillBehindStrokeRole).toBool();
@@ -637,7 +599,7 @@ void Canvas::addItemToCurrentLayer(QGraphicsItem* item)
     int baseZ = m_currentLayerIndex * 1000;
     int maxZ = -1;
     qreal minZ = std::numeric_limits<qreal>::max();
-    for (QGraphicsItem* existing : currentLayer->items) {
+    for (QGraphicsItem* existing : currentLayer->spans.referencedItems()) {
         int z = static_cast<int>(existing->zValue()) % 1000;
         if (z > maxZ) {
             maxZ = z;
@@ -689,7 +651,16 @@ void Canvas::addItemToCurrentLayer(QGraphicsItem* item)
 
 void Canvas::saveFrameState(int frame)
 {
-    qDebug() << "Saving frame state for frame:" << frame << "layer:" << m_currentLayerIndex;
+    if (m_currentLayerIndex < 0 || m_currentLayerIndex >= m_layers.size()) {
+        return;
+    }
+
+    LayerData* layer = static_cast<LayerData*>(m_layers[m_currentLayerIndex]);
+
+    // Hidden layers are not on stage, so the scene has nothing to read back
+    if (!layer->visible) {
+        return;
+    }
 
     // Collect current layer items from scene
     // Use ascending order so items are stored from back to front,
@@ -697,19 +668,30 @@ void Canvas::saveFrameState(int frame)
     QList<QGraphicsItem*> currentLayerItems;
     for (QGraphicsItem* item : m_scene->items(Qt::AscendingOrder)) {
         if (item != m_backgroundRect &&
-            getItemLayerIndex(item) == m_currentLayerIndex &&
-            !m_onionSkinItems.contains(item)) {
+            m_itemRegistry.layerOf(item) == layer) {
             currentLayerItems.append(item);
         }
     }
 
     // Save ONLY to layer-specific storage
-    auto& layerFrameData = m_layerFrameData[m_currentLayerIndex];
-    auto& frameData = layerFrameData[frame];
-    frameData.items = currentLayerItems;
-    frameData.itemStates.clear();
+    FrameSpan* span = layer->spans.spanAt(frame);
+    if (!span) {
+        // Nothing to record on an empty frame until something is drawn on it
+        if (currentLayerItems.isEmpty()) {
+            return;
+        }
+        span = &layer->spans.insertKeyframe(frame);
+    }
+    else if (span->keyframe != frame &&
+        QSet<QGraphicsItem*>(span->items.begin(), span->items.end()) !=
+        QSet<QGraphicsItem*>(currentLayerItems.begin(), currentLayerItems.end())) {
+        // A held frame no longer matches its keyframe - it becomes a keyframe
+        // of its own and holds through the rest of the old span
+        span = &layer->spans.insertKeyframe(frame);
+    }
 
     // Store item states for potential tweening
+    QMap<QGraphicsItem*, QVariant> itemStates;
     for (QGraphicsItem* item : currentLayerItems) {
         if (item) {
             QVariantMap state;
@@ -723,219 +705,406 @@ void Canvas::saveFrameState(int frame)
             else {
                 state["blur"] = 0.0;
             }
-            frameData.itemStates[item] = state;
+            itemStates[item] = state;
         }
     }
 
-    // Update frame type if needed
-    if (frameData.type == FrameType::Empty && !currentLayerItems.isEmpty()) {
-        frameData.type = FrameType::Keyframe;
-        m_layerKeyframes[m_currentLayerIndex].insert(frame);
-    }
+    layer->spans.setItems(*span, currentLayerItems, itemStates);
 
-    // Update layer data structure
-    if (m_currentLayerIndex >= 0 && m_currentLayerIndex < m_layers.size()) {
-        LayerData* layer = static_cast<LayerData*>(m_layers[m_currentLayerIndex]);
-        layer->setFrameItems(frame, currentLayerItems);
+    // Proxies mirroring this keyframe's content are stale now
+    auto poolIt = m_tweenProxyPools.constFind(m_currentLayerIndex);
+    if (poolIt != m_tweenProxyPools.constEnd() &&
+        (poolIt->startFrame == span->keyframe || poolIt->endFrame == span->keyframe)) {
+        releaseTweenProxies(m_currentLayerIndex);
     }
-
-    qDebug() << "Saved frame state - Layer" << m_currentLayerIndex << "items:" << currentLayerItems.size();
 }
 
 
 void Canvas::loadFrameState(int frame)
 {
-    qDebug() << "Loading frame state for frame:" << frame;
-
-    // Remove any existing interpolated items before loading new state
-    cleanupInterpolatedItems();
-
-    clearOnionSkinItems();
-
-    // Clear current items first
-    QList<QGraphicsItem*> currentItems;
-    for (QGraphicsItem* item : scene()->items()) {
-        if (item != m_backgroundRect && item->zValue() > -999 && !item->parentItem()) {
-            currentItems.append(item);
+    // With static layer caching only the current layer is live; the others
+    // are drawn from the composites built at the end
+    auto isLive = [this](int layerIndex) {
+        return !m_staticLayerCaching || layerIndex == m_currentLayerIndex;
+    };
+
+    // Layers showing an in-between at this frame. Their proxies stay on stage
+    // and are re-posed below; every other layer's proxies step off.
+    struct TweenStep { int startFrame = -1; int endFrame = -1; float t = 0.0f; };
+    QHash<int, TweenStep> tweenSteps;
+    QSet<QGraphicsItem*> stayingProxies;
+    for (int layerIndex = 0; layerIndex < m_layers.size(); ++layerIndex) {
+        TweenStep step;
+        if (static_cast<LayerData*>(m_layers[layerIndex])->visible && isLive(layerIndex) &&
+            tweenProgress(frame, layerIndex, step.startFrame, step.endFrame, step.t)) {
+            tweenSteps.insert(layerIndex, step);
+            for (QGraphicsItem* proxy : m_tweenProxyPools.value(layerIndex).proxies) {
+                if (proxy) stayingProxies.insert(proxy);
+            }
+        }
+        else {
+            cleanupInterpolatedItems(layerIndex);
         }
     }
 
-    for (QGraphicsItem* item : currentItems) {
-        scene()->removeItem(item);
-    }
-
-    // Load items for each layer with VALIDATION
+    // Target content for every visible layer. Hidden layers stay out of the
+    // scene entirely instead of being added and hidden.
+    QVector<QList<QGraphicsItem*>> targetItems(static_cast<int>(m_layers.size()));
+    QSet<QGraphicsItem*> targetSet;
     for (int layerIndex = 0; layerIndex < m_layers.size(); ++layerIndex) {
         LayerData* layer = static_cast<LayerData*>(m_layers[layerIndex]);
-        QList<QGraphicsItem*> layerFrameItems = layer->getFrameItems(frame);
+        // Tweened layers show their proxies instead of the held keyframe
+        if (!layer->visible || !isLive(layerIndex) || tweenSteps.contains(layerIndex)) {
+            continue;
+        }
 
-        // Add items for this layer to scene with proper validation
-        int order = 0;
-        for (QGraphicsItem* item : layerFrameItems) {
+        for (QGraphicsItem* item : layer->getFrameItems(frame)) {
             // CRITICAL: Validate item pointer before using it
             if (item && isValidItem(item)) {
-                m_scene->addItem(item);
-                // Ensure proper layer Z-ordering based on stored order
-                item->setZValue(layerIndex * 1000 + order++);
-                // Apply layer properties
-                item->setVisible(layer->visible);
-                item->setOpacity(item->data(0).toDouble() * layer->opacity);
-                item->setFlag(QGraphicsItem::ItemIsSelectable, !layer->locked);
-                item->setFlag(QGraphicsItem::ItemIsMovable, !layer->locked);
+                targetItems[layerIndex].append(item);
+                targetSet.insert(item);
             }
             else {
-                qDebug() << "Invalid item detected in frame" << frame << "layer" << layerIndex
-                    << "- removing from data structures";
                 // Remove invalid item from layer data
                 layer->removeItemFromFrame(frame, item);
             }
         }
     }
 
-    // After base items are loaded, generate interpolated items for tweened layers
-    for (int layerIndex = 0; layerIndex < m_layers.size(); ++layerIndex) {
-        if (!isFrameTweened(frame, layerIndex)) {
-            continue;
+    // Only items leaving the stage are removed; shared items of held frames
+    // stay where they are
+    QList<QGraphicsItem*> leavingItems;
+    for (QGraphicsItem* item : scene()->items()) {
+        if (item != m_backgroundRect && item->zValue() > -999 && !item->parentItem() &&
+            !targetSet.contains(item) && !stayingProxies.contains(item)) {
+            leavingItems.append(item);
         }
+    }
 
-        int startFrame = frame;
-        int endFrame = -1;
+    for (QGraphicsItem* item : leavingItems) {
+        scene()->removeItem(item);
+    }
 
-        if (getFrameType(frame, layerIndex) == FrameType::ExtendedFrame) {
-            startFrame = getSourceKeyframe(frame, layerIndex);
-        }
+    // The background never leaves the scene; it follows its layer's visibility
+    // and is part of the below composite while its layer isn't live
+    if (m_backgroundRect) {
+        const LayerData* backgroundLayer = static_cast<const LayerData*>(m_itemRegistry.layerOf(m_backgroundRect));
+        const int backgroundLayerIndex = getItemLayerIndex(m_backgroundRect);
+        m_backgroundRect->setVisible((!backgroundLayer || backgroundLayer->visible) &&
+            (backgroundLayerIndex < 0 || isLive(backgroundLayerIndex)));
+    }
 
-        if (hasFrameTweening(startFrame, layerIndex)) {
-            endFrame = getTweeningEndFrame(startFrame, layerIndex);
-        }
+    // Add entering items and refresh the ones that stayed. Setters are no-ops
+    // when the value is unchanged, so persisting items cost next to nothing.
+    for (int layerIndex = 0; layerIndex < m_layers.size(); ++layerIndex) {
+        LayerData* layer = static_cast<LayerData*>(m_layers[layerIndex]);
 
-        if (startFrame != -1 && endFrame != -1 && frame > startFrame && frame < endFrame) {
-            clearLayerFromScene(layerIndex);
-            float t = static_cast<float>(frame - startFrame) / (endFrame - startFrame);
-            QString easingType = getFrameTweeningEasing(startFrame, layerIndex);
-            if (easingType == "ease-in") {
-                t = t * t;  // Quadratic ease-in
-            }
-            else if (easingType == "ease-out") {
-                t = 1 - (1 - t) * (1 - t);  // Quadratic ease-out
-            }
-            else if (easingType == "ease-in-out") {
-                t = t < 0.5 ? 2 * t * t : 1 - 2 * (1 - t) * (1 - t);  // Quadratic ease-in-out
+        int order = 0;
+        for (QGraphicsItem* item : targetItems[layerIndex]) {
+            if (item->scene() != m_scene) {
+                m_scene->addItem(item);
             }
-            interpolateFrame(frame, startFrame, endFrame, t, layerIndex);
+            // Ensure proper layer Z-ordering based on stored order
+            item->setZValue(layerIndex * 1000 + order++);
+            // Apply layer properties
+            item->setVisible(true);
+            item->setOpacity(item->data(0).toDouble() * layer->opacity);
+            item->setFlag(QGraphicsItem::ItemIsSelectable, !layer->locked);
+            item->setFlag(QGraphicsItem::ItemIsMovable, !layer->locked);
         }
     }
 
-    applyOnionSkin(frame);
+    // After base items are loaded, pose the in-betweens of tweened layers
+    for (auto it = tweenSteps.constBegin(); it != tweenSteps.constEnd(); ++it) {
+        interpolateFrame(frame, it->startFrame, it->endFrame, it->t, it.key());
+    }
 
-    qDebug() << "Frame state loaded successfully for frame:" << frame;
+    applyOnionSkin(frame);
+    updateLayerComposites(frame);
 }
 
-void Canvas::clearOnionSkinItems()
+void Canvas::clearOnionSkins()
 {
-    if (!m_scene) {
-        m_onionSkinItems.clear();
-        return;
-    }
-    for (QGraphicsItem* item : m_onionSkinItems) {
-        if (m_scene->items().contains(item)) {
-            m_scene->removeItem(item);
-        }
+    m_onionSkinOverlayKey.clear();
+    if (!m_onionSkinOverlay.isNull()) {
+        m_onionSkinOverlay = QImage();
+        updateSceneRegion(m_canvasRect);
     }
-    m_onionSkinItems.clear();
 }
 
+// Onion frames are cached per layer as tinted images and composited into a
+// single overlay, so the scene only ever holds the current frame's items.
+// Stepping re-uses the cached images; only frames whose layer changed are
+// rendered again, and the overlay itself only when what it shows changed.
 void Canvas::applyOnionSkin(int frame)
 {
-    clearOnionSkinItems();
-    if (!m_onionSkinEnabled) return;
+    if (!m_onionSkinEnabled || (m_onionSkinBefore == 0 && m_onionSkinAfter == 0) ||
+        m_canvasSize.isEmpty()) {
+        clearOnionSkins();
+        m_onionSkinCache.clear();
+        return;
+    }
 
     const double baseOpacity = 0.4;
 
-    // Previous frames
-    for (int i = 1; i <= m_onionSkinBefore; ++i) {
-        int f = frame - i;
-        if (f < 1) break;
-        double factor = baseOpacity * (m_onionSkinBefore - i + 1) / m_onionSkinBefore;
+    // One image per layer and drawing: held frames share their keyframe's
+    // drawing, and a drawing several offsets show is drawn once, at the
+    // nearest offset's strength, so held frames don't stack up darker
+    struct OnionImage {
+        int layerIndex;
+        int contentFrame;
+        OnionSkinCache::Side side;
+        double factor;
+    };
+    QVector<OnionImage> images;
+    auto addFrame = [&](int f, double factor, OnionSkinCache::Side side) {
         for (int layerIndex = 0; layerIndex < m_layers.size(); ++layerIndex) {
             LayerData* layer = static_cast<LayerData*>(m_layers[layerIndex]);
-            QList<QGraphicsItem*> items = layer->getFrameItems(f);
-            for (QGraphicsItem* item : items) {
-                if (!item || !isValidItem(item)) continue;
-                m_scene->addItem(item);
-                item->setOpacity(item->data(0).toDouble() * layer->opacity * factor);
-                item->setZValue(layerIndex * 1000 - 500 - i);
-                item->setFlag(QGraphicsItem::ItemIsSelectable, false);
-                item->setFlag(QGraphicsItem::ItemIsMovable, false);
-                item->setAcceptedMouseButtons(Qt::NoButton);
-                m_onionSkinItems.insert(item);
+            if (!layer->visible) continue;
+
+            // Frames still showing the current drawing add nothing
+            int contentFrame = f;
+            if (!layer->spans.isTweened(f)) {
+                contentFrame = layer->spans.sourceKeyframe(f);
+                if (contentFrame == -1 ||
+                    (!layer->spans.isTweened(frame) && contentFrame == layer->spans.sourceKeyframe(frame))) {
+                    continue;
+                }
             }
-        }
-    }
 
-    // Next frames
-    for (int i = 1; i <= m_onionSkinAfter; ++i) {
-        int f = frame + i;
-        double factor = baseOpacity * (m_onionSkinAfter - i + 1) / m_onionSkinAfter;
-        for (int layerIndex = 0; layerIndex < m_layers.size(); ++layerIndex) {
-            LayerData* layer = static_cast<LayerData*>(m_layers[layerIndex]);
-            QList<QGraphicsItem*> items = layer->getFrameItems(f);
-            for (QGraphicsItem* item : items) {
-                if (!item || !isValidItem(item)) continue;
-                m_scene->addItem(item);
-                item->setOpacity(item->data(0).toDouble() * layer->opacity * factor);
-                item->setZValue(layerIndex * 1000 - 500 + i);
-                item->setFlag(QGraphicsItem::ItemIsSelectable, false);
-                item->setFlag(QGraphicsItem::ItemIsMovable, false);
-                item->setAcceptedMouseButtons(Qt::NoButton);
-                m_onionSkinItems.insert(item);
+            // Nearer offsets come later; the drawing moves up to where they draw
+            for (int i = 0; i < images.size(); ++i) {
+                if (images[i].layerIndex == layerIndex && images[i].contentFrame == contentFrame) {
+                    images.remove(i);
+                    break;
+                }
             }
+            images.append(OnionImage{ layerIndex, contentFrame, side, factor });
         }
+    };
+
+    // Farthest frames first so the nearest ones end up on top
+    for (int i = m_onionSkinBefore; i >= 1; --i) {
+        int f = frame - i;
+        if (f < 1) continue;
+        addFrame(f, baseOpacity * (m_onionSkinBefore - i + 1) / m_onionSkinBefore,
+                 OnionSkinCache::Side::Before);
+    }
+    for (int i = m_onionSkinAfter; i >= 1; --i) {
+        addFrame(frame + i, baseOpacity * (m_onionSkinAfter - i + 1) / m_onionSkinAfter,
+                 OnionSkinCache::Side::After);
+    }
+
+    QVector<quint64> key;
+    key.reserve(1 + images.size() * 6);
+    key << (quint64(m_canvasSize.width()) << 32 | quint64(m_canvasSize.height()));
+    for (const OnionImage& onion : images) {
+        const LayerData* layer = static_cast<const LayerData*>(m_layers[onion.layerIndex]);
+        key << quint64(reinterpret_cast<quintptr>(layer)) << quint64(onion.contentFrame)
+            << layer->spans.frameRevision(onion.contentFrame) << quint64(onion.side)
+            << quint64(qRound64(onion.factor * 1000000.0)) << quint64(qRound64(layer->opacity * 1000000.0));
+    }
+    if (key == m_onionSkinOverlayKey) {
+        return;
+    }
+
+    QImage overlay(m_canvasSize, QImage::Format_ARGB32_Premultiplied);
+    overlay.fill(Qt::transparent);
+    QPainter painter(&overlay);
+    bool hasContent = false;
+    for (const OnionImage& onion : images) {
+        const LayerData* layer = static_cast<const LayerData*>(m_layers[onion.layerIndex]);
+        const QImage image = m_onionSkinCache.image(onion.layerIndex, onion.contentFrame, onion.side,
+            layer->spans.frameRevision(onion.contentFrame));
+        if (image.isNull()) continue;
+
+        // The cached images are at full opacity; the layer's is applied here
+        painter.setOpacity(layer->opacity * onion.factor);
+        painter.drawImage(0, 0, image);
+        hasContent = true;
     }
+    painter.end();
+
+    m_onionSkinCache.pruneUnused();
+    m_onionSkinOverlay = hasContent ? overlay : QImage();
+    m_onionSkinOverlayKey = key;
+    updateSceneRegion(m_canvasRect);
 }
 
 
-bool Canvas::isValidItem(QGraphicsItem* item) const
+void Canvas::setStaticLayerCaching(bool enabled)
 {
-    if (!item) {
-        return false;
+    if (m_staticLayerCaching == enabled) {
+        return;
     }
 
-    if (item == m_backgroundRect) {
-        return true;
+    // Whatever is live on the current layer is about to be re-read
+    storeCurrentFrameState();
+    m_staticLayerCaching = enabled;
+    invalidateLayerComposites();
+    loadFrameState(m_currentFrame);
+    qDebug() << "Static layer caching" << (enabled ? "enabled" : "disabled");
+}
+
+void Canvas::invalidateLayerComposites()
+{
+    m_layerCompositeKey.clear();
+}
+
+quint64 Canvas::frameRevision(int layerIndex, int frame) const
+{
+    if (layerIndex < 0 || layerIndex >= m_layers.size()) {
+        return 0;
     }
+    return static_cast<const LayerData*>(m_layers[layerIndex])->spans.frameRevision(frame);
+}
 
-    // If the item is still tracked by any layer, consider it valid
-    for (void* layerPtr : m_layers) {
-        if (!layerPtr) {
-            continue;
-        }
+quint64 Canvas::layerPropertyRevision(int layerIndex) const
+{
+    if (layerIndex < 0 || layerIndex >= m_layers.size()) {
+        return 0;
+    }
+    return static_cast<const LayerData*>(m_layers[layerIndex])->propertyRevision;
+}
+
+void Canvas::trackLayerChanges(LayerData* layer)
+{
+    layer->spans.setChangeListener([this, layer](int firstFrame, int lastFrame) {
+        markFramesChanged(layer, firstFrame, lastFrame);
+    });
+    // Spans of binary projects build their items the first time they are shown
+    layer->spans.setContentLoader([this, layer](const QByteArray& content) {
+        return deserializeItems(layer, ProjectContainer::decodeItems(content));
+    });
+}
+
+// Layers report frames by pointer; the index is resolved now, while it
+// still matches the layer order the change set describes
+void Canvas::markFramesChanged(const LayerData* layer, int firstFrame, int lastFrame)
+{
+    auto it = std::find(m_layers.begin(), m_layers.end(), layer);
+    if (it == m_layers.end()) {
+        return; // Not added yet; the structure change covers it
+    }
+    m_pendingChanges.addFrames(static_cast<int>(it - m_layers.begin()), firstFrame, lastFrame);
+    scheduleChangeSet();
+}
+
+void Canvas::markLayerPropertiesChanged(int layerIndex, bool appearance)
+{
+    LayerData* layer = static_cast<LayerData*>(m_layers[layerIndex]);
+    ++layer->propertyRevision;
+    m_pendingChanges.layerProperties.insert(layerIndex);
+    if (appearance) {
+        m_pendingChanges.layerAppearance.insert(layerIndex);
+    }
+    scheduleChangeSet();
+}
+
+void Canvas::markStructureChanged()
+{
+    m_pendingChanges.structureChanged = true;
+    scheduleChangeSet();
+}
+
+void Canvas::scheduleChangeSet()
+{
+    if (m_changeSetTimer && !m_changeSetTimer->isActive()) {
+        m_changeSetTimer->start();
+    }
+}
+
+void Canvas::emitChangeSet()
+{
+    if (m_destroying || m_pendingChanges.isEmpty()) {
+        return;
+    }
+
+    const CanvasChangeSet changes = m_pendingChanges;
+    m_pendingChanges.clear();
+    emit changeSetReady(changes);
+}
+
+// Rebuilds the below/above composites when anything they show changed:
+// the frame, the current layer, or another layer's revision at this frame,
+// visibility, opacity or position in the stack. Edits on the current layer
+// itself never invalidate them.
+void Canvas::updateLayerComposites(int frame)
+{
+    const bool active = m_staticLayerCaching &&
+        m_currentLayerIndex >= 0 && m_currentLayerIndex < m_layers.size() &&
+        !m_canvasSize.isEmpty();
 
-        LayerData* layer = static_cast<LayerData*>(layerPtr);
-        if (layer->allTimeItems.contains(item)) {
-            return true;
+    if (!active) {
+        if (!m_belowLayersImage.isNull() || !m_aboveLayersImage.isNull()) {
+            m_belowLayersImage = QImage();
+            m_aboveLayersImage = QImage();
+            resetCachedContent();
+            updateSceneRegion(m_canvasRect);
         }
+        m_layerCompositeKey.clear();
+        return;
+    }
+
+    QVector<quint64> key;
+    key.reserve(3 + static_cast<int>(m_layers.size()) * 4);
+    key << quint64(frame) << quint64(m_currentLayerIndex)
+        << (quint64(m_canvasSize.width()) << 32 | quint64(m_canvasSize.height()));
+    for (int layerIndex = 0; layerIndex < m_layers.size(); ++layerIndex) {
+        const LayerData* layer = static_cast<const LayerData*>(m_layers[layerIndex]);
+        const quint64 revision = layerIndex == m_currentLayerIndex ? 0 : layer->spans.frameRevision(frame);
+        key << quint64(reinterpret_cast<quintptr>(layer)) << revision
+            << quint64(layer->visible) << quint64(qRound64(layer->opacity * 1000000.0));
+    }
+
+    if (key == m_layerCompositeKey) {
+        return;
     }
 
-    // Also check legacy frame item tracking structures
-    for (const auto& frameEntry : m_frameItems) {
-        if (frameEntry.second.contains(item)) {
-            return true;
+    FrameSnapshot below(m_canvasSize);
+    FrameSnapshot above(m_canvasSize);
+    for (int layerIndex = 0; layerIndex < m_layers.size(); ++layerIndex) {
+        const LayerData* layer = static_cast<const LayerData*>(m_layers[layerIndex]);
+        if (layerIndex == m_currentLayerIndex || !layer->visible) {
+            continue;
         }
+        appendLayerToSnapshot(layerIndex < m_currentLayerIndex ? below : above,
+            frame, layerIndex, qBound(0.0, layer->opacity, 1.0), true);
     }
 
-    return false;
+    m_belowLayersImage = below.primitiveCount() > 0 ? below.render() : QImage();
+    m_aboveLayersImage = above.primitiveCount() > 0 ? above.render() : QImage();
+    m_layerCompositeKey = key;
+
+    // The below composite is drawn with the cached background
+    resetCachedContent();
+    updateSceneRegion(m_canvasRect);
+}
+
+bool Canvas::isValidItem(QGraphicsItem* item) const
+{
+    if (!item) {
+        return false;
+    }
+
+    if (item == m_backgroundRect) {
+        return true;
+    }
+
+    // If the item is still tracked by any layer, consider it valid
+    return m_itemRegistry.contains(item);
 }
 
 int Canvas::getItemLayerIndex(QGraphicsItem* item) const
 {
     if (!item) return -1;
 
-    // ROBUST: Find which layer an item belongs to using UUID tracking
-    for (int i = 0; i < m_layers.size(); ++i) {
-        LayerData* layer = static_cast<LayerData*>(m_layers[i]);
-        if (layer->containsItem(item)) {
-            return i;
+    // ROBUST: The registry knows the owning layer; only its position is looked up
+    const void* owner = m_itemRegistry.layerOf(item);
+    if (owner) {
+        auto it = std::find(m_layers.begin(), m_layers.end(), owner);
+        if (it != m_layers.end()) {
+            return static_cast<int>(it - m_layers.begin());
         }
     }
 
@@ -945,15 +1114,20 @@ int Canvas::getItemLayerIndex(QGraphicsItem* item) const
 
 void Canvas::updateAllLayerZValues()
 {
-    // ROBUST: Update Z-values to match layer order and prevent Z-fighting
+    QHash<const void*, int> layerIndices;
     for (int i = 0; i < m_layers.size(); ++i) {
-        LayerData* layer = static_cast<LayerData*>(m_layers[i]);
-        int baseZValue = i * 1000;
+        layerIndices.insert(m_layers[i], i);
+    }
 
-        for (QGraphicsItem* item : layer->allTimeItems) {
-            if (item && item != m_backgroundRect && m_scene->items().contains(item)) {
-                item->setZValue(baseZValue + (static_cast<int>(item->zValue()) % 1000));
-            }
+    // ROBUST: Update Z-values to match layer order and prevent Z-fighting
+    for (QGraphicsItem* item : m_scene->items()) {
+        if (item == m_backgroundRect || item->parentItem()) {
+            continue;
+        }
+
+        auto it = layerIndices.constFind(m_itemRegistry.layerOf(item));
+        if (it != layerIndices.constEnd()) {
+            item->setZValue(it.value() * 1000 + (static_cast<int>(item->zValue()) % 1000));
         }
     }
 }
@@ -967,33 +1141,31 @@ void Canvas::deleteSelected()
 
     qDebug() << "Deleting" << selectedItems.size() << "selected items";
 
-    const int frame = m_currentFrame;
+    // Deselect in one go so the scene doesn't report a selection change
+    // for every removed item
+    m_suppressFrameConversion = true;
+    m_scene->clearSelection();
+    m_suppressFrameConversion = false;
+
+    // Group by owning layer so each layer's frames are swept once
+    QHash<LayerData*, QSet<QGraphicsItem*>> itemsByLayer;
     for (QGraphicsItem* item : selectedItems) {
         if (!item) continue;
 
         m_scene->removeItem(item);
 
-        // Limpia de todas las capas y frames
-        for (void* layerPtr : m_layers) {
-            if (!layerPtr) continue;
-            LayerData* layer = static_cast<LayerData*>(layerPtr);
-            layer->removeItem(item);
-            for (auto& frameList : layer->frameItems) {
-                frameList.removeAll(item);
-            }
-        }
-
-        // Limpia de todos los FrameData
-        for (auto& layerFrames : m_layerFrameData) {
-            for (auto& frameData : layerFrames) {
-                frameData.items.removeAll(item);
-                frameData.itemStates.remove(item);
-            }
+        const void* owner = m_itemRegistry.layerOf(item);
+        if (owner) {
+            itemsByLayer[static_cast<LayerData*>(const_cast<void*>(owner))].insert(item);
         }
+    }
 
-        // Limpia de todos los AnimationKeyframe
-        // (Si tienes acceso a todos los keyframes, recorre y llama a removeItemState(item))
+    // Limpia de todas las capas y frames
+    for (auto it = itemsByLayer.begin(); it != itemsByLayer.end(); ++it) {
+        it.key()->spans.removeItems(it.value());
+    }
 
+    for (QGraphicsItem* item : selectedItems) {
         delete item;
     }
 
@@ -1011,17 +1183,12 @@ void Canvas::clear()
     qDebug() << "Canvas::clear() called";
 
     // Ensure no interpolated artifacts remain
-    cleanupInterpolatedItems();
-    m_interpolatedItems.clear();
+    releaseTweenProxies();
 
     // Reset all frame/layer bookkeeping so no stale state survives
-    m_frameData.clear();
-    m_frameItems.clear();
-    m_layerKeyframes.clear();
-    m_layerFrameData.clear();
-    m_layerInterpolatedItems.clear();
     m_layerShowingInterpolated.clear();
-    m_onionSkinItems.clear();
+    clearOnionSkins();
+    m_onionSkinCache.clear();
 
     // Remove every item except the background from the scene
     QList<QGraphicsItem*> allItems = m_scene->items();
@@ -1055,8 +1222,15 @@ void Canvas::setCanvasSize(const QSize& size)
         m_backgroundRect->setRect(m_canvasRect);
     }
 
+    // Cached onion frames were rendered at the old size
+    m_onionSkinCache.clear();
+    markStructureChanged();
+    clearOnionSkins();
+    updateLayerComposites(m_currentFrame);
+
     QRectF sceneRect = m_canvasRect.adjusted(-500, -500, 500, 500);
     m_scene->setSceneRect(sceneRect);
+    resetCachedContent();
     viewport()->update();
 }
 
@@ -1067,55 +1241,9 @@ void Canvas::setCurrentFrame(int frame)
 {
     if (frame == m_currentFrame) return;
 
-    // Clean up any existing interpolated items across all layers to avoid
-    // residual drawings when jumping between frames or layers
-    cleanupInterpolatedItems();
-
     m_currentFrame = frame;
 
-    // Check if this frame is part of a tweened sequence on the current layer
-    if (isFrameTweened(frame, m_currentLayerIndex)) {
-        // Determine tween start and end frames for the active layer
-        int startFrame = frame;
-        int endFrame = -1;
-
-        if (getFrameType(frame, m_currentLayerIndex) == FrameType::ExtendedFrame) {
-            startFrame = getSourceKeyframe(frame, m_currentLayerIndex);
-        }
-
-        if (hasFrameTweening(startFrame, m_currentLayerIndex)) {
-            endFrame = getTweeningEndFrame(startFrame, m_currentLayerIndex);
-        }
-
-        if (frame == startFrame || frame == endFrame) {
-            // For actual keyframes simply load the saved state for all layers
-            loadFrameState(frame);
-        }
-        else if (startFrame != -1 && endFrame != -1 && frame > startFrame && frame < endFrame) {
-            // Load all layer content for this frame first, then replace the
-            // current layer with interpolated items so other layers display
-            // the correct frame content
-            loadFrameState(frame);
-            clearLayerFromScene(m_currentLayerIndex);
-            float t = static_cast<float>(frame - startFrame) / (endFrame - startFrame);
-            QString easingType = getFrameTweeningEasing(startFrame, m_currentLayerIndex);
-            if (easingType == "ease-in") {
-                t = t * t;  // Quadratic ease-in
-            }
-            else if (easingType == "ease-out") {
-                t = 1 - (1 - t) * (1 - t);  // Quadratic ease-out
-            }
-            else if (easingType == "ease-in-out") {
-                t = t < 0.5 ? 2 * t * t : 1 - 2 * (1 - t) * (1 - t);  // Quadratic ease-in-out
-            }
-            interpolateFrame(frame, startFrame, endFrame, t, m_currentLayerIndex);
-        }
-
-        emit frameChanged(frame);
-        return;
-    }
-
-    // Normal frame loading
+    // loadFrameState also re-poses the in-betweens of every tweened layer
     loadFrameState(frame);
     emit frameChanged(frame);
 }
@@ -1124,157 +1252,268 @@ void Canvas::setCurrentFrame(int frame)
 
 void Canvas::cleanupInterpolatedItems(int layerIndex)
 {
-    if (!m_layerInterpolatedItems.contains(layerIndex) ||
-        m_layerInterpolatedItems[layerIndex].isEmpty()) {
+    auto poolIt = m_tweenProxyPools.find(layerIndex);
+    if (poolIt == m_tweenProxyPools.end()) {
+        m_layerShowingInterpolated[layerIndex] = false;
         return;
     }
 
-    qDebug() << "Cleaning up" << m_layerInterpolatedItems[layerIndex].size()
-        << "interpolated items for layer" << layerIndex;
-
     // Retrieve layer pointer if available for safety checks
     LayerData* layer =
         (layerIndex >= 0 && layerIndex < m_layers.size())
         ? static_cast<LayerData*>(m_layers[layerIndex])
         : nullptr;
 
-    QList<QGraphicsItem*>& items = m_layerInterpolatedItems[layerIndex];
-    for (QGraphicsItem* item : items) {
-        if (!item) {
+    // Proxies only leave the stage; the pool keeps them for the next in-between
+    bool promoted = false;
+    for (QGraphicsItem* proxy : poolIt.value().proxies) {
+        if (!proxy) {
             continue;
         }
-
-        // Determine whether the item is a temporary interpolated clone. If an
-        // interpolated item has been promoted to a real layer item (for
-        // example, when editing on a tweened frame), it will also appear in the
-        // layer's data structures. Such items must not be deleted here.
-        const bool isInterpolatedClone = item->data(999).toString() == "interpolated";
-        const bool belongsToLayer = layer && layer->containsItem(item);
-
-        if (scene()->items().contains(item)) {
-            scene()->removeItem(item);
+        if (proxy->scene() == scene()) {
+            scene()->removeItem(proxy);
         }
-
-        if (isInterpolatedClone && !belongsToLayer) {
-            delete item;
+        // A proxy promoted to a real layer item (for example, when editing on
+        // a tweened frame) belongs to the layer now and can't be reused
+        if (layer && layer->containsItem(proxy)) {
+            promoted = true;
         }
     }
 
-    items.clear();
+    if (promoted) {
+        releaseTweenProxies(layerIndex);
+    }
+
     m_layerShowingInterpolated[layerIndex] = false;
 }
 
-
-void Canvas::interpolateFrame(int currentFrame, int startFrame, int endFrame, float t, int layerIndex)
+// Deletes the layer's proxies; the next in-between rebuilds them
+void Canvas::releaseTweenProxies(int layerIndex)
 {
-    // Ensure we don't leave stale interpolated items behind
-    cleanupInterpolatedItems(layerIndex);
+    auto poolIt = m_tweenProxyPools.find(layerIndex);
+    if (poolIt == m_tweenProxyPools.end()) {
+        return;
+    }
 
-    m_layerShowingInterpolated[layerIndex] = true;
+    LayerData* layer =
+        (layerIndex >= 0 && layerIndex < m_layers.size())
+        ? static_cast<LayerData*>(m_layers[layerIndex])
+        : nullptr;
 
-    // Get start and end frame data for specific layer
-    auto& layerFrameData = m_layerFrameData[layerIndex];
-    auto startIt = layerFrameData.find(startFrame);
-    auto endIt = layerFrameData.find(endFrame);
+    const QList<QGraphicsItem*> proxies = poolIt.value().proxies;
+    m_tweenProxyPools.erase(poolIt);
 
-    if (startIt == layerFrameData.end() || endIt == layerFrameData.end()) {
-        m_layerShowingInterpolated[layerIndex] = false;
+    for (QGraphicsItem* proxy : proxies) {
+        if (!proxy) {
+            continue;
+        }
+        if (proxy->scene() == scene()) {
+            scene()->removeItem(proxy);
+        }
+        if (!layer || !layer->containsItem(proxy)) {
+            delete proxy;
+        }
+    }
+
+    m_layerShowingInterpolated[layerIndex] = false;
+}
+
+void Canvas::releaseTweenProxies()
+{
+    const QList<int> layerIndices = m_tweenProxyPools.keys();
+    for (int layerIndex : layerIndices) {
+        releaseTweenProxies(layerIndex);
+    }
+}
+
+
+void Canvas::interpolateFrame(int currentFrame, int startFrame, int endFrame, float t, int layerIndex)
+{
+    Q_UNUSED(currentFrame);
+
+    // Get start and end keyframes for specific layer
+    const FrameSpan* startSpan = nullptr;
+    const FrameSpan* endSpan = nullptr;
+    if (layerIndex >= 0 && layerIndex < m_layers.size()) {
+        const LayerData* layer = static_cast<LayerData*>(m_layers[layerIndex]);
+        startSpan = layer->spans.spanStartingAt(startFrame);
+        endSpan = layer->spans.spanStartingAt(endFrame);
+    }
+
+    if (!startSpan || !endSpan) {
+        cleanupInterpolatedItems(layerIndex);
         return;
     }
 
     // Interpolate between keyframes on this layer only
-    const QList<QGraphicsItem*>& startItems = startIt.value().items;
-    const QList<QGraphicsItem*>& endItems = endIt.value().items;
-
-    for (int i = 0; i < qMin(startItems.size(), endItems.size()); ++i) {
-        QGraphicsItem* startItem = startItems[i];
-        QGraphicsItem* endItem = endItems[i];
-
-        if (!startItem || !endItem) continue;
-
-        QGraphicsItem* interpolatedItem = cloneGraphicsItem(startItem);
-        if (!interpolatedItem) continue;
-
-        // Interpolate position using item centers to keep proper rotation pivot
-        QPointF startCenter = startItem->mapToScene(startItem->boundingRect().center());
-        QPointF endCenter = endItem->mapToScene(endItem->boundingRect().center());
-        QPointF interpolatedCenter = startCenter + t * (endCenter - startCenter);
-
-        // Set transform origin to item center and position accordingly
-        QPointF origin = interpolatedItem->boundingRect().center();
-        interpolatedItem->setTransformOriginPoint(origin);
-        interpolatedItem->setPos(interpolatedCenter - origin);
-
-        // Interpolate rotation
-        qreal startRotation = startItem->rotation();
-        qreal endRotation = endItem->rotation();
-        qreal rotationDiff = endRotation - startRotation;
-        if (rotationDiff > 180) rotationDiff -= 360;
-        if (rotationDiff < -180) rotationDiff += 360;
-        qreal interpolatedRotation = startRotation + t * rotationDiff;
-        interpolatedItem->setRotation(interpolatedRotation);
-
-        // Interpolate scaling
-        QTransform startTransform = startItem->transform();
-        QTransform endTransform = endItem->transform();
-        qreal startScaleX = startTransform.m11();
-        qreal startScaleY = startTransform.m22();
-        qreal endScaleX = endTransform.m11();
-        qreal endScaleY = endTransform.m22();
-        qreal interpolatedScaleX = startScaleX + t * (endScaleX - startScaleX);
-        qreal interpolatedScaleY = startScaleY + t * (endScaleY - startScaleY);
-        QTransform interpolatedTransform;
-        interpolatedTransform.scale(interpolatedScaleX, interpolatedScaleY);
-        interpolatedItem->setTransform(interpolatedTransform);
-
-        // Interpolate opacity
-        qreal startOpacity = startItem->opacity();
-        qreal endOpacity = endItem->opacity();
-        qreal interpolatedOpacity = startOpacity + t * (endOpacity - startOpacity);
-        interpolatedItem->setOpacity(interpolatedOpacity);
-
-        // Interpolate blur
-        qreal startBlur = 0;
-        if (auto blur = dynamic_cast<QGraphicsBlurEffect*>(startItem->graphicsEffect()))
-            startBlur = blur->blurRadius();
-        qreal endBlur = 0;
-        if (auto blur2 = dynamic_cast<QGraphicsBlurEffect*>(endItem->graphicsEffect()))
-            endBlur = blur2->blurRadius();
-        qreal interpolatedBlur = startBlur + t * (endBlur - startBlur);
-        if (interpolatedBlur > 0) {
-            QGraphicsBlurEffect* blurEffect = dynamic_cast<QGraphicsBlurEffect*>(interpolatedItem->graphicsEffect());
-            if (!blurEffect) {
-                blurEffect = new QGraphicsBlurEffect();
-                interpolatedItem->setGraphicsEffect(blurEffect);
+    const QList<QGraphicsItem*>& startItems = startSpan->items;
+    const QList<QGraphicsItem*>& endItems = endSpan->items;
+
+    // Proxies are rebuilt only when the tween's keyframes changed
+    auto poolIt = m_tweenProxyPools.find(layerIndex);
+    if (poolIt != m_tweenProxyPools.end() &&
+        (poolIt->startFrame != startFrame || poolIt->endFrame != endFrame ||
+         poolIt->sources != startItems || poolIt->targets != endItems)) {
+        releaseTweenProxies(layerIndex);
+        poolIt = m_tweenProxyPools.end();
+    }
+
+    if (poolIt == m_tweenProxyPools.end()) {
+        TweenProxyPool pool;
+        pool.startFrame = startFrame;
+        pool.endFrame = endFrame;
+        pool.sources = startItems;
+        pool.targets = endItems;
+
+        for (int i = 0; i < qMin(startItems.size(), endItems.size()); ++i) {
+            QGraphicsItem* proxy = (startItems[i] && endItems[i]) ? cloneGraphicsItem(startItems[i]) : nullptr;
+            if (proxy) {
+                // Mark interpolated items as non-selectable and set layer Z-value
+                proxy->setFlag(QGraphicsItem::ItemIsSelectable, false);
+                proxy->setFlag(QGraphicsItem::ItemIsMovable, false);
+                proxy->setSelected(false);
+                proxy->setData(999, "interpolated");
+                proxy->setData(998, layerIndex);  // Store layer index
+                proxy->setZValue(layerIndex * 1000);  // Proper layer Z-ordering
             }
-            blurEffect->setBlurRadius(interpolatedBlur);
+            pool.proxies.append(proxy);
         }
-        else if (interpolatedItem->graphicsEffect()) {
-            interpolatedItem->setGraphicsEffect(nullptr);
+
+        poolIt = m_tweenProxyPools.insert(layerIndex, pool);
+    }
+
+    const TweenProxyPool& pool = poolIt.value();
+    for (int i = 0; i < pool.proxies.size(); ++i) {
+        QGraphicsItem* proxy = pool.proxies[i];
+        if (!proxy) continue;
+
+        applyTweenPose(proxy, tweenPose(pool.sources[i], pool.targets[i], t));
+        proxy->setVisible(true);
+        if (proxy->scene() != scene()) {
+            scene()->addItem(proxy);
         }
+    }
 
-        // Preserve pen properties for paths
-        if (auto startPath = qgraphicsitem_cast<QGraphicsPathItem*>(startItem)) {
-            if (auto interpPath = qgraphicsitem_cast<QGraphicsPathItem*>(interpolatedItem)) {
-                QPen startPen = startPath->pen();
-                interpPath->setPen(startPen);
-            }
+    m_layerShowingInterpolated[layerIndex] = true;
+}
+
+// Computes where an in-between sits a fraction t of the way from startItem
+// towards endItem's placement, rotation, scale, opacity and blur
+Canvas::TweenPose Canvas::tweenPose(QGraphicsItem* startItem, QGraphicsItem* endItem, float t) const
+{
+    TweenPose pose;
+
+    // Interpolate position using item centers to keep proper rotation pivot
+    QPointF startCenter = startItem->mapToScene(startItem->boundingRect().center());
+    QPointF endCenter = endItem->mapToScene(endItem->boundingRect().center());
+    QPointF interpolatedCenter = startCenter + t * (endCenter - startCenter);
+
+    // Transform origin at the item center, positioned accordingly
+    pose.origin = startItem->boundingRect().center();
+    pose.pos = interpolatedCenter - pose.origin;
+
+    // Interpolate rotation
+    qreal startRotation = startItem->rotation();
+    qreal endRotation = endItem->rotation();
+    qreal rotationDiff = endRotation - startRotation;
+    if (rotationDiff > 180) rotationDiff -= 360;
+    if (rotationDiff < -180) rotationDiff += 360;
+    pose.rotation = startRotation + t * rotationDiff;
+
+    // Interpolate scaling
+    QTransform startTransform = startItem->transform();
+    QTransform endTransform = endItem->transform();
+    pose.scaleX = startTransform.m11() + t * (endTransform.m11() - startTransform.m11());
+    pose.scaleY = startTransform.m22() + t * (endTransform.m22() - startTransform.m22());
+
+    // Interpolate opacity
+    qreal startOpacity = startItem->opacity();
+    qreal endOpacity = endItem->opacity();
+    pose.opacity = startOpacity + t * (endOpacity - startOpacity);
+
+    // Interpolate blur
+    qreal startBlur = 0;
+    if (auto blur = dynamic_cast<QGraphicsBlurEffect*>(startItem->graphicsEffect()))
+        startBlur = blur->blurRadius();
+    qreal endBlur = 0;
+    if (auto blur2 = dynamic_cast<QGraphicsBlurEffect*>(endItem->graphicsEffect()))
+        endBlur = blur2->blurRadius();
+    pose.blurRadius = startBlur + t * (endBlur - startBlur);
+
+    return pose;
+}
+
+// Same composition QGraphicsItem applies: base transform, then rotation
+// around the transform origin, then the translation to pos
+QTransform Canvas::TweenPose::sceneTransform() const
+{
+    QTransform transform = QTransform::fromScale(scaleX, scaleY);
+    transform *= QTransform::fromTranslate(-origin.x(), -origin.y());
+    transform *= QTransform().rotate(rotation);
+    transform *= QTransform::fromTranslate(origin.x(), origin.y());
+    transform *= QTransform::fromTranslate(pos.x(), pos.y());
+    return transform;
+}
+
+// Moves a proxy to its tween pose. The blur effect is kept and toggled
+// rather than recreated, so scrubbing doesn't allocate.
+void Canvas::applyTweenPose(QGraphicsItem* proxy, const TweenPose& pose) const
+{
+    proxy->setTransformOriginPoint(pose.origin);
+    proxy->setPos(pose.pos);
+    proxy->setRotation(pose.rotation);
+    proxy->setTransform(QTransform::fromScale(pose.scaleX, pose.scaleY));
+    proxy->setOpacity(pose.opacity);
+
+    QGraphicsBlurEffect* blurEffect = dynamic_cast<QGraphicsBlurEffect*>(proxy->graphicsEffect());
+    if (pose.blurRadius > 0) {
+        if (!blurEffect) {
+            blurEffect = new QGraphicsBlurEffect();
+            proxy->setGraphicsEffect(blurEffect);
         }
+        blurEffect->setBlurRadius(pose.blurRadius);
+        blurEffect->setEnabled(true);
+    }
+    else if (blurEffect) {
+        blurEffect->setEnabled(false);
+    }
+}
 
-        // Mark interpolated items as non-selectable and set layer Z-value
-        interpolatedItem->setFlag(QGraphicsItem::ItemIsSelectable, false);
-        interpolatedItem->setFlag(QGraphicsItem::ItemIsMovable, false);
-        interpolatedItem->setData(999, "interpolated");
-        interpolatedItem->setData(998, layerIndex);  // Store layer index
-        interpolatedItem->setZValue(layerIndex * 1000);  // Proper layer Z-ordering
+// Returns true when frame is an in-between of a tween on the layer, along
+// with the tween's keyframes and the eased progress between them
+bool Canvas::tweenProgress(int frame, int layerIndex, int& startFrame, int& endFrame, float& t) const
+{
+    if (!isFrameTweened(frame, layerIndex)) {
+        return false;
+    }
+
+    startFrame = frame;
+    endFrame = -1;
+
+    if (getFrameType(frame, layerIndex) == FrameType::ExtendedFrame) {
+        startFrame = getSourceKeyframe(frame, layerIndex);
+    }
+
+    if (hasFrameTweening(startFrame, layerIndex)) {
+        endFrame = getTweeningEndFrame(startFrame, layerIndex);
+    }
 
-        // Add to scene and track per layer
-        scene()->addItem(interpolatedItem);
-        m_layerInterpolatedItems[layerIndex].append(interpolatedItem);
+    if (startFrame == -1 || endFrame == -1 || frame <= startFrame || frame >= endFrame) {
+        return false;
     }
 
-    qDebug() << "Created" << m_layerInterpolatedItems[layerIndex].size()
-        << "interpolated items for layer" << layerIndex << "frame" << currentFrame;
+    t = static_cast<float>(frame - startFrame) / (endFrame - startFrame);
+    QString easingType = getFrameTweeningEasing(startFrame, layerIndex);
+    if (easingType == "ease-in") {
+        t = t * t;  // Quadratic ease-in
+    }
+    else if (easingType == "ease-out") {
+        t = 1 - (1 - t) * (1 - t);  // Quadratic ease-out
+    }
+    else if (easingType == "ease-in-out") {
+        t = t < 0.5 ? 2 * t * t : 1 - 2 * (1 - t) * (1 - t);  // Quadratic ease-in-out
+    }
+    return true;
 }
 
 int Canvas::getCurrentFrame() const { return m_currentFrame; }
@@ -1296,22 +1535,17 @@ void Canvas::createKeyframe(int frame)
     }
 
     // Store as keyframe ONLY in layer-specific data
-    auto& layerFrameData = m_layerFrameData[m_currentLayerIndex];
-    auto& frameData = layerFrameData[frame];
-    frameData.type = FrameType::Keyframe;
-    frameData.items = clonedItems;
-    frameData.sourceKeyframe = -1;
-    frameData.hasTweening = false;
-    frameData.tweeningEndFrame = -1;
-    frameData.easingType = "linear";
-
-    // Update layer data structure
     if (m_currentLayerIndex >= 0 && m_currentLayerIndex < m_layers.size()) {
         LayerData* layer = static_cast<LayerData*>(m_layers[m_currentLayerIndex]);
-        layer->setFrameItems(frame, clonedItems);
+        FrameSpan& span = layer->spans.insertKeyframe(frame);
+        layer->spans.setItems(span, clonedItems);
+        FrameSpanIndex::clearTweening(span);
     }
 
-    m_layerKeyframes[m_currentLayerIndex].insert(frame);
+    // Show the keyframe's own copies instead of the held originals
+    if (frame == m_currentFrame) {
+        loadFrameState(frame);
+    }
 
     qDebug() << "Keyframe created with" << clonedItems.size() << "items";
 }
@@ -1368,6 +1602,11 @@ QGraphicsItem* Canvas::cloneGraphicsItem(QGraphicsItem* item) const
         // Handle imported images
         auto newPixmap = new QGraphicsPixmapItem(pixmapItem->pixmap());
         newPixmap->setOffset(pixmapItem->offset());
+        // Same pixels, so the saved asset stays valid for the copy
+        for (int role : { GraphicsItemRoles::PixmapAssetKeyRole, GraphicsItemRoles::PixmapAssetHashRole,
+                          GraphicsItemRoles::PixmapAssetDataRole }) {
+            newPixmap->setData(role, pixmapItem->data(role));
+        }
         copy = newPixmap;
     }
     else if (auto textItem = qgraphicsitem_cast<QGraphicsTextItem*>(item)) {
@@ -1402,9 +1641,14 @@ QGraphicsItem* Canvas::cloneGraphicsItem(QGraphicsItem* item) const
 
 void Canvas::clearLayerFromScene(int layerIndex)
 {
+    if (layerIndex < 0 || layerIndex >= m_layers.size()) {
+        return;
+    }
+
+    const void* layer = m_layers[layerIndex];
     QList<QGraphicsItem*> itemsToRemove;
     for (QGraphicsItem* item : scene()->items()) {
-        if (item != m_backgroundRect && getItemLayerIndex(item) == layerIndex) {
+        if (item != m_backgroundRect && m_itemRegistry.layerOf(item) == layer) {
             itemsToRemove.append(item);
         }
     }
@@ -1415,17 +1659,6 @@ void Canvas::clearLayerFromScene(int layerIndex)
     }
 }
 
-void Canvas::clearFrameItems(int frame)
-{
-    auto it = m_frameData.find(frame);
-    if (it != m_frameData.end()) {
-        it->second.items.clear();
-        it->second.itemStates.clear();
-    }
-
-    m_frameItems[frame].clear();
-}
-
 void Canvas::createBlankKeyframe(int frame)
 {
     if (m_currentLayerIndex < 0 || m_currentLayerIndex >= m_layers.size()) return;
@@ -1435,18 +1668,11 @@ void Canvas::createBlankKeyframe(int frame)
     if (m_currentLayerIndex == 0 && m_backgroundRect) {
         items.append(m_backgroundRect);
     }
-    layer->setFrameItems(frame, items);
 
-    auto& frameData = m_layerFrameData[m_currentLayerIndex][frame];
-    frameData.type = FrameType::Keyframe;
-    frameData.items = items;
-    frameData.sourceKeyframe = -1;
-    frameData.hasTweening = false;
-    frameData.tweeningEndFrame = -1;
-    frameData.easingType = "linear";
+    FrameSpan& span = layer->spans.insertKeyframe(frame);
+    layer->spans.setItems(span, items);
+    FrameSpanIndex::clearTweening(span);
 
-    m_frameItems[frame] = QList<QGraphicsItem*>();
-    m_layerKeyframes[m_currentLayerIndex].insert(frame);
     clearFrameState();
     emit keyframeCreated(frame);
     qDebug() << "Blank keyframe created at frame:" << frame;
@@ -1454,11 +1680,10 @@ void Canvas::createBlankKeyframe(int frame)
 
 bool Canvas::hasKeyframe(int frame, int layerIndex) const
 {
-    auto it = m_layerKeyframes.find(layerIndex);
-    if (it == m_layerKeyframes.end()) {
+    if (layerIndex < 0 || layerIndex >= m_layers.size()) {
         return false;
     }
-    return it.value().contains(frame);
+    return static_cast<LayerData*>(m_layers[layerIndex])->spans.hasKeyframe(frame);
 }
 
 
@@ -1490,6 +1715,12 @@ void Canvas::clearFrameState()
 
 void Canvas::mousePressEvent(QMouseEvent* event)
 {
+    // The live scene may be on another frame while playback blits images
+    if (isShowingPlaybackFrame()) {
+        event->ignore();
+        return;
+    }
+
     if (!m_scene) {
         QGraphicsView::mousePressEvent(event);
         return;
@@ -1710,6 +1941,13 @@ void Canvas::drawBackground(QPainter* painter, const QRectF& rect)
     if (m_gridVisible) {
         drawGrid(painter, rect);
     }
+    // Layers under the current one, background included, while caching
+    if (!m_belowLayersImage.isNull()) {
+        painter->save();
+        painter->setRenderHint(QPainter::SmoothPixmapTransform, m_zoomFactor != 1.0);
+        painter->drawImage(m_canvasRect, m_belowLayersImage);
+        painter->restore();
+    }
 }
 
 void Canvas::drawCanvasBounds(QPainter* painter, const QRectF& rect)
@@ -1802,7 +2040,13 @@ void Canvas::setZoomFactor(double factor)
 
 double Canvas::getZoomFactor() const { return m_zoomFactor; }
 
-void Canvas::setGridVisible(bool visible) { m_gridVisible = visible; viewport()->update(); }
+void Canvas::setGridVisible(bool visible)
+{
+    m_gridVisible = visible;
+    // The grid is part of the cached background
+    resetCachedContent();
+    viewport()->update();
+}
 void Canvas::setSnapToGrid(bool snap) { m_snapToGrid = snap; }
 void Canvas::setRulersVisible(bool visible) { m_rulersVisible = visible; viewport()->update(); }
 bool Canvas::isGridVisible() const { return m_gridVisible; }
@@ -1859,11 +2103,107 @@ void Canvas::keyPressEvent(QKeyEvent* event)
     QGraphicsView::keyPressEvent(event);
 }
 
-void Canvas::paintEvent(QPaintEvent* event) { QGraphicsView::paintEvent(event); }
+void Canvas::paintEvent(QPaintEvent* event)
+{
+    QElapsedTimer paintTimer;
+    if (m_profileRepaints) {
+        paintTimer.start();
+    }
+
+    if (m_playbackImage.isNull()) {
+        QGraphicsView::paintEvent(event);
+    }
+    else {
+        // Playback: one blit of the pre-rendered frame over the canvas area
+        QPainter painter(viewport());
+        painter.fillRect(viewport()->rect(), backgroundBrush());
+        painter.setTransform(viewportTransform());
+        // Proxy frames from reduced-resolution playback are upscaled too
+        painter.setRenderHint(QPainter::SmoothPixmapTransform,
+                              m_zoomFactor != 1.0 || m_playbackImage.size() != m_canvasRect.size().toSize());
+        if (m_backgroundRect && m_backgroundRect->isVisible()) {
+            painter.fillRect(m_canvasRect, m_backgroundRect->brush());
+        }
+        painter.drawImage(m_canvasRect, m_playbackImage);
+    }
+
+    if (m_profileRepaints) {
+        recordRepaint(paintTimer.nsecsElapsed(), event->region());
+    }
+}
+
+// Averages repaint cost and dirty area over batches of paints, for
+// comparing update strategies while drawing
+void Canvas::recordRepaint(qint64 nanoseconds, const QRegion& region)
+{
+    m_repaintNanoseconds += nanoseconds;
+    for (const QRect& rect : region) {
+        m_repaintPixels += qint64(rect.width()) * rect.height();
+    }
+
+    if (++m_repaintCount < 120) {
+        return;
+    }
+
+    const qint64 viewportPixels = qMax<qint64>(1, qint64(viewport()->width()) * viewport()->height());
+    qCDebug(lcCanvasRepaint) << m_repaintCount << "paints, avg"
+        << m_repaintNanoseconds / 1e6 / m_repaintCount << "ms, avg dirty area"
+        << 100.0 * m_repaintPixels / m_repaintCount / viewportPixels << "% of viewport";
+
+    m_repaintCount = 0;
+    m_repaintNanoseconds = 0;
+    m_repaintPixels = 0;
+}
+
+void Canvas::updateSceneRegion(const QRectF& sceneRect)
+{
+    if (sceneRect.isEmpty()) {
+        return;
+    }
+    // Pad for antialiasing and pen overhang at the edges
+    viewport()->update(mapFromScene(sceneRect).boundingRect().adjusted(-2, -2, 2, 2));
+}
+
+void Canvas::showPlaybackFrame(const QImage& image)
+{
+    // The first frame replaces the whole live view; later ones only the canvas
+    const bool wasShowing = !m_playbackImage.isNull();
+    m_playbackImage = image;
+    if (wasShowing) {
+        updateSceneRegion(m_canvasRect);
+    }
+    else {
+        viewport()->update();
+    }
+}
+
+void Canvas::clearPlaybackFrame()
+{
+    if (m_playbackImage.isNull()) {
+        return;
+    }
+
+    m_playbackImage = QImage();
+    viewport()->update();
+}
 
 void Canvas::drawForeground(QPainter* painter, const QRectF& rect)
 {
     QGraphicsView::drawForeground(painter, rect);
+    if (!m_aboveLayersImage.isNull() || !m_onionSkinOverlay.isNull()) {
+        painter->save();
+        painter->setRenderHint(QPainter::SmoothPixmapTransform, m_zoomFactor != 1.0);
+        // Layers over the current one, while caching
+        if (!m_aboveLayersImage.isNull()) {
+            painter->drawImage(m_canvasRect, m_aboveLayersImage);
+        }
+        // The opaque background is a scene item, so onion frames go on top of
+        // the scene; their reduced opacity keeps the current drawing readable
+        if (!m_onionSkinOverlay.isNull()) {
+            painter->drawImage(m_canvasRect, m_onionSkinOverlay);
+        }
+        painter->restore();
+    }
     if (m_rulersVisible) {
         drawRulers(painter);
     }
@@ -1902,18 +2242,6 @@ void Canvas::groupSelectedItems()
             if (layerIndex >= 0) {
                 LayerData* layer = static_cast<LayerData*>(m_layers[layerIndex]);
                 layer->removeItemFromAllFrames(child);
-
-                if (m_layerFrameData.contains(layerIndex)) {
-                    auto& layerFrameData = m_layerFrameData[layerIndex];
-                    for (auto it = layerFrameData.begin(); it != layerFrameData.end(); ++it) {
-                        it.value().items.removeAll(child);
-                        it.value().itemStates.remove(child);
-                    }
-                }
-            }
-
-            for (auto& frameEntry : m_frameItems) {
-                frameEntry.second.removeAll(child);
             }
         }
 
@@ -1942,18 +2270,6 @@ void Canvas::ungroupSelectedItems()
             if (layerIndex >= 0) {
                 LayerData* layer = static_cast<LayerData*>(m_layers[layerIndex]);
                 layer->removeItemFromAllFrames(group);
-
-                if (m_layerFrameData.contains(layerIndex)) {
-                    auto& layerFrameData = m_layerFrameData[layerIndex];
-                    for (auto it = layerFrameData.begin(); it != layerFrameData.end(); ++it) {
-                        it.value().items.removeAll(group);
-                        it.value().itemStates.remove(group);
-                    }
-                }
-            }
-
-            for (auto& frameEntry : m_frameItems) {
-                frameEntry.second.removeAll(group);
             }
 
             m_scene->destroyItemGroup(group);
@@ -2090,7 +2406,14 @@ void Canvas::createExtendedFrame(int frame)
     if (m_currentLayerIndex < 0 || m_currentLayerIndex >= m_layers.size()) return;
     qDebug() << "Creating extended frame at frame" << frame;
 
-    int sourceKeyframe = getLastKeyframeBefore(frame, m_currentLayerIndex);
+    LayerData* layer = static_cast<LayerData*>(m_layers[m_currentLayerIndex]);
+    if (layer->spans.spanAt(frame)) {
+        qDebug() << "Frame" << frame << "already has content, skipping";
+        setCurrentFrame(frame);
+        return;
+    }
+
+    int sourceKeyframe = layer->spans.keyframeBefore(frame);
     if (sourceKeyframe == -1) {
         qDebug() << "No previous keyframe found, creating blank keyframe";
         createBlankKeyframe(frame);
@@ -2098,210 +2421,61 @@ void Canvas::createExtendedFrame(int frame)
     }
     qDebug() << "Source keyframe found at frame" << sourceKeyframe;
 
-    LayerData* layer = static_cast<LayerData*>(m_layers[m_currentLayerIndex]);
-    QList<QGraphicsItem*> sourceItems = layer->getFrameItems(sourceKeyframe);
-
-    for (int f = sourceKeyframe + 1; f <= frame; ++f) {
-        if (hasContent(f, m_currentLayerIndex)) {
-            qDebug() << "Frame" << f << "already has content, skipping";
-            continue;
-        }
-        qDebug() << "Creating extended frame data for frame" << f;
-
-        FrameData& data = m_layerFrameData[m_currentLayerIndex][f];
-        data.type = FrameType::ExtendedFrame;
-        data.sourceKeyframe = sourceKeyframe;
-        data.items = sourceItems;
-        data.hasTweening = false;
-        data.tweeningEndFrame = -1;
-        data.easingType = "linear";
-        layer->setFrameItems(f, sourceItems);
-
+    // Holding a keyframe longer only moves the end of its span
+    const int previousEnd = layer->spans.spanStartingAt(sourceKeyframe)->lastFrame;
+    const int newEnd = layer->spans.extendSpan(sourceKeyframe, frame);
+    for (int f = previousEnd + 1; f <= newEnd; ++f) {
         emit frameExtended(sourceKeyframe, f);
     }
 
     setCurrentFrame(frame);
-    qDebug() << "Extended frames created from" << sourceKeyframe + 1 << "to" << frame;
-}
-
-
-// ENHANCED: Also update copyItemsToFrame for better performance
-void Canvas::copyItemsToFrame(int fromFrame, int toFrame)
-{
-    if (m_frameData.find(fromFrame) == m_frameData.end()) {
-        qDebug() << "Source frame" << fromFrame << "has no data";
-        return;
-    }
-
-    qDebug() << "Copying items from frame" << fromFrame << "to frame" << toFrame;
-
-    // PERFORMANCE OPTIMIZATION: For extended frames, just reference the items
-    // instead of duplicating them in memory
-    if (m_frameItems.find(fromFrame) != m_frameItems.end()) {
-        // Reference the same items (no scene manipulation needed)
-        m_frameData[toFrame].items = m_frameItems[fromFrame];
-        m_frameItems[toFrame] = m_frameItems[fromFrame];  // Update compatibility layer
-
-        // Copy item states
-        if (m_frameData.find(fromFrame) != m_frameData.end()) {
-            m_frameData[toFrame].itemStates = m_frameData[fromFrame].itemStates;
-        }
-
-        qDebug() << "Referenced" << m_frameItems[fromFrame].size() << "items from frame" << fromFrame;
-        return;
-    }
-
-    // FALLBACK: Original method for cases where we need actual duplication
-    // Clear current scene
-    QList<QGraphicsItem*> currentItems;
-    for (QGraphicsItem* item : m_scene->items()) {
-        if (item != m_backgroundRect && item->zValue() > -999) {
-            currentItems.append(item);
-        }
-    }
-
-    for (QGraphicsItem* item : currentItems) {
-        m_scene->removeItem(item);
-
-        // Only delete transient items that are not tracked by any layer
-        const int ownerLayer = getItemLayerIndex(item);
-        if (ownerLayer == -1 && item && item != m_backgroundRect) {
-            m_interpolatedItems.removeAll(item);
-            m_onionSkinItems.remove(item);
-            for (auto iter = m_layerInterpolatedItems.begin(); iter != m_layerInterpolatedItems.end(); ++iter) {
-                QList<QGraphicsItem*>& layerItems = iter.value();
-                layerItems.removeAll(item);
-            }
-            delete item;
-        }
-    }
-
-    // Load and duplicate items from source frame
-    loadFrameState(fromFrame);
-
-    QList<QGraphicsItem*> sourceItems;
-    for (QGraphicsItem* item : m_scene->items()) {
-        if (item != m_backgroundRect && item->zValue() > -999) {
-            sourceItems.append(item);
-        }
-    }
-
-    // Store for the target frame
-    m_frameData[toFrame].items = sourceItems;
-    m_frameItems[toFrame] = sourceItems;  // Update compatibility layer
+    qDebug() << "Extended frames created from" << previousEnd + 1 << "to" << newEnd;
 }
 
-// Add these methods to Canvas.cpp
-
-
 bool Canvas::hasContent(int frame, int layerIndex) const
 {
-    if (m_layerFrameData.contains(layerIndex)) {
-        const auto& layerFrameData = m_layerFrameData[layerIndex];
-        if (layerFrameData.contains(frame)) {
-            return !layerFrameData[frame].items.isEmpty();
-        }
-    }
-
-    if (layerIndex >= 0 && layerIndex < m_layers.size()) {
-        LayerData* layer = static_cast<LayerData*>(m_layers[layerIndex]);
-        return !layer->getFrameItems(frame).isEmpty();
+    if (layerIndex < 0 || layerIndex >= m_layers.size()) {
+        return false;
     }
 
-    return false;
+    LayerData* layer = static_cast<LayerData*>(m_layers[layerIndex]);
+    const FrameSpan* span = layer->spans.spanAt(frame);
+    return span && !span->items.isEmpty();
 }
 
 FrameType Canvas::getFrameType(int frame, int layerIndex) const
 {
-    if (!m_layerFrameData.contains(layerIndex)) return FrameType::Empty;
-
-    const auto& layerFrameData = m_layerFrameData[layerIndex];
-    auto it = layerFrameData.find(frame);
-    if (it != layerFrameData.end()) {
-        return it.value().type;
-    }
-
-    // Check if it's a keyframe
-    if (hasKeyframe(frame, layerIndex)) {
-        return FrameType::Keyframe;
-    }
-
-    return FrameType::Empty;
+    if (layerIndex < 0 || layerIndex >= m_layers.size()) return FrameType::Empty;
+    return static_cast<LayerData*>(m_layers[layerIndex])->spans.frameType(frame);
 }
 
 
 int Canvas::getSourceKeyframe(int frame, int layerIndex) const
 {
-    if (!m_layerFrameData.contains(layerIndex)) return -1;
-
-    const auto& layerFrameData = m_layerFrameData[layerIndex];
-    auto it = layerFrameData.find(frame);
-    if (it != layerFrameData.end() && it.value().type == FrameType::ExtendedFrame) {
-        return it.value().sourceKeyframe;
-    }
-
-    // If this frame is a keyframe, it's its own source
-    if (hasKeyframe(frame, layerIndex)) {
-        return frame;
-    }
-
-    return -1;
+    // Keyframes are their own source
+    if (layerIndex < 0 || layerIndex >= m_layers.size()) return -1;
+    return static_cast<LayerData*>(m_layers[layerIndex])->spans.sourceKeyframe(frame);
 }
 
 int Canvas::getLastKeyframeBefore(int frame, int layerIndex) const
 {
-    int lastKeyframe = -1;
-    auto it = m_layerKeyframes.find(layerIndex);
-    if (it != m_layerKeyframes.end()) {
-        const QSet<int>& keys = it.value();
-        for (int key : keys) {
-            if (key < frame && key > lastKeyframe) {
-                lastKeyframe = key;
-            }
-        }
-    }
-
-    if (m_layerFrameData.contains(layerIndex)) {
-        const auto& layerFrameData = m_layerFrameData[layerIndex];
-        for (auto iter = layerFrameData.begin(); iter != layerFrameData.end(); ++iter) {
-            if (iter.key() < frame && iter.value().type == FrameType::Keyframe) {
-                if (iter.key() > lastKeyframe) {
-                    lastKeyframe = iter.key();
-                }
-            }
-        }
-    }
-
-    return lastKeyframe;
+    if (layerIndex < 0 || layerIndex >= m_layers.size()) return -1;
+    return static_cast<LayerData*>(m_layers[layerIndex])->spans.keyframeBefore(frame);
 }
 
 int Canvas::getNextKeyframeAfter(int frame, int layerIndex) const
 {
-    int nextKeyframe = -1;
-    auto it = m_layerKeyframes.find(layerIndex);
-    if (it != m_layerKeyframes.end()) {
-        const QSet<int>& keys = it.value();
-        for (int key : keys) {
-            if (key > frame) {
-                if (nextKeyframe == -1 || key < nextKeyframe) {
-                    nextKeyframe = key;
-                }
-            }
-        }
-    }
+    if (layerIndex < 0 || layerIndex >= m_layers.size()) return -1;
+    return static_cast<LayerData*>(m_layers[layerIndex])->spans.keyframeAfter(frame);
+}
 
-    if (m_layerFrameData.contains(layerIndex)) {
-        const auto& layerFrameData = m_layerFrameData[layerIndex];
-        for (auto iter = layerFrameData.begin(); iter != layerFrameData.end(); ++iter) {
-            if (iter.key() > frame && iter.value().type == FrameType::Keyframe) {
-                if (nextKeyframe == -1 || iter.key() < nextKeyframe) {
-                    nextKeyframe = iter.key();
-                }
-            }
-        }
+int Canvas::getLastContentFrame() const
+{
+    int lastFrame = 1;
+    for (void* layerPtr : m_layers) {
+        lastFrame = qMax(lastFrame, static_cast<LayerData*>(layerPtr)->spans.lastFrame());
     }
-
-    return nextKeyframe;
+    return lastFrame;
 }
 
 
@@ -2309,57 +2483,34 @@ void Canvas::clearCurrentFrameContent()
 {
     qDebug() << "Clearing current frame content for frame:" << m_currentFrame;
 
+    if (m_currentLayerIndex < 0 || m_currentLayerIndex >= m_layers.size()) {
+        return;
+    }
+
+    LayerData* currentLayer = static_cast<LayerData*>(m_layers[m_currentLayerIndex]);
+
     // Get items to remove from current layer only
     QList<QGraphicsItem*> itemsToRemove;
-    if (m_currentLayerIndex >= 0 && m_currentLayerIndex < m_layers.size()) {
-        LayerData* currentLayer = static_cast<LayerData*>(m_layers[m_currentLayerIndex]);
-        QList<QGraphicsItem*> currentFrameItems = currentLayer->getFrameItems(m_currentFrame);
-
-        for (QGraphicsItem* item : currentFrameItems) {
-            if (item && item != m_backgroundRect) {
-                itemsToRemove.append(item);
-            }
+    for (QGraphicsItem* item : currentLayer->getFrameItems(m_currentFrame)) {
+        if (item && item != m_backgroundRect) {
+            itemsToRemove.append(item);
         }
     }
 
-    // Remove items from scene and detach them from this frame only
-    for (QGraphicsItem* item : itemsToRemove) {
-        if (!item) {
-            continue;
-        }
+    // Empty this frame only; later frames holding the same keyframe keep it
+    currentLayer->spans.clearFrame(m_currentFrame);
 
-        if (m_scene->items().contains(item)) {
+    // Remove items from scene and delete the ones no frame references anymore
+    for (QGraphicsItem* item : itemsToRemove) {
+        if (item->scene() == m_scene) {
             m_scene->removeItem(item);
         }
 
-        detachItemFromFrame(item, m_currentFrame);
-
         if (!isValidItem(item)) {
             delete item;
         }
     }
 
-    // Clear frame data for current frame
-    auto frameDataIt = m_frameData.find(m_currentFrame);
-    if (frameDataIt != m_frameData.end()) {
-        frameDataIt->second.items.clear();
-        frameDataIt->second.itemStates.clear();
-        frameDataIt->second.type = FrameType::Empty;
-        frameDataIt->second.sourceKeyframe = -1;
-    }
-
-    // Clear from frameItems map
-    m_frameItems[m_currentFrame].clear();
-
-    // Remove from keyframes set if it was a keyframe
-    m_layerKeyframes[m_currentLayerIndex].remove(m_currentFrame);
-
-    // Update current layer data
-    if (m_currentLayerIndex >= 0 && m_currentLayerIndex < m_layers.size()) {
-        LayerData* currentLayer = static_cast<LayerData*>(m_layers[m_currentLayerIndex]);
-        currentLayer->clearFrame(m_currentFrame);
-    }
-
     emit frameChanged(m_currentFrame);
     qDebug() << "Frame content cleared successfully";
 }
@@ -2368,27 +2519,6 @@ void Canvas::removeItemFromAllFrames(QGraphicsItem* item)
 {
     if (!item) return;
 
-    // Remove from all m_frameItems entries
-    for (auto& frameEntry : m_frameItems) {
-        frameEntry.second.removeAll(item);
-    }
-
-    // Remove from all m_frameData entries
-    for (auto& frameEntry : m_frameData) {
-        frameEntry.second.items.removeAll(item);
-        frameEntry.second.itemStates.remove(item);
-    }
-
-    // Remove from layer-specific frame data structures
-    for (auto layerIt = m_layerFrameData.begin(); layerIt != m_layerFrameData.end(); ++layerIt) {
-        QHash<int, FrameData>& frameHash = layerIt.value();
-        for (auto frameIt = frameHash.begin(); frameIt != frameHash.end(); ++frameIt) {
-            FrameData& data = frameIt.value();
-            data.items.removeAll(item);
-            data.itemStates.remove(item);
-        }
-    }
-
     // Remove from all layer data
     for (int i = 0; i < m_layers.size(); ++i) {
         LayerData* layer = static_cast<LayerData*>(m_layers[i]);
@@ -2409,74 +2539,29 @@ void Canvas::detachItemFromFrame(QGraphicsItem* item, int frame)
         return;
     }
 
-    // Update legacy per-frame caches
-    auto frameItemsIt = m_frameItems.find(targetFrame);
-    if (frameItemsIt != m_frameItems.end()) {
-        frameItemsIt->second.removeAll(item);
-    }
-
-    auto frameDataIt = m_frameData.find(targetFrame);
-    if (frameDataIt != m_frameData.end()) {
-        frameDataIt->second.items.removeAll(item);
-        frameDataIt->second.itemStates.remove(item);
-    }
-
     const int layerIndex = getItemLayerIndex(item);
     if (layerIndex < 0 || layerIndex >= m_layers.size()) {
         return;
     }
 
-    // Update layer-specific frame data structures
-    if (m_layerFrameData.contains(layerIndex)) {
-        auto& frameHash = m_layerFrameData[layerIndex];
-        auto frameIt = frameHash.find(targetFrame);
-        if (frameIt != frameHash.end()) {
-            FrameData& data = frameIt.value();
-            data.items.removeAll(item);
-            data.itemStates.remove(item);
-        }
-    }
-
     LayerData* layer = static_cast<LayerData*>(m_layers[layerIndex]);
     layer->removeItemFromFrame(targetFrame, item);
 }
 
 bool Canvas::hasFrameTweening(int frame, int layerIndex) const
 {
-    if (!m_layerFrameData.contains(layerIndex)) return false;
+    if (layerIndex < 0 || layerIndex >= m_layers.size()) return false;
 
-    const auto& layerFrameData = m_layerFrameData[layerIndex];
-    auto it = layerFrameData.find(frame);
-    if (it != layerFrameData.end()) {
-        return it.value().hasTweening;
-    }
-    return false;
+    const FrameSpan* span = static_cast<LayerData*>(m_layers[layerIndex])->spans.spanAt(frame);
+    return span && span->hasTweening;
 }
 
 
 // NEW: Check if a frame is part of a tweened sequence
 bool Canvas::isFrameTweened(int frame, int layerIndex) const
 {
-    if (!m_layerFrameData.contains(layerIndex)) return false;
-
-    const auto& layerFrameData = m_layerFrameData[layerIndex];
-
-    // Check if this frame itself has tweening
-    auto it = layerFrameData.find(frame);
-    if (it != layerFrameData.end() && it.value().hasTweening) {
-        return true;
-    }
-
-    for (auto it = layerFrameData.begin(); it != layerFrameData.end(); ++it) {
-        const FrameData& frameData = it.value();
-        if (frameData.hasTweening &&
-            it.key() < frame &&
-            frame <= frameData.tweeningEndFrame) {
-            return true;
-        }
-    }
-
-    return false;
+    if (layerIndex < 0 || layerIndex >= m_layers.size()) return false;
+    return static_cast<LayerData*>(m_layers[layerIndex])->spans.isTweened(frame);
 }
 
 // NEW: Apply tweening from one keyframe to another
@@ -2491,6 +2576,10 @@ void Canvas::applyTweening(int startFrame, int endFrame, const QString& easingTy
         return;
     }
 
+    if (m_currentLayerIndex < 0 || m_currentLayerIndex >= m_layers.size()) {
+        return;
+    }
+
     // Ensure both start and end frames are keyframes on current layer
     if (!hasKeyframe(startFrame, m_currentLayerIndex)) {
         qDebug() << "Start frame" << startFrame << "is not a keyframe, creating one";
@@ -2502,26 +2591,18 @@ void Canvas::applyTweening(int startFrame, int endFrame, const QString& easingTy
         createKeyframe(endFrame);
     }
 
-    // Set tweening data on start frame for current layer
-    auto& layerFrameData = m_layerFrameData[m_currentLayerIndex];
-    auto& startFrameData = layerFrameData[startFrame];
-    startFrameData.hasTweening = true;
-    startFrameData.tweeningEndFrame = endFrame;
-    startFrameData.easingType = easingType;
+    LayerData* layer = static_cast<LayerData*>(m_layers[m_currentLayerIndex]);
 
-    // Convert all frames between start and end to extended frames with tweening
-    for (int frame = startFrame + 1; frame < endFrame; frame++) {
-        auto& frameData = layerFrameData[frame];
-        frameData.type = FrameType::ExtendedFrame;
-        frameData.sourceKeyframe = startFrame;
-        frameData.hasTweening = true;
-        frameData.tweeningEndFrame = endFrame;
-        frameData.easingType = easingType;
+    // Keyframes between start and end are replaced by the in-betweens
+    layer->spans.takeRange(startFrame + 1, endFrame - 1);
 
-        // Clear any existing items in intermediate frames for this layer
-        frameData.items.clear();
-        frameData.itemStates.clear();
-    }
+    // The start keyframe holds through every in-between frame
+    FrameSpan* startSpan = layer->spans.spanStartingAt(startFrame);
+    startSpan->lastFrame = endFrame - 1;
+    startSpan->hasTweening = true;
+    startSpan->tweeningEndFrame = endFrame;
+    startSpan->easingType = easingType;
+    layer->spans.touch(*startSpan);
 
     emit tweeningApplied(startFrame, endFrame);
     qDebug() << "Tweening applied successfully on layer" << m_currentLayerIndex;
@@ -2530,30 +2611,21 @@ void Canvas::applyTweening(int startFrame, int endFrame, const QString& easingTy
 // NEW: Remove tweening from a frame span
 void Canvas::removeTweening(int startFrame)
 {
-    auto& layerFrameData = m_layerFrameData[m_currentLayerIndex];
-    auto it = layerFrameData.find(startFrame);
-    if (it == layerFrameData.end() || !it.value().hasTweening) {
+    if (m_currentLayerIndex < 0 || m_currentLayerIndex >= m_layers.size()) {
         return;
     }
 
-    int endFrame = it.value().tweeningEndFrame;
-    qDebug() << "Removing tweening from frame" << startFrame << "to" << endFrame;
+    LayerData* layer = static_cast<LayerData*>(m_layers[m_currentLayerIndex]);
+    FrameSpan* span = layer->spans.spanStartingAt(startFrame);
+    if (!span || !span->hasTweening) {
+        return;
+    }
 
-    // Remove tweening from start frame
-    it.value().hasTweening = false;
-    it.value().tweeningEndFrame = -1;
-    it.value().easingType = "linear";
+    qDebug() << "Removing tweening from frame" << startFrame << "to" << span->tweeningEndFrame;
 
-    // Convert intermediate frames back to regular extended frames
-    for (int frame = startFrame + 1; frame < endFrame; frame++) {
-        auto frameIt = layerFrameData.find(frame);
-        if (frameIt != layerFrameData.end()) {
-            frameIt.value().hasTweening = false;
-            frameIt.value().tweeningEndFrame = -1;
-            frameIt.value().easingType = "linear";
-            // Keep them as extended frames but without tweening
-        }
-    }
+    // Intermediate frames stay as regular extended frames of the start keyframe
+    FrameSpanIndex::clearTweening(*span);
+    layer->spans.touch(*span);
 
     emit tweeningRemoved(startFrame);
 }
@@ -2579,15 +2651,12 @@ bool Canvas::canDrawOnCurrentFrame() const
     }
 
     // Allow drawing on the END frame of a tweening sequence
-    if (!m_layerFrameData.contains(m_currentLayerIndex)) return false;
-
-    const auto& layerFrameData = m_layerFrameData[m_currentLayerIndex];
-    for (auto it = layerFrameData.begin(); it != layerFrameData.end(); ++it) {
-        const FrameData& frameData = it.value();
-        if (frameData.hasTweening && frameData.tweeningEndFrame == m_currentFrame) {
-            return true;  // This is an end frame of tweening, allow drawing
-        }
+    const int previousKeyframe = getLastKeyframeBefore(m_currentFrame, m_currentLayerIndex);
+    if (frameType == FrameType::Keyframe && previousKeyframe != -1 &&
+        getTweeningEndFrame(previousKeyframe, m_currentLayerIndex) == m_currentFrame) {
+        return true;
     }
+
     // Disallow drawing on tweened intermediate frames
     return false;
 }
@@ -2595,26 +2664,21 @@ bool Canvas::canDrawOnCurrentFrame() const
 // NEW: Get easing type for a frame
 QString Canvas::getFrameTweeningEasing(int frame, int layerIndex) const
 {
-    if (!m_layerFrameData.contains(layerIndex)) return "linear";
+    if (layerIndex < 0 || layerIndex >= m_layers.size()) return "linear";
 
-    const auto& layerFrameData = m_layerFrameData[layerIndex];
-    auto it = layerFrameData.find(frame);
-    if (it != layerFrameData.end()) {
-        return it.value().easingType;
-    }
-    return "linear";
+    const FrameSpan* span = static_cast<LayerData*>(m_layers[layerIndex])->spans.spanAt(frame);
+    return span ? span->easingType : QString("linear");
 }
 
 
 // NEW: Get the end frame of tweening for a start frame
 int Canvas::getTweeningEndFrame(int frame, int layerIndex) const
 {
-    if (!m_layerFrameData.contains(layerIndex)) return -1;
+    if (layerIndex < 0 || layerIndex >= m_layers.size()) return -1;
 
-    const auto& layerFrameData = m_layerFrameData[layerIndex];
-    auto it = layerFrameData.find(frame);
-    if (it != layerFrameData.end() && it.value().hasTweening) {
-        return it.value().tweeningEndFrame;
+    const FrameSpan* span = static_cast<LayerData*>(m_layers[layerIndex])->spans.spanAt(frame);
+    if (span && span->hasTweening) {
+        return span->tweeningEndFrame;
     }
     return -1;
 }
@@ -2648,96 +2712,56 @@ void Canvas::convertCurrentExtendedFrameToKeyframe()
     if (getFrameType(m_currentFrame) != FrameType::ExtendedFrame) {
         return;
     }
+    if (m_currentLayerIndex < 0 || m_currentLayerIndex >= m_layers.size()) {
+        return;
+    }
 
     int sourceFrame = getSourceKeyframe(m_currentFrame);
     qDebug() << "Converting extended frame" << m_currentFrame << "to keyframe, source:" << sourceFrame;
 
-    // Get current scene items that will be transformed
-    QList<QGraphicsItem*> originalSceneItems;
-    for (QGraphicsItem* item : scene()->items()) {
-        if (item != m_backgroundRect && getItemLayerIndex(item) == m_currentLayerIndex) {
-            originalSceneItems.append(item);
-        }
-    }
-
-    // CRITICAL: Find ALL frames that reference these same objects
-    QList<int> framesToUpdate;
-    for (const auto& pair : m_frameData) {
-        int frame = pair.first;
-        const FrameData& frameData = pair.second;
-
-        // Check if this frame references any of the original objects
-        for (QGraphicsItem* originalItem : originalSceneItems) {
-            if (frameData.items.contains(originalItem)) {
-                framesToUpdate.append(frame);
-                break;
-            }
-        }
-    }
-
-    qDebug() << "Frames sharing objects:" << framesToUpdate;
-
-    // Create independent copies for each frame that shares objects
-    for (int frame : framesToUpdate) {
-        QList<QGraphicsItem*> independentCopies;
-
-        for (QGraphicsItem* originalItem : originalSceneItems) {
-            QGraphicsItem* copy = cloneGraphicsItem(originalItem);
-            if (copy) {
-                independentCopies.append(copy);
-            }
+    LayerData* layer = static_cast<LayerData*>(m_layers[m_currentLayerIndex]);
+    const QList<QGraphicsItem*> sharedItems = layer->getFrameItems(m_currentFrame);
+
+    // CRITICAL: The new keyframe gets independent copies so edits made here
+    // don't leak back into the source keyframe it was holding
+    QList<QGraphicsItem*> independentCopies;
+    m_suppressFrameConversion = true;
+    for (QGraphicsItem* originalItem : sharedItems) {
+        if (!originalItem) continue;
+        if (originalItem == m_backgroundRect) {
+            independentCopies.append(originalItem);
+            continue;
         }
 
-        // Update frame data with independent copies
-        m_frameData[frame].items = independentCopies;
-        m_frameItems[frame] = independentCopies;
-
-        qDebug() << "Created" << independentCopies.size() << "independent copies for frame" << frame;
-    }
-
-    // Remove ALL original shared objects from scene
-    for (QGraphicsItem* item : originalSceneItems) {
-        scene()->removeItem(item);
-    }
+        QGraphicsItem* copy = cloneGraphicsItem(originalItem);
+        if (!copy) continue;
+        copy->setData(0, originalItem->data(0));
+        independentCopies.append(copy);
 
-    // Add the independent copies for current frame to scene
-    if (framesToUpdate.contains(m_currentFrame)) {
-        auto& currentFrameData = m_frameData[m_currentFrame];
-        for (QGraphicsItem* item : currentFrameData.items) {
-            scene()->addItem(item);
+        // Swap the shared object in the scene for its copy
+        if (originalItem->scene() == m_scene) {
+            const bool wasSelected = originalItem->isSelected();
+            m_scene->removeItem(originalItem);
+            m_scene->addItem(copy);
+            copy->setSelected(wasSelected);
         }
     }
+    m_suppressFrameConversion = false;
 
-    // Convert current frame to keyframe
-    auto& frameData = m_frameData[m_currentFrame];
-    frameData.type = FrameType::Keyframe;
-    frameData.sourceKeyframe = -1;
-    m_layerKeyframes[m_currentLayerIndex].insert(m_currentFrame);
+    FrameSpan& span = layer->spans.insertKeyframe(m_currentFrame);
+    layer->spans.setItems(span, independentCopies);
 
-    qDebug() << "Converted frame" << m_currentFrame << "to independent keyframe";
+    qDebug() << "Converted frame" << m_currentFrame << "to independent keyframe with"
+        << independentCopies.size() << "items";
     emit frameChanged(m_currentFrame);
 }
 
 void Canvas::saveStateAfterTransform()
 {
     // Force save current frame state
-    QList<QGraphicsItem*> currentItems;
-    for (QGraphicsItem* item : scene()->items()) {
-        if (item != m_backgroundRect && getItemLayerIndex(item) == m_currentLayerIndex) {
-            currentItems.append(item);
-        }
-    }
-
-    auto& frameData = m_frameData[m_currentFrame];
-    frameData.items = currentItems;
-    m_frameItems[m_currentFrame] = currentItems;
-
-    if (frameData.type != FrameType::ExtendedFrame) {
-        frameData.type = FrameType::Keyframe;
-        m_layerKeyframes[m_currentLayerIndex].insert(m_currentFrame);
-    }
+    storeCurrentFrameState();
 
-    qDebug() << "Force saved state for frame" << m_currentFrame << "with" << currentItems.size() << "items";
+    qDebug() << "Force saved state for frame" << m_currentFrame;
 }
 
 void Canvas::setBackgroundColor(const QColor& color) {
@@ -2745,6 +2769,11 @@ void Canvas::setBackgroundColor(const QColor& color) {
     if (m_backgroundRect) {
         m_backgroundRect->setBrush(QBrush(color));
     }
+    markStructureChanged();
+    if (m_staticLayerCaching) {
+        invalidateLayerComposites();
+        updateLayerComposites(m_currentFrame);
+    }
 }
 
 QList<QGraphicsItem*> Canvas::duplicateItems(const QList<QGraphicsItem*>& items) {
@@ -2778,40 +2807,31 @@ void Canvas::ensureObjectIndependence(QGraphicsItem* item)
 
     // If we're on a keyframe, ensure this item is unique to this frame
     if (frameType == FrameType::Keyframe) {
-        // Check if this item appears in other frames
-        bool itemSharedWithOtherFrames = false;
-
-        for (const auto& pair : m_frameData) {
-            int frame = pair.first;
-            const FrameData& frameData = pair.second;
-
-            if (frame != m_currentFrame && frameData.items.contains(item)) {
-                itemSharedWithOtherFrames = true;
-                break;
-            }
+        LayerData* layer = static_cast<LayerData*>(m_layers[m_currentLayerIndex]);
+        FrameSpan* currentSpan = layer->spans.spanStartingAt(m_currentFrame);
+        if (!currentSpan || !currentSpan->items.contains(item)) {
+            return;
         }
 
+        // Check if this item appears in other frames
+        const bool itemSharedWithOtherFrames = layer->spans.refCount(item) > 1;
+
         if (itemSharedWithOtherFrames) {
             // Create a new independent copy for this frame
             QGraphicsItem* independentCopy = cloneGraphicsItem(item);
             if (independentCopy) {
-                // Replace the shared item with the independent copy
-                auto& currentFrameData = m_frameData[m_currentFrame];
-                int itemIndex = currentFrameData.items.indexOf(item);
-                if (itemIndex >= 0) {
-                    currentFrameData.items[itemIndex] = independentCopy;
-                    m_frameItems[m_currentFrame][itemIndex] = independentCopy;
-
-                    // Replace in scene
-                    m_scene->removeItem(item);
-                    m_scene->addItem(independentCopy);
+                independentCopy->setData(0, item->data(0));
 
-                    // Transfer selection state
-                    if (item->isSelected()) {
-                        independentCopy->setSelected(true);
-                        item->setSelected(false);
-                    }
-                }
+                // Replace the shared item with the independent copy
+                layer->spans.replaceItem(*currentSpan, item, independentCopy);
+
+                // Replace in scene
+                const bool wasSelected = item->isSelected();
+                m_suppressFrameConversion = true;
+                m_scene->removeItem(item);
+                m_scene->addItem(independentCopy);
+                independentCopy->setSelected(wasSelected);
+                m_suppressFrameConversion = false;
             }
         }
     }
@@ -2832,36 +2852,14 @@ void Canvas::onDrawingStarted()
 }
 
 
-// Also add the global cleanup method (calls all layers)
-void Canvas::cleanupInterpolatedItems()
-{
-    for (int layerIndex = 0; layerIndex < m_layers.size(); ++layerIndex) {
-        cleanupInterpolatedItems(layerIndex);
-    }
-
-    // Also clean up legacy interpolated items
-    for (QGraphicsItem* item : m_interpolatedItems) {
-        if (item && scene()->items().contains(item)) {
-            scene()->removeItem(item);
-            delete item;
-        }
-    }
-    m_interpolatedItems.clear();
-    m_isShowingInterpolatedFrame = false;
-}
-
 QList<QGraphicsItem*> Canvas::getFrameItems(int frame) const
 {
     QList<QGraphicsItem*> allFrameItems;
 
     // Combine items from all layers for this frame
     for (int layerIndex = 0; layerIndex < m_layers.size(); ++layerIndex) {
-        if (m_layerFrameData.contains(layerIndex)) {
-            const auto& layerFrameData = m_layerFrameData[layerIndex];
-            if (layerFrameData.contains(frame)) {
-                allFrameItems.append(layerFrameData[frame].items);
-            }
-        }
+        LayerData* layer = static_cast<LayerData*>(m_layers[layerIndex]);
+        allFrameItems.append(layer->getFrameItems(frame));
     }
 
     return allFrameItems;
@@ -2873,29 +2871,24 @@ QList<QGraphicsItem*> Canvas::getLayerFrameItems(int layerIndex, int frame) cons
         return QList<QGraphicsItem*>();
     }
 
-    if (!m_layerFrameData.contains(layerIndex)) {
-        return QList<QGraphicsItem*>();
-    }
-
-    const auto& layerFrameData = m_layerFrameData[layerIndex];
-    auto it = layerFrameData.find(frame);
-    if (it == layerFrameData.end()) {
-        return QList<QGraphicsItem*>();
-    }
-
-    return it.value().items;
+    return static_cast<LayerData*>(m_layers[layerIndex])->getFrameItems(frame);
 }
 
 
 QImage Canvas::renderFlattenedFrame(int frame, const QVector<int>& layerIndices) const
+{
+    return captureFrameSnapshot(frame, layerIndices).render();
+}
+
+FrameSnapshot Canvas::captureFrameSnapshot(int frame, const QVector<int>& layerIndices, bool includeBackground) const
 {
     if (frame < 1) {
-        return QImage();
+        return FrameSnapshot();
     }
 
     const QSize canvasSize = m_canvasSize;
     if (!canvasSize.isValid() || canvasSize.isEmpty()) {
-        return QImage();
+        return FrameSnapshot();
     }
 
     QVector<int> indices = layerIndices;
@@ -2909,9 +2902,7 @@ QImage Canvas::renderFlattenedFrame(int frame, const QVector<int>& layerIndices)
     std::sort(indices.begin(), indices.end());
     indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
 
-    QGraphicsScene tempScene;
-    tempScene.setSceneRect(QRectF(QPointF(0, 0), QSizeF(canvasSize)));
-
+    FrameSnapshot snapshot(canvasSize);
     for (int layerIndex : indices) {
         if (layerIndex < 0 || layerIndex >= m_layers.size()) {
             continue;
@@ -2922,72 +2913,124 @@ QImage Canvas::renderFlattenedFrame(int frame, const QVector<int>& layerIndices)
             continue;
         }
 
-        const double layerOpacity = qBound(0.0, layer->opacity, 1.0);
-        const QList<QGraphicsItem*> items = layer->getFrameItems(frame);
+        appendLayerToSnapshot(snapshot, frame, layerIndex, qBound(0.0, layer->opacity, 1.0), includeBackground);
+    }
 
-        int order = 0;
-        for (QGraphicsItem* item : items) {
-            if (!item || !isValidItem(item)) {
-                continue;
-            }
+    return snapshot;
+}
 
-            QGraphicsItem* clone = cloneGraphicsItem(item);
-            if (!clone) {
-                continue;
-            }
+bool Canvas::isHoldFrame(int frame) const
+{
+    if (frame <= 1) {
+        return false;
+    }
 
-            double individualOpacity = item->data(0).toDouble();
-            if (qFuzzyIsNull(individualOpacity)) {
-                individualOpacity = 1.0;
-            }
+    for (int layerIndex = 0; layerIndex < m_layers.size(); ++layerIndex) {
+        const LayerData* layer = static_cast<const LayerData*>(m_layers[layerIndex]);
+        if (!layer || !layer->visible || layer->opacity <= 0.0) {
+            continue;
+        }
+
+        // Empty frames have no source keyframe, so empty follows empty
+        if (layer->spans.sourceKeyframe(frame) != layer->spans.sourceKeyframe(frame - 1)) {
+            return false;
+        }
 
-            clone->setOpacity(individualOpacity * layerOpacity);
-            clone->setVisible(true);
-            clone->setFlag(QGraphicsItem::ItemIsSelectable, false);
-            clone->setFlag(QGraphicsItem::ItemIsMovable, false);
-            clone->setAcceptedMouseButtons(Qt::NoButton);
-            clone->setZValue(layerIndex * 1000 + order++);
-            tempScene.addItem(clone);
+        int tweenStart = -1;
+        int tweenEnd = -1;
+        float t = 0.0f;
+        if (tweenProgress(frame, layerIndex, tweenStart, tweenEnd, t)) {
+            return false;
         }
     }
+    return true;
+}
 
-    QImage flattened(canvasSize, QImage::Format_ARGB32_Premultiplied);
-    flattened.fill(Qt::transparent);
+// An item's own opacity, kept in data(0) apart from its layer's
+static double individualOpacity(const QGraphicsItem* item)
+{
+    const double opacity = item->data(0).toDouble();
+    return qFuzzyIsNull(opacity) ? 1.0 : opacity;
+}
 
-    QPainter painter(&flattened);
-    painter.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform, true);
-    tempScene.render(&painter, QRectF(QPointF(0, 0), QSizeF(canvasSize)),
-                     QRectF(QPointF(0, 0), QSizeF(canvasSize)));
-    painter.end();
+// Adds one layer's content at frame to the snapshot, scaled by opacity
+void Canvas::appendLayerToSnapshot(FrameSnapshot& snapshot, int frame, int layerIndex,
+                                   double opacity, bool includeBackground) const
+{
+    LayerData* layer = static_cast<LayerData*>(m_layers[layerIndex]);
 
-    return flattened;
-}
+    // In-betweens of a tween are rendered like the live canvas shows them
+    int tweenStart = -1;
+    int tweenEnd = -1;
+    float t = 0.0f;
+    if (tweenProgress(frame, layerIndex, tweenStart, tweenEnd, t)) {
+        const QList<QGraphicsItem*> startItems = layer->getFrameItems(tweenStart);
+        const QList<QGraphicsItem*> endItems = layer->getFrameItems(tweenEnd);
+        for (int i = 0; i < qMin(startItems.size(), endItems.size()); ++i) {
+            if (!startItems[i] || !endItems[i]) {
+                continue;
+            }
+            if (!includeBackground && startItems[i] == m_backgroundRect) {
+                continue;
+            }
+
+            // The items' on-stage opacity is only current for items shown
+            // since the last layer change, so blend their own opacities
+            const TweenPose pose = tweenPose(startItems[i], endItems[i], t);
+            const double startOpacity = individualOpacity(startItems[i]);
+            const double itemOpacity = startOpacity + t * (individualOpacity(endItems[i]) - startOpacity);
+            snapshot.addItem(startItems[i], pose.sceneTransform(), itemOpacity * opacity, pose.blurRadius);
+        }
+        return;
+    }
 
+    // Items are added in their layer order, matching z = layer * 1000 + order
+    const QList<QGraphicsItem*> items = layer->getFrameItems(frame);
+    for (QGraphicsItem* item : items) {
+        if (!item || !isValidItem(item)) {
+            continue;
+        }
+        if (!includeBackground && item == m_backgroundRect) {
+            continue;
+        }
 
-void Canvas::updateGlobalFrameItems(int frame)
-{
-    m_frameItems[frame] = getFrameItems(frame);
+        qreal blurRadius = 0.0;
+        if (auto blur = dynamic_cast<QGraphicsBlurEffect*>(item->graphicsEffect())) {
+            blurRadius = blur->blurRadius();
+        }
+
+        snapshot.addItem(item, item->sceneTransform(), individualOpacity(item) * opacity, blurRadius);
+    }
 }
 
 
 std::optional<FrameData> Canvas::getFrameData(int frame) const
 {
-    auto it = m_frameData.find(frame);
-    if (it != m_frameData.end()) {
-        return it->second;
+    if (m_currentLayerIndex < 0 || m_currentLayerIndex >= m_layers.size()) {
+        return std::nullopt;
     }
 
-    // Check if frame has items in compatibility layer
-    auto itemsIt = m_frameItems.find(frame);
-    if (itemsIt != m_frameItems.end() && !itemsIt->second.isEmpty()) {
-        FrameData data;
-        data.items = itemsIt->second;
-        data.type = hasKeyframe(frame) ? FrameType::Keyframe : FrameType::ExtendedFrame;
-        data.sourceKeyframe = (data.type == FrameType::ExtendedFrame) ? getSourceKeyframe(frame) : -1;
-        return data;
+    LayerData* layer = static_cast<LayerData*>(m_layers[m_currentLayerIndex]);
+    const FrameSpan* span = layer->spans.spanAt(frame);
+    if (!span) {
+        return std::nullopt;
     }
 
-    return std::nullopt;
+    return frameDataFromSpan(*span, frame);
+}
+
+FrameData Canvas::frameDataFromSpan(const FrameSpan& span, int frame) const
+{
+    FrameData data;
+    data.type = span.keyframe == frame ? FrameType::Keyframe : FrameType::ExtendedFrame;
+    data.sourceKeyframe = data.type == FrameType::ExtendedFrame ? span.keyframe : -1;
+    data.items = span.items;
+    data.itemStates = span.itemStates;
+    data.lastFrame = span.lastFrame;
+    data.hasTweening = span.hasTweening;
+    data.tweeningEndFrame = span.tweeningEndFrame;
+    data.easingType = span.easingType;
+    return data;
 }
 
 double Canvas::getLayerOpacity(int index) const
@@ -3004,46 +3047,53 @@ double Canvas::getLayerOpacity(int index) const
 FrameData Canvas::exportFrameData(int layerIndex, int frame)
 {
     FrameData result;
-    auto layerIt = m_layerFrameData.find(layerIndex);
-    if (layerIt != m_layerFrameData.end()) {
-        auto frameIt = layerIt->find(frame);
-        if (frameIt != layerIt->end()) {
-            const FrameData& existing = frameIt.value();
-            result = existing;
-            result.items = duplicateItems(existing.items);
-        }
+    if (layerIndex < 0 || layerIndex >= m_layers.size()) {
+        return result;
+    }
+
+    LayerData* layer = static_cast<LayerData*>(m_layers[layerIndex]);
+    const FrameSpan* span = layer->spans.spanAt(frame);
+    if (!span) {
+        return result;
+    }
+
+    result = frameDataFromSpan(*span, frame);
+    result.itemStates.clear();
+    if (result.type == FrameType::Keyframe) {
+        result.items = duplicateItems(span->items);
+    }
+    else {
+        // Held frames own no content; the keyframe keeps it
+        result.items.clear();
     }
     return result;
 }
 
 void Canvas::removeKeyframe(int layerIndex, int frame)
 {
-    auto layerIt = m_layerFrameData.find(layerIndex);
-    if (layerIt != m_layerFrameData.end()) {
-        auto frameIt = layerIt->find(frame);
-        if (frameIt != layerIt->end()) {
-            const QList<QGraphicsItem*> itemsToRemove = frameIt.value().items;
-            for (QGraphicsItem* item : itemsToRemove) {
-                if (!item) {
-                    continue;
-                }
+    if (layerIndex < 0 || layerIndex >= m_layers.size()) {
+        return;
+    }
 
-                if (item->scene()) {
-                    m_scene->removeItem(item);
-                }
+    LayerData* layer = static_cast<LayerData*>(m_layers[layerIndex]);
+    FrameSpan removed;
+    if (!layer->spans.take(frame, &removed)) {
+        // Removing a held frame only shortens its keyframe's exposure
+        layer->spans.clearFrame(frame);
+        return;
+    }
 
-                removeItemFromAllFrames(item);
-                delete item;
-            }
-            layerIt->remove(frame);
+    for (QGraphicsItem* item : removed.items) {
+        if (!item || item == m_backgroundRect || layer->containsItem(item)) {
+            continue;
         }
-    }
 
-    m_layerKeyframes[layerIndex].remove(frame);
+        if (item->scene()) {
+            m_scene->removeItem(item);
+        }
 
-    if (layerIndex >= 0 && layerIndex < m_layers.size()) {
-        LayerData* layer = static_cast<LayerData*>(m_layers[layerIndex]);
-        layer->clearFrame(frame);
+        removeItemFromAllFrames(item);
+        delete item;
     }
 }
 
@@ -3051,75 +3101,32 @@ void Canvas::importFrameData(int layerIndex, int frame, const FrameData& data)
 {
     removeKeyframe(layerIndex, frame);
 
-    FrameData copy = data;
-    copy.items = duplicateItems(data.items);
-
-    for (QGraphicsItem* item : copy.items) {
-        if (item && !item->scene())
-            m_scene->addItem(item);
-    }
-
-    m_layerFrameData[layerIndex][frame] = copy;
-
-    if (layerIndex >= 0 && layerIndex < m_layers.size()) {
-        LayerData* layer = static_cast<LayerData*>(m_layers[layerIndex]);
-        layer->setFrameItems(frame, copy.items);
+    if (layerIndex < 0 || layerIndex >= m_layers.size()) {
+        return;
     }
 
-    if (copy.type == FrameType::Keyframe)
-        m_layerKeyframes[layerIndex].insert(frame);
-}
-
-QJsonObject Canvas::serializeBrush(const QBrush& brush) const
-{
-    QJsonObject obj;
-    obj["style"] = static_cast<int>(brush.style());
-    if (brush.style() == Qt::SolidPattern) {
-        obj["color"] = brush.color().name();
+    LayerData* layer = static_cast<LayerData*>(m_layers[layerIndex]);
+    if (data.type == FrameType::Keyframe) {
+        FrameSpan& span = layer->spans.insertKeyframe(frame);
+        layer->spans.setItems(span, duplicateItems(data.items));
+        span.hasTweening = data.hasTweening;
+        span.tweeningEndFrame = data.tweeningEndFrame;
+        span.easingType = data.easingType;
+        layer->spans.extendSpan(frame, data.lastFrame);
     }
-    else if (brush.style() == Qt::LinearGradientPattern ||
-        brush.style() == Qt::RadialGradientPattern ||
-        brush.style() == Qt::ConicalGradientPattern) {
-        const QGradient* grad = brush.gradient();
-        if (grad) {
-            obj["type"] = static_cast<int>(grad->type());
-            obj["spread"] = static_cast<int>(grad->spread());
-            QJsonArray stops;
-            for (const auto& stop : grad->stops()) {
-                QJsonObject s;
-                s["pos"] = stop.first;
-                s["color"] = stop.second.name();
-                stops.append(s);
-            }
-            obj["stops"] = stops;
-
-            if (grad->type() == QGradient::LinearGradient) {
-                const QLinearGradient* lg = static_cast<const QLinearGradient*>(grad);
-                obj["startX"] = lg->start().x();
-                obj["startY"] = lg->start().y();
-                obj["endX"] = lg->finalStop().x();
-                obj["endY"] = lg->finalStop().y();
-            }
-            else if (grad->type() == QGradient::RadialGradient) {
-                const QRadialGradient* rg = static_cast<const QRadialGradient*>(grad);
-                obj["centerX"] = rg->center().x();
-                obj["centerY"] = rg->center().y();
-                obj["focalX"] = rg->focalPoint().x();
-                obj["focalY"] = rg->focalPoint().y();
-                obj["radius"] = rg->radius();
-            }
-            else if (grad->type() == QGradient::ConicalGradient) {
-                const QConicalGradient* cg = static_cast<const QConicalGradient*>(grad);
-                obj["centerX"] = cg->center().x();
-                obj["centerY"] = cg->center().y();
-                obj["angle"] = cg->angle();
-            }
+    else if (data.type == FrameType::ExtendedFrame) {
+        int source = data.sourceKeyframe;
+        if (!layer->spans.hasKeyframe(source)) {
+            source = layer->spans.keyframeBefore(frame);
+        }
+        if (source != -1) {
+            layer->spans.extendSpan(source, qMax(frame, data.lastFrame));
         }
     }
-    else if (brush.style() != Qt::NoBrush) {
-        obj["color"] = brush.color().name();
+
+    if (frame == m_currentFrame) {
+        loadFrameState(m_currentFrame);
     }
-    return obj;
 }
 
 QBrush Canvas::deserializeBrush(const QJsonObject& obj) const
@@ -3169,145 +3176,7 @@ QBrush Canvas::deserializeBrush(const QJsonObject& obj) const
     return QBrush();
 }
 
-QJsonObject Canvas::serializeGraphicsItem(QGraphicsItem* item) const
-{
-    QJsonObject json;
-    if (!item)
-        return json;
-
-    if (auto rectItem = qgraphicsitem_cast<QGraphicsRectItem*>(item)) {
-        json["class"] = "rect";
-        QRectF r = rectItem->rect();
-        json["x"] = r.x();
-        json["y"] = r.y();
-        json["w"] = r.width();
-        json["h"] = r.height();
-
-        QPen pen = rectItem->pen();
-        json["penColor"] = pen.color().name();
-        json["penWidth"] = pen.widthF();
-        json["penStyle"] = static_cast<int>(pen.style());
-
-        json["brush"] = serializeBrush(rectItem->brush());
-        if (item == m_backgroundRect) {
-            json["isBackground"] = true;
-        }
-    }
-    else if (auto ellipseItem = qgraphicsitem_cast<QGraphicsEllipseItem*>(item)) {
-        json["class"] = "ellipse";
-        QRectF r = ellipseItem->rect();
-        json["x"] = r.x();
-        json["y"] = r.y();
-        json["w"] = r.width();
-        json["h"] = r.height();
-
-        QPen pen = ellipseItem->pen();
-        json["penColor"] = pen.color().name();
-        json["penWidth"] = pen.widthF();
-        json["penStyle"] = static_cast<int>(pen.style());
-        json["brush"] = serializeBrush(ellipseItem->brush());
-    }
-    else if (auto lineItem = qgraphicsitem_cast<QGraphicsLineItem*>(item)) {
-        json["class"] = "line";
-        QLineF l = lineItem->line();
-        json["x1"] = l.x1();
-        json["y1"] = l.y1();
-        json["x2"] = l.x2();
-        json["y2"] = l.y2();
-
-        QPen pen = lineItem->pen();
-        json["penColor"] = pen.color().name();
-        json["penWidth"] = pen.widthF();
-        json["penStyle"] = static_cast<int>(pen.style());
-    }
-    else if (auto pathItem = qgraphicsitem_cast<QGraphicsPathItem*>(item)) {
-        json["class"] = "path";
-        QPainterPath path = pathItem->path();
-        QJsonArray points;
-        for (int i = 0; i < path.elementCount(); ++i) {
-            QPainterPath::Element e = path.elementAt(i);
-            QJsonObject p; p["x"] = e.x; p["y"] = e.y; points.append(p);
-        }
-        json["points"] = points;
-
-        QPen pen = pathItem->pen();
-        json["penColor"] = pen.color().name();
-        json["penWidth"] = pen.widthF();
-        json["penStyle"] = static_cast<int>(pen.style());
-        json["brush"] = serializeBrush(pathItem->brush());
-    }
-    else if (auto pixmapItem = qgraphicsitem_cast<QGraphicsPixmapItem*>(item)) {
-        json["class"] = "pixmap";
-        QPixmap pix = pixmapItem->pixmap();
-        QByteArray bytes;
-        QBuffer buffer(&bytes);
-        buffer.open(QIODevice::WriteOnly);
-        pix.save(&buffer, "PNG");
-        json["data"] = QString::fromLatin1(bytes.toBase64());
-
-        const QVariant sessionVariant = pixmapItem->data(GraphicsItemRoles::RasterSessionIdRole);
-        if (sessionVariant.isValid()) {
-            json["rasterSessionId"] = sessionVariant.toString();
-        }
-
-        const QVariant frameVariant = pixmapItem->data(GraphicsItemRoles::RasterFrameIndexRole);
-        if (frameVariant.isValid()) {
-            json["rasterFrameIndex"] = frameVariant.toInt();
-        }
-
-        const QVariant documentVariant = pixmapItem->data(GraphicsItemRoles::RasterDocumentJsonRole);
-        if (documentVariant.isValid()) {
-            QByteArray raw = documentVariant.canConvert<QByteArray>()
-                ? documentVariant.toByteArray()
-                : documentVariant.toString().toUtf8();
-
-            if (!raw.isEmpty()) {
-                QJsonParseError error{};
-                QJsonDocument doc = QJsonDocument::fromJson(raw, &error);
-                if (error.error == QJsonParseError::NoError && doc.isObject()) {
-                    json["rasterDocument"] = doc.object();
-                }
-                else {
-                    json["rasterDocumentRaw"] = QString::fromLatin1(raw.toBase64());
-                }
-            }
-        }
-    }
-    else if (auto textItem = qgraphicsitem_cast<QGraphicsTextItem*>(item)) {
-        json["class"] = "text";
-        json["text"] = textItem->toPlainText();
-        QFont f = textItem->font();
-        json["fontFamily"] = f.family();
-        json["fontPointSize"] = f.pointSizeF();
-        json["fontBold"] = f.bold();
-        json["fontItalic"] = f.italic();
-        json["fontUnderline"] = f.underline();
-        json["color"] = textItem->defaultTextColor().name();
-    }
-
-    json["posX"] = item->pos().x();
-    json["posY"] = item->pos().y();
-    json["originX"] = item->transformOriginPoint().x();
-    json["originY"] = item->transformOriginPoint().y();
-    json["rotation"] = item->rotation();
-    json["scaleX"] = item->transform().m11();
-    json["scaleY"] = item->transform().m22();
-    // Store per-item opacity rather than the opacity already multiplied by
-    // the layer opacity. The original opacity is kept in item->data(0).
-    double baseOpacity = item->data(0).isValid() ? item->data(0).toDouble() : item->opacity();
-    json["opacity"] = baseOpacity;
-    json["zValue"] = item->zValue();
-    json["visible"] = item->isVisible();
-    if (auto blur = dynamic_cast<QGraphicsBlurEffect*>(item->graphicsEffect())) {
-        json["blur"] = blur->blurRadius();
-    }
-    else {
-        json["blur"] = 0.0;
-    }
-    return json;
-}
-
-QGraphicsItem* Canvas::deserializeGraphicsItem(const QJsonObject& json) const
+QGraphicsItem* Canvas::deserializeGraphicsItem(const QJsonObject& json)
 {
     QString cls = json["class"].toString();
     QGraphicsItem* item = nullptr;
@@ -3365,10 +3234,19 @@ QGraphicsItem* Canvas::deserializeGraphicsItem(const QJsonObject& json) const
         item = pathItem;
     }
     else if (cls == "pixmap") {
-        QByteArray bytes = QByteArray::fromBase64(json["data"].toString().toLatin1());
-        QPixmap pix;
-        pix.loadFromData(bytes, "PNG");
-        auto pixItem = new QGraphicsPixmapItem(pix);
+        QString hash = json["asset"].toString();
+        if (hash.isEmpty()) {
+            // Projects from before the asset table inline the PNG on every
+            // item; identical ones still end up sharing one pixmap
+            const QByteArray bytes = QByteArray::fromBase64(json["data"].toString().toLatin1());
+            hash = pixmapAssetHash(bytes);
+            m_pixmapAssets.insert(hash, bytes);
+        }
+        auto pixItem = new QGraphicsPixmapItem(m_pixmapAssets.pixmap(hash));
+        const QByteArray png = m_pixmapAssets.png(hash);
+        if (!png.isEmpty()) {
+            rememberPixmapAsset(pixItem, PixmapAsset{ hash, png });
+        }
         pixItem->setTransformationMode(Qt::SmoothTransformation);
         pixItem->setFlag(QGraphicsItem::ItemIsSelectable, true);
         pixItem->setFlag(QGraphicsItem::ItemIsMovable, true);
@@ -3418,25 +3296,18 @@ QGraphicsItem* Canvas::deserializeGraphicsItem(const QJsonObject& json) const
             item->setData(GraphicsItemRoles::RasterFrameIndexRole, json.value("rasterFrameIndex").toInt());
         }
 
-        if (json.contains("rasterDocument")) {
-            QJsonObject docObject = json.value("rasterDocument").toObject();
-            if (!docObject.isEmpty()) {
-                QJsonDocument doc(docObject);
-                item->setData(GraphicsItemRoles::RasterDocumentJsonRole, doc.toJson(QJsonDocument::Compact));
-            }
-        }
-        else if (json.contains("rasterDocumentRaw")) {
-            QByteArray raw = QByteArray::fromBase64(json.value("rasterDocumentRaw").toString().toLatin1());
-            if (!raw.isEmpty()) {
-                item->setData(GraphicsItemRoles::RasterDocumentJsonRole, raw);
-            }
+        // Older projects embedded the whole raster document in every
+        // exported item; it moves to the session table
+        const QJsonObject legacyDocument = json.value("rasterDocument").toObject();
+        if (!legacyDocument.isEmpty() && json.contains("rasterSessionId")) {
+            setRasterSession(json.value("rasterSessionId").toString(), legacyDocument);
         }
     }
 
     return item;
 }
 
-QJsonObject Canvas::toJson() const
+QJsonObject Canvas::layoutJson() const
 {
     QJsonObject json;
     json["width"] = m_canvasSize.width();
@@ -3451,27 +3322,6 @@ QJsonObject Canvas::toJson() const
         layerJson["locked"] = layer->locked;
         layerJson["opacity"] = layer->opacity;
         layerJson["blendMode"] = static_cast<int>(layer->blendMode);
-
-        QJsonObject frames;
-        auto layerFrames = m_layerFrameData.value(i);
-        for (auto it = layerFrames.begin(); it != layerFrames.end(); ++it) {
-            const FrameData& f = it.value();
-            QJsonObject frameJson;
-            frameJson["type"] = static_cast<int>(f.type);
-            frameJson["source"] = f.sourceKeyframe;
-            frameJson["hasTween"] = f.hasTweening;
-            frameJson["tweenEnd"] = f.tweeningEndFrame;
-            frameJson["easing"] = f.easingType;
-
-            QJsonArray itemsArray;
-            for (QGraphicsItem* item : f.items) {
-                itemsArray.append(serializeGraphicsItem(item));
-            }
-            frameJson["items"] = itemsArray;
-            frames[QString::number(it.key())] = frameJson;
-        }
-
-        layerJson["frames"] = frames;
         layers.append(layerJson);
     }
 
@@ -3482,11 +3332,284 @@ QJsonObject Canvas::toJson() const
     return json;
 }
 
+// Items more than one span references - a keyframe started on a held frame
+// keeps the held items - get an ID so that saves write them once
+void Canvas::assignSharedItemIds()
+{
+    for (void* layerPtr : m_layers) {
+        const LayerData* layer = static_cast<const LayerData*>(layerPtr);
+        for (QGraphicsItem* item : layer->spans.referencedItems()) {
+            if (layer->spans.refCount(item) > 1 &&
+                item->data(GraphicsItemRoles::SharedItemIdRole).toString().isEmpty()) {
+                item->setData(GraphicsItemRoles::SharedItemIdRole, QString::number(m_nextSharedItemId++));
+            }
+        }
+    }
+}
+
+CanvasSnapshot Canvas::captureSnapshot()
+{
+    assignSharedItemIds();
+
+    CanvasSnapshot snapshot;
+    snapshot.layout = layoutJson();
+    snapshot.rasterSessions = m_rasterSessions;
+    snapshot.layers.resize(static_cast<int>(m_layers.size()));
+    bool pending = false;
+    for (int i = 0; i < m_layers.size(); ++i) {
+        const LayerData* layer = static_cast<const LayerData*>(m_layers[i]);
+        CanvasSnapshot::Layer& captured = snapshot.layers[i];
+        QHash<QGraphicsItem*, int> indices;
+        bool layerPending = false;
+        for (const auto& entry : layer->spans) {
+            const FrameSpan& span = entry.second;
+            CanvasSnapshot::Span capturedSpan;
+            capturedSpan.keyframe = span.keyframe;
+            capturedSpan.lastFrame = span.lastFrame;
+            capturedSpan.hasTween = span.hasTweening;
+            capturedSpan.tweenEnd = span.tweeningEndFrame;
+            capturedSpan.easing = span.easingType;
+            if (span.isPending()) {
+                capturedSpan.pendingContent = span.pendingContent;
+                layerPending = true;
+            }
+            for (QGraphicsItem* item : span.items) {
+                auto it = indices.constFind(item);
+                if (it == indices.constEnd()) {
+                    it = indices.insert(item, captured.items.size());
+                    captured.items.append(CanvasSnapshot::captureItem(item, item == m_backgroundRect));
+                }
+                capturedSpan.items.append(it.value());
+            }
+            captured.spans.append(capturedSpan);
+        }
+
+        if (layerPending) {
+            captured.pendingSharedItems = layer->sharedItemJson;
+            pending = true;
+        }
+    }
+
+    // Spans still encoded may use any asset the project was loaded with;
+    // once every span is decoded, only the assets items use are kept
+    if (pending) {
+        snapshot.pendingAssets = m_pixmapAssets.encoded();
+    }
+    return snapshot;
+}
+
+void Canvas::rememberPixmapAssets(const QHash<qint64, PixmapAsset>& assets)
+{
+    if (assets.isEmpty())
+        return;
+
+    for (void* layerPtr : m_layers) {
+        const LayerData* layer = static_cast<const LayerData*>(layerPtr);
+        for (QGraphicsItem* item : layer->spans.referencedItems()) {
+            auto pixmapItem = qgraphicsitem_cast<QGraphicsPixmapItem*>(item);
+            if (!pixmapItem)
+                continue;
+            auto it = assets.constFind(pixmapItem->pixmap().cacheKey());
+            if (it != assets.constEnd()) {
+                rememberPixmapAsset(pixmapItem, it.value());
+            }
+        }
+    }
+}
+
+// Spans still encoded are copied out as they are, not decoded
+QJsonObject Canvas::toJson()
+{
+    const CanvasSnapshot snapshot = captureSnapshot();
+    return snapshot.toJson();
+}
+
 bool Canvas::fromJson(const QJsonObject& json)
 {
     if (json.isEmpty())
         return false;
 
+    beginLoad(json);
+
+    const QJsonObject assets = json["assets"].toObject();
+    for (auto it = assets.begin(); it != assets.end(); ++it) {
+        m_pixmapAssets.insert(it.key(), QByteArray::fromBase64(it.value().toString().toLatin1()));
+    }
+
+    QJsonArray layers = json["layers"].toArray();
+    for (int i = 0; i < layers.size() && i < m_layers.size(); ++i) {
+        LayerData* layer = static_cast<LayerData*>(m_layers[i]);
+        QJsonObject frames = layers[i].toObject()["frames"].toObject();
+
+        // Frame keys are strings; rebuild the spans in numeric frame order
+        QList<int> frameNumbers;
+        for (auto it = frames.begin(); it != frames.end(); ++it) {
+            frameNumbers.append(it.key().toInt());
+        }
+        std::sort(frameNumbers.begin(), frameNumbers.end());
+
+        QHash<int, QJsonArray> keyframeItemsJson;
+        for (int frame : frameNumbers) {
+            QJsonObject frameJson = frames.value(QString::number(frame)).toObject();
+            FrameType type = static_cast<FrameType>(frameJson["type"].toInt());
+            QJsonArray itemsArray = frameJson["items"].toArray();
+            bool hasTween = frameJson["hasTween"].toBool(false);
+
+            if (type == FrameType::ExtendedFrame) {
+                // Older projects stored a copy of the held items on every
+                // frame; only a hold whose content diverged needs its own key
+                int source = layer->spans.keyframeBefore(frame);
+                if (source != -1 &&
+                    (hasTween || itemsArray.isEmpty() || itemsArray == keyframeItemsJson.value(source))) {
+                    layer->spans.extendSpan(source, frame);
+                    continue;
+                }
+            }
+            else if (type == FrameType::Empty && itemsArray.isEmpty()) {
+                continue;
+            }
+
+            FrameSpan& span = layer->spans.insertKeyframe(frame);
+            layer->spans.setItems(span, deserializeItems(layer, itemsArray));
+            if (type == FrameType::Keyframe) {
+                span.hasTweening = hasTween;
+                span.tweeningEndFrame = frameJson["tweenEnd"].toInt(-1);
+                span.easingType = frameJson["easing"].toString("linear");
+            }
+            // Projects older than "lastFrame" list each held frame instead
+            if (frameJson.contains("lastFrame")) {
+                layer->spans.extendSpan(frame, frameJson["lastFrame"].toInt(frame));
+            }
+            keyframeItemsJson.insert(frame, itemsArray);
+        }
+    }
+
+    finishLoad(json);
+    return true;
+}
+
+bool Canvas::fromProject(const ProjectContainer& project)
+{
+    if (project.isJson())
+        return fromJson(project.canvasJson());
+
+    const QJsonObject json = project.canvasJson();
+    if (json.isEmpty())
+        return false;
+
+    beginLoad(json);
+
+    const QHash<QString, EncodedChunk> assets = project.assets();
+    for (auto it = assets.constBegin(); it != assets.constEnd(); ++it) {
+        m_pixmapAssets.insert(it.key(), it.value());
+    }
+
+    // Only the timing goes in now; each span's items are built the first
+    // time a frame it covers is shown
+    for (const ProjectFrameChunk& chunk : project.frames()) {
+        if (chunk.layer < 0 || chunk.layer >= m_layers.size() || chunk.lastFrame < chunk.keyframe)
+            continue;
+        LayerData* layer = static_cast<LayerData*>(m_layers[chunk.layer]);
+        FrameSpan& span = layer->spans.insertPending(chunk.keyframe, chunk.lastFrame, chunk.data);
+        span.hasTweening = chunk.hasTween;
+        span.tweeningEndFrame = chunk.tweenEnd;
+        span.easingType = chunk.easing;
+    }
+
+    // The background rectangle lives on the first layer's first frame;
+    // decoding it now keeps finishLoad from creating a second one
+    if (!m_layers.empty()) {
+        static_cast<LayerData*>(m_layers[0])->spans.spanAt(1);
+    }
+
+    finishLoad(json);
+    return true;
+}
+
+QGraphicsItem* Canvas::loadItem(const QJsonObject& itemObj)
+{
+    QGraphicsItem* item = deserializeGraphicsItem(itemObj);
+    if (item && !m_backgroundRect && itemObj["isBackground"].toBool(false) && qgraphicsitem_cast<QGraphicsRectItem*>(item)) {
+        m_backgroundRect = static_cast<QGraphicsRectItem*>(item);
+        m_backgroundRect->setData(1, "background");
+        m_backgroundRect->setData(0, m_backgroundRect->opacity());
+    }
+    return item;
+}
+
+// Every span listing the ID gets the same item. A span decoded after the
+// item was deleted from all others gets a fresh one from its saved form.
+QGraphicsItem* Canvas::sharedItem(LayerData* layer, const QString& id)
+{
+    QGraphicsItem* item = layer->sharedItems.value(id);
+    if (item && layer->spans.references(item) &&
+        item->data(GraphicsItemRoles::SharedItemIdRole).toString() == id) {
+        return item;
+    }
+
+    auto it = layer->sharedItemJson.constFind(id);
+    if (it == layer->sharedItemJson.constEnd()) {
+        qDebug() << "Canvas: missing shared item" << id << "on layer" << layer->name;
+        return nullptr;
+    }
+    item = loadItem(it.value());
+    if (item) {
+        item->setData(GraphicsItemRoles::SharedItemIdRole, id);
+        layer->sharedItems.insert(id, item);
+    }
+    return item;
+}
+
+QList<QGraphicsItem*> Canvas::deserializeItems(LayerData* layer, const QJsonArray& itemsArray)
+{
+    QList<QGraphicsItem*> items;
+    for (const QJsonValue& v : itemsArray) {
+        QJsonObject itemObj = v.toObject();
+        QGraphicsItem* item = itemObj.contains("ref")
+            ? sharedItem(layer, itemObj["ref"].toString())
+            : loadItem(itemObj);
+        if (item && !items.contains(item))
+            items.append(item);
+    }
+    return items;
+}
+
+void Canvas::setRasterSession(const QString& sessionId, const RasterDocumentState& document)
+{
+    if (!sessionId.isEmpty() && !document.json.isEmpty()) {
+        m_rasterSessions.insert(sessionId, document);
+    }
+}
+
+void Canvas::setRasterSession(const QString& sessionId, const QJsonObject& document)
+{
+    RasterDocumentState state;
+    state.json = document;
+    setRasterSession(sessionId, state);
+}
+
+QJsonObject Canvas::rasterSession(const QString& sessionId) const
+{
+    return m_rasterSessions.value(sessionId).toJson();
+}
+
+void Canvas::rememberRasterSessions(const CanvasSnapshot& snapshot)
+{
+    const QHash<QString, QJsonObject> encoded = snapshot.encodedRasterSessions();
+    for (auto it = encoded.constBegin(); it != encoded.constEnd(); ++it) {
+        auto session = m_rasterSessions.find(it.key());
+        if (session != m_rasterSessions.end()
+            && session.value().sharesFrames(snapshot.rasterSessions.value(it.key()))) {
+            RasterDocumentState state;
+            state.json = it.value();
+            session.value() = state;
+        }
+    }
+}
+
+// Drops the current document and rebuilds the layer table, without frames
+void Canvas::beginLoad(const QJsonObject& json)
+{
     setCanvasSize(QSize(json["width"].toInt(800), json["height"].toInt(600)));
 
     // Remove any existing background before rebuilding from JSON
@@ -3497,8 +3620,18 @@ bool Canvas::fromJson(const QJsonObject& json)
     }
 
     clear();
-    m_layerFrameData.clear();
+    for (void* layerPtr : m_layers) {
+        delete static_cast<LayerData*>(layerPtr);
+    }
     m_layers.clear();
+    m_pixmapAssets.clear();
+    m_nextSharedItemId = 1;
+
+    m_rasterSessions.clear();
+    const QJsonObject sessions = json["rasterSessions"].toObject();
+    for (auto it = sessions.begin(); it != sessions.end(); ++it) {
+        setRasterSession(it.key(), it.value().toObject());
+    }
 
     // Avoid storing stale state while reconstructing layers
     m_currentLayerIndex = -1;
@@ -3521,50 +3654,18 @@ bool Canvas::fromJson(const QJsonObject& json)
         setLayerLocked(idx, layerJson["locked"].toBool(false));
         setLayerOpacity(idx, opacity);
 
-        QJsonObject frames = layerJson["frames"].toObject();
-        for (auto it = frames.begin(); it != frames.end(); ++it) {
-            int frame = it.key().toInt();
-            QJsonObject frameJson = it.value().toObject();
-            FrameData data;
-            data.type = static_cast<FrameType>(frameJson["type"].toInt());
-            data.sourceKeyframe = frameJson["source"].toInt(-1);
-            data.hasTweening = frameJson["hasTween"].toBool(false);
-            data.tweeningEndFrame = frameJson["tweenEnd"].toInt(-1);
-            data.easingType = frameJson["easing"].toString("linear");
-
-            QJsonArray itemsArray = frameJson["items"].toArray();
-            for (const QJsonValue& v : itemsArray) {
-                QJsonObject itemObj = v.toObject();
-                QGraphicsItem* item = deserializeGraphicsItem(itemObj);
-                if (item) {
-                    if (itemObj["isBackground"].toBool(false) && qgraphicsitem_cast<QGraphicsRectItem*>(item)) {
-                        m_backgroundRect = static_cast<QGraphicsRectItem*>(item);
-                        m_backgroundRect->setData(1, "background");
-                        m_backgroundRect->setData(0, m_backgroundRect->opacity());
-                    }
-                    data.items.append(item);
-                }
-            }
-
-            m_layerFrameData[idx][frame] = data;
-            LayerData* layer = static_cast<LayerData*>(m_layers[idx]);
-            layer->setFrameItems(frame, data.items);
-
-            if (data.type == FrameType::Keyframe)
-                m_layerKeyframes[idx].insert(frame);
-        }
-
-        // Ensure each layer has a frame 1
-        if (!m_layerFrameData[idx].contains(1)) {
-            FrameData defaultFrame;
-            defaultFrame.type = FrameType::Keyframe;
-            LayerData* layer = static_cast<LayerData*>(m_layers[idx]);
-            layer->setFrameItems(1, QList<QGraphicsItem*>());
-            m_layerFrameData[idx][1] = defaultFrame;
-            m_layerKeyframes[idx].insert(1);
+        LayerData* layer = static_cast<LayerData*>(m_layers[idx]);
+        const QJsonObject sharedItems = layerJson["sharedItems"].toObject();
+        for (auto it = sharedItems.begin(); it != sharedItems.end(); ++it) {
+            layer->sharedItemJson.insert(it.key(), it.value().toObject());
+            m_nextSharedItemId = qMax(m_nextSharedItemId, it.key().toLongLong() + 1);
         }
     }
+}
 
+// Makes sure there is a background and shows the saved frame
+void Canvas::finishLoad(const QJsonObject& json)
+{
     // Ensure a background rectangle exists even if not provided
     if (!m_backgroundRect) {
         m_backgroundRect = new QGraphicsRectItem(m_canvasRect);
@@ -3578,7 +3679,6 @@ bool Canvas::fromJson(const QJsonObject& json)
         if (!m_layers.empty()) {
             LayerData* bgLayer = static_cast<LayerData*>(m_layers[0]);
             bgLayer->addItem(m_backgroundRect, 1);
-            m_layerFrameData[0][1].items.append(m_backgroundRect);
         }
     }
 
@@ -3586,8 +3686,6 @@ bool Canvas::fromJson(const QJsonObject& json)
     m_currentLayerIndex = json["currentLayer"].toInt(0);
 
     loadFrameState(m_currentFrame);
-
-    return true;
 }
 
 
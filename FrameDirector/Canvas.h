@@ -3,7 +3,15 @@
 #define CANVAS_H
 
 #include "Common/FrameTypes.h"
+#include "Common/FrameSpanIndex.h"
+#include "Common/ItemRegistry.h"
+#include "Common/PixmapAssets.h"
+#include "Common/CanvasChangeSet.h"
 #include "Common/CommonIncludes.h"
+#include "Animation/FrameSnapshot.h"
+#include "Animation/OnionSkinCache.h"
+#include "CanvasSnapshot.h"
+#include "ProjectContainer.h"
 #include <QGraphicsView>
 #include <QMouseEvent>
 #include <QKeyEvent>
@@ -14,6 +22,7 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QImage>
+#include <QRegion>
 #include <set>
 #include <optional>
 #include <QHash>
@@ -99,8 +108,27 @@ public:
     void deleteFrame(int frame);
 
     // Serialization
-    QJsonObject toJson() const;
+    QJsonObject toJson();
     bool fromJson(const QJsonObject& json);
+    // The document as values, for a save to serialize on another thread;
+    // see CanvasSnapshot. Spans not decoded since loading stay encoded.
+    // Gives items that spans share their SharedItemIdRole first.
+    CanvasSnapshot captureSnapshot();
+    // Caches the PNGs a save encoded on the pixmap items still showing
+    // those pixels, see CanvasSnapshot::encodedPixmaps
+    void rememberPixmapAssets(const QHash<qint64, PixmapAsset>& assets);
+    // Either format; binary spans stay encoded until a frame shows them
+    bool fromProject(const ProjectContainer& project);
+
+    // Raster editor sessions by RasterSessionIdRole: the document a session's
+    // exported pixmaps were painted in, kept once however many it exported.
+    // Captured documents are PNG-encoded by the next save, off this thread.
+    void setRasterSession(const QString& sessionId, const RasterDocumentState& document);
+    void setRasterSession(const QString& sessionId, const QJsonObject& document);
+    // Encodes frames no save has encoded yet
+    QJsonObject rasterSession(const QString& sessionId) const;
+    // Keeps the JSON a save encoded for sessions not exported again since
+    void rememberRasterSessions(const CanvasSnapshot& snapshot);
 
     // Frame data helpers for undo/redo
     FrameData exportFrameData(int layerIndex, int frame);
@@ -118,6 +146,7 @@ public:
     int getSourceKeyframe(int frame, int layerIndex) const;      // For extended frames
     int getLastKeyframeBefore(int frame, int layerIndex) const;  // Find previous keyframe
     int getNextKeyframeAfter(int frame, int layerIndex) const;   // Find next keyframe
+    int getLastContentFrame() const;                             // Last frame any layer shows, or 1
     bool hasFrameTweening(int frame, int layerIndex) const;
     bool isFrameTweened(int frame, int layerIndex) const;
     void applyTweening(int startFrame, int endFrame, const QString& easingType = "linear");
@@ -144,6 +173,12 @@ public:
     bool isOnionSkinEnabled() const;
     void setOnionSkinRange(int before, int after);
 
+    // Edit mode for heavy scenes: every layer except the current one is
+    // flattened into a cached image below or above it, so only the current
+    // layer's items are live in the scene
+    void setStaticLayerCaching(bool enabled);
+    bool isStaticLayerCaching() const { return m_staticLayerCaching; }
+
     // Tools and drawing
     void setCurrentTool(Tool* tool);
     Tool* getCurrentTool() const;
@@ -188,7 +223,6 @@ public:
     void sendSelectedBackward();
     void sendSelectedToBack();
     void flipSelectedHorizontal();
-    void updateGlobalFrameItems(int frame);
     void flipSelectedVertical();
     void rotateSelected(double angle);
 
@@ -197,6 +231,24 @@ public:
 
     // Rendering helpers
     QImage renderFlattenedFrame(int frame, const QVector<int>& layerIndices = QVector<int>()) const;
+    // Captures the frame as plain data that can be rendered on any thread.
+    // Without the background the frame renders on transparency.
+    FrameSnapshot captureFrameSnapshot(int frame, const QVector<int>& layerIndices = QVector<int>(),
+                                       bool includeBackground = true) const;
+    // True when every visible layer shows at frame what it showed at frame - 1:
+    // same source keyframe and not a tween in-between. Judged from the
+    // exposure sheet alone, so a redrawn identical keyframe is not detected.
+    bool isHoldFrame(int frame) const;
+
+    // Playback blitting: while an image is set the viewport shows it in place
+    // of the live scene and canvas input is ignored
+    void showPlaybackFrame(const QImage& image);
+    void clearPlaybackFrame();
+    bool isShowingPlaybackFrame() const { return !m_playbackImage.isNull(); }
+
+    // Schedules a repaint of just this scene area. Item changes report their
+    // own dirty regions; tools use this for anything drawn outside items.
+    void updateSceneRegion(const QRectF& sceneRect);
 
     // Item management
     void addItemToCurrentLayer(QGraphicsItem* item);
@@ -211,6 +263,13 @@ public:
     void removeItemFromAllFrames(QGraphicsItem* item);
     bool isValidItem(QGraphicsItem* item) const;
 
+    // Change tracking. Revisions only grow: what a layer shows at a frame
+    // changed if frameRevision moved on, and its name, lock, visibility or
+    // opacity changed if layerPropertyRevision did. Both are per layer, so
+    // structure changes (reported in the change set) invalidate them.
+    quint64 frameRevision(int layerIndex, int frame) const;
+    quint64 layerPropertyRevision(int layerIndex) const;
+
 signals:
     void selectionChanged();
     void mousePositionChanged(QPointF position);
@@ -230,6 +289,10 @@ signals:
     void tweeningApplied(int startFrame, int endFrame);
     void tweeningRemoved(int frame);
 
+    // Everything changed since the previous emission, at most once per
+    // event-loop turn
+    void changeSetReady(const FrameDirector::CanvasChangeSet& changes);
+
 protected:
     void mousePressEvent(QMouseEvent* event) override;
     void mouseMoveEvent(QMouseEvent* event) override;
@@ -249,25 +312,69 @@ private:
     void setupDefaultLayers();
     void updateSceneRect();
     QGraphicsItem* cloneGraphicsItem(QGraphicsItem* item) const;
-    void clearFrameItems(int frame);
-    QJsonObject serializeBrush(const QBrush& brush) const;
+    // Placement of a tween in-between a fraction t of the way between two items
+    struct TweenPose {
+        QPointF origin;
+        QPointF pos;
+        qreal rotation = 0.0;
+        qreal scaleX = 1.0;
+        qreal scaleY = 1.0;
+        qreal opacity = 1.0;
+        qreal blurRadius = 0.0;
+
+        QTransform sceneTransform() const;
+    };
+    TweenPose tweenPose(QGraphicsItem* startItem, QGraphicsItem* endItem, float t) const;
+    void applyTweenPose(QGraphicsItem* proxy, const TweenPose& pose) const;
+
+    // In-between proxies of one tweened layer: clones of the start keyframe's
+    // items, built once per tween and only re-posed while scrubbing
+    struct TweenProxyPool {
+        int startFrame = -1;
+        int endFrame = -1;
+        QList<QGraphicsItem*> sources;  // Start keyframe items the proxies mirror
+        QList<QGraphicsItem*> targets;  // Matching end keyframe items
+        QList<QGraphicsItem*> proxies;  // Null where a source cannot be cloned
+    };
+    void releaseTweenProxies(int layerIndex);
+    void releaseTweenProxies();
+    bool tweenProgress(int frame, int layerIndex, int& startFrame, int& endFrame, float& t) const;
+    FrameData frameDataFromSpan(const FrameSpan& span, int frame) const;
+    void appendLayerToSnapshot(FrameSnapshot& snapshot, int frame, int layerIndex,
+                               double opacity, bool includeBackground) const;
     QBrush deserializeBrush(const QJsonObject& json) const;
-    QJsonObject serializeGraphicsItem(QGraphicsItem* item) const;
-    QGraphicsItem* deserializeGraphicsItem(const QJsonObject& json) const;
+    QGraphicsItem* deserializeGraphicsItem(const QJsonObject& json);
+    QJsonObject layoutJson() const;
+    void assignSharedItemIds();
+    QGraphicsItem* loadItem(const QJsonObject& itemObj);
+    QGraphicsItem* sharedItem(LayerData* layer, const QString& id);
+    QList<QGraphicsItem*> deserializeItems(LayerData* layer, const QJsonArray& itemsArray);
+    void beginLoad(const QJsonObject& json);
+    void finishLoad(const QJsonObject& json);
 
     void applyOnionSkin(int frame);
-    void clearOnionSkinItems();
+    void clearOnionSkins();
+    void updateLayerComposites(int frame);
+    void invalidateLayerComposites();
+
+    // Change set coalescing
+    void trackLayerChanges(LayerData* layer);
+    void markFramesChanged(const LayerData* layer, int firstFrame, int lastFrame);
+    void markLayerPropertiesChanged(int layerIndex, bool appearance);
+    void markStructureChanged();
+    void scheduleChangeSet();
+    void emitChangeSet();
 
     // Drawing and rendering
     void drawGrid(QPainter* painter, const QRectF& rect);
     void drawGrid(QPainter* painter); // Alternative signature
     void drawRulers(QPainter* painter);
     void drawCanvasBounds(QPainter* painter, const QRectF& rect);
+    void recordRepaint(qint64 nanoseconds, const QRegion& region);
     void drawBackground(QPainter* painter);
 
     // ENHANCED: Layer-aware tweening and interpolation methods
-    void cleanupInterpolatedItems();  // Global cleanup (all layers)
-    void cleanupInterpolatedItems(int layerIndex);  // Layer-specific cleanup
+    void cleanupInterpolatedItems(int layerIndex);  // Takes the layer's proxies off stage
 
     // Utility functions
     QPointF snapToGrid(const QPointF& point);
@@ -275,8 +382,6 @@ private:
     void updateAllLayerZValues();
 
     // Frame management helpers
-    void copyItemsToFrame(int fromFrame, int toFrame);
-    void captureCurrentStateAsKeyframe(int frame);
     QList<QGraphicsItem*> duplicateItems(const QList<QGraphicsItem*>& items);
 
     // Drawing operation detection for auto-conversion
@@ -295,25 +400,28 @@ private:
     QGraphicsRectItem* m_backgroundRect;
     QColor m_backgroundColor;
 
-    // Layer management using LayerData structures
+    // Layer management using LayerData structures. Each LayerData owns the
+    // layer's FrameSpanIndex, the single source of truth for its frames.
+    // Layer spans keep m_itemRegistry up to date, so item -> layer lookups
+    // and validity checks never scan the layers.
+    ItemRegistry m_itemRegistry;
     std::vector<void*> m_layers;  // Contains LayerData* pointers
-    std::vector<LayerData> m_layersData; // Alternative storage
+
+    // Embedded pixmaps of the loaded project, decoded once and shared
+    PixmapAssetTable m_pixmapAssets;
+    QHash<QString, RasterDocumentState> m_rasterSessions;
+    // Next SharedItemIdRole to hand out; above every ID the project uses
+    qint64 m_nextSharedItemId = 1;
     int m_currentLayerIndex;
 
     // ENHANCED: Layer-specific tweening and animation data
-    QHash<int, QHash<int, FrameData>> m_layerFrameData;  // layerIndex -> frame -> FrameData
-    QHash<int, QList<QGraphicsItem*>> m_layerInterpolatedItems;  // layerIndex -> interpolated items
+    QHash<int, TweenProxyPool> m_tweenProxyPools;  // layerIndex -> in-between proxies
     QHash<int, bool> m_layerShowingInterpolated;  // layerIndex -> isShowingInterpolated flag
 
-    // Frame and keyframe management with extension support (legacy - for compatibility)
+    // Frame management
     int m_currentFrame;
-    std::map<int, FrameData> m_frameData;        // Enhanced frame tracking (legacy global)
-    std::map<int, QList<QGraphicsItem*>> m_frameItems; // Keep for compatibility
-    QHash<int, QSet<int>> m_layerKeyframes;      // layerIndex -> keyframe set
-    QList<QGraphicsItem*> m_interpolatedItems;  // Legacy global interpolated items
 
     // Tweening state flags
-    bool m_isShowingInterpolatedFrame = false;  // Legacy global flag
     bool m_suppressFrameConversion = false;     // Prevents unwanted frame conversions
 
     // View properties
@@ -344,7 +452,30 @@ private:
     bool m_onionSkinEnabled;
     int m_onionSkinBefore;
     int m_onionSkinAfter;
-    QSet<QGraphicsItem*> m_onionSkinItems;
+    OnionSkinCache m_onionSkinCache;
+    QImage m_onionSkinOverlay;  // Composited onion frames, drawn in drawForeground
+    QVector<quint64> m_onionSkinOverlayKey; // What the overlay was composited from
+
+    // Static layer caching: flattened layers under and over the current one,
+    // and the layer state they were built from
+    bool m_staticLayerCaching = false;
+    QImage m_belowLayersImage;
+    QImage m_aboveLayersImage;
+    QVector<quint64> m_layerCompositeKey;
+
+    // Pre-rendered playback frame shown instead of the live scene
+    QImage m_playbackImage;
+
+    // Changes collected during this event-loop turn
+    CanvasChangeSet m_pendingChanges;
+    QTimer* m_changeSetTimer = nullptr;
+
+    // Repaint timing, logged when the framedirector.canvas.repaint category
+    // is enabled for debug messages
+    bool m_profileRepaints = false;
+    int m_repaintCount = 0;
+    qint64 m_repaintNanoseconds = 0;
+    qint64 m_repaintPixels = 0;
 };
 
 #endif // CANVAS_H
\ No newline at end of file
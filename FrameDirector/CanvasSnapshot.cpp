@@ -0,0 +1,369 @@
+// CanvasSnapshot.cpp
+#include "CanvasSnapshot.h"
+#include "Common/FrameTypes.h"
+#include "Common/GraphicsItemRoles.h"
+#include <QConicalGradient>
+#include <QGraphicsBlurEffect>
+#include <QGraphicsEllipseItem>
+#include <QGraphicsLineItem>
+#include <QGraphicsPathItem>
+#include <QGraphicsPixmapItem>
+#include <QGraphicsRectItem>
+#include <QGraphicsTextItem>
+#include <QLinearGradient>
+#include <QRadialGradient>
+
+using namespace FrameDirector;
+
+CanvasSnapshot::Item CanvasSnapshot::captureItem(QGraphicsItem* item, bool background)
+{
+    Item captured;
+    if (auto rectItem = qgraphicsitem_cast<QGraphicsRectItem*>(item)) {
+        captured.kind = Item::Kind::Rect;
+        captured.rect = rectItem->rect();
+        captured.pen = rectItem->pen();
+        captured.brush = rectItem->brush();
+        captured.background = background;
+    }
+    else if (auto ellipseItem = qgraphicsitem_cast<QGraphicsEllipseItem*>(item)) {
+        captured.kind = Item::Kind::Ellipse;
+        captured.rect = ellipseItem->rect();
+        captured.pen = ellipseItem->pen();
+        captured.brush = ellipseItem->brush();
+    }
+    else if (auto lineItem = qgraphicsitem_cast<QGraphicsLineItem*>(item)) {
+        captured.kind = Item::Kind::Line;
+        captured.line = lineItem->line();
+        captured.pen = lineItem->pen();
+    }
+    else if (auto pathItem = qgraphicsitem_cast<QGraphicsPathItem*>(item)) {
+        captured.kind = Item::Kind::Path;
+        captured.path = pathItem->path();
+        captured.pen = pathItem->pen();
+        captured.brush = pathItem->brush();
+    }
+    else if (auto pixmapItem = qgraphicsitem_cast<QGraphicsPixmapItem*>(item)) {
+        captured.kind = Item::Kind::Pixmap;
+        captured.pixmapKey = pixmapItem->pixmap().cacheKey();
+        if (!cachedPixmapAsset(pixmapItem, &captured.asset)) {
+            // QPixmap stays on the GUI thread; the PNG is encoded by the save
+            captured.image = pixmapItem->pixmap().toImage();
+        }
+
+        const QVariant sessionVariant = pixmapItem->data(GraphicsItemRoles::RasterSessionIdRole);
+        if (sessionVariant.isValid()) {
+            captured.rasterSessionId = sessionVariant.toString();
+        }
+        const QVariant frameVariant = pixmapItem->data(GraphicsItemRoles::RasterFrameIndexRole);
+        if (frameVariant.isValid()) {
+            captured.rasterFrameIndex = frameVariant.toInt();
+        }
+    }
+    else if (auto textItem = qgraphicsitem_cast<QGraphicsTextItem*>(item)) {
+        captured.kind = Item::Kind::Text;
+        captured.text = textItem->toPlainText();
+        const QFont f = textItem->font();
+        captured.fontFamily = f.family();
+        captured.fontPointSize = f.pointSizeF();
+        captured.fontBold = f.bold();
+        captured.fontItalic = f.italic();
+        captured.fontUnderline = f.underline();
+        captured.textColor = textItem->defaultTextColor();
+    }
+
+    captured.pos = item->pos();
+    captured.origin = item->transformOriginPoint();
+    captured.rotation = item->rotation();
+    captured.scaleX = item->transform().m11();
+    captured.scaleY = item->transform().m22();
+    // Store per-item opacity rather than the opacity already multiplied by
+    // the layer opacity. The original opacity is kept in item->data(0).
+    captured.opacity = item->data(0).isValid() ? item->data(0).toDouble() : item->opacity();
+    captured.zValue = item->zValue();
+    captured.visible = item->isVisible();
+    if (auto blur = dynamic_cast<QGraphicsBlurEffect*>(item->graphicsEffect())) {
+        captured.blur = blur->blurRadius();
+    }
+    captured.sharedId = item->data(GraphicsItemRoles::SharedItemIdRole).toString();
+    return captured;
+}
+
+QJsonObject CanvasSnapshot::serializeBrush(const QBrush& brush)
+{
+    QJsonObject obj;
+    obj["style"] = static_cast<int>(brush.style());
+    if (brush.style() == Qt::SolidPattern) {
+        obj["color"] = brush.color().name();
+    }
+    else if (brush.style() == Qt::LinearGradientPattern ||
+        brush.style() == Qt::RadialGradientPattern ||
+        brush.style() == Qt::ConicalGradientPattern) {
+        const QGradient* grad = brush.gradient();
+        if (grad) {
+            obj["type"] = static_cast<int>(grad->type());
+            obj["spread"] = static_cast<int>(grad->spread());
+            QJsonArray stops;
+            for (const auto& stop : grad->stops()) {
+                QJsonObject s;
+                s["pos"] = stop.first;
+                s["color"] = stop.second.name();
+                stops.append(s);
+            }
+            obj["stops"] = stops;
+
+            if (grad->type() == QGradient::LinearGradient) {
+                const QLinearGradient* lg = static_cast<const QLinearGradient*>(grad);
+                obj["startX"] = lg->start().x();
+                obj["startY"] = lg->start().y();
+                obj["endX"] = lg->finalStop().x();
+                obj["endY"] = lg->finalStop().y();
+            }
+            else if (grad->type() == QGradient::RadialGradient) {
+                const QRadialGradient* rg = static_cast<const QRadialGradient*>(grad);
+                obj["centerX"] = rg->center().x();
+                obj["centerY"] = rg->center().y();
+                obj["focalX"] = rg->focalPoint().x();
+                obj["focalY"] = rg->focalPoint().y();
+                obj["radius"] = rg->radius();
+            }
+            else if (grad->type() == QGradient::ConicalGradient) {
+                const QConicalGradient* cg = static_cast<const QConicalGradient*>(grad);
+                obj["centerX"] = cg->center().x();
+                obj["centerY"] = cg->center().y();
+                obj["angle"] = cg->angle();
+            }
+        }
+    }
+    else if (brush.style() != Qt::NoBrush) {
+        obj["color"] = brush.color().name();
+    }
+    return obj;
+}
+
+QJsonObject CanvasSnapshot::serializeItem(const Item& item, QHash<QString, EncodedChunk>& assets) const
+{
+    QJsonObject json;
+    auto writePen = [&json](const QPen& pen) {
+        json["penColor"] = pen.color().name();
+        json["penWidth"] = pen.widthF();
+        json["penStyle"] = static_cast<int>(pen.style());
+    };
+
+    switch (item.kind) {
+    case Item::Kind::Rect:
+    case Item::Kind::Ellipse:
+        json["class"] = item.kind == Item::Kind::Rect ? "rect" : "ellipse";
+        json["x"] = item.rect.x();
+        json["y"] = item.rect.y();
+        json["w"] = item.rect.width();
+        json["h"] = item.rect.height();
+        writePen(item.pen);
+        json["brush"] = serializeBrush(item.brush);
+        if (item.background) {
+            json["isBackground"] = true;
+        }
+        break;
+    case Item::Kind::Line:
+        json["class"] = "line";
+        json["x1"] = item.line.x1();
+        json["y1"] = item.line.y1();
+        json["x2"] = item.line.x2();
+        json["y2"] = item.line.y2();
+        writePen(item.pen);
+        break;
+    case Item::Kind::Path: {
+        json["class"] = "path";
+        QJsonArray points;
+        for (int i = 0; i < item.path.elementCount(); ++i) {
+            QPainterPath::Element e = item.path.elementAt(i);
+            QJsonObject p; p["x"] = e.x; p["y"] = e.y; points.append(p);
+        }
+        json["points"] = points;
+        writePen(item.pen);
+        json["brush"] = serializeBrush(item.brush);
+        break;
+    }
+    case Item::Kind::Pixmap: {
+        json["class"] = "pixmap";
+        PixmapAsset asset = item.asset;
+        if (!item.image.isNull()) {
+            // Copies of one pixmap share its cache key; encode it once
+            auto encoded = m_encodedPixmaps.constFind(item.pixmapKey);
+            if (encoded == m_encodedPixmaps.constEnd()) {
+                encoded = m_encodedPixmaps.insert(item.pixmapKey, encodePixmapAsset(item.image));
+            }
+            asset = encoded.value();
+        }
+        json["asset"] = asset.hash;
+        assets.insert(asset.hash, asset.png);
+
+        if (!item.rasterSessionId.isNull()) {
+            json["rasterSessionId"] = item.rasterSessionId;
+        }
+        if (item.rasterFrameIndex >= 0) {
+            json["rasterFrameIndex"] = item.rasterFrameIndex;
+        }
+        break;
+    }
+    case Item::Kind::Text:
+        json["class"] = "text";
+        json["text"] = item.text;
+        json["fontFamily"] = item.fontFamily;
+        json["fontPointSize"] = item.fontPointSize;
+        json["fontBold"] = item.fontBold;
+        json["fontItalic"] = item.fontItalic;
+        json["fontUnderline"] = item.fontUnderline;
+        json["color"] = item.textColor.name();
+        break;
+    case Item::Kind::Other:
+        break;
+    }
+
+    json["posX"] = item.pos.x();
+    json["posY"] = item.pos.y();
+    json["originX"] = item.origin.x();
+    json["originY"] = item.origin.y();
+    json["rotation"] = item.rotation;
+    json["scaleX"] = item.scaleX;
+    json["scaleY"] = item.scaleY;
+    json["opacity"] = item.opacity;
+    json["zValue"] = item.zValue;
+    json["visible"] = item.visible;
+    json["blur"] = item.blur;
+    return json;
+}
+
+// Items with a shared ID are written once into sharedItems and listed by ID
+QJsonArray CanvasSnapshot::serializeSpanItems(const Layer& layer, const Span& span,
+                                              QJsonObject& sharedItems, QHash<QString, EncodedChunk>& assets) const
+{
+    QJsonArray itemsArray;
+    for (int index : span.items) {
+        const Item& item = layer.items[index];
+        if (item.sharedId.isEmpty()) {
+            itemsArray.append(serializeItem(item, assets));
+            continue;
+        }
+
+        if (!sharedItems.contains(item.sharedId)) {
+            sharedItems[item.sharedId] = serializeItem(item, assets);
+        }
+        QJsonObject ref;
+        ref["ref"] = item.sharedId;
+        itemsArray.append(ref);
+    }
+    return itemsArray;
+}
+
+QJsonObject CanvasSnapshot::rasterSessionsJson() const
+{
+    QJsonObject sessions;
+    for (auto it = rasterSessions.constBegin(); it != rasterSessions.constEnd(); ++it) {
+        // Sessions loaded from the project hold their frames encoded already
+        if (it.value().frames.isEmpty()) {
+            sessions[it.key()] = it.value().json;
+            continue;
+        }
+        auto encoded = m_encodedSessions.constFind(it.key());
+        if (encoded == m_encodedSessions.constEnd()) {
+            encoded = m_encodedSessions.insert(it.key(), it.value().toJson());
+        }
+        sessions[it.key()] = encoded.value();
+    }
+    return sessions;
+}
+
+QJsonObject CanvasSnapshot::toProject(QVector<ProjectFrameChunk>& chunks, QHash<QString, EncodedChunk>& assets) const
+{
+    QJsonObject json = layout;
+    json["rasterSessions"] = rasterSessionsJson();
+    QJsonArray layersJson = json["layers"].toArray();
+    for (int i = 0; i < layers.size() && i < layersJson.size(); ++i) {
+        const Layer& layer = layers[i];
+        QJsonObject sharedItems;
+        for (const Span& span : layer.spans) {
+            ProjectFrameChunk chunk;
+            chunk.layer = i;
+            chunk.keyframe = span.keyframe;
+            chunk.lastFrame = span.lastFrame;
+            chunk.hasTween = span.hasTween;
+            chunk.tweenEnd = span.tweenEnd;
+            chunk.easing = span.easing;
+            if (!span.pendingContent.isNull()) {
+                chunk.data = span.pendingContent;
+            }
+            else {
+                chunk.items = serializeSpanItems(layer, span, sharedItems, assets);
+            }
+            chunks.append(chunk);
+        }
+
+        // Encoded spans may list shared items no decoded span uses
+        for (auto it = layer.pendingSharedItems.constBegin(); it != layer.pendingSharedItems.constEnd(); ++it) {
+            if (!sharedItems.contains(it.key())) {
+                sharedItems[it.key()] = it.value();
+            }
+        }
+
+        QJsonObject layerJson = layersJson[i].toObject();
+        layerJson["sharedItems"] = sharedItems;
+        layersJson[i] = layerJson;
+    }
+    json["layers"] = layersJson;
+
+    for (auto it = pendingAssets.constBegin(); it != pendingAssets.constEnd(); ++it) {
+        assets.insert(it.key(), it.value());
+    }
+    return json;
+}
+
+QJsonObject CanvasSnapshot::toJson() const
+{
+    QJsonObject json = layout;
+    json["rasterSessions"] = rasterSessionsJson();
+    QJsonArray layersJson = json["layers"].toArray();
+    QHash<QString, EncodedChunk> assets;
+    for (int i = 0; i < layers.size() && i < layersJson.size(); ++i) {
+        const Layer& layer = layers[i];
+
+        // One entry per span; "lastFrame" covers the frames it holds.
+        // Encoded spans already hold their items in this form.
+        QJsonObject frames;
+        QJsonObject sharedItems;
+        for (const Span& span : layer.spans) {
+            QJsonObject frameJson;
+            frameJson["type"] = static_cast<int>(FrameType::Keyframe);
+            frameJson["source"] = -1;
+            frameJson["lastFrame"] = span.lastFrame;
+            frameJson["hasTween"] = span.hasTween;
+            frameJson["tweenEnd"] = span.tweenEnd;
+            frameJson["easing"] = span.easing;
+            frameJson["items"] = span.pendingContent.isNull()
+                ? serializeSpanItems(layer, span, sharedItems, assets)
+                : ProjectContainer::decodeItems(span.pendingContent.bytes());
+            frames[QString::number(span.keyframe)] = frameJson;
+        }
+        for (auto it = layer.pendingSharedItems.constBegin(); it != layer.pendingSharedItems.constEnd(); ++it) {
+            if (!sharedItems.contains(it.key())) {
+                sharedItems[it.key()] = it.value();
+            }
+        }
+
+        QJsonObject layerJson = layersJson[i].toObject();
+        layerJson["frames"] = frames;
+        layerJson["sharedItems"] = sharedItems;
+        layersJson[i] = layerJson;
+    }
+
+    for (auto it = pendingAssets.constBegin(); it != pendingAssets.constEnd(); ++it) {
+        assets.insert(it.key(), it.value());
+    }
+    QJsonObject assetsJson;
+    for (auto it = assets.constBegin(); it != assets.constEnd(); ++it) {
+        assetsJson[it.key()] = QString::fromLatin1(it.value().bytes().toBase64());
+    }
+
+    json["layers"] = layersJson;
+    json["assets"] = assetsJson;
+    return json;
+}
@@ -0,0 +1,130 @@
+// CanvasSnapshot.h - Value copy of the canvas document, serialized off the GUI thread
+#ifndef CANVASSNAPSHOT_H
+#define CANVASSNAPSHOT_H
+
+#include "Common/PixmapAssets.h"
+#include "ProjectContainer.h"
+#include "RasterEditor/RasterDocument.h"
+#include <QBrush>
+#include <QByteArray>
+#include <QColor>
+#include <QHash>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QLineF>
+#include <QPainterPath>
+#include <QPen>
+#include <QPointF>
+#include <QRectF>
+#include <QString>
+#include <QVector>
+
+class QGraphicsItem;
+
+// What a save needs from the canvas, captured on the GUI thread as values:
+// each item's geometry, pen, brush and transform, pixmaps as their cached
+// asset or as a QImage, spans still encoded as their chunk. Paths, brushes,
+// images and JSON are implicitly shared, so capturing copies no points or
+// pixels. Building the JSON, encoding stale pixmaps to PNG and everything
+// ProjectContainer::write does then happen on the save job's thread.
+class CanvasSnapshot
+{
+public:
+    // One item, with the fields the project format stores
+    struct Item {
+        enum class Kind { Rect, Ellipse, Line, Path, Pixmap, Text, Other };
+
+        Kind kind = Kind::Other;
+        QRectF rect;
+        QLineF line;
+        QPainterPath path;
+        QPen pen;
+        QBrush brush;
+        bool background = false;
+
+        // Pixmaps: the cached asset while it matches the pixels, otherwise
+        // the pixels to encode; pixmapKey is QPixmap::cacheKey()
+        FrameDirector::PixmapAsset asset;
+        QImage image;
+        qint64 pixmapKey = 0;
+        QString rasterSessionId;
+        int rasterFrameIndex = -1;
+
+        QString text;
+        QString fontFamily;
+        qreal fontPointSize = 0.0;
+        bool fontBold = false;
+        bool fontItalic = false;
+        bool fontUnderline = false;
+        QColor textColor;
+
+        QPointF pos;
+        QPointF origin;
+        qreal rotation = 0.0;
+        qreal scaleX = 1.0;
+        qreal scaleY = 1.0;
+        qreal opacity = 1.0;
+        qreal zValue = 0.0;
+        bool visible = true;
+        qreal blur = 0.0;
+
+        // SharedItemIdRole, for items several spans list
+        QString sharedId;
+    };
+
+    struct Span {
+        int keyframe = 0;
+        int lastFrame = 0;
+        bool hasTween = false;
+        int tweenEnd = -1;
+        QString easing = "linear";
+        QVector<int> items;         // Into Layer::items
+        FrameDirector::EncodedChunk pendingContent;  // Spans never decoded, passed on as they are
+    };
+
+    struct Layer {
+        QVector<Item> items;        // Each item once, however many spans list it
+        QVector<Span> spans;
+        // Saved form of shared items the encoded spans may list
+        QHash<QString, QJsonObject> pendingSharedItems;
+    };
+
+    // GUI thread only. background marks the canvas background rectangle.
+    static Item captureItem(QGraphicsItem* item, bool background);
+
+    // Canvas::layoutJson(): layer table, current frame
+    QJsonObject layout;
+    // Raster editor sessions by id, frames not yet PNG-encoded
+    QHash<QString, RasterDocumentState> rasterSessions;
+    QVector<Layer> layers;
+    // Assets of the loaded project, kept while encoded spans may use them
+    QHash<QString, FrameDirector::EncodedChunk> pendingAssets;
+
+    // Any thread. Binary projects: returns the canvas object, with each
+    // layer's "sharedItems", and fills chunks with one chunk per span and
+    // assets with the PNG of every pixmap they reference.
+    QJsonObject toProject(QVector<ProjectFrameChunk>& chunks, QHash<QString, FrameDirector::EncodedChunk>& assets) const;
+    // Any thread. The whole canvas as one JSON object, frames included.
+    QJsonObject toJson() const;
+
+    // PNGs encoded for stale pixmaps by the calls above, by pixmapKey, for
+    // Canvas::rememberPixmapAssets to cache on the items
+    QHash<qint64, FrameDirector::PixmapAsset> encodedPixmaps() const { return m_encodedPixmaps; }
+    // Sessions whose frames the calls above encoded, as their saved JSON,
+    // for Canvas::rememberRasterSessions
+    QHash<QString, QJsonObject> encodedRasterSessions() const { return m_encodedSessions; }
+
+    static QJsonObject serializeBrush(const QBrush& brush);
+
+private:
+    QJsonObject serializeItem(const Item& item, QHash<QString, FrameDirector::EncodedChunk>& assets) const;
+    QJsonArray serializeSpanItems(const Layer& layer, const Span& span,
+                                  QJsonObject& sharedItems, QHash<QString, FrameDirector::EncodedChunk>& assets) const;
+    QJsonObject rasterSessionsJson() const;
+
+    mutable QHash<qint64, FrameDirector::PixmapAsset> m_encodedPixmaps;
+    mutable QHash<QString, QJsonObject> m_encodedSessions;
+};
+
+#endif // CANVASSNAPSHOT_H
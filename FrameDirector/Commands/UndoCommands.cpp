@@ -183,7 +183,7 @@ RemoveItemCommand::~RemoveItemCommand()
 
             bool inScene = false;
             if (m_canvas && m_canvas->scene()) {
-                inScene = m_canvas->scene()->items().contains(item);
+                inScene = item->scene() == m_canvas->scene();
             }
 
             if (!inScene) {
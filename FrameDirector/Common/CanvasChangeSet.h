@@ -0,0 +1,102 @@
+#ifndef FRAMEDIRECTOR_CANVASCHANGESET_H
+#define FRAMEDIRECTOR_CANVASCHANGESET_H
+
+#include <QMap>
+#include <QSet>
+#include <QVector>
+#include <algorithm>
+
+namespace FrameDirector {
+
+// Inclusive run of frames
+struct FrameRange {
+    int first = 0;
+    int last = 0;
+
+    bool contains(int frame) const { return frame >= first && frame <= last; }
+};
+
+// Everything that changed on the canvas during one event-loop turn. Caches
+// of rendered frames drop exactly the frames listed here instead of
+// everything; a structure change means layer indices, canvas size or
+// background moved and nothing keyed by them can be trusted.
+struct CanvasChangeSet {
+    QMap<int, QVector<FrameRange>> layerFrames; // Sorted, non-overlapping per layer
+    QSet<int> layerProperties;                  // Name, lock, visibility or opacity changed
+    QSet<int> layerAppearance;                  // Visibility or opacity changed
+    bool structureChanged = false;
+
+    bool isEmpty() const {
+        return layerFrames.isEmpty() && layerProperties.isEmpty() && !structureChanged;
+    }
+
+    // True when every frame has to be considered changed
+    bool affectsAllFrames() const {
+        return structureChanged || !layerAppearance.isEmpty();
+    }
+
+    bool touchesLayer(int layerIndex) const {
+        return structureChanged || layerFrames.contains(layerIndex) ||
+            layerProperties.contains(layerIndex);
+    }
+
+    // Whether what the layer shows at the frame may have changed
+    bool touchesFrame(int layerIndex, int frame) const {
+        if (structureChanged || layerAppearance.contains(layerIndex)) return true;
+        auto it = layerFrames.constFind(layerIndex);
+        if (it == layerFrames.constEnd()) return false;
+        for (const FrameRange& range : it.value()) {
+            if (range.contains(frame)) return true;
+        }
+        return false;
+    }
+
+    // Whether the composited frame may have changed on any layer
+    bool touchesFrame(int frame) const {
+        if (affectsAllFrames()) return true;
+        for (auto it = layerFrames.constBegin(); it != layerFrames.constEnd(); ++it) {
+            for (const FrameRange& range : it.value()) {
+                if (range.contains(frame)) return true;
+            }
+        }
+        return false;
+    }
+
+    // Union of the changed frames over all layers
+    QVector<FrameRange> frameRanges() const {
+        QVector<FrameRange> result;
+        for (auto it = layerFrames.constBegin(); it != layerFrames.constEnd(); ++it) {
+            for (const FrameRange& range : it.value()) {
+                addRange(result, range.first, range.last);
+            }
+        }
+        return result;
+    }
+
+    void addFrames(int layerIndex, int first, int last) {
+        if (last < first) return;
+        addRange(layerFrames[layerIndex], first, last);
+    }
+
+    void clear() { *this = CanvasChangeSet(); }
+
+private:
+    // Inserts [first, last] and merges it with every range it touches
+    static void addRange(QVector<FrameRange>& ranges, int first, int last) {
+        auto it = std::lower_bound(ranges.begin(), ranges.end(), first,
+            [](const FrameRange& range, int frame) { return range.last + 1 < frame; });
+        FrameRange merged{ first, last };
+        auto end = it;
+        while (end != ranges.end() && end->first <= last + 1) {
+            merged.first = std::min(merged.first, end->first);
+            merged.last = std::max(merged.last, end->last);
+            ++end;
+        }
+        it = ranges.erase(it, end);
+        ranges.insert(it, merged);
+    }
+};
+
+} // namespace FrameDirector
+
+#endif // FRAMEDIRECTOR_CANVASCHANGESET_H
@@ -0,0 +1,60 @@
+#ifndef FRAMEDIRECTOR_ENCODEDCHUNK_H
+#define FRAMEDIRECTOR_ENCODEDCHUNK_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QtGlobal>
+#include <memory>
+
+namespace FrameDirector {
+
+// Where chunks that are still on disk are read from, such as an open
+// project file. Kept alive, and the file open, by the chunks referring to it.
+// Chunks keep the offsets they were read at, also after a save moved them.
+class ChunkSource {
+public:
+    virtual ~ChunkSource() = default;
+
+    // Thread-safe. Null when the range is outside the source.
+    virtual QByteArray read(quint64 offset, quint32 size) const = 0;
+    // The file chunks are read from
+    virtual QString fileName() const = 0;
+
+    // A save is about to replace the file, having copied the chunks at the
+    // keys of moved to the offsets they map to. Other chunks are kept in
+    // memory; where the platform cannot replace an open file, it is closed
+    // and reads wait for endReplace. Thread-safe.
+    virtual void beginReplace(const QHash<quint64, quint64>& moved) = 0;
+    // After the save: when the file was replaced, reads of moved chunks go
+    // to the new file; otherwise to the file as it was. Thread-safe.
+    virtual void endReplace(bool replaced, const QHash<quint64, quint64>& moved) = 0;
+};
+
+// Encoded bytes, either in memory or still in a ChunkSource. A chunk on
+// disk is only read when bytes() is called, one chunk at a time.
+class EncodedChunk {
+public:
+    EncodedChunk() = default;
+    EncodedChunk(const QByteArray& bytes) : m_bytes(bytes) {}
+    EncodedChunk(std::shared_ptr<ChunkSource> source, quint64 offset, quint32 size)
+        : m_source(std::move(source)), m_offset(offset), m_size(size) {}
+
+    bool isNull() const { return !m_source && m_bytes.isNull(); }
+    ChunkSource* source() const { return m_source.get(); }
+    // Where the chunk is in its source
+    quint64 offset() const { return m_offset; }
+    quint32 size() const { return m_size; }
+
+    QByteArray bytes() const { return m_source ? m_source->read(m_offset, m_size) : m_bytes; }
+
+private:
+    std::shared_ptr<ChunkSource> m_source;
+    quint64 m_offset = 0;
+    quint32 m_size = 0;
+    QByteArray m_bytes;
+};
+
+} // namespace FrameDirector
+
+#endif // FRAMEDIRECTOR_ENCODEDCHUNK_H
@@ -0,0 +1,508 @@
+#ifndef FRAMEDIRECTOR_FRAMESPANINDEX_H
+#define FRAMEDIRECTOR_FRAMESPANINDEX_H
+
+#include "EncodedChunk.h"
+#include "FrameTypes.h"
+#include "ItemRegistry.h"
+
+#include <QByteArray>
+#include <QGraphicsItem>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include <QString>
+#include <QVariant>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <vector>
+
+namespace FrameDirector {
+
+// One exposure on a layer: a keyframe and the run of frames that hold it.
+// Frames after the keyframe up to lastFrame (inclusive) are extended frames
+// and share the keyframe's items.
+struct FrameSpan {
+    int keyframe = -1;
+    int lastFrame = -1;
+    QList<QGraphicsItem*> items;
+    QMap<QGraphicsItem*, QVariant> itemStates;
+
+    // Tweening runs from this keyframe to the next one (tweeningEndFrame)
+    bool hasTweening = false;
+    int tweeningEndFrame = -1;
+    QString easingType = "linear";
+
+    // Revision of this span's content and timing, see FrameSpanIndex::frameRevision
+    quint64 revision = 0;
+
+    // Items of a span restored from a binary project, still encoded and
+    // usually still in the project file. The index's content loader reads
+    // and decodes them the first time the span is looked up; until then the
+    // span has its timing but no items.
+    EncodedChunk pendingContent;
+
+    bool isPending() const { return !pendingContent.isNull(); }
+    bool contains(int frame) const { return frame >= keyframe && frame <= lastFrame; }
+    int length() const { return lastFrame - keyframe + 1; }
+};
+
+// Ordered per-layer exposure sheet. Spans are keyed by their keyframe and
+// never overlap, so every frame query is a single O(log n) map lookup.
+//
+// The index also counts how many spans reference each item. Span item lists
+// must therefore only be changed through setItems/appendItem/replaceItem/
+// removeItemFromSpan; the span's other fields can be edited directly, followed
+// by touch(span) so its revision moves on.
+//
+// Spans may be pending (see FrameSpan::pendingContent). The span lookups
+// decode them on the way out; queries that only need timing never do.
+class FrameSpanIndex {
+public:
+    using SpanMap = std::map<int, FrameSpan>;
+    using const_iterator = SpanMap::const_iterator;
+    using iterator = SpanMap::iterator;
+
+    // Told the inclusive frame range whose content changed, once per mutation
+    using ChangeListener = std::function<void(int firstFrame, int lastFrame)>;
+    // Turns a pending span's content into its items
+    using ContentLoader = std::function<QList<QGraphicsItem*>(const QByteArray& content)>;
+
+    FrameSpanIndex() = default;
+    FrameSpanIndex(const FrameSpanIndex&) = delete;
+    FrameSpanIndex& operator=(const FrameSpanIndex&) = delete;
+    ~FrameSpanIndex() { clear(); }
+
+    // Items gaining their first reference are registered as owned by owner,
+    // and unregistered again when their last reference goes away
+    void attachRegistry(ItemRegistry* registry, const void* owner) {
+        m_registry = registry;
+        m_owner = owner;
+    }
+
+    void setChangeListener(ChangeListener listener) { m_listener = std::move(listener); }
+    void setContentLoader(ContentLoader loader) { m_loader = std::move(loader); }
+
+    bool isEmpty() const { return m_spans.empty(); }
+    int size() const { return static_cast<int>(m_spans.size()); }
+    // Last frame with content, or -1
+    int lastFrame() const { return m_spans.empty() ? -1 : m_spans.rbegin()->second.lastFrame; }
+
+    // Changes whenever spans or their item lists change; caches built from
+    // the layer's content compare it to know when to rebuild
+    quint64 revision() const { return m_revision; }
+
+    // Revision of what the frame shows. Frames of one span share it, tween
+    // in-betweens also follow their end keyframe, and every empty frame
+    // shares one that moves on whenever content is removed. Values only grow,
+    // so a cache holding an older one knows it is stale.
+    quint64 frameRevision(int frame) const {
+        const FrameSpan* span = findSpan(frame);
+        if (!span) return m_emptyRevision;
+        quint64 result = span->revision;
+        if (span->hasTweening && frame > span->keyframe) {
+            if (const FrameSpan* end = findStartingAt(span->tweeningEndFrame)) {
+                result = std::max(result, end->revision);
+            }
+        }
+        return result;
+    }
+
+    // Call after editing a span's timing or tween fields directly
+    void touch(FrameSpan& span) { markDirty(span); }
+
+    // Does not notify the listener; the owner is being reset or destroyed
+    void clear() {
+        m_emptyRevision = ++m_revision;
+        if (m_registry) {
+            for (auto it = m_refs.constBegin(); it != m_refs.constEnd(); ++it) {
+                m_registry->remove(it.key(), m_owner);
+            }
+        }
+        m_refs.clear();
+        m_spans.clear();
+    }
+
+    // Spans as stored: pending ones have no items yet, see loadAll
+    iterator begin() { return m_spans.begin(); }
+    iterator end() { return m_spans.end(); }
+    const_iterator begin() const { return m_spans.begin(); }
+    const_iterator end() const { return m_spans.end(); }
+
+    // Decodes every pending span, for callers walking begin()/end()
+    void loadAll() const {
+        for (const auto& entry : m_spans) {
+            loaded(&entry.second);
+        }
+    }
+
+    // Span covering the frame, or nullptr for empty frames
+    const FrameSpan* spanAt(int frame) const { return loaded(findSpan(frame)); }
+    FrameSpan* spanAt(int frame) {
+        return const_cast<FrameSpan*>(static_cast<const FrameSpanIndex*>(this)->spanAt(frame));
+    }
+
+    const FrameSpan* spanStartingAt(int keyframe) const { return loaded(findStartingAt(keyframe)); }
+    FrameSpan* spanStartingAt(int keyframe) {
+        return const_cast<FrameSpan*>(static_cast<const FrameSpanIndex*>(this)->spanStartingAt(keyframe));
+    }
+
+    // Last span whose keyframe is strictly before the frame
+    const FrameSpan* spanBefore(int frame) const { return loaded(findBefore(frame)); }
+
+    bool hasKeyframe(int frame) const { return m_spans.count(frame) > 0; }
+
+    FrameType frameType(int frame) const {
+        const FrameSpan* span = findSpan(frame);
+        if (!span) return FrameType::Empty;
+        return span->keyframe == frame ? FrameType::Keyframe : FrameType::ExtendedFrame;
+    }
+
+    int sourceKeyframe(int frame) const {
+        const FrameSpan* span = findSpan(frame);
+        return span ? span->keyframe : -1;
+    }
+
+    int keyframeBefore(int frame) const {
+        const FrameSpan* span = findBefore(frame);
+        return span ? span->keyframe : -1;
+    }
+
+    int keyframeAfter(int frame) const {
+        auto it = m_spans.upper_bound(frame);
+        return it != m_spans.end() ? it->first : -1;
+    }
+
+    // True for the tween's start keyframe, its in-betweens and its end keyframe
+    bool isTweened(int frame) const {
+        const FrameSpan* start = findStartingAt(frame);
+        if (start && start->hasTweening) return true;
+        const FrameSpan* previous = findBefore(frame);
+        return previous && previous->hasTweening && frame <= previous->tweeningEndFrame;
+    }
+
+    QList<int> keyframes() const {
+        QList<int> result;
+        result.reserve(size());
+        for (const auto& entry : m_spans) {
+            result.append(entry.first);
+        }
+        return result;
+    }
+
+    // Starts a keyframe at the given frame. A span already covering the frame
+    // is split and the new keyframe keeps holding through the old span's end;
+    // on an empty frame the new span is a single frame long. The returned span
+    // has no items - callers fill it in.
+    FrameSpan& insertKeyframe(int frame) {
+        auto existing = m_spans.find(frame);
+        if (existing != m_spans.end()) {
+            return const_cast<FrameSpan&>(*loaded(&existing->second));
+        }
+
+        FrameSpan span;
+        span.keyframe = frame;
+        span.lastFrame = frame;
+
+        if (FrameSpan* covering = const_cast<FrameSpan*>(findSpan(frame))) {
+            span.lastFrame = covering->lastFrame;
+            covering->lastFrame = frame - 1;
+            if (covering->hasTweening) {
+                covering->tweeningEndFrame = frame;
+                markDirty(*covering);
+            }
+        }
+
+        FrameSpan& inserted = m_spans.emplace(frame, span).first->second;
+        markDirty(inserted);
+        return inserted;
+    }
+
+    // Extends the span starting at keyframe so it holds through lastFrame,
+    // stopping before the next keyframe. Returns the span's resulting end.
+    int extendSpan(int keyframe, int lastFrame) {
+        auto it = m_spans.find(keyframe);
+        if (it == m_spans.end()) return -1;
+
+        FrameSpan& span = it->second;
+        auto next = std::next(it);
+        int limit = next != m_spans.end() ? next->first - 1 : lastFrame;
+        int newLast = std::max(span.lastFrame, std::min(lastFrame, limit));
+        if (newLast != span.lastFrame) {
+            span.lastFrame = newLast;
+            markDirty(span);
+        }
+        return span.lastFrame;
+    }
+
+    // Adds a span restored from a binary project with its items still
+    // encoded; the caller sets its tween fields
+    FrameSpan& insertPending(int keyframe, int lastFrame, const EncodedChunk& content) {
+        FrameSpan& span = insertKeyframe(keyframe);
+        extendSpan(keyframe, lastFrame);
+        span.pendingContent = content;
+        return span;
+    }
+
+    // Removes the span starting at keyframe. A tween that ended on it is
+    // dropped from the previous span since it no longer has an end keyframe.
+    bool take(int keyframe, FrameSpan* removed = nullptr) {
+        auto it = m_spans.find(keyframe);
+        if (it == m_spans.end()) return false;
+        if (removed) loaded(&it->second);
+
+        if (it != m_spans.begin()) {
+            FrameSpan& previous = std::prev(it)->second;
+            if (previous.hasTweening && previous.tweeningEndFrame == keyframe) {
+                clearTweening(previous);
+                markDirty(previous);
+            }
+        }
+
+        markEmptied(it->second.keyframe, it->second.lastFrame);
+        unrefAll(it->second.items);
+        if (removed) {
+            *removed = std::move(it->second);
+        }
+        m_spans.erase(it);
+        return true;
+    }
+
+    // Removes every span whose keyframe lies in [first, last]
+    std::vector<FrameSpan> takeRange(int first, int last) {
+        std::vector<FrameSpan> removed;
+        auto it = m_spans.lower_bound(first);
+        while (it != m_spans.end() && it->first <= last) {
+            loaded(&it->second);
+            markEmptied(it->second.keyframe, it->second.lastFrame);
+            unrefAll(it->second.items);
+            removed.push_back(std::move(it->second));
+            it = m_spans.erase(it);
+        }
+        return removed;
+    }
+
+    // Makes a single frame empty. Frames after it that were holding the same
+    // keyframe keep its content as a new span starting on the next frame.
+    void clearFrame(int frame) {
+        FrameSpan* span = spanAt(frame);
+        if (!span) return;
+
+        if (span->lastFrame > frame) {
+            FrameSpan remainder;
+            remainder.keyframe = frame + 1;
+            remainder.lastFrame = span->lastFrame;
+            remainder.items = span->items;
+            remainder.itemStates = span->itemStates;
+            refAll(remainder.items);
+            markDirty(m_spans.emplace(remainder.keyframe, remainder).first->second);
+        }
+
+        if (span->keyframe == frame) {
+            take(frame);
+        }
+        else {
+            span->lastFrame = frame - 1;
+            clearTweening(*span);
+            markDirty(*span);
+            markEmptied(frame, frame);
+        }
+    }
+
+    // Replaces the span's content, keeping reference counts in step
+    void setItems(FrameSpan& span, const QList<QGraphicsItem*>& items,
+        const QMap<QGraphicsItem*, QVariant>& itemStates = QMap<QGraphicsItem*, QVariant>()) {
+        refAll(items);
+        unrefAll(span.items);
+        span.items = items;
+        span.itemStates = itemStates;
+        markDirty(span);
+        markSharingSpansDirty(span);
+    }
+
+    void appendItem(FrameSpan& span, QGraphicsItem* item) {
+        if (!item || span.items.contains(item)) return;
+        span.items.append(item);
+        ref(item);
+        markDirty(span);
+    }
+
+    // Swaps one item for another in place, keeping its stacking position
+    void replaceItem(FrameSpan& span, QGraphicsItem* from, QGraphicsItem* to) {
+        int index = span.items.indexOf(from);
+        if (index < 0 || !to) return;
+        span.items[index] = to;
+        span.itemStates.remove(from);
+        ref(to);
+        unref(from);
+        markDirty(span);
+    }
+
+    void removeItemFromSpan(FrameSpan& span, QGraphicsItem* item) {
+        int removedCount = static_cast<int>(span.items.removeAll(item));
+        span.itemStates.remove(item);
+        if (removedCount > 0) markDirty(span);
+        while (removedCount-- > 0) {
+            unref(item);
+        }
+    }
+
+    // Number of spans referencing the item - O(1)
+    int refCount(QGraphicsItem* item) const { return m_refs.value(item, 0); }
+    bool references(QGraphicsItem* item) const { return m_refs.contains(item); }
+
+    // Every item referenced by at least one span, in no particular order
+    QList<QGraphicsItem*> referencedItems() const { return m_refs.keys(); }
+
+    // Drops the item from every span; stops as soon as no reference is left
+    void removeItem(QGraphicsItem* item) {
+        for (auto& entry : m_spans) {
+            if (!references(item)) break;
+            removeItemFromSpan(entry.second, item);
+        }
+    }
+
+    // Batch form of removeItem: one pass over each span instead of one per item
+    void removeItems(const QSet<QGraphicsItem*>& items) {
+        if (items.isEmpty()) return;
+        for (auto& entry : m_spans) {
+            FrameSpan& span = entry.second;
+            QList<QGraphicsItem*> kept;
+            kept.reserve(span.items.size());
+            for (QGraphicsItem* item : span.items) {
+                if (items.contains(item)) {
+                    span.itemStates.remove(item);
+                    unref(item);
+                }
+                else {
+                    kept.append(item);
+                }
+            }
+            if (kept.size() != span.items.size()) {
+                span.items = kept;
+                markDirty(span);
+            }
+        }
+    }
+
+    static void clearTweening(FrameSpan& span) {
+        span.hasTweening = false;
+        span.tweeningEndFrame = -1;
+        span.easingType = "linear";
+    }
+
+private:
+    const FrameSpan* findSpan(int frame) const {
+        auto it = m_spans.upper_bound(frame);
+        if (it == m_spans.begin()) return nullptr;
+        --it;
+        return it->second.contains(frame) ? &it->second : nullptr;
+    }
+
+    const FrameSpan* findStartingAt(int keyframe) const {
+        auto it = m_spans.find(keyframe);
+        return it != m_spans.end() ? &it->second : nullptr;
+    }
+
+    const FrameSpan* findBefore(int frame) const {
+        auto it = m_spans.lower_bound(frame);
+        if (it == m_spans.begin()) return nullptr;
+        --it;
+        return &it->second;
+    }
+
+    // Decoding only brings in content the span already had, so neither its
+    // revision nor the listener hear about it
+    const FrameSpan* loaded(const FrameSpan* span) const {
+        if (!span || !span->isPending()) return span;
+        FrameSpan& pending = const_cast<FrameSpan&>(*span);
+        const EncodedChunk content = pending.pendingContent;
+        pending.pendingContent = EncodedChunk();
+        if (m_loader) {
+            pending.items = m_loader(content.bytes());
+            const_cast<FrameSpanIndex*>(this)->refAll(pending.items);
+        }
+        return span;
+    }
+
+    // Gives the span a fresh revision and reports the frames showing it,
+    // including the in-betweens of a tween ending on it
+    void markDirty(FrameSpan& span) {
+        span.revision = ++m_revision;
+        if (!m_listener) return;
+        m_listener(span.keyframe, span.lastFrame);
+        if (const FrameSpan* previous = findBefore(span.keyframe)) {
+            if (previous->hasTweening && previous->tweeningEndFrame == span.keyframe) {
+                m_listener(previous->keyframe, previous->lastFrame);
+            }
+        }
+    }
+
+    // A save may have restyled items other spans show as well, e.g. the
+    // held content a keyframe started from
+    void markSharingSpansDirty(const FrameSpan& span) {
+        QSet<QGraphicsItem*> shared;
+        for (QGraphicsItem* item : span.items) {
+            if (refCount(item) > 1) shared.insert(item);
+        }
+        if (shared.isEmpty()) return;
+        for (auto& entry : m_spans) {
+            FrameSpan& other = entry.second;
+            if (&other == &span) continue;
+            for (QGraphicsItem* item : other.items) {
+                if (shared.contains(item)) {
+                    markDirty(other);
+                    break;
+                }
+            }
+        }
+    }
+
+    // Frames that lost their content now show the shared empty revision
+    void markEmptied(int firstFrame, int lastFrame) {
+        m_emptyRevision = ++m_revision;
+        if (m_listener) m_listener(firstFrame, lastFrame);
+    }
+
+    void ref(QGraphicsItem* item) {
+        if (!item) return;
+        int& count = m_refs[item];
+        if (count++ == 0 && m_registry) {
+            m_registry->insert(item, m_owner);
+        }
+    }
+
+    void unref(QGraphicsItem* item) {
+        auto it = m_refs.find(item);
+        if (it == m_refs.end()) return;
+        if (--it.value() == 0) {
+            m_refs.erase(it);
+            if (m_registry) {
+                m_registry->remove(item, m_owner);
+            }
+        }
+    }
+
+    void refAll(const QList<QGraphicsItem*>& items) {
+        for (QGraphicsItem* item : items) ref(item);
+    }
+
+    void unrefAll(const QList<QGraphicsItem*>& items) {
+        for (QGraphicsItem* item : items) unref(item);
+    }
+
+    SpanMap m_spans;
+    QHash<QGraphicsItem*, int> m_refs;
+    ItemRegistry* m_registry = nullptr;
+    const void* m_owner = nullptr;
+    ChangeListener m_listener;
+    ContentLoader m_loader;
+    quint64 m_revision = 0;
+    quint64 m_emptyRevision = 0;
+};
+
+} // namespace FrameDirector
+
+#endif // FRAMEDIRECTOR_FRAMESPANINDEX_H
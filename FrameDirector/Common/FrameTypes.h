@@ -21,6 +21,7 @@ struct FrameData {
     int sourceKeyframe = -1;  // For extended frames, which keyframe they extend from
     QList<QGraphicsItem*> items;
     QMap<QGraphicsItem*, QVariant> itemStates; // Store item states for tweening
+    int lastFrame = -1;       // Last frame the keyframe is held through (exposure end)
 
     // Tweening support
     bool hasTweening = false;          // Whether this frame span has tweening applied
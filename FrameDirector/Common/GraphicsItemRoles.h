@@ -19,9 +19,16 @@ inline constexpr int RasterSessionIdRole = Qt::UserRole + 551;
 // re-exports from the raster editor.
 inline constexpr int RasterFrameIndexRole = Qt::UserRole + 552;
 
-// Stores a serialized representation of the raster document (in compact JSON
-// form) so that project serialization can preserve the layered raster data and
-// restore it on load.
-inline constexpr int RasterDocumentJsonRole = Qt::UserRole + 553;
+// Pixmap items cache their entry in the project asset table: its content
+// hash, its PNG bytes and the QPixmap::cacheKey() of the pixmap they were
+// encoded from. Saves reuse them until the item shows different pixels.
+inline constexpr int PixmapAssetHashRole = Qt::UserRole + 561;
+inline constexpr int PixmapAssetDataRole = Qt::UserRole + 562;
+inline constexpr int PixmapAssetKeyRole = Qt::UserRole + 563;
+
+// Stable ID of an item several spans of a layer reference. The project
+// stores such items once, in the layer's "sharedItems", and spans list the
+// ID; loading builds one item for all of them.
+inline constexpr int SharedItemIdRole = Qt::UserRole + 571;
 
 } // namespace GraphicsItemRoles
@@ -0,0 +1,44 @@
+#ifndef FRAMEDIRECTOR_ITEMREGISTRY_H
+#define FRAMEDIRECTOR_ITEMREGISTRY_H
+
+#include <QGraphicsItem>
+#include <QHash>
+#include <QList>
+
+namespace FrameDirector {
+
+// Reverse index from graphics items to the layer that owns them. Layers
+// register an item when its first frame reference appears and unregister it
+// when the last one goes away, so "which layer is this on" and "is this
+// still tracked" are single hash lookups instead of scans over every layer.
+// Scene membership is not duplicated here: item->scene() is already O(1).
+class ItemRegistry {
+public:
+    void insert(QGraphicsItem* item, const void* layer) {
+        if (item) {
+            m_owners.insert(item, layer);
+        }
+    }
+
+    // Only the layer that currently owns the item can unregister it, so an
+    // item moved to another layer is not dropped by its previous owner.
+    void remove(QGraphicsItem* item, const void* layer) {
+        auto it = m_owners.find(item);
+        if (it != m_owners.end() && it.value() == layer) {
+            m_owners.erase(it);
+        }
+    }
+
+    bool contains(QGraphicsItem* item) const { return item && m_owners.contains(item); }
+    const void* layerOf(QGraphicsItem* item) const { return m_owners.value(item, nullptr); }
+
+    int size() const { return m_owners.size(); }
+    void clear() { m_owners.clear(); }
+
+private:
+    QHash<QGraphicsItem*, const void*> m_owners;
+};
+
+} // namespace FrameDirector
+
+#endif // FRAMEDIRECTOR_ITEMREGISTRY_H
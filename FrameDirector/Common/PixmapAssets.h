@@ -0,0 +1,127 @@
+#ifndef FRAMEDIRECTOR_PIXMAPASSETS_H
+#define FRAMEDIRECTOR_PIXMAPASSETS_H
+
+#include "EncodedChunk.h"
+#include "GraphicsItemRoles.h"
+
+#include <QBuffer>
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QGraphicsPixmapItem>
+#include <QHash>
+#include <QImage>
+#include <QPixmap>
+#include <QString>
+
+namespace FrameDirector {
+
+// Embedded pixmaps are stored once per project in an asset table keyed by
+// the SHA-1 of their PNG bytes; items only carry the hash. An image used on
+// hundreds of frames is written once, and its PNG is encoded once per
+// change of its pixels rather than on every save.
+struct PixmapAsset {
+    QString hash;
+    QByteArray png;
+};
+
+inline QString pixmapAssetHash(const QByteArray& png)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(png, QCryptographicHash::Sha1).toHex());
+}
+
+// Caches the asset on the item, valid for as long as it shows this pixmap
+inline void rememberPixmapAsset(QGraphicsPixmapItem* item, const PixmapAsset& asset)
+{
+    item->setData(GraphicsItemRoles::PixmapAssetKeyRole, item->pixmap().cacheKey());
+    item->setData(GraphicsItemRoles::PixmapAssetHashRole, asset.hash);
+    item->setData(GraphicsItemRoles::PixmapAssetDataRole, asset.png);
+}
+
+// The item's cached asset, while it is still current: QPixmap::cacheKey
+// changes whenever the pixels do, so a matching key means the cached PNG
+// still describes the pixmap
+inline bool cachedPixmapAsset(QGraphicsPixmapItem* item, PixmapAsset* asset)
+{
+    const QVariant key = item->data(GraphicsItemRoles::PixmapAssetKeyRole);
+    if (!key.isValid() || key.toLongLong() != item->pixmap().cacheKey()) {
+        return false;
+    }
+    asset->hash = item->data(GraphicsItemRoles::PixmapAssetHashRole).toString();
+    asset->png = item->data(GraphicsItemRoles::PixmapAssetDataRole).toByteArray();
+    return true;
+}
+
+// Encodes pixels captured from a pixmap; unlike QPixmap, QImage may be used
+// from any thread
+inline PixmapAsset encodePixmapAsset(const QImage& image)
+{
+    PixmapAsset asset;
+    QBuffer buffer(&asset.png);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG");
+    asset.hash = pixmapAssetHash(asset.png);
+    return asset;
+}
+
+// Asset table of a loaded project. Each PNG is read from the project file
+// and decoded the first time an item asks for it; every later item shares
+// that QPixmap and its pixels.
+class PixmapAssetTable {
+public:
+    void clear() { m_entries.clear(); }
+    bool isEmpty() const { return m_entries.isEmpty(); }
+    bool contains(const QString& hash) const { return m_entries.contains(hash); }
+
+    // Keeps the first PNG seen for a hash; equal hashes mean equal bytes
+    void insert(const QString& hash, const EncodedChunk& png) {
+        if (!hash.isEmpty() && !m_entries.contains(hash)) {
+            m_entries.insert(hash, Entry{ png, QByteArray(), QPixmap() });
+        }
+    }
+
+    // Null for an unknown hash or a PNG that does not decode
+    QPixmap pixmap(const QString& hash) {
+        auto it = m_entries.find(hash);
+        if (it == m_entries.end()) return QPixmap();
+        if (it->pixmap.isNull()) {
+            const QByteArray bytes = png(hash);
+            if (!bytes.isEmpty()) {
+                it->pixmap.loadFromData(bytes, "PNG");
+            }
+        }
+        return it->pixmap;
+    }
+
+    // Reads the PNG on first use
+    QByteArray png(const QString& hash) {
+        auto it = m_entries.find(hash);
+        if (it == m_entries.end()) return QByteArray();
+        if (it->png.isNull()) {
+            it->png = it->source.bytes();
+        }
+        return it->png;
+    }
+
+    // Every asset, those never read still referring to the project file
+    QHash<QString, EncodedChunk> encoded() const {
+        QHash<QString, EncodedChunk> result;
+        result.reserve(m_entries.size());
+        for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+            result.insert(it.key(), it->png.isNull() ? it->source : EncodedChunk(it->png));
+        }
+        return result;
+    }
+
+private:
+    struct Entry {
+        EncodedChunk source;
+        QByteArray png;
+        QPixmap pixmap;
+    };
+
+    QHash<QString, Entry> m_entries;
+};
+
+} // namespace FrameDirector
+
+#endif // FRAMEDIRECTOR_PIXMAPASSETS_H
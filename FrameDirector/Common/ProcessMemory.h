@@ -0,0 +1,45 @@
+#ifndef FRAMEDIRECTOR_PROCESSMEMORY_H
+#define FRAMEDIRECTOR_PROCESSMEMORY_H
+
+#include <QtGlobal>
+
+#ifdef Q_OS_WIN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+namespace FrameDirector {
+
+// Largest resident set the process has had so far, in bytes, or 0 where the
+// platform does not report it. Logged after loading a project so the
+// formats' memory cost can be compared; only meaningful in a fresh process.
+inline qint64 peakResidentBytes()
+{
+#ifdef Q_OS_WIN
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return qint64(counters.PeakWorkingSetSize);
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef Q_OS_MACOS
+    return qint64(usage.ru_maxrss);
+#else
+    return qint64(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+} // namespace FrameDirector
+
+#endif // FRAMEDIRECTOR_PROCESSMEMORY_H
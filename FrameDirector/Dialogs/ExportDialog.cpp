@@ -18,7 +18,10 @@ ExportDialog::ExportDialog(QWidget* parent)
     QFormLayout* formLayout = new QFormLayout;
     
     m_formatCombo = new QComboBox;
-    m_formatCombo->addItems({"GIF", "MP4"});
+    m_formatCombo->addItem("GIF", "gif");
+    m_formatCombo->addItem("MP4", "mp4");
+    m_formatCombo->addItem("PNG Sequence", "png");
+    m_formatCombo->addItem("Sprite Sheet", "sprites");
     formLayout->addRow("Format:", m_formatCombo);
 
     m_qualitySpinBox = new QSpinBox;
@@ -31,6 +34,41 @@ ExportDialog::ExportDialog(QWidget* parent)
     m_loopCheckBox->setChecked(true);
     formLayout->addRow("", m_loopCheckBox);
 
+    m_ditherCombo = new QComboBox;
+    m_ditherCombo->addItem("None", "none");
+    m_ditherCombo->addItem("Ordered", "ordered");
+    m_ditherCombo->addItem("Error diffusion", "diffusion");
+    formLayout->addRow("Dithering:", m_ditherCombo);
+
+    m_paletteCombo = new QComboBox;
+    m_paletteCombo->addItems({"Per frame", "Global"});
+    m_paletteCombo->setToolTip("Global uses one palette for the whole animation; per frame keeps more colors");
+    formLayout->addRow("Palette:", m_paletteCombo);
+
+    m_sizesEdit = new QLineEdit;
+    m_sizesEdit->setPlaceholderText("Canvas size");
+    m_sizesEdit->setToolTip("Comma-separated sizes rendered in one pass, e.g. 3840x2160, 1920x1080, 320 or 50%");
+    m_sizesEdit->setEnabled(false);
+    formLayout->addRow("Sizes:", m_sizesEdit);
+
+    m_pngCompressionCombo = new QComboBox;
+    m_pngCompressionCombo->addItem("Fast (dailies)", "fast");
+    m_pngCompressionCombo->addItem("Default", "default");
+    m_pngCompressionCombo->addItem("Maximum (archive)", "max");
+    m_pngCompressionCombo->setCurrentIndex(1);
+    m_pngCompressionCombo->setEnabled(false);
+    formLayout->addRow("Compression:", m_pngCompressionCombo);
+
+    m_pngFilterCombo = new QComboBox;
+    m_pngFilterCombo->addItem("From compression", QString());
+    for (const char* name : { "adaptive", "none", "sub", "up", "average", "paeth" }) {
+        const QString filter = QString::fromLatin1(name);
+        m_pngFilterCombo->addItem(filter.left(1).toUpper() + filter.mid(1), filter);
+    }
+    m_pngFilterCombo->setToolTip("PNG row filter; adaptive picks one per row and compresses best but encodes slowest");
+    m_pngFilterCombo->setEnabled(false);
+    formLayout->addRow("PNG filter:", m_pngFilterCombo);
+
     mainLayout->addLayout(formLayout);
 
     // Progress section
@@ -47,11 +85,11 @@ ExportDialog::ExportDialog(QWidget* parent)
     // Buttons
     QHBoxLayout* buttonLayout = new QHBoxLayout;
     QPushButton* cancelButton = new QPushButton("Cancel");
-    QPushButton* exportButton = new QPushButton("Export");
-    exportButton->setDefault(true);
+    m_exportButton = new QPushButton("Export");
+    m_exportButton->setDefault(true);
 
     buttonLayout->addWidget(cancelButton);
-    buttonLayout->addWidget(exportButton);
+    buttonLayout->addWidget(m_exportButton);
     mainLayout->addLayout(buttonLayout);
 
     // Style
@@ -60,7 +98,7 @@ ExportDialog::ExportDialog(QWidget* parent)
             background-color: #2D2D2D;
             color: #FFFFFF;
         }
-        QComboBox, QSpinBox {
+        QComboBox, QSpinBox, QLineEdit {
             background-color: #3D3D3D;
             color: #FFFFFF;
             border: 1px solid #555555;
@@ -132,19 +170,24 @@ ExportDialog::ExportDialog(QWidget* parent)
     )");
 
     connect(cancelButton, &QPushButton::clicked, this, &QDialog::reject);
-    connect(exportButton, &QPushButton::clicked, this, &QDialog::accept);
+    connect(m_exportButton, &QPushButton::clicked, this, &QDialog::accept);
 
     connect(m_formatCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
-        [this](int index) {
-            bool isGif = index == 0;
+        [this](int) {
+            const bool isGif = getFormat() == "gif";
             m_loopCheckBox->setEnabled(isGif);
-            m_qualitySpinBox->setEnabled(!isGif);
+            m_ditherCombo->setEnabled(isGif);
+            m_paletteCombo->setEnabled(isGif);
+            m_qualitySpinBox->setEnabled(getFormat() == "mp4");
+            m_sizesEdit->setEnabled(getFormat() == "png");
+            m_pngCompressionCombo->setEnabled(getFormat() == "png");
+            m_pngFilterCombo->setEnabled(getFormat() == "png");
         });
 }
 
 QString ExportDialog::getFormat() const
 {
-    return m_formatCombo->currentText().toLower();
+    return m_formatCombo->currentData().toString();
 }
 
 int ExportDialog::getQuality() const
@@ -157,6 +200,29 @@ bool ExportDialog::getLoop() const
     return m_loopCheckBox->isChecked();
 }
 
+QString ExportDialog::getGifDither() const
+{
+    return m_ditherCombo->currentData().toString();
+}
+
+bool ExportDialog::getGifGlobalPalette() const
+{
+    return m_paletteCombo->currentIndex() == 1;
+}
+
+QString ExportDialog::getSizes() const
+{
+    return m_sizesEdit->text();
+}
+
+PngEncoder::Options ExportDialog::getPngOptions() const
+{
+    PngEncoder::Options options;
+    PngEncoder::optionsFromName(m_pngCompressionCombo->currentData().toString(), options);
+    PngEncoder::filterFromName(m_pngFilterCombo->currentData().toString(), options.filter);
+    return options;
+}
+
 void ExportDialog::updateProgress(int value, int maximum)
 {
     if (maximum > 0) {
@@ -7,6 +7,9 @@
 #include <QProgressBar>
 #include <QLabel>
 #include <QCheckBox>
+#include <QLineEdit>
+#include <QPushButton>
+#include "../Animation/PngEncoder.h"
 
 class ExportDialog : public QDialog
 {
@@ -14,9 +17,16 @@ class ExportDialog : public QDialog
 
 public:
     explicit ExportDialog(QWidget* parent = nullptr);
+    // "gif", "mp4", "png" or "sprites"
     QString getFormat() const;
     int getQuality() const;
     bool getLoop() const;
+    // "none", "ordered" or "diffusion"
+    QString getGifDither() const;
+    bool getGifGlobalPalette() const;
+    // PNG sequence sizes as typed, e.g. "3840x2160, 1920x1080, 320"
+    QString getSizes() const;
+    PngEncoder::Options getPngOptions() const;
 
 public slots:
     void updateProgress(int value, int maximum);
@@ -25,6 +35,12 @@ private:
     QComboBox* m_formatCombo;
     QSpinBox* m_qualitySpinBox;
     QCheckBox* m_loopCheckBox;
+    QComboBox* m_ditherCombo;
+    QComboBox* m_paletteCombo;
+    QLineEdit* m_sizesEdit;
+    QComboBox* m_pngCompressionCombo;
+    QComboBox* m_pngFilterCombo;
+    QPushButton* m_exportButton;
     QProgressBar* m_progressBar;
     QLabel* m_statusLabel;
 };
@@ -0,0 +1,261 @@
+// JobScheduler.cpp
+#include "JobScheduler.h"
+#include <QThread>
+#include <QThreadPool>
+#include <QMutexLocker>
+#include <QDebug>
+
+JobScheduler::JobScheduler(QObject* parent)
+    : QObject(parent)
+    , m_pool(new QThreadPool(this))
+    , m_nextId(1)
+{
+    // Exports render on pools of their own, so job threads mostly wait on
+    // them; a few are enough to let an import or a save overtake an export
+    m_pool->setMaxThreadCount(qMax(2, QThread::idealThreadCount() / 2));
+}
+
+JobScheduler::~JobScheduler()
+{
+    cancelAll();
+    m_pool->waitForDone();
+}
+
+int JobScheduler::submit(const QString& title, Priority priority, Work work,
+    Completion completion, bool cancellable)
+{
+    auto job = std::make_shared<Job>();
+    job->work = std::move(work);
+    job->completion = std::move(completion);
+    job->info.title = title;
+    job->info.priority = priority;
+    job->info.cancellable = cancellable;
+
+    int id;
+    {
+        QMutexLocker locker(&m_mutex);
+        id = m_nextId++;
+        job->info.id = id;
+        m_jobs.insert(id, job);
+        m_order.append(id);
+    }
+
+    emit jobAdded(id);
+    m_pool->start([this, job]() { run(job); }, int(priority));
+    return id;
+}
+
+bool JobScheduler::cancel(int id)
+{
+    std::shared_ptr<Job> job;
+    {
+        QMutexLocker locker(&m_mutex);
+        job = m_jobs.value(id);
+        if (!job || !job->info.cancellable || isOver(job->info.state) || job->cancelled) {
+            return false;
+        }
+        job->cancelled = true;
+        if (job->info.state == State::Running) {
+            job->info.status = "Cancelling...";
+        }
+    }
+    notifyChanged(job);
+    return true;
+}
+
+void JobScheduler::cancelAll()
+{
+    for (int id : jobIds()) {
+        cancel(id);
+    }
+}
+
+bool JobScheduler::wait(int id)
+{
+    QMutexLocker locker(&m_mutex);
+    const std::shared_ptr<Job> job = m_jobs.value(id);
+    if (!job) {
+        return false;
+    }
+    while (!isOver(job->info.state)) {
+        m_jobDone.wait(&m_mutex);
+    }
+    return job->info.state == State::Finished;
+}
+
+void JobScheduler::waitForDone()
+{
+    m_pool->waitForDone();
+}
+
+JobScheduler::JobInfo JobScheduler::jobInfo(int id) const
+{
+    QMutexLocker locker(&m_mutex);
+    const std::shared_ptr<Job> job = m_jobs.value(id);
+    return job ? job->info : JobInfo();
+}
+
+QVector<int> JobScheduler::jobIds() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_order;
+}
+
+bool JobScheduler::hasActiveJobs() const
+{
+    QMutexLocker locker(&m_mutex);
+    for (const std::shared_ptr<Job>& job : m_jobs) {
+        if (!job->completed) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobScheduler::removeFinished()
+{
+    QVector<int> removed;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (auto it = m_jobs.begin(); it != m_jobs.end();) {
+            if (it.value()->completed) {
+                removed.append(it.key());
+                m_order.removeOne(it.key());
+                it = m_jobs.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+    for (int id : removed) {
+        emit jobRemoved(id);
+    }
+}
+
+bool JobScheduler::isOver(State state)
+{
+    return state == State::Finished || state == State::Failed || state == State::Cancelled;
+}
+
+void JobScheduler::run(const std::shared_ptr<Job>& job)
+{
+    bool started = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!job->cancelled) {
+            job->info.state = State::Running;
+            started = true;
+        }
+    }
+
+    bool success = false;
+    if (started) {
+        notifyChanged(job);
+        JobContext context(this, job);
+        success = job->work(context);
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        if (job->cancelled) {
+            job->info.state = State::Cancelled;
+            job->info.status = "Cancelled";
+        }
+        else if (success) {
+            job->info.state = State::Finished;
+            job->info.status = "Done";
+        }
+        else {
+            job->info.state = State::Failed;
+            job->info.status = job->info.error.isEmpty() ? QString("Failed") : job->info.error;
+        }
+        m_jobDone.wakeAll();
+    }
+
+    // The work captured by the job may hold large snapshots; release them
+    // on this thread rather than with the job record
+    job->work = Work();
+
+    QMetaObject::invokeMethod(this, [this, job]() { complete(job); }, Qt::QueuedConnection);
+}
+
+void JobScheduler::complete(const std::shared_ptr<Job>& job)
+{
+    JobInfo info;
+    {
+        QMutexLocker locker(&m_mutex);
+        info = job->info;
+    }
+
+    qDebug() << "Job" << info.id << info.title << "ended with state" << int(info.state);
+
+    if (job->completion) {
+        job->completion(info);
+        job->completion = Completion();
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        job->completed = true;
+    }
+
+    emit jobChanged(info.id);
+    emit jobFinished(info.id, info.state == State::Finished);
+}
+
+void JobScheduler::notifyChanged(const std::shared_ptr<Job>& job)
+{
+    // One pending notification per job; the GUI reads the latest state
+    if (job->notifyPending.exchange(true)) {
+        return;
+    }
+
+    QMetaObject::invokeMethod(this, [this, job]() {
+        job->notifyPending = false;
+        emit jobChanged(job->info.id);
+    }, Qt::QueuedConnection);
+}
+
+JobContext::JobContext(JobScheduler* scheduler, std::shared_ptr<JobScheduler::Job> job)
+    : m_scheduler(scheduler)
+    , m_job(std::move(job))
+{
+}
+
+bool JobContext::isCancelled() const
+{
+    return m_job->cancelled;
+}
+
+void JobContext::setProgress(int value, int maximum)
+{
+    {
+        QMutexLocker locker(&m_scheduler->m_mutex);
+        if (m_job->info.progress == value && m_job->info.maximum == maximum) {
+            return;
+        }
+        m_job->info.progress = value;
+        m_job->info.maximum = maximum;
+    }
+    m_scheduler->notifyChanged(m_job);
+}
+
+void JobContext::setStatus(const QString& status)
+{
+    {
+        QMutexLocker locker(&m_scheduler->m_mutex);
+        if (m_job->cancelled) {
+            return;
+        }
+        m_job->info.status = status;
+    }
+    m_scheduler->notifyChanged(m_job);
+}
+
+void JobContext::setError(const QString& error)
+{
+    QMutexLocker locker(&m_scheduler->m_mutex);
+    m_job->info.error = error;
+}
@@ -0,0 +1,138 @@
+// JobScheduler.h - Background jobs with priorities, progress and cancel
+#ifndef JOBSCHEDULER_H
+#define JOBSCHEDULER_H
+
+#include <QObject>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <QWaitCondition>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+class QThreadPool;
+class JobContext;
+
+// Runs long operations (export, import, waveform, save) on a shared thread
+// pool so the GUI thread never blocks or spins a nested event loop. Jobs are
+// started in priority order, report progress through their JobContext and
+// stop cooperatively when cancelled. Anything a job needs from the document
+// must be captured on the GUI thread before it is submitted; the completion
+// callback runs back on the GUI thread to apply the result.
+class JobScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Priority {
+        Low,
+        Normal,
+        High
+    };
+
+    enum class State {
+        Queued,
+        Running,
+        Finished,
+        Failed,
+        Cancelled
+    };
+
+    struct JobInfo {
+        int id = 0;
+        QString title;
+        Priority priority = Priority::Normal;
+        State state = State::Queued;
+        int progress = 0;
+        int maximum = 0;    // 0 while the amount of work is unknown
+        QString status;
+        QString error;
+        bool cancellable = true;
+    };
+
+    // Runs on a pool thread; returns false on failure. A job that sees
+    // JobContext::isCancelled() should return as soon as it can.
+    using Work = std::function<bool(JobContext& context)>;
+    // Runs on the GUI thread once the work returned, however it ended
+    using Completion = std::function<void(const JobInfo& info)>;
+
+    explicit JobScheduler(QObject* parent = nullptr);
+    ~JobScheduler();
+
+    int submit(const QString& title, Priority priority, Work work,
+        Completion completion = Completion(), bool cancellable = true);
+
+    // Queued jobs are dropped; running ones see isCancelled(). Returns false
+    // for jobs that are not cancellable or already over.
+    bool cancel(int id);
+    void cancelAll();
+
+    // Blocks until the job's work returned; true when it succeeded. The
+    // completion callback has not necessarily run yet.
+    bool wait(int id);
+    // Blocks until every job's work returned
+    void waitForDone();
+
+    JobInfo jobInfo(int id) const;
+    QVector<int> jobIds() const;
+    bool hasActiveJobs() const;
+
+    // Forgets jobs that are over and whose completion has run
+    void removeFinished();
+
+    static bool isOver(State state);
+
+signals:
+    void jobAdded(int id);
+    // Progress, status or state changed; coalesced so a job reporting every
+    // item does not flood the GUI thread
+    void jobChanged(int id);
+    void jobFinished(int id, bool success);
+    void jobRemoved(int id);
+
+private:
+    friend class JobContext;
+
+    struct Job {
+        JobInfo info;
+        Work work;
+        Completion completion;
+        std::atomic<bool> cancelled{ false };
+        std::atomic<bool> notifyPending{ false };
+        bool completed = false;     // Completion has run on the GUI thread
+    };
+
+    void run(const std::shared_ptr<Job>& job);
+    void complete(const std::shared_ptr<Job>& job);
+    void notifyChanged(const std::shared_ptr<Job>& job);
+
+    QThreadPool* m_pool;
+    mutable QMutex m_mutex;         // Guards m_jobs, m_order and every JobInfo
+    QWaitCondition m_jobDone;
+    QMap<int, std::shared_ptr<Job>> m_jobs;
+    QVector<int> m_order;           // Submission order, for display
+    int m_nextId;
+};
+
+// Handed to a job's work on its pool thread
+class JobContext
+{
+public:
+    bool isCancelled() const;
+
+    void setProgress(int value, int maximum);
+    void setStatus(const QString& status);
+    // Message reported when the work returns false
+    void setError(const QString& error);
+
+private:
+    friend class JobScheduler;
+    JobContext(JobScheduler* scheduler, std::shared_ptr<JobScheduler::Job> job);
+
+    JobScheduler* m_scheduler;
+    std::shared_ptr<JobScheduler::Job> m_job;
+};
+
+#endif // JOBSCHEDULER_H
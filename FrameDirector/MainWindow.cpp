@@ -1,11 +1,14 @@
 ﻿#include "MainWindow.h"
 #include "Canvas.h"
 #include "Timeline.h"
+#include "JobScheduler.h"
+#include "ProjectContainer.h"
 #include "Panels/LayerManager.h"
 #include "Panels/PropertiesPanel.h"
 #include "Panels/ToolsPanel.h"
 #include "Panels/ColorPanel.h"
 #include "Panels/AlignmentPanel.h"
+#include "Panels/JobsPanel.h"
 #include "Tools/Tool.h"
 #include "Tools/SelectionTool.h"
 #include "Tools/DrawingTool.h"
@@ -20,6 +23,9 @@
 #include "Animation/AnimationLayer.h"
 #include "Animation/AnimationKeyframe.h"
 #include "Animation/AnimationController.h"
+#include "Animation/MultiResolutionWriter.h"
+#include "Animation/CapturedFrames.h"
+#include "Animation/PlaybackCache.h"
 #include "Dialogs/ExportDialog.h"
 #include "Dialogs/AutosaveSettingsDialog.h"
 #include "Import/ORAImporter.h"
@@ -239,12 +245,17 @@ MainWindow::MainWindow(QWidget* parent)
     , m_currentTool(SelectTool)
     , m_currentFile("")
     , m_isModified(false)
+    , m_documentRevision(0)
     , m_currentFrame(1)
     , m_totalFrames(150)
     , m_currentZoom(1.0)
     , m_frameRate(24)
     , m_isPlaying(false)
     , m_playbackTimer(new QTimer(this))
+    , m_playbackCache(new PlaybackCache(this))
+    , m_jobs(new JobScheduler(this))
+    , m_waveformJob(0)
+    , m_saveJob(0)
     , m_autosaveTimer(new QTimer(this))
     , m_audioPlayer(new QMediaPlayer(this))
     , m_audioOutput(new QAudioOutput(this))
@@ -272,6 +283,14 @@ MainWindow::MainWindow(QWidget* parent)
     // Setup playback timer
     m_playbackTimer->setSingleShot(false);
     connect(m_playbackTimer, &QTimer::timeout, this, &MainWindow::onPlaybackTimer);
+    m_playbackCache->setSnapshotProvider([this](int frame) {
+        return m_canvas ? m_canvas->captureFrameSnapshot(frame) : FrameSnapshot();
+    });
+    connect(m_playbackCache, &PlaybackCache::resolutionChanged, this, [this](int) {
+        if (m_isPlaying) {
+            updatePlaybackStatus();
+        }
+    });
 
     // Setup autosave timer
     m_autosaveTimer->setSingleShot(false);
@@ -303,6 +322,17 @@ MainWindow::MainWindow(QWidget* parent)
     connect(m_canvas, &Canvas::mousePositionChanged, this, &MainWindow::onCanvasMouseMove);
     connect(m_canvas, &Canvas::zoomChanged, this, &MainWindow::onZoomChanged);
 
+    // Pre-rendered frames stay valid until an edit touches them
+    connect(m_canvas, &Canvas::changeSetReady, this, [this](const CanvasChangeSet& changes) {
+        if (changes.affectsAllFrames()) {
+            m_playbackCache->invalidate();
+            return;
+        }
+        for (const FrameRange& range : changes.frameRanges()) {
+            m_playbackCache->invalidateFrames(range.first, range.last);
+        }
+    });
+
     // Create timeline dock
     m_timelineDock = new QDockWidget("Timeline", this);
     m_timeline = new Timeline(this);
@@ -436,7 +466,7 @@ void MainWindow::connectToolsAndCanvas()
                     if (item && m_canvas && m_canvas->scene()) {
                         onSelectionChanged();
                         m_statusLabel->setText("Item created");
-                        m_isModified = true;
+                        markModified();
                     }
                     });
                 qDebug() << "Connected tool:" << static_cast<int>(toolPair.first) << "Tool object:" << tool;
@@ -476,7 +506,7 @@ void MainWindow::connectToolsAndCanvas()
         connect(m_propertiesPanel, &PropertiesPanel::propertyChanged, [this]() {
             if (m_canvas) {
                 m_canvas->storeCurrentFrameState();
-                m_isModified = true;
+                markModified();
             }
             });
 
@@ -772,6 +802,35 @@ void MainWindow::createActions()
     m_toggleRulersAction->setCheckable(true);
     connect(m_toggleRulersAction, &QAction::triggered, this, &MainWindow::toggleRulers);
 
+    m_staticLayerCachingAction = new QAction("&Flatten Other Layers While Editing", this);
+    m_staticLayerCachingAction->setStatusTip("Draw layers other than the current one from cached images");
+    m_staticLayerCachingAction->setCheckable(true);
+    connect(m_staticLayerCachingAction, &QAction::toggled, this, [this](bool enabled) {
+        if (m_canvas) {
+            m_canvas->setStaticLayerCaching(enabled);
+        }
+    });
+
+    // Resolution playback frames are rendered at; the data is a PlaybackCache::Quality
+    m_playbackQualityGroup = new QActionGroup(this);
+    const QList<QPair<QString, PlaybackCache::Quality>> playbackQualities = {
+        { "&Full Resolution", PlaybackCache::Quality::Full },
+        { "&Half Resolution", PlaybackCache::Quality::Half },
+        { "&Quarter Resolution", PlaybackCache::Quality::Quarter },
+        { "&Auto", PlaybackCache::Quality::Auto }
+    };
+    for (const auto& quality : playbackQualities) {
+        QAction* action = m_playbackQualityGroup->addAction(quality.first);
+        action->setCheckable(true);
+        action->setData(static_cast<int>(quality.second));
+    }
+    m_playbackQualityGroup->actions().last()->setStatusTip(
+        "Lower the playback resolution while frames render slower than the frame rate");
+    m_playbackQualityGroup->actions().first()->setChecked(true);
+    connect(m_playbackQualityGroup, &QActionGroup::triggered, this, [this](QAction* action) {
+        m_playbackCache->setQuality(static_cast<PlaybackCache::Quality>(action->data().toInt()));
+    });
+
     m_openRasterEditorAction = new QAction("Raster &Editor", this);
     m_openRasterEditorAction->setStatusTip("Open the raster editor window");
     m_openRasterEditorAction->setCheckable(true);
@@ -1070,6 +1129,7 @@ void MainWindow::createMenus()
     m_viewMenu->addAction(m_toggleGridAction);
     m_viewMenu->addAction(m_toggleSnapAction);
     m_viewMenu->addAction(m_toggleRulersAction);
+    m_viewMenu->addAction(m_staticLayerCachingAction);
     m_viewMenu->addSeparator();
     m_viewMenu->addAction(m_openRasterEditorAction);
 
@@ -1079,6 +1139,8 @@ void MainWindow::createMenus()
     // Playback controls
     m_animationMenu->addAction(m_playAction);
     m_animationMenu->addAction(m_stopAction);
+    QMenu* playbackQualityMenu = m_animationMenu->addMenu("Playback &Quality");
+    playbackQualityMenu->addActions(m_playbackQualityGroup->actions());
     m_animationMenu->addSeparator();
     m_animationMenu->addAction(m_applyTweeningAction);
     m_animationMenu->addAction(m_removeTweeningAction);
@@ -1514,7 +1576,7 @@ void MainWindow::importImage()
         }
 
         m_statusLabel->setText(QString("Image imported: %1").arg(fileInfo.fileName()));
-        m_isModified = true;
+        markModified();
     }
 }
 
@@ -1584,7 +1646,7 @@ void MainWindow::importLayeredImage()
         m_timeline->updateLayersFromCanvas();
 
     m_statusLabel->setText(QString("Layered image imported: %1").arg(fileInfo.fileName()));
-    m_isModified = true;
+    markModified();
 }
 
 void MainWindow::importVector()
@@ -1659,7 +1721,7 @@ void MainWindow::importVector()
         }
 
         m_statusLabel->setText(QString("SVG imported: %1").arg(fileInfo.fileName()));
-        m_isModified = true;
+        markModified();
     }
 }
 
@@ -1683,127 +1745,108 @@ void MainWindow::importMultipleFiles()
         QStandardPaths::writableLocation(QStandardPaths::PicturesLocation),
         filter);
 
-    if (!fileNames.isEmpty()) {
-        QProgressDialog progress("Importing files...", "Cancel", 0, fileNames.size(), this);
-        progress.setWindowModality(Qt::WindowModal);
-        progress.show();
-
-        int imported = 0;
-        int failed = 0;
-        QStringList failedFiles;
-
-        for (int i = 0; i < fileNames.size(); ++i) {
-            if (progress.wasCanceled()) {
-                break;
-            }
-
-            progress.setValue(i);
-            progress.setLabelText(QString("Importing %1...").arg(QFileInfo(fileNames[i]).fileName()));
-            QApplication::processEvents();
-
-            QString fileName = fileNames[i];
-            QFileInfo fileInfo(fileName);
-            bool success = false;
+    if (fileNames.isEmpty())
+        return;
 
-            if (fileInfo.suffix().toLower() == "svg") {
-                // Import SVG
-                QFile file(fileName);
-                if (!file.open(QIODevice::ReadOnly)) {
-                    failedFiles << fileInfo.fileName();
-                    ++failed;
-                    continue;
+    // Files are read and decoded in a job; the items are created back on
+    // the GUI thread, in whatever layer and frame are current by then
+    struct ImportedFile {
+        QString fileName;
+        QImage image;
+        QByteArray svgData;
+    };
+    auto importedFiles = std::make_shared<QVector<ImportedFile>>();
+    auto failedFiles = std::make_shared<QStringList>();
+
+    m_jobs->submit(QString("Import %1 files").arg(fileNames.size()), JobScheduler::Priority::Normal,
+        [fileNames, importedFiles, failedFiles](JobContext& context) {
+            for (int i = 0; i < fileNames.size(); ++i) {
+                if (context.isCancelled())
+                    return false;
+
+                const QFileInfo fileInfo(fileNames[i]);
+                context.setProgress(i, fileNames.size());
+                context.setStatus(QString("Importing %1...").arg(fileInfo.fileName()));
+
+                ImportedFile imported;
+                imported.fileName = fileInfo.absoluteFilePath();
+                if (fileInfo.suffix().toLower() == "svg") {
+                    QFile file(fileNames[i]);
+                    if (file.open(QIODevice::ReadOnly)) {
+                        imported.svgData = file.readAll();
+                        file.close();
+                    }
+                    if (imported.svgData.isEmpty() || !QSvgRenderer(imported.svgData).isValid()) {
+                        failedFiles->append(fileInfo.fileName());
+                        continue;
+                    }
                 }
+                else {
+                    imported.image = QImage(fileNames[i]);
+                    if (imported.image.isNull()) {
+                        failedFiles->append(fileInfo.fileName());
+                        continue;
+                    }
 
-                QByteArray svgData = file.readAll();
-                file.close();
-
-                if (svgData.isEmpty()) {
-                    failedFiles << fileInfo.fileName();
-                    ++failed;
-                    continue;
+                    // Scale down large images
+                    const int maxSize = 200;
+                    if (imported.image.width() > maxSize || imported.image.height() > maxSize) {
+                        imported.image = imported.image.scaled(maxSize, maxSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+                    }
                 }
-
-                QSvgRenderer renderer(svgData);
-                if (!renderer.isValid()) {
-                    failedFiles << fileInfo.fileName();
-                    ++failed;
-                    continue;
+                importedFiles->append(imported);
+            }
+            context.setProgress(fileNames.size(), fileNames.size());
+            return true;
+        },
+        [this, importedFiles, failedFiles](const JobScheduler::JobInfo&) {
+            if (!m_canvas)
+                return;
+
+            // A cancelled import keeps the files read so far
+            int imported = 0;
+            QStringList failed = *failedFiles;
+            for (const ImportedFile& file : *importedFiles) {
+                QGraphicsItem* item = nullptr;
+                if (!file.svgData.isEmpty()) {
+                    item = createSvgItemFromData(file.svgData, file.fileName);
                 }
-
-                QGraphicsSvgItem* svgItem = createSvgItemFromData(svgData, fileInfo.absoluteFilePath());
-                if (!svgItem) {
-                    failedFiles << fileInfo.fileName();
-                    ++failed;
+                else {
+                    item = new QGraphicsPixmapItem(QPixmap::fromImage(file.image));
+                }
+                if (!item) {
+                    failed << QFileInfo(file.fileName).fileName();
                     continue;
                 }
 
-                svgItem->setFlag(QGraphicsItem::ItemIsSelectable, true);
-                svgItem->setFlag(QGraphicsItem::ItemIsMovable, true);
+                item->setFlag(QGraphicsItem::ItemIsSelectable, true);
+                item->setFlag(QGraphicsItem::ItemIsMovable, true);
 
                 // Position items in a grid
                 int gridX = (imported % 5) * 150;
                 int gridY = (imported / 5) * 150;
-                svgItem->setPos(gridX, gridY);
+                item->setPos(gridX, gridY);
 
-                if (m_canvas) {
-                    QUndoCommand* command = new AddItemCommand(m_canvas, svgItem);
-                    m_undoStack->push(command);
-                    success = true;
-                }
+                QUndoCommand* command = new AddItemCommand(m_canvas, item);
+                m_undoStack->push(command);
+                ++imported;
             }
-            else {
-                // Import image
-                QPixmap pixmap(fileName);
-                if (!pixmap.isNull()) {
-                    // Scale down large images
-                    const int maxSize = 200;
-                    if (pixmap.width() > maxSize || pixmap.height() > maxSize) {
-                        pixmap = pixmap.scaled(maxSize, maxSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-                    }
-
-                    QGraphicsPixmapItem* pixmapItem = new QGraphicsPixmapItem(pixmap);
-                    pixmapItem->setFlag(QGraphicsItem::ItemIsSelectable, true);
-                    pixmapItem->setFlag(QGraphicsItem::ItemIsMovable, true);
-
-                    // Position items in a grid
-                    int gridX = (imported % 5) * 150;
-                    int gridY = (imported / 5) * 150;
-                    pixmapItem->setPos(gridX, gridY);
 
-                    if (m_canvas) {
-                        QUndoCommand* command = new AddItemCommand(m_canvas, pixmapItem);
-                        m_undoStack->push(command);
-                        success = true;
-                    }
+            QString message = QString("Import complete:\n%1 files imported successfully").arg(imported);
+            if (!failed.isEmpty()) {
+                message += QString("\n%1 files failed to import").arg(failed.size());
+                if (failed.size() <= 5) {
+                    message += QString(":\n%1").arg(failed.join("\n"));
                 }
             }
 
-            if (success) {
-                imported++;
-            }
-            else {
-                failed++;
-                failedFiles << fileInfo.fileName();
-            }
-        }
-
-        progress.close();
+            QMessageBox::information(this, "Import Results", message);
 
-        QString message = QString("Import complete:\n%1 files imported successfully").arg(imported);
-        if (failed > 0) {
-            message += QString("\n%1 files failed to import").arg(failed);
-            if (failedFiles.size() <= 5) {
-                message += QString(":\n%1").arg(failedFiles.join("\n"));
+            if (imported > 0) {
+                m_statusLabel->setText(QString("%1 files imported").arg(imported));
+                markModified();
             }
-        }
-
-        QMessageBox::information(this, "Import Results", message);
-
-        if (imported > 0) {
-            m_statusLabel->setText(QString("%1 files imported").arg(imported));
-            m_isModified = true;
-        }
-    }
+        });
 }
 
 void MainWindow::showSupportedFormats()
@@ -1902,10 +1945,7 @@ void MainWindow::onAudioDurationChanged(qint64 duration)
         return;
 
     m_audioFrameLength = static_cast<int>((duration / 1000.0) * m_frameRate);
-    if (m_timeline) {
-        m_audioWaveform = createAudioWaveform(m_audioFile, m_audioFrameLength);
-        m_timeline->setAudioTrack(m_audioFrameLength, m_audioWaveform, QFileInfo(m_audioFile).fileName());
-    }
+    updateAudioWaveform();
 }
 
 void MainWindow::onTotalFramesChanged(int frames)
@@ -1915,10 +1955,50 @@ void MainWindow::onTotalFramesChanged(int frames)
         m_frameLabel->setText(QString("Frame: %1 / %2").arg(m_currentFrame).arg(m_totalFrames));
 }
 
-QPixmap MainWindow::createAudioWaveform(const QString& fileName, int samples, int height)
+// Shows the soundtrack on the timeline right away and decodes its waveform
+// in a background job; a newer soundtrack supersedes a running decode
+void MainWindow::updateAudioWaveform()
+{
+    if (m_waveformJob) {
+        m_jobs->cancel(m_waveformJob);
+        m_waveformJob = 0;
+    }
+
+    m_audioWaveform = QPixmap();
+    if (!m_timeline || m_audioFile.isEmpty() || m_audioFrameLength <= 0)
+        return;
+    m_timeline->setAudioTrack(m_audioFrameLength, m_audioWaveform, QFileInfo(m_audioFile).fileName());
+
+    const QString fileName = m_audioFile;
+    const int frameLength = m_audioFrameLength;
+    auto waveform = std::make_shared<QImage>();
+    m_waveformJob = m_jobs->submit(QString("Waveform: %1").arg(QFileInfo(fileName).fileName()),
+        JobScheduler::Priority::Low,
+        [fileName, frameLength, waveform](JobContext& context) {
+            *waveform = createAudioWaveform(fileName, frameLength, 100, &context);
+            if (waveform->isNull()) {
+                context.setError("Cannot decode the audio file");
+                return false;
+            }
+            return true;
+        },
+        [this, fileName, waveform](const JobScheduler::JobInfo& info) {
+            if (info.id == m_waveformJob)
+                m_waveformJob = 0;
+            // The soundtrack may have been replaced while decoding
+            if (info.state != JobScheduler::State::Finished || fileName != m_audioFile || !m_timeline)
+                return;
+            m_audioWaveform = QPixmap::fromImage(*waveform);
+            m_timeline->setAudioTrack(m_audioFrameLength, m_audioWaveform, QFileInfo(m_audioFile).fileName());
+        });
+}
+
+// Runs on a job thread: decodes with a local event loop there, which is
+// why it returns a QImage rather than a QPixmap
+QImage MainWindow::createAudioWaveform(const QString& fileName, int samples, int height, JobContext* context)
 {
     if (fileName.isEmpty() || samples <= 0)
-        return QPixmap();
+        return QImage();
 
     QAudioDecoder decoder;
     decoder.setSource(QUrl::fromLocalFile(fileName));
@@ -1926,9 +2006,18 @@ QPixmap MainWindow::createAudioWaveform(const QString& fileName, int samples, in
     QVector<double> pcm;
     pcm.reserve(samples);
     bool decodeError = false;
+    QEventLoop loop;
 
     QObject::connect(&decoder, &QAudioDecoder::bufferReady, [&]() {
+        if (context && context->isCancelled()) {
+            decoder.stop();
+            loop.quit();
+            return;
+        }
+
         const QAudioBuffer buffer = decoder.read();
+        if (context && decoder.duration() > 0)
+            context->setProgress(static_cast<int>(buffer.startTime() / 1000), static_cast<int>(decoder.duration()));
         const QAudioFormat format = buffer.format();
         if (!format.isValid())
             return;
@@ -1986,7 +2075,6 @@ QPixmap MainWindow::createAudioWaveform(const QString& fileName, int samples, in
 #endif
     });
 
-    QEventLoop loop;
     QObject::connect(&decoder, &QAudioDecoder::finished, &loop, &QEventLoop::quit);
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
     // Qt6: Usa QAudioDecoder::error(QAudioDecoder::Error)
@@ -2009,8 +2097,8 @@ QPixmap MainWindow::createAudioWaveform(const QString& fileName, int samples, in
     decoder.start();
     loop.exec();
 
-    if (decodeError || pcm.isEmpty())
-        return QPixmap();
+    if (decodeError || pcm.isEmpty() || (context && context->isCancelled()))
+        return QImage();
 
     QImage image(samples, height, QImage::Format_ARGB32_Premultiplied);
     image.fill(Qt::transparent);
@@ -2041,7 +2129,7 @@ QPixmap MainWindow::createAudioWaveform(const QString& fileName, int samples, in
     }
 
     painter.end();
-    return QPixmap::fromImage(image);
+    return image;
 }
 
 void MainWindow::exportAnimation()
@@ -2052,38 +2140,98 @@ void MainWindow::exportAnimation()
         return;
 
     QString format = options.getFormat();
-    QString filter = (format == "gif") ? "GIF Files (*.gif)" : "Video Files (*.mp4)";
-    QString fileName = QFileDialog::getSaveFileName(this,
-        "Export Animation", "", filter);
+    QString filter = "Video Files (*.mp4)";
+    QString extension = format;
+    if (format == "gif") {
+        filter = "GIF Files (*.gif)";
+    }
+    else if (format == "sprites") {
+        // The JSON sidecar is chosen; atlas images are written next to it
+        filter = "Sprite Sheet Data (*.json)";
+        extension = "json";
+    }
+    // PNG sequences go into a directory, one subdirectory per size
+    QVector<QSize> sizes;
+    if (format == "png") {
+        QString error;
+        sizes = MultiResolutionWriter::parseSizes(options.getSizes(), m_canvas->getCanvasSize(), &error);
+        if (sizes.isEmpty()) {
+            QMessageBox::warning(this, "Export Animation", error);
+            return;
+        }
+    }
+
+    QString fileName = format == "png"
+        ? QFileDialog::getExistingDirectory(this, "Export PNG Sequence")
+        : QFileDialog::getSaveFileName(this, "Export Animation", "", filter);
     if (fileName.isEmpty())
         return;
 
-    if (!fileName.endsWith('.' + format, Qt::CaseInsensitive))
-        fileName += '.' + format;
-
-    int originalFrame = m_timeline ? m_timeline->getCurrentFrame() : 1;
-    if (m_timeline)
-        m_timeline->setCurrentFrame(1);
+    if (format != "png" && !fileName.endsWith('.' + extension, Qt::CaseInsensitive))
+        fileName += '.' + extension;
 
-    AnimationController controller(this);
-    int totalFrames = m_timeline ? m_timeline->getTotalFrames() : 0;
-    if (m_timeline)
-        controller.setTotalFrames(totalFrames);
+    const int totalFrames = m_timeline ? m_timeline->getTotalFrames() : m_totalFrames;
 
     // Respect the project's FPS (timeline if available, otherwise MainWindow setting)
-    int exportFps = (m_timeline ? m_timeline->getFrameRate() : m_frameRate);
-    controller.setFrameRate(exportFps);
-
-    connect(&controller, &AnimationController::exportProgress, &options, &ExportDialog::updateProgress);
-    options.show();
-    QApplication::processEvents();
-
-    bool ok = controller.exportAnimation(fileName, format, options.getQuality(), options.getLoop());
-    options.close();
-    m_statusLabel->setText(ok ? "Animation exported" : "Export failed");
+    const int exportFps = (m_timeline ? m_timeline->getFrameRate() : m_frameRate);
+    const QString gifDither = options.getGifDither();
+    const bool gifGlobalPalette = options.getGifGlobalPalette();
+    const PngEncoder::Options pngOptions = options.getPngOptions();
+    const int quality = options.getQuality();
+    const bool loop = options.getLoop();
+    const QString audioFile = m_audioFile;
+
+    // The job renders snapshots the GUI thread captures a few frames ahead
+    // of it, so editing can go on while it runs. Sprite frames are trimmed,
+    // so they leave out the background.
+    const CapturedFrames frames = CapturedFrames::capture(m_canvas, 1, totalFrames, format != "sprites");
+
+    m_jobs->submit(QString("Export %1").arg(QFileInfo(fileName).fileName()), JobScheduler::Priority::Normal,
+        [=](JobContext& context) {
+            // Closing the window cancels and waits for jobs on the GUI
+            // thread, which then no longer captures frames
+            frames.setCancelCheck([&context]() { return context.isCancelled(); });
+            AnimationController controller(nullptr);
+            controller.setCapturedFrames(frames);
+            controller.setAudioFile(audioFile);
+            controller.setTotalFrames(totalFrames);
+            controller.setFrameRate(exportFps);
+            controller.setGifOptions(gifDither, gifGlobalPalette);
+            controller.setExportSizes(sizes);
+            controller.setPngOptions(pngOptions);
+            QObject::connect(&controller, &AnimationController::exportProgress, [&context](int done, int total) {
+                context.setProgress(done, total);
+            });
 
-    if (m_timeline)
-        m_timeline->setCurrentFrame(originalFrame);
+            // The export spins this thread's event loop while frames render,
+            // which lets a timer pass a cancel request on
+            QTimer cancelPoll;
+            QObject::connect(&cancelPoll, &QTimer::timeout, &controller, [&context, &controller]() {
+                if (context.isCancelled())
+                    controller.cancelExport();
+            });
+            cancelPoll.start(100);
+
+            const bool ok = controller.exportAnimation(fileName, format, quality, loop);
+            if (!ok)
+                context.setError(controller.exportErrorString());
+            return ok;
+        },
+        [this, fileName](const JobScheduler::JobInfo& info) {
+            if (info.state == JobScheduler::State::Finished) {
+                m_statusLabel->setText("Animation exported");
+                QMessageBox::information(this, "Export Complete",
+                    "Animation exported successfully to:\n" + fileName);
+            }
+            else if (info.state == JobScheduler::State::Failed) {
+                m_statusLabel->setText("Export failed");
+                QMessageBox::warning(this, "Export Error", info.error.isEmpty() ? QString("Export failed.") : info.error);
+            }
+            else {
+                m_statusLabel->setText("Export cancelled");
+            }
+        });
+    m_statusLabel->setText("Exporting animation...");
 }
 
 void MainWindow::exportFrame()
@@ -2322,7 +2470,7 @@ void MainWindow::paste()
     }
 
     m_statusLabel->setText(QString("Pasted %1 items").arg(pastedItems.size()));
-    m_isModified = true;
+    markModified();
 }
 
 void MainWindow::selectAll()
@@ -2395,8 +2543,14 @@ void MainWindow::play()
     if (!m_isPlaying) {
         m_isPlaying = true;
         m_playbackTimer->start();
+
+        // Start pre-rendering ahead of the playhead so ticks can blit images.
+        // Frames cached by an earlier run are reused unless edits touched them.
+        m_playbackCache->resetStatistics();
+        m_playbackCache->setFrameBudget(1000.0 / m_frameRate);
+        m_playbackCache->start(m_currentFrame, 1, m_totalFrames);
         m_playAction->setText("Pause");
-        m_statusLabel->setText("Playing");
+        updatePlaybackStatus();
         emit playbackStateChanged(true); // Add this line
 
         if (!m_audioFile.isEmpty()) {
@@ -2411,13 +2565,28 @@ void MainWindow::play()
 }
 
 
+void MainWindow::updatePlaybackStatus()
+{
+    const int divisor = m_playbackCache->resolutionDivisor();
+    m_statusLabel->setText(divisor > 1 ? QString("Playing at 1/%1 resolution").arg(divisor) : QString("Playing"));
+}
+
 void MainWindow::stop()
 {
     if (m_isPlaying) {
         m_isPlaying = false;
         m_playbackTimer->stop();
+        m_playbackCache->stop();
+
+        // Paused: back to the live scene, on the frame the playhead stopped at
+        if (m_canvas && m_canvas->isShowingPlaybackFrame()) {
+            m_canvas->clearPlaybackFrame();
+            m_canvas->setCurrentFrame(m_currentFrame);
+        }
+
         m_playAction->setText("Play");
-        m_statusLabel->setText("Stopped");
+        m_statusLabel->setText(QString("Stopped (playback cache: %1 hits, %2 misses)")
+            .arg(m_playbackCache->hits()).arg(m_playbackCache->misses()));
         emit playbackStateChanged(false); // Add this line
         if (m_audioPlayer)
             m_audioPlayer->stop();
@@ -2497,7 +2666,7 @@ void MainWindow::addKeyframe()
         updateFrameActions();
         showFrameTypeIndicator();
         m_statusLabel->setText(QString("Keyframe created at frame %1").arg(m_currentFrame));
-        m_isModified = true;
+        markModified();
     }
 }
 
@@ -2514,7 +2683,7 @@ void MainWindow::insertFrame()
         updateFrameActions();
         showFrameTypeIndicator();
         m_statusLabel->setText(QString("Frame inserted at frame %1").arg(m_currentFrame));
-        m_isModified = true;
+        markModified();
     }
 }
 
@@ -2531,7 +2700,7 @@ void MainWindow::insertBlankKeyframe()
         updateFrameActions();
         showFrameTypeIndicator();
         m_statusLabel->setText(QString("Blank keyframe inserted at frame %1").arg(m_currentFrame));
-        m_isModified = true;
+        markModified();
     }
 }
 
@@ -2543,7 +2712,7 @@ void MainWindow::clearCurrentFrame()
         updateFrameActions();
         showFrameTypeIndicator();
         m_statusLabel->setText(QString("Frame %1 cleared").arg(m_currentFrame));
-        m_isModified = true;
+        markModified();
     }
 }
 
@@ -2560,7 +2729,7 @@ void MainWindow::convertToKeyframe()
         updateFrameActions();
         showFrameTypeIndicator();
         m_statusLabel->setText(QString("Frame %1 converted to keyframe").arg(m_currentFrame));
-        m_isModified = true;
+        markModified();
     }
 }
 
@@ -2689,7 +2858,7 @@ void MainWindow::applyTweening()
     }
 
     m_statusLabel->setText(QString("Tweening applied from frame %1 to %2").arg(startFrame).arg(endFrame));
-    m_isModified = true;
+    markModified();
 }
 
 // NEW: Remove tweening from current frame
@@ -2720,7 +2889,7 @@ void MainWindow::removeTweening()
     }
 
     m_statusLabel->setText(QString("Tweening removed from frame %1").arg(startFrame));
-    m_isModified = true;
+    markModified();
 }
 
 // NEW: Create actions for tweening
@@ -2740,7 +2909,8 @@ void MainWindow::onFrameChanged(int frame)
 {
     m_currentFrame = frame;
 
-    if (m_canvas) {
+    // While playback blits pre-rendered frames the live scene is left alone
+    if (m_canvas && !m_canvas->isShowingPlaybackFrame()) {
         m_canvas->setCurrentFrame(frame);
     }
 
@@ -2930,7 +3100,7 @@ void MainWindow::pasteFrame()
         .arg(pastedItems.size())
         .arg(m_currentFrame));
 
-    m_isModified = true;
+    markModified();
 
     qDebug() << "Pasted" << pastedItems.size() << "items to frame" << m_currentFrame;
 }
@@ -3042,7 +3212,7 @@ void MainWindow::setTimelineLength()
         if (m_timeline) {
             m_timeline->setTotalFrames(newLength);
             m_statusLabel->setText(QString("Timeline length set to %1 frames").arg(newLength));
-            m_isModified = true;
+            markModified();
         }
     }
 }
@@ -3058,7 +3228,7 @@ void MainWindow::createBlankKeyframe()
         }
 
         m_statusLabel->setText(QString("Blank keyframe created at frame %1").arg(m_currentFrame));
-        m_isModified = true;
+        markModified();
     }
 }
 
@@ -3078,7 +3248,7 @@ void MainWindow::removeKeyframe()
         }
         updateFrameActions();
         m_statusLabel->setText("Keyframe removed");
-        m_isModified = true;
+        markModified();
     }
 }
 
@@ -3684,6 +3854,21 @@ void MainWindow::onCanvasMouseMove(QPointF position)
 
 void MainWindow::onPlaybackTimer()
 {
+    const int next = m_currentFrame < m_totalFrames ? m_currentFrame + 1 : 1;
+
+    // Blit the pre-rendered frame when it is ready; on a miss fall back to
+    // switching the live scene
+    if (m_canvas) {
+        QImage image = m_playbackCache->frame(next);
+        if (!image.isNull()) {
+            m_canvas->showPlaybackFrame(image);
+        }
+        else {
+            m_canvas->clearPlaybackFrame();
+        }
+    }
+    m_playbackCache->setPlayhead(next);
+
     if (m_currentFrame < m_totalFrames) {
         nextFrame();
     }
@@ -3707,6 +3892,9 @@ void MainWindow::togglePanel(const QString& panelName)
     else if (panelName.toLower() == "timeline") {
         dock = m_timelineDock;
     }
+    else if (panelName.toLower() == "jobs") {
+        dock = m_jobsDock;
+    }
 
     if (dock) {
         if (dock->isVisible()) {
@@ -3808,6 +3996,9 @@ void MainWindow::updateStatusBar()
 
 bool MainWindow::maybeSave()
 {
+    // A save still being written counts as unsaved until it lands
+    waitForSave();
+
     if (m_isModified) {
         QMessageBox::StandardButton ret = QMessageBox::warning(this,
             "FrameDirector",
@@ -3816,7 +4007,8 @@ bool MainWindow::maybeSave()
             QMessageBox::Save | QMessageBox::Discard | QMessageBox::Cancel);
 
         if (ret == QMessageBox::Save) {
-            return save(), true;
+            save();
+            return waitForSave();
         }
         else if (ret == QMessageBox::Cancel) {
             return false;
@@ -3827,26 +4019,16 @@ bool MainWindow::maybeSave()
 
 void MainWindow::loadFile(const QString& fileName)
 {
-    QFile file(fileName);
-    if (!file.open(QIODevice::ReadOnly)) {
-        QMessageBox::warning(this, "Error", "Unable to open file");
-        return;
-    }
-    QByteArray data = file.readAll();
-    file.close();
-
-    QJsonDocument doc = QJsonDocument::fromJson(data);
-    if (!doc.isObject()) {
-        QMessageBox::warning(this, "Error", "Invalid project file");
+    // Binary containers and older JSON projects alike
+    ProjectContainer project;
+    if (!project.read(fileName)) {
+        QMessageBox::warning(this, "Error", project.errorString());
         return;
     }
-    QJsonObject root = doc.object();
+    const QJsonObject root = project.layout();
 
     if (m_canvas) {
-        if (root.contains("canvas"))
-            m_canvas->fromJson(root.value("canvas").toObject());
-        else
-            m_canvas->fromJson(root); // backward compatibility
+        m_canvas->fromProject(project);
         if (m_timeline) {
             m_timeline->updateLayersFromCanvas();
         }
@@ -3868,9 +4050,7 @@ void MainWindow::loadFile(const QString& fileName)
     if (!m_audioFile.isEmpty()) {
         m_audioPlayer->setSource(QUrl::fromLocalFile(m_audioFile));
         if (m_audioFrameLength > 0) {
-            m_audioWaveform = createAudioWaveform(m_audioFile, m_audioFrameLength);
-            if (m_timeline)
-                m_timeline->setAudioTrack(m_audioFrameLength, m_audioWaveform, QFileInfo(m_audioFile).fileName());
+            updateAudioWaveform();
         }
     }
 
@@ -3884,22 +4064,143 @@ bool MainWindow::saveFile(const QString& fileName)
     if (!m_canvas)
         return false;
 
-    QJsonDocument doc(createProjectJson());
-
-    QFile file(fileName);
-    if (!file.open(QIODevice::WriteOnly)) {
-        QMessageBox::warning(this, "Error", "Unable to save file");
-        return false;
-    }
-    file.write(doc.toJson());
-    file.close();
+    // Only a value copy of the project is taken here; serializing,
+    // encoding and writing it happen in a job, so the UI does not stall on
+    // large projects
+    queueSave(fileName, captureProject(), false);
 
+    // The document stays modified until the save lands, see applySaveResult
     setCurrentFile(fileName);
-    m_isModified = false;
-    m_statusLabel->setText("File saved");
+    m_statusLabel->setText("Saving...");
     return true;
 }
 
+// Every change to the document goes through here, so a save can tell
+// whether what it wrote is still the current document
+void MainWindow::markModified()
+{
+    m_isModified = true;
+    ++m_documentRevision;
+}
+
+// A save that landed leaves the document unmodified unless it changed after
+// the capture; one that failed leaves it modified. Autosaves go elsewhere and
+// change neither.
+void MainWindow::applySaveResult(const PendingSave& save, bool saved)
+{
+    if (save.autosave)
+        return;
+    if (!saved)
+        m_isModified = true;
+    else if (save.revision == m_documentRevision)
+        m_isModified = false;
+}
+
+// Saves and autosaves are written one at a time, in the order they were
+// captured, so an older snapshot never lands on top of a newer one
+void MainWindow::queueSave(const QString& fileName, const std::shared_ptr<ProjectCapture>& project, bool autosave)
+{
+    PendingSave save;
+    save.fileName = fileName;
+    save.project = project;
+    save.autosave = autosave;
+    save.revision = m_documentRevision;
+    m_pendingSaves.append(save);
+
+    startNextSave();
+    updateSaveStatus();
+}
+
+void MainWindow::startNextSave()
+{
+    if (m_saveJob || m_pendingSaves.isEmpty())
+        return;
+
+    const PendingSave save = m_pendingSaves.takeFirst();
+    const QString fileName = save.fileName;
+    const std::shared_ptr<ProjectCapture> capture = save.project;
+    const bool autosave = save.autosave;
+
+    m_currentSave = save;
+    m_currentSave.project.reset();  // The job holds it while it needs it
+    m_saveJob = m_jobs->submit(QString("%1 %2").arg(autosave ? "Autosave" : "Save", strippedName(fileName)),
+        autosave ? JobScheduler::Priority::Normal : JobScheduler::Priority::High,
+        [capture, fileName](JobContext& context) {
+            const ProjectContainer project = capture->build();
+            if (!project.write(fileName)) {
+                context.setError(QString("Unable to save file: %1").arg(project.errorString()));
+                return false;
+            }
+            return true;
+        },
+        [this, save, capture, fileName, autosave](const JobScheduler::JobInfo& info) {
+            // Unless waitForSave already took this save's result
+            if (info.id == m_saveJob) {
+                applySaveResult(save, info.state == JobScheduler::State::Finished);
+                m_saveJob = 0;
+                startNextSave();
+            }
+            updateSaveStatus();
+
+            // Pixmaps and raster sessions the job encoded skip that on the next save
+            if (m_canvas && capture->hasCanvas) {
+                m_canvas->rememberPixmapAssets(capture->canvas.encodedPixmaps());
+                m_canvas->rememberRasterSessions(capture->canvas);
+            }
+
+            if (info.state == JobScheduler::State::Finished) {
+                if (autosave) {
+                    statusBar()->showMessage(tr("Autosaved to %1").arg(fileName), 5000);
+                    m_statusLabel->setText(tr("Autosaved at %1").arg(QTime::currentTime().toString("hh:mm")));
+                }
+                else {
+                    m_statusLabel->setText("File saved");
+                }
+                return;
+            }
+            if (autosave) {
+                qWarning() << "Autosave:" << info.error;
+                statusBar()->showMessage(tr("Autosave failed: %1").arg(info.error), 5000);
+                return;
+            }
+            m_statusLabel->setText("Save failed");
+            QMessageBox::warning(this, "Error", info.error);
+        },
+        false);
+}
+
+// Blocks until every queued save is written; false if a save (not an
+// autosave) failed. Completions only run once control is back in the event
+// loop, so results are applied and the queue is advanced here.
+bool MainWindow::waitForSave()
+{
+    bool saved = true;
+    while (m_saveJob) {
+        const bool written = m_jobs->wait(m_saveJob);
+        applySaveResult(m_currentSave, written);
+        if (!written && !m_currentSave.autosave)
+            saved = false;
+        m_saveJob = 0;
+        startNextSave();
+    }
+    updateSaveStatus();
+    return saved;
+}
+
+void MainWindow::updateSaveStatus()
+{
+    if (!m_saveJob) {
+        m_saveStatusLabel->hide();
+        return;
+    }
+
+    QString text = m_currentSave.autosave ? tr("Autosaving...") : tr("Saving...");
+    if (!m_pendingSaves.isEmpty())
+        text += tr(" (%1 queued)").arg(m_pendingSaves.size());
+    m_saveStatusLabel->setText(text);
+    m_saveStatusLabel->show();
+}
+
 void MainWindow::setCurrentFile(const QString& fileName)
 {
     m_currentFile = fileName;
@@ -3916,24 +4217,53 @@ QUndoStack* MainWindow::undoStack() const
     return m_undoStack;
 }
 
-QJsonObject MainWindow::createProjectJson() const
+// Everything a save writes, as values: captured on the GUI thread, then
+// turned into a ProjectContainer on the save job's thread
+struct MainWindow::ProjectCapture {
+    bool hasCanvas = false;
+    CanvasSnapshot canvas;
+    QJsonObject root;               // Audio settings
+    bool hasRasterEditor = false;
+    RasterEditorWindow::State rasterEditor;
+
+    // Frame content goes into per-span chunks; everything else is the layout
+    ProjectContainer build() const {
+        QJsonObject layout = root;
+        ProjectContainer project;
+        if (hasCanvas) {
+            QVector<ProjectFrameChunk> frames;
+            QHash<QString, FrameDirector::EncodedChunk> assets;
+            layout["canvas"] = canvas.toProject(frames, assets);
+            project.setFrames(frames);
+            project.setAssets(assets);
+        }
+        if (hasRasterEditor) {
+            layout["rasterEditor"] = rasterEditor.toJson();
+        }
+        project.setLayout(layout);
+        return project;
+    }
+};
+
+std::shared_ptr<MainWindow::ProjectCapture> MainWindow::captureProject() const
 {
-    QJsonObject root;
+    auto capture = std::make_shared<ProjectCapture>();
 
     if (m_canvas) {
-        root["canvas"] = m_canvas->toJson();
+        capture->hasCanvas = true;
+        capture->canvas = m_canvas->captureSnapshot();
     }
 
     if (!m_audioFile.isEmpty()) {
-        root["audioFile"] = m_audioFile;
-        root["audioFrameLength"] = m_audioFrameLength;
+        capture->root["audioFile"] = m_audioFile;
+        capture->root["audioFrameLength"] = m_audioFrameLength;
     }
 
     if (m_rasterEditorWindow) {
-        root["rasterEditor"] = m_rasterEditorWindow->toJson();
+        capture->hasRasterEditor = true;
+        capture->rasterEditor = m_rasterEditorWindow->captureState();
     }
-
-    return root;
+    return capture;
 }
 
 void MainWindow::readSettings()
@@ -3955,6 +4285,14 @@ void MainWindow::readSettings()
     if (m_autosaveDirectory.isEmpty()) {
         m_autosaveDirectory = defaultAutosaveDirectory();
     }
+
+    const int playbackQuality = settings.value("playback/quality", static_cast<int>(PlaybackCache::Quality::Full)).toInt();
+    for (QAction* action : m_playbackQualityGroup->actions()) {
+        if (action->data().toInt() == playbackQuality) {
+            action->setChecked(true);
+            m_playbackCache->setQuality(static_cast<PlaybackCache::Quality>(playbackQuality));
+        }
+    }
 }
 
 void MainWindow::writeSettings()
@@ -3964,6 +4302,7 @@ void MainWindow::writeSettings()
     settings.setValue("windowState", saveState());
     settings.setValue("autosave/intervalMinutes", m_autosaveIntervalMinutes);
     settings.setValue("autosave/directory", m_autosaveDirectory);
+    settings.setValue("playback/quality", static_cast<int>(m_playbackCache->quality()));
     settings.setValue("session/inProgress", false);
     settings.sync();
 }
@@ -4056,7 +4395,7 @@ bool MainWindow::promptToRecoverAutosave()
     }
 
     loadFile(latestFile.absoluteFilePath());
-    m_isModified = true;
+    markModified();
     m_currentFile.clear();
     m_recoveredAutosavePath = latestFile.absoluteFilePath();
 
@@ -4079,14 +4418,13 @@ bool MainWindow::promptToRecoverAutosave()
     return true;
 }
 
-bool MainWindow::writeProjectSnapshot(const QString& fileName) const
+// Captures the project and queues it to be written to fileName
+bool MainWindow::writeProjectSnapshot(const QString& fileName)
 {
     if (!m_canvas) {
         return false;
     }
 
-    QJsonDocument doc(createProjectJson());
-
     QFileInfo fileInfo(fileName);
     QDir directory = fileInfo.dir();
     if (!directory.exists()) {
@@ -4095,13 +4433,7 @@ bool MainWindow::writeProjectSnapshot(const QString& fileName) const
         }
     }
 
-    QFile file(fileName);
-    if (!file.open(QIODevice::WriteOnly)) {
-        return false;
-    }
-
-    file.write(doc.toJson());
-    file.close();
+    queueSave(fileName, captureProject(), true);
     return true;
 }
 
@@ -4120,6 +4452,14 @@ void MainWindow::performAutosave()
         return;
     }
 
+    // While an earlier autosave still waits behind another save, the next
+    // tick catches up instead of queueing a second one
+    for (const PendingSave& save : m_pendingSaves) {
+        if (save.autosave) {
+            return;
+        }
+    }
+
     if (m_autosaveDirectory.isEmpty()) {
         m_autosaveDirectory = defaultAutosaveDirectory();
     }
@@ -4140,11 +4480,9 @@ void MainWindow::performAutosave()
     const QString fileName = QStringLiteral("%1_autosave_%2.fdr").arg(baseName, timestamp);
     const QString fullPath = directory.filePath(fileName);
 
-    if (writeProjectSnapshot(fullPath)) {
-        statusBar()->showMessage(tr("Autosaved to %1").arg(fullPath), 5000);
-        if (m_statusLabel) {
-            m_statusLabel->setText(tr("Autosaved at %1").arg(QTime::currentTime().toString("hh:mm")));
-        }
+    // Reported by the save job once written
+    if (!writeProjectSnapshot(fullPath)) {
+        qWarning() << "Autosave: Unable to write" << fullPath;
     }
 }
 
@@ -4163,6 +4501,10 @@ void MainWindow::closeEvent(QCloseEvent* event)
             m_autosaveTimer->stop();
         }
 
+        // Background jobs must not outlive the document they work on
+        m_jobs->cancelAll();
+        m_jobs->waitForDone();
+
         // 2. Clean up all tools
         qDebug() << "Cleaning up tools before close...";
         for (auto& toolPair : m_tools) {
@@ -4259,8 +4601,11 @@ void MainWindow::createStatusBar()
     m_frameLabel = new QLabel("Frame: 1");
     m_selectionLabel = new QLabel("No selection");
     m_fpsLabel = new QLabel("FPS: 24");
+    m_saveStatusLabel = new QLabel;
+    m_saveStatusLabel->hide();
 
     statusBar()->addWidget(m_statusLabel);
+    statusBar()->addPermanentWidget(m_saveStatusLabel);
     statusBar()->addPermanentWidget(m_positionLabel);
     statusBar()->addPermanentWidget(m_zoomLabel);
     statusBar()->addPermanentWidget(m_frameLabel);
@@ -4302,6 +4647,21 @@ void MainWindow::createDockWindows()
     m_propertiesDock->setFeatures(QDockWidget::DockWidgetMovable | QDockWidget::DockWidgetFloatable);
     addDockWidget(Qt::RightDockWidgetArea, m_propertiesDock);
 
+    // Background jobs (export, import, waveform, save)
+    m_jobsDock = new QDockWidget("Jobs", this);
+    m_jobsPanel = new JobsPanel(m_jobs, this);
+    m_jobsDock->setWidget(m_jobsPanel);
+    m_jobsDock->setFeatures(QDockWidget::DockWidgetMovable | QDockWidget::DockWidgetFloatable |
+        QDockWidget::DockWidgetClosable);
+    addDockWidget(Qt::RightDockWidgetArea, m_jobsDock);
+    m_jobsDock->hide();
+    // Saves cannot be cancelled and have their own status bar indicator, so
+    // an autosave does not pop the dock up mid-stroke
+    connect(m_jobs, &JobScheduler::jobAdded, this, [this](int id) {
+        if (m_jobs->jobInfo(id).cancellable)
+            m_jobsDock->show();
+    });
+
     m_rasterEditorWindow = new RasterEditorWindow(this);
     m_rasterEditorWindow->resize(980, 720);
     m_rasterEditorWindow->hide();
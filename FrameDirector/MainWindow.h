@@ -67,6 +67,9 @@ class PropertiesPanel;
 class ToolsPanel;
 class ColorPanel;
 class AlignmentPanel;
+class JobsPanel;
+class JobScheduler;
+class JobContext;
 class RasterEditorWindow;
 class Tool;
 class DrawingTool;
@@ -74,6 +77,7 @@ class SelectionTool;
 class VectorGraphicsItem;
 class AnimationKeyframe;
 class AnimationLayer;
+class PlaybackCache;
 class AddItemCommand;
 class DrawCommand;
 class UndoCommands;
@@ -272,6 +276,7 @@ private:
     void createDockWindows();
     void createStatusBar();
     void setupAnimationSystem();
+    void updatePlaybackStatus();
     void setupStyleSheet();
     void readSettings();
     void writeSettings();
@@ -281,11 +286,17 @@ private:
     bool ensureAutosaveDirectoryExists() const;
     QString defaultAutosaveDirectory() const;
     bool promptToRecoverAutosave();
-    bool writeProjectSnapshot(const QString& fileName) const;
-    QJsonObject createProjectJson() const;
+    bool writeProjectSnapshot(const QString& fileName);
+    struct ProjectCapture;
+    std::shared_ptr<ProjectCapture> captureProject() const;
     bool maybeSave();
     void loadFile(const QString& fileName);
     bool saveFile(const QString& fileName);
+    bool waitForSave();
+    void markModified();
+    void queueSave(const QString& fileName, const std::shared_ptr<ProjectCapture>& project, bool autosave);
+    void startNextSave();
+    void updateSaveStatus();
     void setCurrentFile(const QString& fileName);
     void updateRecentFileActions();
     QString strippedName(const QString& fullFileName);
@@ -294,7 +305,9 @@ private:
     void updateStatusBar();
     void updateImportMenu();
     void showFrameTypeIndicator();      // Show current frame type in status bar
-    QPixmap createAudioWaveform(const QString& fileName, int samples, int height = 100);
+    void updateAudioWaveform();
+    static QImage createAudioWaveform(const QString& fileName, int samples, int height = 100,
+        JobContext* context = nullptr);
 
 
     struct FrameClipboard {
@@ -366,6 +379,7 @@ private:
     QDockWidget* m_colorDock;
     QDockWidget* m_alignmentDock;
     QDockWidget* m_timelineDock;
+    QDockWidget* m_jobsDock;
     RasterEditorWindow* m_rasterEditorWindow;
 
     // Panels
@@ -373,6 +387,7 @@ private:
     PropertiesPanel* m_propertiesPanel;
     ColorPanel* m_colorPanel;
     AlignmentPanel* m_alignmentPanel;
+    JobsPanel* m_jobsPanel;
     QTabWidget* m_rightPanelTabs;
 
     // Tools
@@ -383,12 +398,28 @@ private:
     // Current state
     QString m_currentFile;
     bool m_isModified;
+    quint64 m_documentRevision;     // Bumped by markModified
     int m_currentFrame;
     int m_totalFrames;
     double m_currentZoom;
     int m_frameRate;
     bool m_isPlaying;
     QTimer* m_playbackTimer;
+    PlaybackCache* m_playbackCache; // Frames pre-rendered ahead of the playhead
+    JobScheduler* m_jobs;           // Export, import, waveform and save jobs
+    int m_waveformJob;              // Running waveform decode, or 0
+    int m_saveJob;                  // Save still being written, or 0
+
+    // Project captured on the GUI thread, waiting to be written
+    struct PendingSave {
+        QString fileName;
+        std::shared_ptr<ProjectCapture> project;
+        bool autosave = false;
+        quint64 revision = 0;       // m_documentRevision when captured
+    };
+    PendingSave m_currentSave;      // The one m_saveJob writes
+    QList<PendingSave> m_pendingSaves; // Behind m_saveJob, oldest first
+    void applySaveResult(const PendingSave& save, bool saved);
     QTimer* m_autosaveTimer;
     QMediaPlayer* m_audioPlayer; // NEW
     QAudioOutput* m_audioOutput; // NEW
@@ -448,6 +479,8 @@ private:
     QAction* m_toggleGridAction;
     QAction* m_toggleSnapAction;
     QAction* m_toggleRulersAction;
+    QAction* m_staticLayerCachingAction;
+    QActionGroup* m_playbackQualityGroup;
     QAction* m_openRasterEditorAction;
 
     // Actions - Animation Menu
@@ -524,6 +557,7 @@ private:
     QLabel* m_frameLabel;
     QLabel* m_selectionLabel;
     QLabel* m_fpsLabel;
+    QLabel* m_saveStatusLabel;      // Shown while saves are being written
     QAction* m_pasteFrameAction;
 
     // Recent files
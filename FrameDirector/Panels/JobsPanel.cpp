@@ -0,0 +1,151 @@
+// Panels/JobsPanel.cpp
+#include "JobsPanel.h"
+#include "../JobScheduler.h"
+#include <QHBoxLayout>
+#include <QScrollArea>
+
+JobsPanel::JobsPanel(JobScheduler* scheduler, QWidget* parent)
+    : QWidget(parent)
+    , m_scheduler(scheduler)
+{
+    setupUI();
+
+    connect(m_scheduler, &JobScheduler::jobAdded, this, &JobsPanel::onJobAdded);
+    connect(m_scheduler, &JobScheduler::jobChanged, this, &JobsPanel::onJobChanged);
+    connect(m_scheduler, &JobScheduler::jobRemoved, this, &JobsPanel::onJobRemoved);
+
+    for (int id : m_scheduler->jobIds()) {
+        onJobAdded(id);
+    }
+}
+
+void JobsPanel::setupUI()
+{
+    QVBoxLayout* mainLayout = new QVBoxLayout(this);
+    mainLayout->setContentsMargins(4, 4, 4, 4);
+    mainLayout->setSpacing(4);
+
+    QWidget* jobsWidget = new QWidget;
+    m_jobsLayout = new QVBoxLayout(jobsWidget);
+    m_jobsLayout->setContentsMargins(0, 0, 0, 0);
+    m_jobsLayout->setSpacing(6);
+
+    m_emptyLabel = new QLabel("No background jobs");
+    m_emptyLabel->setStyleSheet("color: #888888;");
+    m_jobsLayout->addWidget(m_emptyLabel);
+    m_jobsLayout->addStretch();
+
+    QScrollArea* scrollArea = new QScrollArea;
+    scrollArea->setWidget(jobsWidget);
+    scrollArea->setWidgetResizable(true);
+    scrollArea->setFrameShape(QFrame::NoFrame);
+    mainLayout->addWidget(scrollArea);
+
+    m_clearButton = new QPushButton("Clear Finished");
+    m_clearButton->setEnabled(false);
+    connect(m_clearButton, &QPushButton::clicked, m_scheduler, &JobScheduler::removeFinished);
+    mainLayout->addWidget(m_clearButton);
+}
+
+void JobsPanel::onJobAdded(int id)
+{
+    if (m_rows.contains(id)) {
+        return;
+    }
+
+    JobRow row;
+    row.widget = new QWidget;
+    QVBoxLayout* rowLayout = new QVBoxLayout(row.widget);
+    rowLayout->setContentsMargins(0, 0, 0, 0);
+    rowLayout->setSpacing(2);
+
+    QHBoxLayout* headerLayout = new QHBoxLayout;
+    row.titleLabel = new QLabel;
+    row.cancelButton = new QToolButton;
+    row.cancelButton->setText("Cancel");
+    row.cancelButton->setToolTip("Cancel this job");
+    connect(row.cancelButton, &QToolButton::clicked, this, [this, id]() {
+        m_scheduler->cancel(id);
+    });
+    headerLayout->addWidget(row.titleLabel, 1);
+    headerLayout->addWidget(row.cancelButton);
+    rowLayout->addLayout(headerLayout);
+
+    row.progressBar = new QProgressBar;
+    row.progressBar->setMaximumHeight(12);
+    row.progressBar->setTextVisible(false);
+    rowLayout->addWidget(row.progressBar);
+
+    row.statusLabel = new QLabel;
+    row.statusLabel->setStyleSheet("color: #AAAAAA;");
+    rowLayout->addWidget(row.statusLabel);
+
+    // Newest jobs first, above the stretch
+    m_jobsLayout->insertWidget(0, row.widget);
+    m_rows.insert(id, row);
+
+    onJobChanged(id);
+    updateEmptyState();
+}
+
+void JobsPanel::onJobChanged(int id)
+{
+    auto it = m_rows.find(id);
+    if (it == m_rows.end()) {
+        return;
+    }
+
+    const JobScheduler::JobInfo info = m_scheduler->jobInfo(id);
+    const bool over = JobScheduler::isOver(info.state);
+    JobRow& row = it.value();
+
+    row.titleLabel->setText(info.title);
+    row.cancelButton->setVisible(info.cancellable && !over);
+
+    QString status = info.status;
+    if (status.isEmpty()) {
+        status = info.state == JobScheduler::State::Queued ? QString("Queued") : QString("Running");
+    }
+    row.statusLabel->setText(status);
+
+    if (over) {
+        row.progressBar->setRange(0, 1);
+        row.progressBar->setValue(info.state == JobScheduler::State::Finished ? 1 : 0);
+    }
+    else if (info.state == JobScheduler::State::Running && info.maximum <= 0) {
+        // Busy indicator until the job knows how much work there is
+        row.progressBar->setRange(0, 0);
+    }
+    else {
+        row.progressBar->setRange(0, qMax(1, info.maximum));
+        row.progressBar->setValue(info.progress);
+    }
+
+    updateEmptyState();
+}
+
+void JobsPanel::onJobRemoved(int id)
+{
+    auto it = m_rows.find(id);
+    if (it == m_rows.end()) {
+        return;
+    }
+
+    it.value().widget->deleteLater();
+    m_rows.erase(it);
+    updateEmptyState();
+}
+
+void JobsPanel::updateEmptyState()
+{
+    bool anyOver = false;
+    for (auto it = m_rows.cbegin(); it != m_rows.cend(); ++it) {
+        if (JobScheduler::isOver(m_scheduler->jobInfo(it.key()).state)) {
+            anyOver = true;
+            break;
+        }
+    }
+
+    m_emptyLabel->setVisible(m_rows.isEmpty());
+    m_clearButton->setEnabled(anyOver);
+}
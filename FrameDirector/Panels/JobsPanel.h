@@ -0,0 +1,46 @@
+// Panels/JobsPanel.h - Progress and cancel for background jobs
+#ifndef JOBSPANEL_H
+#define JOBSPANEL_H
+
+#include <QWidget>
+#include <QVBoxLayout>
+#include <QLabel>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QToolButton>
+#include <QMap>
+
+class JobScheduler;
+
+class JobsPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit JobsPanel(JobScheduler* scheduler, QWidget* parent = nullptr);
+
+private slots:
+    void onJobAdded(int id);
+    void onJobChanged(int id);
+    void onJobRemoved(int id);
+
+private:
+    struct JobRow {
+        QWidget* widget;
+        QLabel* titleLabel;
+        QLabel* statusLabel;
+        QProgressBar* progressBar;
+        QToolButton* cancelButton;
+    };
+
+    void setupUI();
+    void updateEmptyState();
+
+    JobScheduler* m_scheduler;
+    QVBoxLayout* m_jobsLayout;
+    QLabel* m_emptyLabel;
+    QPushButton* m_clearButton;
+    QMap<int, JobRow> m_rows;
+};
+
+#endif // JOBSPANEL_H
@@ -0,0 +1,494 @@
+// ProjectContainer.cpp
+#include "ProjectContainer.h"
+#include <QCborArray>
+#include <QCborMap>
+#include <QCborValue>
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QMap>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <limits>
+
+using namespace FrameDirector;
+
+namespace {
+
+const char kMagic[] = "FDRP";
+const int kHeaderSize = 32;
+
+// Below this, zlib's own header and trailer outweigh what it saves
+const int kCompressThreshold = 64;
+
+// Pinned, so the encoding of the header and index does not follow Qt's
+const QDataStream::Version kStreamVersion = QDataStream::Qt_6_0;
+
+enum IndexFlag : quint8 {
+    HasTween = 0x01
+};
+
+void writeHeader(QDataStream& out, quint64 layoutOffset, quint32 layoutSize, quint64 indexOffset, quint32 indexCount)
+{
+    out.writeRawData(kMagic, 4);
+    out << quint16(ProjectContainer::Version) << quint16(0)
+        << layoutOffset << layoutSize << indexOffset << indexCount;
+}
+
+}
+
+// An open project file, which the chunks and assets read() returns point
+// into. Mapped where the platform allows it, so reading a chunk touches only
+// its own pages; otherwise each read seeks. A save over the file moves the
+// source to the new file: chunks keep their original offsets, which then map
+// to where the save wrote them.
+class ProjectFile : public ChunkSource
+{
+public:
+    bool open(const QString& fileName) {
+        m_fileName = fileName;
+        QMutexLocker lock(&m_mutex);
+        return openFile();
+    }
+
+    qint64 size() const { return m_size; }
+
+    // Called by read() for every chunk and asset it hands out
+    void addRange(quint64 offset, quint32 size) { m_ranges.insert(offset, size); }
+
+    QByteArray read(quint64 offset, quint32 size) const override {
+        QMutexLocker lock(&m_mutex);
+        while (m_replacing) {
+            m_reopened.wait(&m_mutex);
+        }
+        return readChunk(offset, size);
+    }
+
+    QString fileName() const override { return m_fileName; }
+
+    void beginReplace(const QHash<quint64, quint64>& moved) override {
+        QMutexLocker lock(&m_mutex);
+        // Chunks no longer in the project, which an undo may still bring back
+        for (auto it = m_ranges.constBegin(); it != m_ranges.constEnd(); ++it) {
+            if (!moved.contains(it.key()) && !m_kept.contains(it.key())) {
+                m_kept.insert(it.key(), readChunk(it.key(), it.value()));
+            }
+        }
+#ifdef Q_OS_WIN
+        // A file that is open or mapped cannot be renamed over
+        closeFile();
+        m_replacing = true;
+#endif
+    }
+
+    void endReplace(bool replaced, const QHash<quint64, quint64>& moved) override {
+        QMutexLocker lock(&m_mutex);
+        if (replaced) {
+            closeFile();
+            m_moved = moved;
+            m_relocated = true;
+            for (auto it = moved.constBegin(); it != moved.constEnd(); ++it) {
+                m_kept.remove(it.key());
+            }
+        }
+        if (!m_file.isOpen() && !openFile()) {
+            qDebug() << "ProjectContainer: cannot reopen" << m_fileName;
+        }
+        m_replacing = false;
+        m_reopened.wakeAll();
+    }
+
+private:
+    bool openFile() {
+        m_file.setFileName(m_fileName);
+        if (!m_file.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+        m_size = m_file.size();
+        m_data = m_size > 0 ? m_file.map(0, m_size) : nullptr;
+        return true;
+    }
+
+    void closeFile() {
+        if (m_data) {
+            m_file.unmap(m_data);
+            m_data = nullptr;
+        }
+        m_file.close();
+    }
+
+    // With m_mutex held
+    QByteArray readChunk(quint64 offset, quint32 size) const {
+        auto kept = m_kept.constFind(offset);
+        if (kept != m_kept.constEnd()) {
+            return kept.value();
+        }
+        if (m_relocated) {
+            auto moved = m_moved.constFind(offset);
+            if (moved == m_moved.constEnd()) {
+                return QByteArray();
+            }
+            offset = moved.value();
+        }
+        if (!m_file.isOpen() || offset > quint64(m_size) || size > quint64(m_size) - offset) {
+            return QByteArray();
+        }
+        if (m_data) {
+            return QByteArray(reinterpret_cast<const char*>(m_data) + offset, qsizetype(size));
+        }
+        if (!m_file.seek(qint64(offset))) {
+            return QByteArray();
+        }
+        const QByteArray bytes = m_file.read(size);
+        return bytes.size() == qsizetype(size) ? bytes : QByteArray();
+    }
+
+    QString m_fileName;
+    mutable QFile m_file;
+    mutable QMutex m_mutex;
+    mutable QWaitCondition m_reopened;
+    uchar* m_data = nullptr;
+    qint64 m_size = 0;
+    QMap<quint64, quint32> m_ranges;    // Offset and size of every chunk handed out
+    QHash<quint64, quint64> m_moved;    // Original offset -> offset in the file now
+    QHash<quint64, QByteArray> m_kept;  // Chunks the last save left out, by original offset
+    bool m_relocated = false;
+    bool m_replacing = false;
+};
+
+bool ProjectContainer::isContainer(const QString& fileName)
+{
+    QFile file(fileName);
+    return file.open(QIODevice::ReadOnly) && file.read(4) == QByteArray(kMagic, 4);
+}
+
+bool ProjectContainer::read(const QString& fileName)
+{
+    m_layout = QJsonObject();
+    m_frames.clear();
+    m_assets.clear();
+    m_json = false;
+    m_error.clear();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_error = "Unable to open file";
+        return false;
+    }
+    if (file.read(4) != QByteArray(kMagic, 4)) {
+        file.seek(0);
+        return readJson(file.readAll());
+    }
+    file.close();
+
+    auto source = std::make_shared<ProjectFile>();
+    if (!source->open(fileName)) {
+        m_error = "Unable to open file";
+        return false;
+    }
+    return readContainer(source, source->size());
+}
+
+bool ProjectContainer::readJson(const QByteArray& data)
+{
+    const QJsonDocument doc = QJsonDocument::fromJson(data);
+    if (!doc.isObject()) {
+        m_error = "Invalid project file";
+        return false;
+    }
+    m_layout = doc.object();
+    m_json = true;
+    return true;
+}
+
+bool ProjectContainer::readContainer(const std::shared_ptr<ProjectFile>& file, qint64 size)
+{
+    auto inFile = [size](quint64 offset, quint64 length) {
+        return offset <= quint64(size) && length <= quint64(size) - offset;
+    };
+
+    const QByteArray header = file->read(0, kHeaderSize);
+    QDataStream in(header);
+    in.setVersion(kStreamVersion);
+    in.setByteOrder(QDataStream::LittleEndian);
+    in.skipRawData(4);
+
+    quint16 version = 0;
+    quint16 flags = 0;
+    quint64 layoutOffset = 0;
+    quint32 layoutSize = 0;
+    quint64 indexOffset = 0;
+    quint32 indexCount = 0;
+    in >> version >> flags >> layoutOffset >> layoutSize >> indexOffset >> indexCount;
+    if (in.status() != QDataStream::Ok || header.size() < kHeaderSize) {
+        m_error = "Damaged project file";
+        return false;
+    }
+    if (version > Version) {
+        m_error = "The project was saved by a newer version of FrameDirector";
+        return false;
+    }
+
+    const QByteArray layoutChunk = inFile(layoutOffset, layoutSize) ? file->read(layoutOffset, layoutSize) : QByteArray();
+    QCborParserError parseError;
+    const QCborValue layout = QCborValue::fromCbor(decodeChunk(layoutChunk), &parseError);
+    if (layoutChunk.isNull() || parseError.error != QCborError::NoError || !layout.isMap()) {
+        m_error = "Damaged project file";
+        return false;
+    }
+    m_layout = layout.toMap().toJsonObject();
+
+    // The index runs from its offset to the end of the file
+    if (indexOffset > quint64(size) || quint64(size) - indexOffset > std::numeric_limits<quint32>::max()) {
+        m_error = "Damaged project file";
+        return false;
+    }
+    const QByteArray index = file->read(indexOffset, quint32(quint64(size) - indexOffset));
+    QDataStream entries(index);
+    entries.setVersion(kStreamVersion);
+    entries.setByteOrder(QDataStream::LittleEndian);
+
+    m_frames.reserve(int(qMin<quint64>(indexCount, quint64(index.size()) / 32)));
+    for (quint32 i = 0; i < indexCount; ++i) {
+        qint32 layer = 0;
+        qint32 keyframe = 0;
+        qint32 lastFrame = 0;
+        quint8 entryFlags = 0;
+        qint32 tweenEnd = -1;
+        quint64 offset = 0;
+        quint32 chunkSize = 0;
+        QByteArray easing;
+        entries >> layer >> keyframe >> lastFrame >> entryFlags >> tweenEnd >> offset >> chunkSize >> easing;
+        if (entries.status() != QDataStream::Ok || chunkSize == 0 || !inFile(offset, chunkSize)) {
+            m_error = "Damaged project file";
+            m_frames.clear();
+            return false;
+        }
+
+        ProjectFrameChunk frame;
+        frame.layer = layer;
+        frame.keyframe = keyframe;
+        frame.lastFrame = lastFrame;
+        frame.hasTween = entryFlags & HasTween;
+        frame.tweenEnd = tweenEnd;
+        frame.easing = easing.isEmpty() ? QString("linear") : QString::fromUtf8(easing);
+        frame.data = EncodedChunk(file, offset, chunkSize);
+        file->addRange(offset, chunkSize);
+        m_frames.append(frame);
+    }
+
+    quint32 assetCount = 0;
+    if (version >= 2) {
+        entries >> assetCount;
+    }
+    for (quint32 i = 0; i < assetCount; ++i) {
+        QByteArray hash;
+        quint64 offset = 0;
+        quint32 assetSize = 0;
+        entries >> hash >> offset >> assetSize;
+        if (entries.status() != QDataStream::Ok || !inFile(offset, assetSize)) {
+            m_error = "Damaged project file";
+            m_frames.clear();
+            m_assets.clear();
+            return false;
+        }
+        m_assets.insert(QString::fromLatin1(hash), EncodedChunk(file, offset, assetSize));
+        file->addRange(offset, assetSize);
+    }
+
+    qDebug() << "ProjectContainer: indexed" << m_frames.size() << "frame chunks and"
+             << m_assets.size() << "assets, version" << version;
+    return true;
+}
+
+bool ProjectContainer::write(const QString& fileName) const
+{
+    m_error.clear();
+
+    // Each layer's chunks are encoded and compressed on a thread of their
+    // own; the file is then written in index order
+    QVector<QByteArray> chunks(m_frames.size());
+    QByteArray* encoded = chunks.data();
+    QMap<int, QVector<int>> layerChunks;
+    for (int i = 0; i < m_frames.size(); ++i) {
+        if (m_frames[i].data.isNull()) {
+            layerChunks[m_frames[i].layer].append(i);
+        }
+    }
+    QThreadPool pool;
+    for (auto it = layerChunks.constBegin(); it != layerChunks.constEnd(); ++it) {
+        const QVector<int> indices = it.value();
+        pool.start([this, indices, encoded]() {
+            for (int i : indices) {
+                encoded[i] = encodeItems(m_frames[i].items);
+            }
+        });
+    }
+    pool.waitForDone();
+
+    // Chunks copied from the file being replaced, by source: where each one
+    // ends up in the new file
+    const QString target = QFileInfo(fileName).absoluteFilePath();
+    QHash<ChunkSource*, bool> replacedSources;
+    QHash<ChunkSource*, QHash<quint64, quint64>> moved;
+    auto recordMove = [&](const EncodedChunk& chunk, quint64 offset) {
+        ChunkSource* source = chunk.source();
+        if (!source) {
+            return;
+        }
+        auto known = replacedSources.constFind(source);
+        if (known == replacedSources.constEnd()) {
+            known = replacedSources.insert(source, QFileInfo(source->fileName()).absoluteFilePath() == target);
+        }
+        if (known.value()) {
+            moved[source].insert(chunk.offset(), offset);
+        }
+    };
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        m_error = file.errorString();
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(kStreamVersion);
+    out.setByteOrder(QDataStream::LittleEndian);
+
+    // Written again at the end, once the offsets are known
+    writeHeader(out, 0, 0, 0, 0);
+
+    const QByteArray layout = encodeChunk(QCborMap::fromJsonObject(m_layout).toCborValue().toCbor());
+    const quint64 layoutOffset = quint64(file.pos());
+    out.writeRawData(layout.constData(), int(layout.size()));
+
+    QVector<quint64> offsets;
+    QVector<quint32> sizes;
+    offsets.reserve(m_frames.size() + m_assets.size());
+    sizes.reserve(m_frames.size() + m_assets.size());
+    // Chunks copied through are read one at a time as they are written
+    bool copied = true;
+    for (int i = 0; i < m_frames.size() && copied; ++i) {
+        const QByteArray chunk = m_frames[i].data.isNull() ? chunks[i] : m_frames[i].data.bytes();
+        copied = !chunk.isEmpty();
+        recordMove(m_frames[i].data, quint64(file.pos()));
+        offsets.append(quint64(file.pos()));
+        sizes.append(quint32(chunk.size()));
+        out.writeRawData(chunk.constData(), int(chunk.size()));
+    }
+
+    // PNGs are already compressed, so assets are stored as they are
+    QVector<QString> assetHashes;
+    assetHashes.reserve(m_assets.size());
+    for (auto it = m_assets.constBegin(); it != m_assets.constEnd() && copied; ++it) {
+        const QByteArray png = it.value().bytes();
+        copied = !png.isNull();
+        recordMove(it.value(), quint64(file.pos()));
+        assetHashes.append(it.key());
+        offsets.append(quint64(file.pos()));
+        sizes.append(quint32(png.size()));
+        out.writeRawData(png.constData(), int(png.size()));
+    }
+    if (!copied) {
+        m_error = "Unable to read frames from the original project file";
+        file.cancelWriting();
+        return false;
+    }
+
+    const quint64 indexOffset = quint64(file.pos());
+    for (int i = 0; i < m_frames.size(); ++i) {
+        const ProjectFrameChunk& frame = m_frames[i];
+        out << qint32(frame.layer) << qint32(frame.keyframe) << qint32(frame.lastFrame)
+            << quint8(frame.hasTween ? HasTween : 0) << qint32(frame.tweenEnd)
+            << offsets[i] << sizes[i] << frame.easing.toUtf8();
+    }
+    out << quint32(assetHashes.size());
+    for (int i = 0; i < assetHashes.size(); ++i) {
+        const int entry = m_frames.size() + i;
+        out << assetHashes[i].toLatin1() << offsets[entry] << sizes[entry];
+    }
+
+    file.seek(0);
+    writeHeader(out, layoutOffset, quint32(layout.size()), indexOffset, quint32(m_frames.size()));
+
+    if (out.status() != QDataStream::Ok) {
+        m_error = file.errorString();
+        file.cancelWriting();
+        return false;
+    }
+    // Flushed to disk before the rename over the previous file
+    for (auto it = moved.constBegin(); it != moved.constEnd(); ++it) {
+        it.key()->beginReplace(it.value());
+    }
+    const bool committed = file.commit();
+    for (auto it = moved.constBegin(); it != moved.constEnd(); ++it) {
+        it.key()->endReplace(committed, it.value());
+    }
+    if (!committed) {
+        m_error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+QJsonObject ProjectContainer::canvasJson() const
+{
+    return m_layout.contains("canvas") ? m_layout.value("canvas").toObject() : m_layout;
+}
+
+QByteArray ProjectContainer::encodeItems(const QJsonArray& items)
+{
+    return encodeChunk(QCborArray::fromJsonArray(items).toCborValue().toCbor());
+}
+
+QJsonArray ProjectContainer::decodeItems(const QByteArray& chunk)
+{
+    QCborParserError parseError;
+    const QCborValue items = QCborValue::fromCbor(decodeChunk(chunk), &parseError);
+    if (parseError.error != QCborError::NoError || !items.isArray()) {
+        qDebug() << "ProjectContainer: damaged frame chunk:" << parseError.errorString();
+        return QJsonArray();
+    }
+    return items.toArray().toJsonArray();
+}
+
+QByteArray ProjectContainer::encodeChunk(const QByteArray& payload)
+{
+    QByteArray compressed;
+    if (payload.size() >= kCompressThreshold) {
+        compressed = qCompress(payload);
+    }
+
+    QByteArray chunk;
+    if (!compressed.isEmpty() && compressed.size() < payload.size()) {
+        chunk.reserve(compressed.size() + 1);
+        chunk.append(char(CompressedCbor));
+        chunk.append(compressed);
+    }
+    else {
+        chunk.reserve(payload.size() + 1);
+        chunk.append(char(Cbor));
+        chunk.append(payload);
+    }
+    return chunk;
+}
+
+QByteArray ProjectContainer::decodeChunk(const QByteArray& chunk)
+{
+    if (chunk.isEmpty()) {
+        return QByteArray();
+    }
+
+    const QByteArray payload = QByteArray::fromRawData(chunk.constData() + 1, chunk.size() - 1);
+    switch (quint8(chunk.at(0))) {
+    case Cbor:
+        return QByteArray(payload.constData(), payload.size());
+    case CompressedCbor:
+        return qUncompress(payload);
+    }
+    return QByteArray();
+}
@@ -0,0 +1,113 @@
+// ProjectContainer.h - Chunked binary project file with a per-frame index
+#ifndef PROJECTCONTAINER_H
+#define PROJECTCONTAINER_H
+
+#include "Common/EncodedChunk.h"
+#include <QByteArray>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+
+class ProjectFile;
+
+// One (layer, keyframe) chunk: the span's timing, which the index carries,
+// and its items. Held frames share their keyframe's chunk.
+struct ProjectFrameChunk {
+    int layer = 0;
+    int keyframe = 0;
+    int lastFrame = 0;
+    bool hasTween = false;
+    int tweenEnd = -1;
+    QString easing = "linear";
+
+    // Items to encode when the chunk is written...
+    QJsonArray items;
+    // ...or the chunk as already encoded, copied through unchanged. Spans
+    // never decoded since the project was opened are saved this way. Chunks
+    // read() returns are an offset and size into the still open file.
+    FrameDirector::EncodedChunk data;
+};
+
+// Binary project file. JSON projects parse the whole document and build
+// every frame's items before the first frame shows; here only the header,
+// the layout and the index are read up front. The file then stays open
+// (mapped where possible) for as long as a chunk or asset refers to it, and
+// each frame's items are read and decoded when the canvas first looks at
+// that frame.
+//
+// File layout, little-endian:
+//   header   "FDRP", version, flags, layout offset and size, index offset and count
+//   layout   the project without frame content: canvas size, layer table,
+//            audio and raster editor settings, as CBOR
+//   chunks   one per (layer, keyframe), see ProjectFrameChunk
+//   assets   the PNG of each embedded pixmap, once, see Common/PixmapAssets.h
+//   index    per chunk: layer, keyframe, last held frame, tween, offset, size;
+//            then per asset: hash, offset, size (version 2 on)
+// Every chunk begins with an encoding byte: plain CBOR, or CBOR compressed
+// with zlib when that is smaller.
+//
+// read() also accepts the older JSON projects, see isJson.
+class ProjectContainer
+{
+public:
+    static const quint16 Version = 2;
+
+    // True when the file starts with the container's magic
+    static bool isContainer(const QString& fileName);
+
+    // Reads the header, layout and index; chunks and assets are left in the
+    // file, see ProjectFrameChunk::data
+    bool read(const QString& fileName);
+    // Encodes the chunks that still need it, a thread per layer, and writes
+    // the file through QSaveFile, so a failed save leaves the previous file
+    // intact. Saving over the open project moves the chunks still in it to
+    // the new file, see ChunkSource::beginReplace. Safe to call from a job.
+    bool write(const QString& fileName) const;
+
+    // For JSON projects, the whole document; frame content is then inside
+    // the canvas object rather than in frames()
+    bool isJson() const { return m_json; }
+
+    // Project root: "canvas" (layer table without frames), "audioFile",
+    // "audioFrameLength" and "rasterEditor", as MainWindow writes them
+    QJsonObject layout() const { return m_layout; }
+    void setLayout(const QJsonObject& layout) { m_layout = layout; }
+    // The canvas object; JSON projects older than the "canvas" key are the
+    // canvas itself
+    QJsonObject canvasJson() const;
+
+    const QVector<ProjectFrameChunk>& frames() const { return m_frames; }
+    void setFrames(const QVector<ProjectFrameChunk>& frames) { m_frames = frames; }
+
+    // Embedded pixmaps' PNG bytes by content hash
+    QHash<QString, FrameDirector::EncodedChunk> assets() const { return m_assets; }
+    void setAssets(const QHash<QString, FrameDirector::EncodedChunk>& assets) { m_assets = assets; }
+
+    QString errorString() const { return m_error; }
+
+    static QByteArray encodeItems(const QJsonArray& items);
+    // Empty for a damaged chunk
+    static QJsonArray decodeItems(const QByteArray& chunk);
+
+private:
+    enum Encoding : quint8 {
+        Cbor = 0,
+        CompressedCbor = 1
+    };
+
+    bool readJson(const QByteArray& data);
+    bool readContainer(const std::shared_ptr<ProjectFile>& file, qint64 size);
+
+    static QByteArray encodeChunk(const QByteArray& payload);
+    static QByteArray decodeChunk(const QByteArray& chunk);
+
+    QJsonObject m_layout;
+    QVector<ProjectFrameChunk> m_frames;
+    QHash<QString, FrameDirector::EncodedChunk> m_assets;
+    bool m_json = false;
+    mutable QString m_error;
+};
+
+#endif // PROJECTCONTAINER_H
@@ -563,7 +563,13 @@ QImage RasterDocument::flattenFrame(int frameIndex) const
 
 QJsonObject RasterDocument::toJson() const
 {
-    QJsonObject root;
+    return captureState().toJson();
+}
+
+RasterDocumentState RasterDocument::captureState() const
+{
+    RasterDocumentState state;
+    QJsonObject& root = state.json;
     root[QStringLiteral("canvasWidth")] = m_canvasSize.width();
     root[QStringLiteral("canvasHeight")] = m_canvasSize.height();
     root[QStringLiteral("frameCount")] = m_frameCount;
@@ -584,13 +590,34 @@ QJsonObject RasterDocument::toJson() const
         layerObject[QStringLiteral("offsetX")] = layer.offset().x();
         layerObject[QStringLiteral("offsetY")] = layer.offset().y();
 
-        QJsonArray framesArray;
+        QVector<QImage> images;
         const int frameLimit = qMin(layer.frameCount(), m_frameCount);
         for (int frame = 0; frame < frameLimit; ++frame) {
+            images.append(layer.frameAt(frame).image());
+        }
+
+        layerArray.append(layerObject);
+        state.frames.append(images);
+    }
+
+    root[QStringLiteral("layers")] = layerArray;
+    return state;
+}
+
+QJsonObject RasterDocumentState::toJson() const
+{
+    QJsonObject root = json;
+    QJsonArray layerArray = root.value(QStringLiteral("layers")).toArray();
+    for (int layerIndex = 0; layerIndex < layerArray.size() && layerIndex < frames.size(); ++layerIndex) {
+        QJsonObject layerObject = layerArray[layerIndex].toObject();
+
+        QJsonArray framesArray;
+        const QVector<QImage>& images = frames[layerIndex];
+        for (int frame = 0; frame < images.size(); ++frame) {
             QJsonObject frameObject;
             frameObject[QStringLiteral("index")] = frame;
 
-            const QImage& image = layer.frameAt(frame).image();
+            const QImage& image = images[frame];
             if (!image.isNull() && !image.size().isEmpty()) {
                 QImage exportImage = image;
                 if (exportImage.format() != QImage::Format_ARGB32_Premultiplied) {
@@ -608,13 +635,33 @@ QJsonObject RasterDocument::toJson() const
         }
 
         layerObject[QStringLiteral("frames")] = framesArray;
-        layerArray.append(layerObject);
+        layerArray[layerIndex] = layerObject;
     }
 
     root[QStringLiteral("layers")] = layerArray;
     return root;
 }
 
+bool RasterDocumentState::sharesFrames(const RasterDocumentState& other) const
+{
+    if (json != other.json || frames.size() != other.frames.size()) {
+        return false;
+    }
+    for (int layerIndex = 0; layerIndex < frames.size(); ++layerIndex) {
+        const QVector<QImage>& images = frames[layerIndex];
+        const QVector<QImage>& otherImages = other.frames[layerIndex];
+        if (images.size() != otherImages.size()) {
+            return false;
+        }
+        for (int frame = 0; frame < images.size(); ++frame) {
+            if (images[frame].cacheKey() != otherImages[frame].cacheKey()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 bool RasterDocument::fromJson(const QJsonObject& json)
 {
     if (json.isEmpty()) {
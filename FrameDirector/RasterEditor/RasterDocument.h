@@ -74,6 +74,20 @@ struct RasterLayerDescriptor
     QVector<QImage> frames;
 };
 
+// A document captured as values, for saving on another thread. Frame
+// images are implicitly shared with the live document, which detaches them
+// when it next paints, so capturing copies no pixels.
+struct RasterDocumentState
+{
+    QJsonObject json;                   // RasterDocument::toJson() without the frames' "data"
+    QVector<QVector<QImage>> frames;    // Per layer, per frame
+
+    // PNG-encodes the frames; any thread
+    QJsonObject toJson() const;
+    // Same settings and the same, undetached frame images
+    bool sharesFrames(const RasterDocumentState& other) const;
+};
+
 class RasterDocument : public QObject
 {
     Q_OBJECT
@@ -128,6 +142,7 @@ public:
     QImage flattenFrame(int frameIndex) const;
 
     QJsonObject toJson() const;
+    RasterDocumentState captureState() const;
     bool fromJson(const QJsonObject& json);
 
 signals:
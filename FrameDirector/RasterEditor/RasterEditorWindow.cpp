@@ -1067,10 +1067,9 @@ void RasterEditorWindow::onExportToTimeline()
     pixmapItem->setData(0, 1.0);
     pixmapItem->setOpacity(1.0);
 
-    const QByteArray documentState = serializeDocumentState();
-    if (!documentState.isEmpty()) {
-        pixmapItem->setData(GraphicsItemRoles::RasterDocumentJsonRole, documentState);
-    }
+    // The document goes into the project's session table once; exported
+    // items only name their session. Its frames are encoded by the next save.
+    m_canvas->setRasterSession(m_sessionId, m_document->captureState());
     pixmapItem->setData(GraphicsItemRoles::RasterSessionIdRole, m_sessionId);
     pixmapItem->setData(GraphicsItemRoles::RasterFrameIndexRole, projectFrame);
 
@@ -1138,13 +1137,16 @@ void RasterEditorWindow::setProjectContext(MainWindow* mainWindow, Canvas* canva
         connect(m_document, &RasterDocument::documentReset, m_onionProvider, &RasterOnionSkinProvider::invalidate, Qt::UniqueConnection);
     }
 
+    // Project edits drop just the snapshots of the frames they touched
+    if (m_canvas && m_onionProvider) {
+        connect(m_canvas, &Canvas::changeSetReady, m_onionProvider, &RasterOnionSkinProvider::invalidateChanges, Qt::UniqueConnection);
+    }
+
     if (!m_projectContextInitialized) {
         if (m_canvas) {
             connect(m_canvas, &Canvas::layerAdded, this, &RasterEditorWindow::onProjectLayersChanged, Qt::UniqueConnection);
             connect(m_canvas, &Canvas::layerRemoved, this, &RasterEditorWindow::onProjectLayersChanged, Qt::UniqueConnection);
             connect(m_canvas, &Canvas::layerNameChanged, this, &RasterEditorWindow::onProjectLayerRenamed, Qt::UniqueConnection);
-            connect(m_canvas, &Canvas::layerVisibilityChanged, this, &RasterEditorWindow::onProjectLayerAppearanceChanged, Qt::UniqueConnection);
-            connect(m_canvas, &Canvas::layerOpacityChanged, this, &RasterEditorWindow::onProjectLayerAppearanceChanged, Qt::UniqueConnection);
             connect(m_canvas, &Canvas::keyframeCreated, this, &RasterEditorWindow::onProjectFrameStructureChanged, Qt::UniqueConnection);
             connect(m_canvas, &Canvas::frameExtended, this, &RasterEditorWindow::onProjectFrameStructureChanged, Qt::UniqueConnection);
         }
@@ -1199,24 +1201,11 @@ void RasterEditorWindow::onProjectLayerRenamed(int index, const QString& name)
     Q_UNUSED(name);
     Q_UNUSED(index);
     syncProjectLayers();
-    if (m_onionProvider) {
-        m_onionProvider->invalidate();
-    }
     refreshProjectMetadata();
 }
 
-void RasterEditorWindow::onProjectLayerAppearanceChanged()
-{
-    if (m_onionProvider) {
-        m_onionProvider->invalidate();
-    }
-}
-
 void RasterEditorWindow::onProjectFrameStructureChanged()
 {
-    if (m_onionProvider) {
-        m_onionProvider->invalidate();
-    }
     ensureDocumentFrameBounds();
     refreshProjectMetadata();
 }
@@ -1282,16 +1271,6 @@ QList<QGraphicsItem*> RasterEditorWindow::rasterItemsForFrame(int layerIndex, in
     return matches;
 }
 
-QByteArray RasterEditorWindow::serializeDocumentState() const
-{
-    if (!m_document) {
-        return QByteArray();
-    }
-
-    QJsonDocument doc(m_document->toJson());
-    return doc.toJson(QJsonDocument::Compact);
-}
-
 void RasterEditorWindow::refreshProjectMetadata()
 {
     updateLayerInfo();
@@ -1386,10 +1365,26 @@ int RasterEditorWindow::clampProjectFrame(int frame) const
 
 QJsonObject RasterEditorWindow::toJson() const
 {
-    QJsonObject json;
-    json[QStringLiteral("sessionId")] = m_sessionId;
+    return captureState().toJson();
+}
+
+RasterEditorWindow::State RasterEditorWindow::captureState() const
+{
+    State state;
+    state.sessionId = m_sessionId;
     if (m_document) {
-        json[QStringLiteral("document")] = m_document->toJson();
+        state.hasDocument = true;
+        state.document = m_document->captureState();
+    }
+    return state;
+}
+
+QJsonObject RasterEditorWindow::State::toJson() const
+{
+    QJsonObject json;
+    json[QStringLiteral("sessionId")] = sessionId;
+    if (hasDocument) {
+        json[QStringLiteral("document")] = document.toJson();
     }
     return json;
 }
@@ -50,6 +50,17 @@ public:
     void setProjectContext(MainWindow* mainWindow, Canvas* canvas, Timeline* timeline, LayerManager* layerManager);
     QJsonObject toJson() const;
     void loadFromJson(const QJsonObject& json);
+
+    // toJson() in two steps, so a save can encode the document's frames off
+    // the GUI thread: capture here, then State::toJson() on any thread
+    struct State {
+        QString sessionId;
+        bool hasDocument = false;
+        RasterDocumentState document;
+
+        QJsonObject toJson() const;
+    };
+    State captureState() const;
     void resetDocument();
 
 signals:
@@ -82,7 +93,6 @@ private slots:
     void onExportToTimeline();
     void onProjectLayersChanged();
     void onProjectLayerRenamed(int index, const QString& name);
-    void onProjectLayerAppearanceChanged();
     void onProjectFrameStructureChanged();
     void onTimelineLengthChanged(int frames);
     void onTimelineFrameChanged(int frame);
@@ -106,7 +116,6 @@ private:
     void ensureDocumentFrameBounds();
     int clampProjectFrame(int frame) const;
     QList<QGraphicsItem*> rasterItemsForFrame(int layerIndex, int frame) const;
-    QByteArray serializeDocumentState() const;
     void loadAvailableBrushes();
     void applyBrushPreset(int index);
 
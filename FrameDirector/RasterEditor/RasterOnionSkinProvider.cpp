@@ -51,7 +51,7 @@ QImage RasterOnionSkinProvider::frameSnapshot(int frame, const QVector<int>& lay
 
     auto it = m_cache.find(key);
     if (it != m_cache.end()) {
-        return it.value();
+        return it->image;
     }
 
     QImage snapshot;
@@ -63,7 +63,7 @@ QImage RasterOnionSkinProvider::frameSnapshot(int frame, const QVector<int>& lay
     }
 
     if (!snapshot.isNull()) {
-        m_cache.insert(key, snapshot);
+        m_cache.insert(key, CacheEntry{ frame, normalized, snapshot });
     }
 
     return snapshot;
@@ -75,6 +75,38 @@ void RasterOnionSkinProvider::invalidate()
     emit cacheInvalidated();
 }
 
+void RasterOnionSkinProvider::invalidateChanges(const FrameDirector::CanvasChangeSet& changes)
+{
+    if (changes.affectsAllFrames()) {
+        invalidate();
+        return;
+    }
+
+    bool removed = false;
+    for (auto it = m_cache.begin(); it != m_cache.end();) {
+        const CacheEntry& entry = it.value();
+        bool stale = entry.layers.isEmpty() && changes.touchesFrame(entry.frame);
+        for (int layer : entry.layers) {
+            if (stale) {
+                break;
+            }
+            stale = changes.touchesFrame(layer, entry.frame);
+        }
+
+        if (stale) {
+            it = m_cache.erase(it);
+            removed = true;
+        }
+        else {
+            ++it;
+        }
+    }
+
+    if (removed) {
+        emit cacheInvalidated();
+    }
+}
+
 QString RasterOnionSkinProvider::cacheKey(int frame, const QVector<int>& layers) const
 {
     return QString::number(frame) + QLatin1Char('|') + serializeLayers(layers);
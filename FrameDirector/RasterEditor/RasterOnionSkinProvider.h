@@ -1,5 +1,7 @@
 #pragma once
 
+#include "../Common/CanvasChangeSet.h"
+
 #include <QObject>
 #include <QHash>
 #include <QImage>
@@ -22,16 +24,24 @@ public:
 
 public slots:
     void invalidate();
+    // Drops only the snapshots showing a frame the change set touched
+    void invalidateChanges(const FrameDirector::CanvasChangeSet& changes);
 
 signals:
     void cacheInvalidated();
 
 private:
+    struct CacheEntry {
+        int frame = 0;
+        QVector<int> layers;    // Empty for all layers
+        QImage image;
+    };
+
     QString cacheKey(int frame, const QVector<int>& layers) const;
     QVector<int> normalizedLayers(const QVector<int>& layers) const;
 
     MainWindow* m_mainWindow;
     QVector<int> m_layerFilter;
-    mutable QHash<QString, QImage> m_cache;
+    mutable QHash<QString, CacheEntry> m_cache;
 };
 
@@ -29,10 +29,10 @@ void GradientFillTool::mousePressEvent(QMouseEvent* event, const QPointF& sceneP
                 QRectF bounds = shape->boundingRect();
                 QLinearGradient grad(bounds.topLeft(), bounds.topRight());
                 grad.setStops(chosen);
+                // setBrush repaints just this item
                 shape->setBrush(QBrush(grad));
             }
         }
-        m_canvas->scene()->update();
     }
 }
 
@@ -12,6 +12,7 @@
 #include <QByteArray>
 
 #include "MainWindow.h"
+#include "Animation/BatchRenderer.h"
 
 class FrameDirectorApplication : public QApplication
 {
@@ -98,6 +99,17 @@ private:
 
 int main(int argc, char* argv[])
 {
+    // Batch renders (--render) need no window system and skip the editor UI
+    if (BatchRenderer::isBatchCommandLine(argc, argv)) {
+        if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        }
+        QApplication app(argc, argv);
+        app.setApplicationName("FrameDirector");
+        app.setApplicationVersion("1.0.0");
+        return BatchRenderer::exec(app.arguments());
+    }
+
     // Create application
     FrameDirectorApplication app(argc, argv);
 